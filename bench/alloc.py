@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+# Object allocation microbenchmark.
+#
+# Generates one main class per kind of object, each running a loop that
+# creates N objects of that kind and drops them right away, plus a class
+# running the same loop without creating objects. The cost of each
+# allocation is the time per iteration of its loop minus the time per
+# iteration of the empty loop. Times are the best of several runs, as
+# reported by "-t". The peak resident memory of each run is also printed,
+# and the heap bytes taken by each object, header included, as counted by
+# one more run with "-allocprof".
+#
+# Usage: python3 bench/alloc.py [jvm binary] [N] [runs]
+# Must be run from the repository root, so java/lang/Object.class is found.
+
+import os
+import re
+import shutil
+import struct
+import sys
+import tempfile
+
+from classfile import ConstantPool, class_file, counted_loop
+from common import run, reported_seconds
+
+DEFAULT_COUNT = 2000000
+DEFAULT_RUNS = 5
+
+# Bodies of the loops: (class name, description, function building the code)
+CASES = [
+    ('AllocEmpty', 'empty loop', lambda cp: b''),
+    # new AllocNode; pop
+    ('AllocInstance', 'instance, 4 fields', lambda cp: b'\xbb' + struct.pack('>H', cp.klass('AllocNode')) + b'\x57'),
+    # bipush 16; newarray int; pop
+    ('AllocIntArray', 'int[16]', lambda cp: b'\x10\x10\xbc\x0a\x57'),
+    # iconst_4; anewarray java/lang/Object; pop
+    ('AllocObjectArray', 'Object[4]', lambda cp: b'\x07\xbd' + struct.pack('>H', cp.klass('java/lang/Object')) + b'\x57'),
+    # ldc "allocation"; pop
+    ('AllocString', 'string, 10 chars', lambda cp: b'\x12' + bytes([cp.string('allocation')]) + b'\x57'),
+]
+
+
+def generate_node(directory):
+    """Writes the class with 4 fields created by the instance case."""
+    fields = [(0x0001, 'f%d' % i, 'I') for i in range(4)]
+
+    with open(os.path.join(directory, 'AllocNode.class'), 'wb') as f:
+        f.write(class_file('AllocNode', 'java/lang/Object', [], fields=fields))
+
+
+def generate(directory, count):
+    generate_node(directory)
+
+    for name, description, body in CASES:
+        # public static void main(String[]) { for (int i = 0; i < count; i++) { body } }
+        cp = ConstantPool()
+        code = counted_loop(cp, body(cp), count) + b'\xb1'
+
+        with open(os.path.join(directory, name + '.class'), 'wb') as f:
+            f.write(class_file(name, 'java/lang/Object',
+                               [(0x0009, 'main', '([Ljava/lang/String;)V', 2, code)], cp))
+
+
+def bytes_per_object(jvm, path, directory):
+    """Runs a class with "-allocprof", returning the average heap bytes of the objects it created."""
+    output, peak_kb = run(jvm, path, ['-allocprof', os.path.join(directory, 'allocations.csv')])
+    allocated = re.search(r'(\d+) objects \((\d+)K\) allocated', output)
+
+    if not allocated or int(allocated.group(1)) == 0:
+        return None
+
+    return 1024.0 * int(allocated.group(2)) / int(allocated.group(1))
+
+
+def main():
+    jvm = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else './jvm.exe')
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else DEFAULT_COUNT
+    runs = int(sys.argv[3]) if len(sys.argv) > 3 else DEFAULT_RUNS
+    directory = tempfile.mkdtemp(prefix='alloc')
+    baseline = None
+
+    print('%-20s %12s %14s %14s %10s %12s' % ('object', 'seconds', 'ns per loop', 'ns per alloc', 'peak KB',
+                                              'bytes/object'))
+
+    try:
+        generate(directory, count)
+
+        for name, description, body in CASES:
+            path = os.path.join(directory, name + '.class')
+            results = [run(jvm, path) for i in range(runs)]
+            times = [reported_seconds(output) for output, peak_kb in results]
+            times = [seconds for seconds in times if seconds is not None]
+
+            if not times:
+                print('%-20s %12s' % (description, 'failed'))
+                continue
+
+            best = min(times)
+            per_loop = 1e9 * best / count
+            baseline = per_loop if baseline is None else baseline
+            size = bytes_per_object(jvm, path, directory)
+            print('%-20s %12.6f %14.2f %14.2f %10d %12s' % (description, best, per_loop, per_loop - baseline,
+                                                            max(peak_kb for output, peak_kb in results),
+                                                            '%.1f' % size if size is not None else '-'))
+    finally:
+        shutil.rmtree(directory)
+
+
+if __name__ == '__main__':
+    main()
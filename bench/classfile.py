@@ -0,0 +1,88 @@
+# Minimal class file writer shared by the benchmark generators.
+
+import struct
+
+
+class ConstantPool:
+    def __init__(self):
+        self.entries = []
+        self.indexes = {}
+
+    def add(self, key, data):
+        if key not in self.indexes:
+            self.entries.append(data)
+            self.indexes[key] = len(self.entries)
+        return self.indexes[key]
+
+    def utf8(self, text):
+        data = text.encode()
+        return self.add(('Utf8', text), b'\x01' + struct.pack('>H', len(data)) + data)
+
+    def integer(self, value):
+        return self.add(('Integer', value), b'\x03' + struct.pack('>i', value))
+
+    def string(self, text):
+        return self.add(('String', text), b'\x08' + struct.pack('>H', self.utf8(text)))
+
+    def klass(self, name):
+        return self.add(('Class', name), b'\x07' + struct.pack('>H', self.utf8(name)))
+
+    def name_and_type(self, name, descriptor):
+        return self.add(('NameAndType', name, descriptor),
+                        b'\x0c' + struct.pack('>HH', self.utf8(name), self.utf8(descriptor)))
+
+    def fieldref(self, klass, name, descriptor):
+        return self.add(('Fieldref', klass, name, descriptor),
+                        b'\x09' + struct.pack('>HH', self.klass(klass), self.name_and_type(name, descriptor)))
+
+    def methodref(self, klass, name, descriptor):
+        return self.add(('Methodref', klass, name, descriptor),
+                        b'\x0a' + struct.pack('>HH', self.klass(klass), self.name_and_type(name, descriptor)))
+
+    def to_bytes(self):
+        return struct.pack('>H', len(self.entries) + 1) + b''.join(self.entries)
+
+
+def class_file(name, super_name, methods, cp=None, fields=(), interfaces=(), access_flags=0x21):
+    """Builds a class file.
+
+    methods is a list of (flags, name, descriptor, max_stack, code), where
+    max_locals is always 2, optionally followed by the exception table, a list
+    of (start_pc, end_pc, handler_pc, catch_type), where catch_type is a class
+    constant index or 0. fields is a list of (flags, name, descriptor) and
+    interfaces is a list of the names of the implemented interfaces.
+    """
+    cp = cp or ConstantPool()
+    this_index = cp.klass(name)
+    super_index = cp.klass(super_name)
+    interface_indexes = [cp.klass(interface) for interface in interfaces]
+    code_index = cp.utf8('Code')
+    field_bytes = b''
+    method_bytes = b''
+
+    for flags, field_name, descriptor in fields:
+        field_bytes += struct.pack('>HHHH', flags, cp.utf8(field_name), cp.utf8(descriptor), 0)
+
+    for method in methods:
+        flags, method_name, descriptor, max_stack, code = method[:5]
+        handlers = method[5] if len(method) > 5 else ()
+        attribute = struct.pack('>HHI', max_stack, 2, len(code)) + code + struct.pack('>H', len(handlers))
+        attribute += b''.join(struct.pack('>HHHH', *handler) for handler in handlers) + struct.pack('>H', 0)
+        method_bytes += struct.pack('>HHHH', flags, cp.utf8(method_name), cp.utf8(descriptor), 1)
+        method_bytes += struct.pack('>HI', code_index, len(attribute)) + attribute
+
+    data = b'\xca\xfe\xba\xbe' + struct.pack('>HH', 0, 46) + cp.to_bytes()
+    data += struct.pack('>HHH', access_flags, this_index, super_index)
+    data += struct.pack('>H', len(interfaces)) + b''.join(struct.pack('>H', index) for index in interface_indexes)
+    data += struct.pack('>H', len(fields)) + field_bytes
+    data += struct.pack('>H', len(methods)) + method_bytes + struct.pack('>H', 0)
+    return data
+
+
+def counted_loop(cp, body, count):
+    """Returns the code of a loop running body count times, with the counter in
+    local variable 1: for (int i = 0; i < count; i++) { body }. The body must
+    leave the operand stack as it found it."""
+    # iconst_0; istore_1; loop: body; iinc 1, 1; iload_1; ldc_w count; if_icmplt loop
+    loop = body + b'\x84\x01\x01\x1b\x13' + struct.pack('>H', cp.integer(count))
+    return b'\x03\x3c' + loop + b'\xa1' + struct.pack('>h', -len(loop))
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+# Class loading stress benchmark.
+#
+# Generates a main class that invokes a static method of each of N synthetic
+# classes, so running it resolves N + 1 classes. Every class extends the one
+# generated before it, in chains of CHAIN_LENGTH classes, so resolution also
+# walks super classes. The run is repeated for increasing values of N and the
+# time reported by "-t" is printed for each one, showing how resolution
+# time scales with the number of loaded classes.
+#
+# Each run is made four times: with the classes as loose files in a
+# directory, packed in a JAR, either stored or deflated (see the "-cp"
+# option), and opened from a class archive written by an extra directory run
+# (see the "-archive" and "-dumparchive" options).
+#
+# Usage: python3 bench/classload.py [jvm binary] [N...]
+# Must be run from the repository root, so java/lang/Object.class is found.
+
+import os
+import re
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import zipfile
+
+from classfile import ConstantPool, class_file
+
+CHAIN_LENGTH = 8
+DEFAULT_COUNTS = [500, 1000, 2000, 4000, 8000]
+
+
+def generate(directory, count):
+    for i in range(count):
+        name = 'C%d' % i
+        super_name = 'C%d' % (i - 1) if i % CHAIN_LENGTH else 'java/lang/Object'
+        # public static void f() { return; }
+        code = b'\xb1'
+        with open(os.path.join(directory, name + '.class'), 'wb') as f:
+            f.write(class_file(name, super_name, [(0x0009, 'f', '()V', 0, code)]))
+
+    # public static void main(String[]) { C0.f(); C1.f(); ...; return; }
+    cp = ConstantPool()
+    code = b''.join(b'\xb8' + struct.pack('>H', cp.methodref('C%d' % i, 'f', '()V')) for i in range(count))
+    code += b'\xb1'
+
+    with open(os.path.join(directory, 'ClassLoad.class'), 'wb') as f:
+        f.write(class_file('ClassLoad', 'java/lang/Object',
+                           [(0x0009, 'main', '([Ljava/lang/String;)V', 0, code)], cp))
+
+
+def make_jar(directory, count, compression):
+    path = os.path.join(directory, 'classes-%d.jar' % compression)
+
+    with zipfile.ZipFile(path, 'w', compression) as jar:
+        for name in ['ClassLoad'] + ['C%d' % i for i in range(count)]:
+            jar.write(os.path.join(directory, name + '.class'), name + '.class')
+
+    return path
+
+
+def run(jvm, arguments, count):
+    """Runs the benchmark class, returning the time reported by "-t", or None if it failed."""
+    output = subprocess.run([jvm] + arguments + ['-e', '-t'], input='Y\n', capture_output=True, text=True).stdout
+    loaded = re.search(r'Loaded (\d+) classes', output)
+    seconds = re.search(r'in ([0-9.]+) seconds', output)
+
+    if not loaded or not seconds or int(loaded.group(1)) < count + 1:
+        return None
+
+    return float(seconds.group(1))
+
+
+def main():
+    jvm = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else './jvm.exe')
+    counts = [int(n) for n in sys.argv[2:]] or DEFAULT_COUNTS
+    separator = ';' if os.name == 'nt' else ':'
+
+    print('%8s %12s %16s %16s %16s %16s' % ('classes', 'seconds', 'us per class', 'stored jar', 'deflated jar',
+                                             'archive'))
+
+    for count in counts:
+        directory = tempfile.mkdtemp(prefix='classload')
+
+        try:
+            generate(directory, count)
+            stored = make_jar(directory, count, zipfile.ZIP_STORED)
+            deflated = make_jar(directory, count, zipfile.ZIP_DEFLATED)
+            archive = os.path.join(directory, 'classes.jsa')
+            main_class = os.path.join(directory, 'ClassLoad.class')
+
+            # java/lang/Object is found in the current directory
+            times = [run(jvm, [main_class], count),
+                     run(jvm, ['ClassLoad', '-cp', stored + separator + '.'], count),
+                     run(jvm, ['ClassLoad', '-cp', deflated + separator + '.'], count)]
+
+            run(jvm, [main_class, '-dumparchive', archive], count)
+            times.append(run(jvm, [main_class, '-archive', archive], count))
+        finally:
+            shutil.rmtree(directory)
+
+        columns = ['%16.2f' % (1e6 * elapsed / count) if elapsed is not None else '%16s' % 'failed'
+                   for elapsed in times]
+        print('%8d %12s %s' % (count, '%.6f' % times[0] if times[0] is not None else 'failed', ' '.join(columns)))
+
+
+if __name__ == '__main__':
+    main()
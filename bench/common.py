@@ -0,0 +1,32 @@
+# Helpers shared by the benchmark scripts to run the JVM.
+
+import os
+import re
+import subprocess
+
+
+def run(jvm, path, arguments=()):
+    """Runs a class with "-e -t", answering "Y" if it reads its input.
+    Returns its output and the peak resident memory of the process, in KB,
+    as reported by "-t" or, where that isn't available, by the system."""
+    process = subprocess.Popen([jvm, path, '-e', '-t'] + list(arguments), stdin=subprocess.PIPE,
+                               stdout=subprocess.PIPE, universal_newlines=True, errors='replace')
+
+    # Programs that don't read their input may exit before it is written
+    try:
+        process.stdin.write('Y\n')
+        process.stdin.close()
+    except BrokenPipeError:
+        pass
+
+    output = process.stdout.read()
+    process.stdout.close()
+    pid, process.returncode, usage = os.wait4(process.pid, 0)
+    peak = re.search(r'Peak resident memory: (\d+)K', output)
+    return output, int(peak.group(1)) if peak else usage.ru_maxrss
+
+
+def reported_seconds(output):
+    """Returns the execution time reported by "-t", or None if the program failed."""
+    seconds = re.search(r'in ([0-9.]+) seconds', output)
+    return float(seconds.group(1)) if seconds and 'Status:' not in output else None
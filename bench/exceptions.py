@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+# Exception microbenchmark.
+#
+# Generates one class per case, each running a loop N times. The first loop
+# does nothing, the second does the same inside a try block that is never left
+# by an exception, and the others create and throw a RuntimeException on each
+# iteration, caught either in the same method or after unwinding the frame of
+# the method that threw it. Handlers are only looked up when an exception is
+# thrown, so the loop inside the try block should take as long as the loop
+# without it. Times are the best of several runs, as reported by "-t".
+#
+# Usage: python3 bench/exceptions.py [jvm binary] [N] [runs]
+# Must be run from the repository root, so java/lang/Object.class is found.
+
+import os
+import shutil
+import struct
+import sys
+import tempfile
+
+from classfile import ConstantPool, class_file, counted_loop
+from common import run, reported_seconds
+
+DEFAULT_COUNT = 1000000
+DEFAULT_RUNS = 5
+
+
+def throw(cp):
+    # throw new RuntimeException();
+    return (b'\xbb' + struct.pack('>H', cp.klass('java/lang/RuntimeException')) + b'\x59\xb7' +
+            struct.pack('>H', cp.methodref('java/lang/RuntimeException', '<init>', '()V')) + b'\xbf')
+
+
+def invoke_thrower(cp):
+    return b'\xb8' + struct.pack('>H', cp.methodref('ExceptUnwind', 'thrower', '()V'))
+
+
+# Cases: (class name, description, function building the body of the loop,
+# whether the body is inside a try block, whether the body throws an exception)
+CASES = [
+    ('ExceptNone', 'no try block', lambda cp: b'\x1b\x57', False, False),
+    ('ExceptTry', 'try, nothing thrown', lambda cp: b'\x1b\x57', True, False),
+    ('ExceptCatch', 'throw and catch', throw, True, True),
+    ('ExceptUnwind', 'throw from a call', invoke_thrower, True, True),
+]
+
+
+def generate(directory, name, body, catches, throws, count):
+    cp = ConstantPool()
+    catch = cp.klass('java/lang/RuntimeException')
+    methods = [(0x0009, 'thrower', '()V', 2, throw(cp))]
+
+    # for (int i = 0; i < count; i++) { try { body } catch (RuntimeException e) {} }
+    # The body starts right after "i = 0", and a handler that is never used is
+    # placed after the loop for bodies that don't throw
+    loop = body(cp)
+    start = 2
+    end = start + len(loop)
+
+    if throws:
+        loop += b'\x57'
+
+    code = counted_loop(cp, loop, count) + b'\xb1'
+    handler = end if throws else len(code)
+
+    if not throws:
+        code += b'\x57\xb1'
+
+    handlers = [(start, end, handler, catch)] if catches else []
+    methods.append((0x0009, 'main', '([Ljava/lang/String;)V', 4, code, handlers))
+
+    with open(os.path.join(directory, name + '.class'), 'wb') as f:
+        f.write(class_file(name, 'java/lang/Object', methods, cp))
+
+
+def main():
+    jvm = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else './jvm.exe')
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else DEFAULT_COUNT
+    runs = int(sys.argv[3]) if len(sys.argv) > 3 else DEFAULT_RUNS
+    directory = tempfile.mkdtemp(prefix='exceptions')
+    baseline = None
+
+    print('%-22s %12s %14s %14s' % ('case', 'seconds', 'ns per loop', 'ns over none'))
+
+    try:
+        for name, description, body, catches, throws in CASES:
+            generate(directory, name, body, catches, throws, count)
+
+        for name, description, body, catches, throws in CASES:
+            class_path = ['-cp', '%s%s.' % (directory, os.pathsep)]
+            times = [reported_seconds(run(jvm, os.path.join(directory, name + '.class'), class_path)[0])
+                     for i in range(runs)]
+            times = [seconds for seconds in times if seconds is not None]
+
+            if not times:
+                print('%-22s %12s' % (description, 'failed'))
+                continue
+
+            per_loop = 1e9 * min(times) / count
+            baseline = per_loop if baseline is None else baseline
+            print('%-22s %12.6f %14.2f %14.2f' % (description, min(times), per_loop, per_loop - baseline))
+    finally:
+        shutil.rmtree(directory)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,71 @@
+#!/usr/bin/env python3
+# Member lookup microbenchmark.
+#
+# Generates classes that declare M static methods each, for increasing values
+# of M, whose main method calls the last declared method N times in a loop.
+# invokestatic finds the invoked method by its name and descriptor the first
+# time it runs, and calls it directly afterwards, so the time per call shows
+# the cost of invoking a static method, which shouldn't grow with the number
+# of methods of its class. Times are the best of several runs, as reported
+# by "-t".
+#
+# Usage: python3 bench/members.py [jvm binary] [N] [runs]
+# Must be run from the repository root, so java/lang/Object.class is found.
+
+import os
+import shutil
+import struct
+import sys
+import tempfile
+
+from classfile import ConstantPool, class_file, counted_loop
+from common import run, reported_seconds
+
+DEFAULT_COUNT = 1000000
+DEFAULT_RUNS = 5
+MEMBER_COUNTS = [1, 10, 100, 1000]
+
+
+def generate(directory, members, count):
+    name = 'Members%d' % members
+    cp = ConstantPool()
+
+    # public static void m<i>() { return; }
+    methods = [(0x0009, 'm%d' % i, '()V', 0, b'\xb1') for i in range(members)]
+
+    # public static void main(String[]) { for (int i = 0; i < count; i++) m<members - 1>(); }
+    call = b'\xb8' + struct.pack('>H', cp.methodref(name, 'm%d' % (members - 1), '()V'))
+    code = counted_loop(cp, call, count) + b'\xb1'
+    methods.append((0x0009, 'main', '([Ljava/lang/String;)V', 2, code))
+
+    with open(os.path.join(directory, name + '.class'), 'wb') as f:
+        f.write(class_file(name, 'java/lang/Object', methods, cp))
+
+    return os.path.join(directory, name + '.class')
+
+
+def main():
+    jvm = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else './jvm.exe')
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else DEFAULT_COUNT
+    runs = int(sys.argv[3]) if len(sys.argv) > 3 else DEFAULT_RUNS
+    directory = tempfile.mkdtemp(prefix='members')
+
+    print('%8s %12s %14s' % ('methods', 'seconds', 'ns per call'))
+
+    try:
+        for members in MEMBER_COUNTS:
+            path = generate(directory, members, count)
+            times = [reported_seconds(run(jvm, path)[0]) for i in range(runs)]
+            times = [seconds for seconds in times if seconds is not None]
+
+            if not times:
+                print('%8d %12s' % (members, 'failed'))
+                continue
+
+            print('%8d %12.6f %14.2f' % (members, min(times), 1e9 * min(times) / count))
+    finally:
+        shutil.rmtree(directory)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# Class file parsing throughput benchmark.
+#
+# Parses every class file of the examples and test files folders N times
+# in a row with the "-p" option, which opens and closes the class without
+# printing or executing it, and reports how many megabytes of class files
+# are parsed per second, for each file and for the whole corpus. Times are
+# the best of several runs.
+#
+# Usage: python3 bench/parse.py [jvm binary] [N] [runs]
+# Must be run from the repository root.
+
+import glob
+import os
+import re
+import subprocess
+import sys
+
+DEFAULT_REPETITIONS = 2000
+DEFAULT_RUNS = 3
+CORPUS = ['examples/*.class', 'test files/*.class']
+
+
+def run(jvm, path, repetitions):
+    """Parses a class file, returning the number of bytes parsed and the time it took."""
+    output = subprocess.run([jvm, path, '-p', str(repetitions)], stdout=subprocess.PIPE,
+                            stdin=subprocess.DEVNULL, universal_newlines=True).stdout
+    match = re.search(r'Parsed ([0-9]+) bytes in ([0-9.]+) seconds', output)
+    return (int(match.group(1)), float(match.group(2))) if match else (None, None)
+
+
+def main():
+    jvm = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else './jvm.exe')
+    repetitions = int(sys.argv[2]) if len(sys.argv) > 2 else DEFAULT_REPETITIONS
+    runs = int(sys.argv[3]) if len(sys.argv) > 3 else DEFAULT_RUNS
+    files = sorted(path for pattern in CORPUS for path in glob.glob(pattern))
+    total_bytes = 0
+    total_seconds = 0.0
+
+    print('%-40s %10s %12s %10s' % ('class file', 'bytes', 'seconds', 'MB/s'))
+
+    for path in files:
+        results = [run(jvm, path, repetitions) for i in range(runs)]
+        results = [(parsed, seconds) for parsed, seconds in results if parsed is not None]
+
+        if not results:
+            print('%-40s %10d %12s' % (path, os.path.getsize(path), 'failed'))
+            continue
+
+        parsed, seconds = min(results, key=lambda result: result[1])
+        total_bytes += parsed
+        total_seconds += seconds
+        print('%-40s %10d %12.6f %10.2f' % (path, os.path.getsize(path), seconds,
+                                            parsed / seconds / 2 ** 20 if seconds > 0 else 0))
+
+    if total_seconds > 0:
+        print('%-40s %10d %12.6f %10.2f' % ('total (%d files x %d)' % (len(files), repetitions),
+                                            total_bytes // repetitions, total_seconds,
+                                            total_bytes / total_seconds / 2 ** 20))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,312 @@
+#!/usr/bin/env python3
+# Interpreter benchmark suite and regression check.
+#
+# Runs every program of "test files" and "examples" that has a main method,
+# plus generated microbenchmarks whose main method loops over an invocation,
+# a field access, an array access or an allocation N times. A first run of
+# each workload with "-allocprof" counts the instructions it executes and the
+# objects it creates. Then all workloads are run several times in turn with
+# "-t", recording the execution time they report (wall clock time, including
+# class loading) and their peak resident memory.
+#
+# The results are compared with a baseline saved by a previous run with
+# "--save". Times and peak memory are flagged as regressions when they grew
+# by more than a few percent and Welch's t-test says the growth is
+# significant. Instruction and allocation counts don't vary between runs,
+# so any growth is flagged. The exit status is 1 if there are regressions.
+#
+# Usage: python3 bench/suite.py [jvm binary] [runs] [--save] [--baseline <file>]
+# Must be run from the repository root, so java/lang/Object.class is found.
+
+import glob
+import json
+import math
+import os
+import re
+import shutil
+import statistics
+import struct
+import sys
+import tempfile
+
+import alloc
+from classfile import ConstantPool, class_file, counted_loop
+from common import run
+
+DEFAULT_RUNS = 10
+DEFAULT_BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'baseline.json')
+MICRO_COUNT = 1000000
+
+# A time or peak memory is a regression if it grew by more than this
+# fraction and the growth is significant at this level
+MIN_TIME_GROWTH = 0.03
+MIN_MEMORY_GROWTH = 0.10
+SIGNIFICANCE = 0.01
+
+PROGRAM_DIRECTORIES = ['test files', 'examples']
+
+# Microbenchmarks: (class name, description, max stack, code run before the loop,
+# body of the loop, extra methods, fields). The code before the loop leaves the
+# object or array that the body uses on the operand stack.
+MICRO_CASES = [
+    # invokestatic m()V
+    ('BenchInvokeStatic', 'invokestatic', 2, lambda cp: b'',
+     lambda cp: b'\xb8' + struct.pack('>H', cp.methodref('BenchInvokeStatic', 'm', '()V')),
+     [(0x0009, 'm', '()V', 0, b'\xb1')], []),
+    # new; loop: dup; invokevirtual v()V
+    ('BenchInvokeVirtual', 'invokevirtual', 3, lambda cp: b'\xbb' + struct.pack('>H', cp.klass('BenchInvokeVirtual')),
+     lambda cp: b'\x59\xb6' + struct.pack('>H', cp.methodref('BenchInvokeVirtual', 'v', '()V')),
+     [(0x0001, 'v', '()V', 0, b'\xb1')], []),
+    # new; loop: dup; dup; getfield f; iconst_1; iadd; putfield f
+    ('BenchInstanceField', 'getfield/putfield', 4, lambda cp: b'\xbb' + struct.pack('>H', cp.klass('BenchInstanceField')),
+     lambda cp: (b'\x59\x59\xb4' + struct.pack('>H', cp.fieldref('BenchInstanceField', 'f', 'I')) + b'\x04\x60\xb5' +
+                 struct.pack('>H', cp.fieldref('BenchInstanceField', 'f', 'I'))),
+     [], [(0x0001, 'f', 'I')]),
+    # getstatic s; iconst_1; iadd; putstatic s
+    ('BenchStaticField', 'getstatic/putstatic', 2, lambda cp: b'',
+     lambda cp: (b'\xb2' + struct.pack('>H', cp.fieldref('BenchStaticField', 's', 'I')) + b'\x04\x60\xb3' +
+                 struct.pack('>H', cp.fieldref('BenchStaticField', 's', 'I'))),
+     [], [(0x0009, 's', 'I')]),
+    # bipush 16; newarray int; loop: dup; iload_1; bipush 15; iand; dup2; iaload; iconst_1; iadd; iastore
+    ('BenchArrayAccess', 'iaload/iastore', 6, lambda cp: b'\x10\x10\xbc\x0a',
+     lambda cp: b'\x59\x1b\x10\x0f\x7e\x5c\x2e\x04\x60\x4f', [], []),
+] + [
+    # The allocations of alloc.py, except its empty loop
+    (name, 'alloc ' + description, 2, lambda cp: b'', body, [], [])
+    for name, description, body in alloc.CASES if name != 'AllocEmpty'
+]
+
+
+def generate_micro(directory, count):
+    """Writes the classes of the microbenchmarks, returning their (name, path)."""
+    alloc.generate_node(directory)
+    workloads = []
+
+    for name, description, max_stack, setup, body, methods, fields in MICRO_CASES:
+        # public static void main(String[]) { setup; for (int i = 0; i < count; i++) { body } }
+        cp = ConstantPool()
+        code = setup(cp) + counted_loop(cp, body(cp), count) + b'\xb1'
+        path = os.path.join(directory, name + '.class')
+
+        with open(path, 'wb') as f:
+            f.write(class_file(name, 'java/lang/Object',
+                               methods + [(0x0009, 'main', '([Ljava/lang/String;)V', max_stack, code)], cp, fields))
+
+        workloads.append(('micro: ' + description, path))
+
+    return workloads
+
+
+def find_programs():
+    """Lists the (name, path) of the bundled programs."""
+    workloads = []
+
+    for directory in PROGRAM_DIRECTORIES:
+        for path in sorted(glob.glob(os.path.join(directory, '*.class'))):
+            workloads.append((path[:-len('.class')], path))
+
+    return workloads
+
+
+def probe(jvm, path, directory):
+    """Runs a workload once with "-allocprof", which also warms up the file cache.
+    Returns its instruction and object counts, or a string telling why it is skipped."""
+    output, peak_kb = run(jvm, path, ['-allocprof', os.path.join(directory, 'allocations.csv')])
+    status = re.search(r'Status message: (.*?)\.', output)
+    executed = re.search(r'Executed (\d+) instructions in ([0-9.]+) seconds', output)
+    allocated = re.search(r'(\d+) objects \((\d+)K\) allocated', output)
+
+    if status or not executed:
+        return status.group(1) if status else 'no timing reported'
+
+    return {'instructions': int(executed.group(1)), 'objects': int(allocated.group(1)) if allocated else None,
+            'seconds': [], 'peak_kb': []}
+
+
+def measure(jvm, path, result):
+    """Runs a workload once more, adding its time and peak memory to its results."""
+    output, peak_kb = run(jvm, path)
+    executed = re.search(r'Executed (\d+) instructions in ([0-9.]+) seconds', output)
+
+    result['seconds'].append(float(executed.group(2)) if executed else float('nan'))
+    result['peak_kb'].append(peak_kb)
+
+
+def incomplete_beta_fraction(a, b, x):
+    """Continued fraction of the regularized incomplete beta function (modified Lentz's method)."""
+    tiny = 1e-300
+    c, d = 1.0, 1.0 - (a + b) * x / (a + 1.0)
+    d = 1.0 / (d if abs(d) > tiny else tiny)
+    fraction = d
+
+    for m in range(1, 300):
+        for numerator in (m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m)),
+                          -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1))):
+            d = 1.0 + numerator * d
+            d = 1.0 / (d if abs(d) > tiny else tiny)
+            c = 1.0 + numerator / c
+            c = c if abs(c) > tiny else tiny
+            fraction *= c * d
+
+        if abs(c * d - 1.0) < 1e-12:
+            break
+
+    return fraction
+
+
+def incomplete_beta(a, b, x):
+    if x <= 0.0 or x >= 1.0:
+        return max(0.0, min(1.0, x))
+
+    front = math.exp(math.lgamma(a + b) - math.lgamma(a) - math.lgamma(b) + a * math.log(x) + b * math.log(1.0 - x))
+
+    if x < (a + 1.0) / (a + b + 2.0):
+        return front * incomplete_beta_fraction(a, b, x) / a
+
+    return 1.0 - front * incomplete_beta_fraction(b, a, 1.0 - x) / b
+
+
+def growth_p_value(before, after):
+    """One-sided p-value of Welch's t-test for the mean of "after" being larger than the mean of "before"."""
+    if len(before) < 2 or len(after) < 2:
+        return None
+
+    mean_before, mean_after = statistics.mean(before), statistics.mean(after)
+    error_before = statistics.variance(before) / len(before)
+    error_after = statistics.variance(after) / len(after)
+
+    # Without any variation, the means are either equal or certainly different
+    if error_before + error_after == 0:
+        return 0.0 if mean_after > mean_before else 1.0
+
+    t = (mean_after - mean_before) / math.sqrt(error_before + error_after)
+    freedom = (error_before + error_after) ** 2 / (error_before ** 2 / (len(before) - 1) +
+                                                   error_after ** 2 / (len(after) - 1))
+    tail = 0.5 * incomplete_beta(freedom / 2, 0.5, freedom / (freedom + t * t))
+    return tail if t > 0 else 1.0 - tail
+
+
+def compare_samples(before, after, min_growth):
+    """Returns the growth of the median and whether it is a significant regression."""
+    old, new = statistics.median(before), statistics.median(after)
+    growth = (new - old) / old if old else 0.0
+    p = growth_p_value(before, after)
+    return growth, p, growth > min_growth and p is not None and p < SIGNIFICANCE
+
+
+def compare(name, result, baseline):
+    """Returns the changes of a workload compared with its baseline, and its regressions."""
+    changes, regressions = [], []
+
+    for metric, min_growth in (('seconds', MIN_TIME_GROWTH), ('peak_kb', MIN_MEMORY_GROWTH)):
+        growth, p, regressed = compare_samples(baseline[metric], result[metric], min_growth)
+        changes.append('%+.1f%%' % (100 * growth) + (' (p=%.3f)' % p if p is not None else ''))
+
+        if regressed:
+            regressions.append('%s: %s grew %.1f%% (p=%.4f)' % (name, metric, 100 * growth, p))
+
+    for metric in ('instructions', 'objects'):
+        old, new = baseline.get(metric), result.get(metric)
+
+        if old is not None and new is not None and new > old:
+            regressions.append('%s: %s grew from %d to %d' % (name, metric, old, new))
+
+    return changes, regressions
+
+
+def main():
+    arguments = []
+    baseline_path = DEFAULT_BASELINE
+    save = False
+    index = 1
+
+    while index < len(sys.argv):
+        if sys.argv[index] == '--save':
+            save = True
+        elif sys.argv[index] == '--baseline' and index + 1 < len(sys.argv):
+            index += 1
+            baseline_path = sys.argv[index]
+        else:
+            arguments.append(sys.argv[index])
+
+        index += 1
+
+    jvm = os.path.abspath(arguments[0] if arguments else './jvm.exe')
+    runs = int(arguments[1]) if len(arguments) > 1 else DEFAULT_RUNS
+    baseline = None
+
+    if not save and os.path.exists(baseline_path):
+        with open(baseline_path) as f:
+            baseline = json.load(f)['workloads']
+
+    directory = tempfile.mkdtemp(prefix='suite')
+    results, regressions = {}, []
+
+    print('%-38s %12s %14s %10s %10s  %s' % ('workload', 'seconds', 'instructions', 'peak KB', 'objects',
+                                             'time and memory vs. baseline' if baseline else ''))
+
+    try:
+        workloads = generate_micro(directory, MICRO_COUNT) + find_programs()
+
+        for name, path in workloads:
+            result = probe(jvm, path, directory)
+
+            if isinstance(result, str):
+                print('%-38s %12s  (%s)' % (name, 'skipped', result))
+            else:
+                results[name] = result
+
+        # Runs are interleaved, so a change of the load of the machine while
+        # the suite runs shows up as variance of every workload instead of
+        # making some workloads look slower than others
+        for index in range(runs):
+            for name, path in workloads:
+                if name in results:
+                    measure(jvm, path, results[name])
+
+        for name, path in workloads:
+            if name not in results:
+                continue
+
+            result = results[name]
+            changes = ''
+
+            if baseline and name in baseline:
+                change_list, workload_regressions = compare(name, result, baseline[name])
+                changes = ', '.join(change_list)
+                regressions += workload_regressions
+            elif baseline:
+                changes = 'not in baseline'
+
+            print('%-38s %12.6f %14d %10d %10s  %s' % (name, statistics.median(result['seconds']),
+                                                       result['instructions'], statistics.median(result['peak_kb']),
+                                                       result['objects'] if result['objects'] is not None else '?',
+                                                       changes))
+    finally:
+        shutil.rmtree(directory)
+
+    if save:
+        with open(baseline_path, 'w') as f:
+            json.dump({'jvm': jvm, 'runs': runs, 'workloads': results}, f, indent=1, sort_keys=True)
+
+        print('\nBaseline of %d workloads saved to %s.' % (len(results), baseline_path))
+        return 0
+
+    if not baseline:
+        print('\nNo baseline to compare with, run with --save to create one.')
+        return 0
+
+    if regressions:
+        print('\n%d regressions:' % len(regressions))
+
+        for regression in regressions:
+            print('  ' + regression)
+
+        return 1
+
+    print('\nNo regressions.')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
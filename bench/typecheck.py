@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+# Type check microbenchmark.
+#
+# Generates a small class hierarchy (an interface, a class implementing it
+# and two levels of subclasses) and one main class per kind of type check,
+# each running a loop that takes three objects of an array in turn and checks
+# them with checkcast or instanceof, plus a class running the same loop
+# without checking the objects. The objects are instances of the three
+# classes, arrays of them or strings. The cost of each check is the
+# time per iteration of its loop minus the time per iteration of the loop
+# without checks. Times are the best of several runs, as reported by "-t".
+#
+# Usage: python3 bench/typecheck.py [jvm binary] [N] [runs]
+# Must be run from the repository root, so java/lang/Object.class is found.
+
+import os
+import shutil
+import struct
+import sys
+import tempfile
+
+from classfile import ConstantPool, class_file, counted_loop
+from common import run, reported_seconds
+
+DEFAULT_COUNT = 2000000
+DEFAULT_RUNS = 5
+
+# Classes of the hierarchy: (name, super class, interfaces)
+CLASSES = [
+    ('TypeBase', 'java/lang/Object', ['TypeShape']),
+    ('TypeMid', 'TypeBase', []),
+    ('TypeLeaf', 'TypeMid', []),
+    ('TypeOther', 'java/lang/Object', []),
+]
+
+ELEMENTS = ['TypeLeaf', 'TypeMid', 'TypeBase']
+
+
+def instance(cp, element):
+    # new <element>(), as an element of the array of objects
+    return b'\xbb' + struct.pack('>H', cp.klass(element)) + b'\x59\xb7' + \
+        struct.pack('>H', cp.methodref(element, '<init>', '()V'))
+
+
+def array(cp, element):
+    # new <element>[1]
+    return b'\x04\xbd' + struct.pack('>H', cp.klass(element))
+
+
+def string(cp, element):
+    # ldc "<element>"
+    return b'\x13' + struct.pack('>H', cp.string(element))
+
+
+def check(opcode, type_name):
+    return lambda cp: opcode + struct.pack('>H', cp.klass(type_name))
+
+
+INSTANCEOF, CHECKCAST = b'\xc1', b'\xc0'
+
+# Checks made on each object: (class name, description, function building
+# the objects, function building the check)
+CASES = [
+    ('TypeNone', 'no check', instance, lambda cp: b''),
+    ('TypeInterface', 'instanceof interface', instance, check(INSTANCEOF, 'TypeShape')),
+    ('TypeClass', 'instanceof class', instance, check(INSTANCEOF, 'TypeBase')),
+    ('TypeFailed', 'instanceof, false', instance, check(INSTANCEOF, 'TypeOther')),
+    ('TypeCast', 'checkcast class', instance, check(CHECKCAST, 'TypeBase')),
+    ('TypeArrayCast', 'checkcast array', array, check(CHECKCAST, '[LTypeShape;')),
+    ('TypeArrayFailed', 'instanceof array, false', array, check(INSTANCEOF, '[LTypeOther;')),
+    ('TypeStringCast', 'checkcast string', string, check(CHECKCAST, 'java/lang/CharSequence')),
+]
+
+
+def constructor(cp, super_name):
+    # public <init>() { super(); }
+    code = b'\x2a\xb7' + struct.pack('>H', cp.methodref(super_name, '<init>', '()V')) + b'\xb1'
+    return (0x0001, '<init>', '()V', 1, code)
+
+
+def generate(directory, count):
+    with open(os.path.join(directory, 'TypeShape.class'), 'wb') as f:
+        f.write(class_file('TypeShape', 'java/lang/Object', [], access_flags=0x0601))
+
+    for name, super_name, interfaces in CLASSES:
+        cp = ConstantPool()
+
+        with open(os.path.join(directory, name + '.class'), 'wb') as f:
+            f.write(class_file(name, super_name, [constructor(cp, super_name)], cp, interfaces=interfaces))
+
+    for name, description, objects, check in CASES:
+        cp = ConstantPool()
+
+        # Object[] objects = { <object of TypeLeaf>, <object of TypeMid>, <object of TypeBase> };
+        code = b'\x06\xbd' + struct.pack('>H', cp.klass('java/lang/Object')) + b'\x4b'
+
+        for index, element in enumerate(ELEMENTS):
+            code += b'\x2a' + bytes([0x03 + index]) + objects(cp, element) + b'\x53'
+
+        # for (int i = 0; i < count; i++) { check objects[i % 3]; }
+        code += counted_loop(cp, b'\x2a\x1b\x06\x70\x32' + check(cp) + b'\x57', count) + b'\xb1'
+
+        with open(os.path.join(directory, name + '.class'), 'wb') as f:
+            f.write(class_file(name, 'java/lang/Object',
+                               [(0x0009, 'main', '([Ljava/lang/String;)V', 6, code)], cp))
+
+
+def main():
+    jvm = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else './jvm.exe')
+    count = int(sys.argv[2]) if len(sys.argv) > 2 else DEFAULT_COUNT
+    runs = int(sys.argv[3]) if len(sys.argv) > 3 else DEFAULT_RUNS
+    directory = tempfile.mkdtemp(prefix='typecheck')
+    baseline = None
+
+    print('%-24s %12s %14s %14s' % ('check', 'seconds', 'ns per loop', 'ns per check'))
+
+    try:
+        generate(directory, count)
+
+        for name, description, objects, check in CASES:
+            class_path = ['-cp', '%s%s.' % (directory, os.pathsep)]
+            times = [reported_seconds(run(jvm, os.path.join(directory, name + '.class'), class_path)[0])
+                     for i in range(runs)]
+            times = [seconds for seconds in times if seconds is not None]
+
+            if not times:
+                print('%-24s %12s' % (description, 'failed'))
+                continue
+
+            per_loop = 1e9 * min(times) / count
+            baseline = per_loop if baseline is None else baseline
+            print('%-24s %12.6f %14.2f %14.2f' % (description, min(times), per_loop, per_loop - baseline))
+    finally:
+        shutil.rmtree(directory)
+
+
+if __name__ == '__main__':
+    main()
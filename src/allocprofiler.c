@@ -0,0 +1,637 @@
+// Needed for sigaction() in strict C99 mode
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "allocprofiler.h"
+#include "jvm.h"
+#include "gc.h"
+#include "methods.h"
+#include "utf8.h"
+#include "debugging.h"
+
+/// @brief Initial number of slots of the table of allocation sites
+/// and of the table of a heap histogram. Must be a power of two.
+#define ALLOCATION_TABLE_INITIAL_CAPACITY 256
+
+#ifdef ALLOCATION_PROFILER_USES_SIGNAL
+
+/// @brief The profiler that handles SIGUSR1. There can only be one,
+/// as the signal is sent to the whole process.
+static AllocationProfiler* signaledProfiler;
+
+/// @brief The action of SIGUSR1 before the profiler started.
+static struct sigaction previousAction;
+
+static void requestHeapHistogram(int signal)
+{
+    if (signaledProfiler)
+        signaledProfiler->histogramRequested = 1;
+}
+
+#endif // ALLOCATION_PROFILER_USES_SIGNAL
+
+/// @brief Initializes an allocation profiler without allocations.
+void initAllocationProfiler(AllocationProfiler* profiler)
+{
+    memset(profiler, 0, sizeof(AllocationProfiler));
+}
+
+/// @brief Starts handling SIGUSR1, which requests a heap histogram.
+/// @return 1 on success, 0 if the signal couldn't be handled.
+uint8_t startAllocationProfiler(AllocationProfiler* profiler)
+{
+#ifdef ALLOCATION_PROFILER_USES_SIGNAL
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestHeapHistogram;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (signaledProfiler || sigaction(SIGUSR1, &action, &previousAction))
+        return 0;
+
+    signaledProfiler = profiler;
+#endif // ALLOCATION_PROFILER_USES_SIGNAL
+
+    return 1;
+}
+
+/// @brief Stops handling SIGUSR1.
+void stopAllocationProfiler(AllocationProfiler* profiler)
+{
+#ifdef ALLOCATION_PROFILER_USES_SIGNAL
+    if (signaledProfiler != profiler)
+        return;
+
+    sigaction(SIGUSR1, &previousAction, NULL);
+    signaledProfiler = NULL;
+#endif // ALLOCATION_PROFILER_USES_SIGNAL
+}
+
+/// @brief Frees all allocation sites.
+void freeAllocationProfiler(AllocationProfiler* profiler)
+{
+    uint32_t index;
+
+    stopAllocationProfiler(profiler);
+
+    for (index = 0; index < profiler->siteCapacity; index++)
+    {
+        if (profiler->sites[index])
+            free(profiler->sites[index]);
+    }
+
+    if (profiler->sites)
+        free(profiler->sites);
+
+    profiler->sites = NULL;
+    profiler->siteCapacity = 0;
+    profiler->siteCount = 0;
+}
+
+/// @brief Gets the name of the type of an object, as a class name
+/// for class instances and strings, or a descriptor for arrays.
+/// @return The name, or NULL if memory allocation failed.
+static const Symbol* getObjectType(AllocationProfiler* profiler, Reference* obj)
+{
+    static const char primitiveDescriptors[T_LONG + 1] = {
+        [T_BOOLEAN] = 'Z', [T_CHAR] = 'C', [T_FLOAT] = 'F', [T_DOUBLE] = 'D',
+        [T_BYTE] = 'B', [T_SHORT] = 'S', [T_INT] = 'I', [T_LONG] = 'J'
+    };
+
+    uint8_t descriptor[2] = {'['};
+    const Symbol* type;
+    cp_info* cpi;
+
+    switch (obj->type)
+    {
+        case REFTYPE_CLASSINSTANCE:
+            cpi = obj->ci.c->constantPool + obj->ci.c->thisClass - 1;
+            return obj->ci.c->constantPool[cpi->Class.name_index - 1].Utf8.symbol;
+
+        case REFTYPE_STRING:
+
+            if (!profiler->stringType)
+                profiler->stringType = internSymbol((const uint8_t*)"java/lang/String", 16);
+
+            return profiler->stringType;
+
+        case REFTYPE_ARRAY:
+
+            if (obj->arr.type < T_BOOLEAN || obj->arr.type > T_LONG)
+                return NULL;
+
+            if (!profiler->arrayTypes[obj->arr.type])
+            {
+                descriptor[1] = primitiveDescriptors[obj->arr.type];
+                profiler->arrayTypes[obj->arr.type] = internSymbol(descriptor, 2);
+            }
+
+            return profiler->arrayTypes[obj->arr.type];
+
+        case REFTYPE_OBJARRAY:
+            type = profiler->lastObjectArrayType;
+
+            if (type && type->length == obj->oar.utf8_len &&
+                !memcmp(type->bytes, OBJECT_ARRAY_CLASS_NAME(obj), obj->oar.utf8_len))
+            {
+                return type;
+            }
+
+            type = internSymbol(OBJECT_ARRAY_CLASS_NAME(obj), obj->oar.utf8_len);
+
+            if (type)
+                profiler->lastObjectArrayType = type;
+
+            return type;
+
+        default:
+            return NULL;
+    }
+}
+
+static uint32_t hashAllocationSite(method_info* method, int32_t offset, const Symbol* type)
+{
+    uint32_t hash = (uint32_t)((uintptr_t)method >> 3);
+
+    hash = hash * 31u + (uint32_t)offset;
+    return hash * 31u + type->hash;
+}
+
+/// @brief Doubles the number of slots of the table of allocation sites,
+/// or allocates the table if it is empty.
+/// @return 1 on success, 0 if memory allocation failed.
+static uint8_t growAllocationSiteTable(AllocationProfiler* profiler)
+{
+    uint32_t oldCapacity = profiler->siteCapacity;
+    uint32_t newCapacity = oldCapacity ? 2 * oldCapacity : ALLOCATION_TABLE_INITIAL_CAPACITY;
+    AllocationSite** oldTable = profiler->sites;
+    AllocationSite** newTable = (AllocationSite**)malloc(newCapacity * sizeof(AllocationSite*));
+    uint32_t index, slot;
+
+    if (!newTable)
+        return 0;
+
+    memset(newTable, 0, newCapacity * sizeof(AllocationSite*));
+
+    for (index = 0; index < oldCapacity; index++)
+    {
+        if (!oldTable[index])
+            continue;
+
+        slot = oldTable[index]->hash & (newCapacity - 1);
+
+        while (newTable[slot])
+            slot = (slot + 1) & (newCapacity - 1);
+
+        newTable[slot] = oldTable[index];
+    }
+
+    if (oldTable)
+        free(oldTable);
+
+    profiler->sites = newTable;
+    profiler->siteCapacity = newCapacity;
+    return 1;
+}
+
+/// @brief Counts an object that was just created.
+/// @param AllocationProfiler* profiler - the profiler
+/// @param FrameStack* frames - the frames of the JVM. The object is counted under
+/// the instruction being executed by the frame at the top of the stack.
+/// @param Reference* obj - the object, whose type must already be set
+/// @return 1 on success, 0 if memory allocation failed.
+uint8_t profileAllocation(AllocationProfiler* profiler, FrameStack* frames, Reference* obj)
+{
+    Frame* frame = frames->frameCount ? frames->frames + frames->frameCount - 1 : NULL;
+    JavaClass* jc = frame ? frame->jc : NULL;
+    method_info* method = frame ? frame->method : NULL;
+    const Symbol* type = getObjectType(profiler, obj);
+    int32_t offset = -1;
+    uint32_t hash, slot;
+    AllocationSite* site;
+
+    if (!type)
+        return 0;
+
+    // The pc of a frame is the instruction after the one being executed
+    if (frame && frame->pc > 0)
+        offset = (int32_t)frame->instructions[frame->pc - 1].offset;
+
+    hash = hashAllocationSite(method, offset, type);
+    profiler->objectCount++;
+    profiler->byteCount += obj->size;
+
+    if (profiler->siteCount > 0)
+    {
+        for (slot = hash & (profiler->siteCapacity - 1); profiler->sites[slot];
+             slot = (slot + 1) & (profiler->siteCapacity - 1))
+        {
+            site = profiler->sites[slot];
+
+            if (site->hash == hash && site->method == method && site->offset == offset && site->type == type)
+            {
+                site->count++;
+                site->bytes += obj->size;
+                return 1;
+            }
+        }
+    }
+
+    // Keep the load factor of the table at most 1/2
+    if (2 * (profiler->siteCount + 1) > profiler->siteCapacity && !growAllocationSiteTable(profiler))
+        return 0;
+
+    site = (AllocationSite*)malloc(sizeof(AllocationSite));
+
+    if (!site)
+        return 0;
+
+    site->hash = hash;
+    site->jc = jc;
+    site->method = method;
+    site->offset = offset;
+    site->line = -1;
+    site->type = type;
+    site->count = 1;
+    site->bytes = obj->size;
+
+    slot = hash & (profiler->siteCapacity - 1);
+
+    while (profiler->sites[slot])
+        slot = (slot + 1) & (profiler->siteCapacity - 1);
+
+    profiler->sites[slot] = site;
+    profiler->siteCount++;
+    return 1;
+}
+
+/// @brief Orders sites by their methods, lines and types, so sites that
+/// are written the same way end up next to each other.
+static int compareSiteLines(const void* a, const void* b)
+{
+    const AllocationSite* first = (const AllocationSite*)a;
+    const AllocationSite* second = (const AllocationSite*)b;
+
+    if (first->method != second->method)
+        return (uintptr_t)first->method < (uintptr_t)second->method ? -1 : 1;
+
+    if (first->line != second->line)
+        return first->line < second->line ? -1 : 1;
+
+    if (first->type != second->type)
+        return (uintptr_t)first->type < (uintptr_t)second->type ? -1 : 1;
+
+    return 0;
+}
+
+static int compareSiteBytes(const void* a, const void* b)
+{
+    const AllocationSite* first = (const AllocationSite*)a;
+    const AllocationSite* second = (const AllocationSite*)b;
+
+    return (first->bytes < second->bytes) - (first->bytes > second->bytes);
+}
+
+/// @brief Lists the allocation sites, with sites of the same line and type
+/// merged, sorted by bytes allocated, most first.
+///
+/// The lines of the sites are only looked up now, so this must be called
+/// while the classes of the JVM are still loaded.
+///
+/// @return The list, which must be freed, or NULL if there are no sites or
+/// memory allocation failed.
+static AllocationSite* sortAllocationSites(AllocationProfiler* profiler, uint32_t* outCount)
+{
+    AllocationSite* sites;
+    uint32_t count = 0, merged = 0, index;
+
+    *outCount = 0;
+
+    if (profiler->siteCount == 0)
+        return NULL;
+
+    sites = (AllocationSite*)malloc(profiler->siteCount * sizeof(AllocationSite));
+
+    if (!sites)
+        return NULL;
+
+    for (index = 0; index < profiler->siteCapacity; index++)
+    {
+        if (!profiler->sites[index])
+            continue;
+
+        sites[count] = *profiler->sites[index];
+
+        if (sites[count].method)
+            sites[count].line = getMethodLineNumber(sites[count].jc, sites[count].method, sites[count].offset);
+
+        count++;
+    }
+
+    qsort(sites, count, sizeof(AllocationSite), compareSiteLines);
+
+    for (index = 0; index < count; index++)
+    {
+        if (merged > 0 && !compareSiteLines(sites + merged - 1, sites + index))
+        {
+            sites[merged - 1].count += sites[index].count;
+            sites[merged - 1].bytes += sites[index].bytes;
+        }
+        else
+        {
+            sites[merged++] = sites[index];
+        }
+    }
+
+    qsort(sites, merged, sizeof(AllocationSite), compareSiteBytes);
+    *outCount = merged;
+    return sites;
+}
+
+/// @brief Writes a name of the JVM with dots instead of slashes.
+static void writeTypeName(FILE* file, const Symbol* type)
+{
+    int32_t index;
+
+    for (index = 0; index < type->length; index++)
+        fputc(type->bytes[index] == '/' ? '.' : type->bytes[index], file);
+}
+
+/// @brief Writes a site as "package.Class.method:line", without the line if it
+/// is unknown, or as "<vm>" for objects created outside of any frame.
+static void writeSiteName(FILE* file, AllocationSite* site)
+{
+    cp_info* cpi;
+    int32_t index;
+
+    if (!site->method)
+    {
+        fprintf(file, "<vm>");
+        return;
+    }
+
+    cpi = site->jc->constantPool + site->jc->thisClass - 1;
+    cpi = site->jc->constantPool + cpi->Class.name_index - 1;
+
+    for (index = 0; index < cpi->Utf8.length; index++)
+        fputc(cpi->Utf8.bytes[index] == '/' ? '.' : cpi->Utf8.bytes[index], file);
+
+    cpi = site->jc->constantPool + site->method->name_index - 1;
+    fprintf(file, ".%.*s", PRINT_UTF8(cpi));
+
+    if (site->line >= 0)
+        fprintf(file, ":%d", site->line);
+}
+
+/// @brief Prints the allocation sites that allocated the most memory.
+///
+/// Each site is printed with its share of all bytes allocated. Sites of
+/// instructions of the same line that created objects of the same type
+/// are printed as one.
+void printAllocationProfile(AllocationProfiler* profiler)
+{
+    uint32_t count, index;
+    AllocationSite* sites = sortAllocationSites(profiler, &count);
+    uint64_t totalBytes = profiler->byteCount ? profiler->byteCount : 1;
+
+    printf("\n%llu objects (%lluK) allocated.\n", (unsigned long long)profiler->objectCount,
+           (unsigned long long)(profiler->byteCount / 1024));
+    printf("%14s %14s %8s  %-32s %s\n", "objects", "bytes", "%", "type", "site");
+
+    for (index = 0; index < count && index < ALLOCATION_PRINTED_ROWS; index++)
+    {
+        printf("%14llu %14llu %7.2f%%  ", (unsigned long long)sites[index].count,
+               (unsigned long long)sites[index].bytes, 100.0 * sites[index].bytes / totalBytes);
+        writeTypeName(stdout, sites[index].type);
+        printf("%*s ", sites[index].type->length < 32 ? 32 - sites[index].type->length : 0, "");
+        writeSiteName(stdout, sites + index);
+        printf("\n");
+    }
+
+    if (sites)
+        free(sites);
+}
+
+/// @brief Writes the allocation sites and a heap histogram to a CSV file.
+///
+/// The file has a header line and one line per allocation site and per type of the
+/// histogram, with the columns "kind" ("site" or "live"), "type", "site" (empty for
+/// the histogram), "count" (objects) and "bytes". Rows are sorted by bytes, most first.
+/// @param HeapHistogram* histogram - the histogram written, which can be NULL
+/// @return 1 on success, 0 if the file couldn't be written.
+uint8_t writeAllocationProfile(AllocationProfiler* profiler, HeapHistogram* histogram, const char* path)
+{
+    uint32_t count, index;
+    AllocationSite* sites = sortAllocationSites(profiler, &count);
+    FILE* file;
+
+    if (profiler->siteCount && !sites)
+        return 0;
+
+    file = fopen(path, "w");
+
+    if (!file)
+    {
+        if (sites)
+            free(sites);
+
+        return 0;
+    }
+
+    fprintf(file, "kind,type,site,count,bytes\n");
+
+    for (index = 0; index < count; index++)
+    {
+        fprintf(file, "site,\"");
+        writeTypeName(file, sites[index].type);
+        fprintf(file, "\",\"");
+        writeSiteName(file, sites + index);
+        fprintf(file, "\",%llu,%llu\n", (unsigned long long)sites[index].count, (unsigned long long)sites[index].bytes);
+    }
+
+    for (index = 0; histogram && index < histogram->entryCount; index++)
+    {
+        fprintf(file, "live,\"");
+        writeTypeName(file, histogram->entries[index].type);
+        fprintf(file, "\",,%llu,%llu\n", (unsigned long long)histogram->entries[index].count,
+                (unsigned long long)histogram->entries[index].bytes);
+    }
+
+    if (sites)
+        free(sites);
+
+    return fclose(file) == 0;
+}
+
+/// @brief State of the walk of the heap made by takeHeapHistogram().
+typedef struct HistogramBuilder
+{
+    AllocationProfiler* profiler;
+    HeapHistogram* histogram;
+
+    /// @brief Number of slots of the entries of the histogram,
+    /// which are an open addressing hash table keyed by type.
+    uint32_t capacity;
+} HistogramBuilder;
+
+/// @brief Doubles the number of slots of the table of a histogram being built.
+/// @return 1 on success, 0 if memory allocation failed.
+static uint8_t growHistogramTable(HistogramBuilder* builder)
+{
+    uint32_t oldCapacity = builder->capacity;
+    uint32_t newCapacity = oldCapacity ? 2 * oldCapacity : ALLOCATION_TABLE_INITIAL_CAPACITY;
+    HeapHistogramEntry* oldTable = builder->histogram->entries;
+    HeapHistogramEntry* newTable = (HeapHistogramEntry*)malloc(newCapacity * sizeof(HeapHistogramEntry));
+    uint32_t index, slot;
+
+    if (!newTable)
+        return 0;
+
+    memset(newTable, 0, newCapacity * sizeof(HeapHistogramEntry));
+
+    for (index = 0; index < oldCapacity; index++)
+    {
+        if (!oldTable[index].type)
+            continue;
+
+        slot = oldTable[index].type->hash & (newCapacity - 1);
+
+        while (newTable[slot].type)
+            slot = (slot + 1) & (newCapacity - 1);
+
+        newTable[slot] = oldTable[index];
+    }
+
+    if (oldTable)
+        free(oldTable);
+
+    builder->histogram->entries = newTable;
+    builder->capacity = newCapacity;
+    return 1;
+}
+
+/// @brief Counts an object of the heap in the histogram being built.
+/// @see walkHeap()
+static uint8_t countHeapObject(Reference* obj, void* context)
+{
+    HistogramBuilder* builder = (HistogramBuilder*)context;
+    HeapHistogram* histogram = builder->histogram;
+    const Symbol* type = getObjectType(builder->profiler, obj);
+    uint32_t slot;
+
+    if (!type)
+        return 0;
+
+    histogram->objectCount++;
+    histogram->byteCount += obj->size;
+
+    if (histogram->entryCount > 0)
+    {
+        for (slot = type->hash & (builder->capacity - 1); histogram->entries[slot].type;
+             slot = (slot + 1) & (builder->capacity - 1))
+        {
+            if (histogram->entries[slot].type == type)
+            {
+                histogram->entries[slot].count++;
+                histogram->entries[slot].bytes += obj->size;
+                return 1;
+            }
+        }
+    }
+
+    // Keep the load factor of the table at most 1/2
+    if (2 * (histogram->entryCount + 1) > builder->capacity && !growHistogramTable(builder))
+        return 0;
+
+    slot = type->hash & (builder->capacity - 1);
+
+    while (histogram->entries[slot].type)
+        slot = (slot + 1) & (builder->capacity - 1);
+
+    histogram->entries[slot].type = type;
+    histogram->entries[slot].count = 1;
+    histogram->entries[slot].bytes = obj->size;
+    histogram->entryCount++;
+    return 1;
+}
+
+static int compareHistogramBytes(const void* a, const void* b)
+{
+    const HeapHistogramEntry* first = (const HeapHistogramEntry*)a;
+    const HeapHistogramEntry* second = (const HeapHistogramEntry*)b;
+
+    return (first->bytes < second->bytes) - (first->bytes > second->bytes);
+}
+
+/// @brief Counts the objects that are reachable by the program, by type.
+/// @param JavaVirtualMachine* jvm - the JVM, which must have an allocation profiler
+/// @param HeapHistogram* outHistogram - filled with the objects of the heap, and
+/// must be freed with freeHeapHistogram()
+///
+/// Garbage is collected first, so the objects that are left are the live ones.
+/// If the collection can't be made, all objects of the heap are counted.
+///
+/// @pre All live references must be stored in frames, static fields or other
+/// objects, see GC_SAFEPOINT.
+/// @return 1 on success, 0 if memory allocation failed.
+uint8_t takeHeapHistogram(JavaVirtualMachine* jvm, HeapHistogram* outHistogram)
+{
+    HistogramBuilder builder;
+    uint32_t count = 0, index;
+
+    jvm->allocationProfiler->histogramRequested = 0;
+    memset(outHistogram, 0, sizeof(HeapHistogram));
+    collectGarbage(jvm);
+
+    builder.profiler = jvm->allocationProfiler;
+    builder.histogram = outHistogram;
+    builder.capacity = 0;
+
+    if (!walkHeap(&jvm->heap, countHeapObject, &builder))
+    {
+        freeHeapHistogram(outHistogram);
+        return 0;
+    }
+
+    // Moves the entries to the start of the table, which then becomes a list
+    for (index = 0; index < builder.capacity; index++)
+    {
+        if (outHistogram->entries[index].type)
+            outHistogram->entries[count++] = outHistogram->entries[index];
+    }
+
+    qsort(outHistogram->entries, count, sizeof(HeapHistogramEntry), compareHistogramBytes);
+    return 1;
+}
+
+/// @brief Prints the types whose objects take the most memory.
+void printHeapHistogram(HeapHistogram* histogram)
+{
+    uint64_t totalBytes = histogram->byteCount ? histogram->byteCount : 1;
+    uint32_t index;
+
+    printf("\n%llu live objects (%lluK) of %u types.\n", (unsigned long long)histogram->objectCount,
+           (unsigned long long)(histogram->byteCount / 1024), histogram->entryCount);
+    printf("%14s %14s %8s  %s\n", "objects", "bytes", "%", "type");
+
+    for (index = 0; index < histogram->entryCount && index < ALLOCATION_PRINTED_ROWS; index++)
+    {
+        printf("%14llu %14llu %7.2f%%  ", (unsigned long long)histogram->entries[index].count,
+               (unsigned long long)histogram->entries[index].bytes, 100.0 * histogram->entries[index].bytes / totalBytes);
+        writeTypeName(stdout, histogram->entries[index].type);
+        printf("\n");
+    }
+}
+
+/// @brief Frees the entries of a heap histogram.
+void freeHeapHistogram(HeapHistogram* histogram)
+{
+    if (histogram->entries)
+        free(histogram->entries);
+
+    memset(histogram, 0, sizeof(HeapHistogram));
+}
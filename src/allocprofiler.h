@@ -0,0 +1,124 @@
+#ifndef ALLOCPROFILER_H
+#define ALLOCPROFILER_H
+
+#include <stdint.h>
+#include <signal.h>
+#include "framestack.h"
+#include "symbols.h"
+#include "opcodes.h"
+
+struct JavaVirtualMachine;
+struct Reference;
+
+// A heap histogram can be requested while the program
+// runs by sending SIGUSR1 where that signal exists
+#ifdef SIGUSR1
+    #define ALLOCATION_PROFILER_USES_SIGNAL
+#endif
+
+/// @brief Number of rows of each table printed by printAllocationProfile()
+/// and printHeapHistogram(). The CSV file written by writeAllocationProfile()
+/// has all of them.
+#define ALLOCATION_PRINTED_ROWS 20
+
+/// @brief Objects of a type created by an instruction.
+typedef struct AllocationSite
+{
+    uint32_t hash;
+
+    /// @brief Method and bytecode offset of the instruction, or NULL and -1
+    /// for objects created by the JVM itself, outside of any frame.
+    JavaClass* jc;
+    method_info* method;
+    int32_t offset;
+
+    /// @brief Line of the instruction, or -1 if it is unknown.
+    /// Only set when the profile is printed or written.
+    int32_t line;
+
+    /// @brief Name of the class of the objects, or descriptor for arrays.
+    const Symbol* type;
+
+    uint64_t count;
+
+    /// @brief Size of the heap blocks of the objects, including their headers.
+    uint64_t bytes;
+} AllocationSite;
+
+/// @brief Number and size of the objects of a type found in the heap.
+typedef struct HeapHistogramEntry
+{
+    const Symbol* type;
+    uint64_t count;
+    uint64_t bytes;
+} HeapHistogramEntry;
+
+/// @brief Objects of the heap, by type, sorted by size, largest first.
+/// @see takeHeapHistogram()
+typedef struct HeapHistogram
+{
+    HeapHistogramEntry* entries;
+    uint32_t entryCount;
+    uint64_t objectCount;
+    uint64_t byteCount;
+} HeapHistogram;
+
+/// @brief Counts the objects created by each instruction, by type.
+/// @see profileAllocation(), printAllocationProfile(), writeAllocationProfile()
+typedef struct AllocationProfiler
+{
+    /// @brief Set when a heap histogram should be printed before the next instruction.
+    volatile sig_atomic_t histogramRequested;
+
+    /// @brief Open addressing hash table of all allocation sites,
+    /// keyed by their methods, offsets and types.
+    AllocationSite** sites;
+    uint32_t siteCapacity;
+    uint32_t siteCount;
+
+    uint64_t objectCount;
+    uint64_t byteCount;
+
+    /// @brief Names of the types of strings and of arrays of primitive
+    /// types, indexed by Opcode_newarray_type, interned when first needed.
+    const Symbol* stringType;
+    const Symbol* arrayTypes[T_LONG + 1];
+
+    /// @brief Type of the last array of references created, which is likely
+    /// to be the type of the next one, so it isn't interned again.
+    const Symbol* lastObjectArrayType;
+} AllocationProfiler;
+
+void initAllocationProfiler(AllocationProfiler* profiler);
+uint8_t startAllocationProfiler(AllocationProfiler* profiler);
+void stopAllocationProfiler(AllocationProfiler* profiler);
+void freeAllocationProfiler(AllocationProfiler* profiler);
+uint8_t profileAllocation(AllocationProfiler* profiler, FrameStack* frames, struct Reference* obj);
+void printAllocationProfile(AllocationProfiler* profiler);
+uint8_t writeAllocationProfile(AllocationProfiler* profiler, HeapHistogram* histogram, const char* path);
+uint8_t takeHeapHistogram(struct JavaVirtualMachine* jvm, HeapHistogram* outHistogram);
+void printHeapHistogram(HeapHistogram* histogram);
+void freeHeapHistogram(HeapHistogram* histogram);
+
+#endif // ALLOCPROFILER_H
+
+/// @defgroup allocprofiler Allocation profiler module
+///
+/// @brief Finds which instructions create the most objects, and which
+/// types of objects take the most memory.
+///
+/// With the "-allocprof" option, every object created is counted, with the
+/// size of its heap block, under the instruction that was running when it was
+/// created and the type of the object (see profileAllocation()). Objects created
+/// by natives are counted under the instruction that invoked them. Without the
+/// option, the only cost is a check when an object is created.
+///
+/// A heap histogram counts the objects left in the heap by type, after a
+/// garbage collection, so only objects that are still reachable are counted
+/// (see takeHeapHistogram()). One is taken at exit, and sending SIGUSR1 to the
+/// process prints one while the program runs, before the next instruction.
+///
+/// At exit, the sites that allocated the most memory and the histogram are
+/// printed, and both are written in full to a CSV file.
+///
+/// @see allocprofiler.c
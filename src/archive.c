@@ -0,0 +1,1110 @@
+// Needed for the POSIX file functions in strict C99 mode
+#define _DEFAULT_SOURCE
+
+#include <string.h>
+#include <stddef.h>
+#include "archive.h"
+#include "symbols.h"
+#include "opcodes.h"
+#include "bytecode.h"
+#include "inflate.h"
+#include "debugging.h"
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+/// @brief Identifies class archive files ("JVMA").
+#define ARCHIVE_MAGIC 0x414D564Au
+
+/// @brief Version of the archive format. Must be incremented whenever a
+/// structure stored in archives changes, as the layout check only sees sizes.
+#define ARCHIVE_VERSION 2
+
+/// @brief Alignment of the copies of classes in an archive.
+#define ARCHIVE_ALIGNMENT 16
+
+/// @brief Start of an archive file.
+typedef struct ArchiveHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t layoutKey;
+
+    /// @brief Size of the whole archive, in bytes.
+    uint32_t size;
+
+    /// @brief Offset of the ArchivedClass array.
+    uint32_t classCount;
+    uint32_t classesOffset;
+
+    /// @brief Offset of the hash table of classes, keyed by class name. Each slot
+    /// holds the index of a class plus one, or 0 if the slot is empty.
+    uint32_t tableCapacity;
+    uint32_t tableOffset;
+
+    /// @brief Offset of an array with the offset of each string of the
+    /// archive. Strings are stored as a uint32_t length followed by the bytes.
+    uint32_t symbolCount;
+    uint32_t symbolsOffset;
+} ArchiveHeader;
+
+/// @brief Description of a class stored in an archive.
+typedef struct ArchivedClass
+{
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t hash;
+
+    /// @brief Where the class file was found, as given by openClassFromClassPath().
+    uint32_t sourceOffset;
+    uint32_t sourceLength;
+
+    ClassFingerprint fingerprint;
+
+    /// @brief Copy of the class, starting with its JavaClass structure.
+    uint32_t dataOffset;
+    uint32_t dataSize;
+
+    /// @brief CRC-32 of the copy of the class, before it is relocated. The copy
+    /// is trusted once its pointers are checked, so a damaged copy is detected
+    /// by its CRC before it is used.
+    uint32_t dataCRC;
+
+    /// @brief Offsets, in the copy of the class, of the pointers to be relocated.
+    uint32_t fixupOffset;
+    uint32_t fixupCount;
+
+    /// @brief Pairs of the offset of a UTF-8 constant, in the copy of
+    /// the class, and the index of the string of the constant.
+    uint32_t symbolFixupOffset;
+    uint32_t symbolFixupCount;
+} ArchivedClass;
+
+/// @brief A growable buffer of bytes.
+typedef struct ByteBuffer
+{
+    uint8_t* data;
+    uint32_t size;
+    uint32_t capacity;
+
+    /// @brief Set if memory couldn't be allocated, in which case
+    /// further appends are ignored.
+    uint8_t failed;
+} ByteBuffer;
+
+/// @brief A class recorded to be written to an archive.
+struct ArchiveRecord
+{
+    uint8_t* name;
+    uint32_t nameLength;
+    uint32_t hash;
+    char* source;
+    ClassFingerprint fingerprint;
+
+    ByteBuffer data;
+    ByteBuffer fixups;
+    ByteBuffer symbolFixups;
+};
+
+/// @brief Appends bytes to a buffer.
+/// @param ByteBuffer* buffer - the buffer
+/// @param const void* bytes - bytes to be appended, or NULL to append zeros
+/// @param size_t count - number of bytes to be appended
+/// @param uint32_t alignment - alignment of the offset where the bytes
+/// are appended, which must be a power of two. Padding is filled with zeros.
+/// @return The offset where the bytes were appended. If the buffer fails to
+/// grow, the returned value must not be used, see ByteBuffer::failed.
+static uint32_t appendBytes(ByteBuffer* buffer, const void* bytes, size_t count, uint32_t alignment)
+{
+    uint32_t offset = (buffer->size + alignment - 1) & ~(alignment - 1);
+    uint8_t* data;
+
+    if (buffer->failed)
+        return 0;
+
+    if (count > UINT32_MAX - offset)
+    {
+        buffer->failed = 1;
+        return 0;
+    }
+
+    if (offset + count > buffer->capacity)
+    {
+        uint32_t capacity = buffer->capacity ? buffer->capacity : 4096;
+
+        while (capacity < offset + count)
+        {
+            if (capacity > UINT32_MAX / 2)
+            {
+                buffer->failed = 1;
+                return 0;
+            }
+
+            capacity *= 2;
+        }
+
+        data = (uint8_t*)malloc(capacity);
+
+        if (!data)
+        {
+            buffer->failed = 1;
+            return 0;
+        }
+
+        if (buffer->data)
+        {
+            memcpy(data, buffer->data, buffer->size);
+            free(buffer->data);
+        }
+
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+
+    memset(buffer->data + buffer->size, 0, offset - buffer->size);
+
+    if (bytes)
+        memcpy(buffer->data + offset, bytes, count);
+    else
+        memset(buffer->data + offset, 0, count);
+
+    buffer->size = offset + (uint32_t)count;
+    return offset;
+}
+
+static void freeByteBuffer(ByteBuffer* buffer)
+{
+    if (buffer->data)
+        free(buffer->data);
+
+    buffer->data = NULL;
+    buffer->size = buffer->capacity = 0;
+}
+
+/// @brief Gets the computed layout of the structures stored in archives,
+/// so archives written by a different build aren't used.
+static uint32_t getLayoutKey(void)
+{
+    const uint32_t layout[] = {
+        ARCHIVE_VERSION, sizeof(void*), sizeof(JavaClass), sizeof(cp_info), sizeof(field_info),
+        sizeof(method_info), sizeof(attribute_info), sizeof(att_Code_info), sizeof(Instruction),
+        sizeof(ExceptionTableEntry), sizeof(ExceptionRange),
+        sizeof(att_InnerClasses_info), sizeof(att_LineNumberTable_info), sizeof(att_Exceptions_info),
+        offsetof(JavaClass, constantPool), offsetof(cp_info, Utf8.symbol), offsetof(Instruction, switchTable)
+    };
+
+    return hashUTF8((const uint8_t*)layout, sizeof(layout));
+}
+
+/// @brief Makes a pointer in the copy of a class point to another
+/// offset of the copy, recording it to be relocated.
+static void setPointer(struct ArchiveRecord* record, uint32_t pointerOffset, uint32_t targetOffset)
+{
+    uintptr_t value = targetOffset;
+
+    if (record->data.failed)
+        return;
+
+    memcpy(record->data.data + pointerOffset, &value, sizeof(value));
+    appendBytes(&record->fixups, &pointerOffset, sizeof(pointerOffset), sizeof(uint32_t));
+}
+
+/// @brief Sets a pointer in the copy of a class to NULL.
+static void clearPointer(struct ArchiveRecord* record, uint32_t pointerOffset)
+{
+    if (!record->data.failed)
+        memset(record->data.data + pointerOffset, 0, sizeof(void*));
+}
+
+/// @brief Copies the memory pointed by a pointer of a class to the copy of the
+/// class, making the pointer in the copy point to it.
+/// @param struct ArchiveRecord* record - the class being recorded
+/// @param uint32_t pointerOffset - offset of the pointer in the copy
+/// @param const void* memory - the memory the pointer points to
+/// @param size_t size - number of bytes to be copied
+/// @return Offset of the copied memory. Unspecified if \c memory is NULL.
+static uint32_t copyPointedMemory(struct ArchiveRecord* record, uint32_t pointerOffset, const void* memory, size_t size)
+{
+    uint32_t offset;
+
+    if (!memory)
+    {
+        clearPointer(record, pointerOffset);
+        return 0;
+    }
+
+    offset = appendBytes(&record->data, memory, size, ARCHIVE_ALIGNMENT);
+    setPointer(record, pointerOffset, offset);
+    return offset;
+}
+
+/// @brief Gets the index of a symbol in the strings of an archive, adding it if needed.
+/// @return The index of the symbol, or UINT32_MAX if memory couldn't be allocated.
+static uint32_t getSymbolIndex(ClassArchiveBuilder* builder, const Symbol* symbol)
+{
+    uint32_t mask, slot, index;
+
+    // The table is kept at most half full
+    if (2 * (builder->symbolCount + 1) > builder->symbolTableCapacity)
+    {
+        uint32_t capacity = builder->symbolTableCapacity ? 2 * builder->symbolTableCapacity : 256;
+        uint32_t* table = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+
+        if (!table)
+            return UINT32_MAX;
+
+        memset(table, 0, capacity * sizeof(uint32_t));
+
+        for (index = 0; index < builder->symbolCount; index++)
+        {
+            slot = builder->symbols[index]->hash & (capacity - 1);
+
+            while (table[slot])
+                slot = (slot + 1) & (capacity - 1);
+
+            table[slot] = index + 1;
+        }
+
+        if (builder->symbolTable)
+            free(builder->symbolTable);
+
+        builder->symbolTable = table;
+        builder->symbolTableCapacity = capacity;
+    }
+
+    mask = builder->symbolTableCapacity - 1;
+    slot = symbol->hash & mask;
+
+    while (builder->symbolTable[slot])
+    {
+        if (builder->symbols[builder->symbolTable[slot] - 1] == symbol)
+            return builder->symbolTable[slot] - 1;
+
+        slot = (slot + 1) & mask;
+    }
+
+    if (builder->symbolCount == builder->symbolCapacity)
+    {
+        uint32_t capacity = builder->symbolCapacity ? 2 * builder->symbolCapacity : 256;
+        const Symbol** symbols = (const Symbol**)malloc(capacity * sizeof(Symbol*));
+
+        if (!symbols)
+            return UINT32_MAX;
+
+        if (builder->symbols)
+        {
+            memcpy(symbols, builder->symbols, builder->symbolCount * sizeof(Symbol*));
+            free(builder->symbols);
+        }
+
+        builder->symbols = symbols;
+        builder->symbolCapacity = capacity;
+    }
+
+    builder->symbols[builder->symbolCount] = symbol;
+    builder->symbolTable[slot] = ++builder->symbolCount;
+    return builder->symbolCount - 1;
+}
+
+static void recordAttributes(struct ArchiveRecord* record, uint32_t pointerOffset,
+                             const attribute_info* attributes, uint16_t count);
+
+/// @brief Gets the number of handlers of all ranges of the exception index of a Code attribute.
+static uint32_t countExceptionHandlers(const att_Code_info* info)
+{
+    const ExceptionRange* last = info->exception_ranges + info->exception_range_count - 1;
+    return info->exception_range_count ? last->first_handler + last->handler_count : 0;
+}
+
+/// @brief Copies a Code attribute, with its bytecode, decoded instructions,
+/// exception table and index, and attributes.
+static void recordCode(struct ArchiveRecord* record, uint32_t pointerOffset, const att_Code_info* info)
+{
+    uint32_t offset = copyPointedMemory(record, pointerOffset, info, sizeof(att_Code_info));
+    uint32_t instructions, index;
+    const Instruction* instruction;
+    size_t tableSize;
+
+    if (!info)
+        return;
+
+    copyPointedMemory(record, offset + offsetof(att_Code_info, code), info->code, info->code_length);
+    copyPointedMemory(record, offset + offsetof(att_Code_info, exception_table), info->exception_table,
+                      info->exception_table_length * sizeof(ExceptionTableEntry));
+    copyPointedMemory(record, offset + offsetof(att_Code_info, exception_ranges), info->exception_ranges,
+                      info->exception_range_count * sizeof(ExceptionRange));
+    copyPointedMemory(record, offset + offsetof(att_Code_info, exception_handlers), info->exception_handlers,
+                      countExceptionHandlers(info) * sizeof(uint16_t));
+
+    instructions = copyPointedMemory(record, offset + offsetof(att_Code_info, instructions), info->instructions,
+                                     info->instruction_count * sizeof(Instruction));
+
+    for (index = 0; info->instructions && index < info->instruction_count; index++)
+    {
+        instruction = info->instructions + index;
+        pointerOffset = instructions + index * sizeof(Instruction) + offsetof(Instruction, switchTable);
+
+        // Only switches point to memory when the instruction is decoded,
+        // inline caches are created by the JVM later.
+        if (instruction->opcode == opcode_tableswitch)
+            tableSize = 1 + (uint32_t)((int64_t)instruction->operand2 - instruction->operand1 + 1);
+        else if (instruction->opcode == opcode_lookupswitch)
+            tableSize = 1 + 2 * (size_t)instruction->operand1;
+        else
+            tableSize = 0;
+
+        if (tableSize)
+            copyPointedMemory(record, pointerOffset, instruction->switchTable, tableSize * sizeof(int32_t));
+        else
+            clearPointer(record, pointerOffset);
+    }
+
+    recordAttributes(record, offset + offsetof(att_Code_info, attributes), info->attributes, info->attributes_count);
+}
+
+/// @brief Copies an array of attributes and their information.
+static void recordAttributes(struct ArchiveRecord* record, uint32_t pointerOffset,
+                             const attribute_info* attributes, uint16_t count)
+{
+    uint32_t array = copyPointedMemory(record, pointerOffset, attributes, count * sizeof(attribute_info));
+    uint32_t offset;
+    uint16_t index;
+
+    for (index = 0; attributes && index < count; index++)
+    {
+        const attribute_info* attribute = attributes + index;
+        const void* info = attribute->info;
+
+        pointerOffset = array + index * sizeof(attribute_info) + offsetof(attribute_info, info);
+
+        switch (attribute->attributeType)
+        {
+            case ATTR_ConstantValue:
+                copyPointedMemory(record, pointerOffset, info, sizeof(att_ConstantValue_info));
+                break;
+
+            case ATTR_SourceFile:
+                copyPointedMemory(record, pointerOffset, info, sizeof(att_SourceFile_info));
+                break;
+
+            case ATTR_InnerClasses:
+            {
+                const att_InnerClasses_info* innerClasses = (const att_InnerClasses_info*)info;
+                offset = copyPointedMemory(record, pointerOffset, info, sizeof(att_InnerClasses_info));
+
+                if (innerClasses)
+                {
+                    copyPointedMemory(record, offset + offsetof(att_InnerClasses_info, inner_classes),
+                                      innerClasses->inner_classes,
+                                      innerClasses->number_of_classes * sizeof(InnerClassInfo));
+                }
+
+                break;
+            }
+
+            case ATTR_LineNumberTable:
+            {
+                const att_LineNumberTable_info* lines = (const att_LineNumberTable_info*)info;
+                offset = copyPointedMemory(record, pointerOffset, info, sizeof(att_LineNumberTable_info));
+
+                if (lines)
+                {
+                    copyPointedMemory(record, offset + offsetof(att_LineNumberTable_info, line_number_table),
+                                      lines->line_number_table,
+                                      lines->line_number_table_length * sizeof(LineNumberTableEntry));
+                }
+
+                break;
+            }
+
+            case ATTR_Exceptions:
+            {
+                const att_Exceptions_info* exceptions = (const att_Exceptions_info*)info;
+                offset = copyPointedMemory(record, pointerOffset, info, sizeof(att_Exceptions_info));
+
+                if (exceptions)
+                {
+                    copyPointedMemory(record, offset + offsetof(att_Exceptions_info, exception_index_table),
+                                      exceptions->exception_index_table,
+                                      exceptions->number_of_exceptions * sizeof(uint16_t));
+                }
+
+                break;
+            }
+
+            case ATTR_Code:
+                recordCode(record, pointerOffset, (const att_Code_info*)info);
+                break;
+
+            // Deprecated and unknown attributes have no information
+            default:
+                clearPointer(record, pointerOffset);
+                break;
+        }
+    }
+}
+
+/// @brief Copies a class and everything it points to.
+/// @return 0 if memory couldn't be allocated, otherwise 1.
+static uint8_t recordClassData(ClassArchiveBuilder* builder, struct ArchiveRecord* record, JavaClass* jc)
+{
+    uint32_t pool, offset, symbolIndex, fixup[2];
+    uint16_t index;
+
+    appendBytes(&record->data, jc, sizeof(JavaClass), ARCHIVE_ALIGNMENT);
+
+    // Data created when the class is resolved isn't archived,
+    // and the class file itself is no longer needed.
+    clearPointer(record, offsetof(JavaClass, fileData));
+    clearPointer(record, offsetof(JavaClass, vtable));
+    clearPointer(record, offsetof(JavaClass, itables));
+    clearPointer(record, offsetof(JavaClass, supers));
+    clearPointer(record, offsetof(JavaClass, interfaceBits));
+    clearPointer(record, offsetof(JavaClass, loadedClass));
+
+    copyPointedMemory(record, offsetof(JavaClass, interfaces), jc->interfaces, jc->interfaceCount * sizeof(uint16_t));
+
+    pool = copyPointedMemory(record, offsetof(JavaClass, constantPool), jc->constantPool,
+                             (jc->constantPoolCount - 1) * sizeof(cp_info));
+
+    for (index = 0; jc->constantPool && index < jc->constantPoolCount - 1; index++)
+    {
+        cp_info* entry = jc->constantPool + index;
+        offset = pool + index * sizeof(cp_info);
+
+        switch (entry->tag)
+        {
+            case CONSTANT_Utf8:
+                symbolIndex = getSymbolIndex(builder, entry->Utf8.symbol);
+
+                if (symbolIndex == UINT32_MAX)
+                    return 0;
+
+                fixup[0] = offset;
+                fixup[1] = symbolIndex;
+                appendBytes(&record->symbolFixups, fixup, sizeof(fixup), sizeof(uint32_t));
+                clearPointer(record, offset + offsetof(cp_info, Utf8.bytes));
+                clearPointer(record, offset + offsetof(cp_info, Utf8.symbol));
+                break;
+
+            case CONSTANT_Fieldref:
+                clearPointer(record, offset + offsetof(cp_info, Fieldref.resolvedClass));
+                break;
+
+            case CONSTANT_Methodref:
+            case CONSTANT_InterfaceMethodref:
+                clearPointer(record, offset + offsetof(cp_info, Methodref.resolvedInterface));
+                break;
+
+            case CONSTANT_Long:
+            case CONSTANT_Double:
+                index++;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    offset = copyPointedMemory(record, offsetof(JavaClass, fields), jc->fields, jc->fieldCount * sizeof(field_info));
+
+    for (index = 0; jc->fields && index < jc->fieldCount; index++)
+    {
+        recordAttributes(record, offset + index * sizeof(field_info) + offsetof(field_info, attributes),
+                         jc->fields[index].attributes, jc->fields[index].attributes_count);
+    }
+
+    offset = copyPointedMemory(record, offsetof(JavaClass, methods), jc->methods, jc->methodCount * sizeof(method_info));
+
+    for (index = 0; jc->methods && index < jc->methodCount; index++)
+    {
+        recordAttributes(record, offset + index * sizeof(method_info) + offsetof(method_info, attributes),
+                         jc->methods[index].attributes, jc->methods[index].attributes_count);
+    }
+
+    recordAttributes(record, offsetof(JavaClass, attributes), jc->attributes, jc->attributeCount);
+
+    // The tables are hashed on the bytes of the symbols, so they stay valid
+    copyPointedMemory(record, offsetof(JavaClass, methodTable), jc->methodTable,
+                      jc->methodTableCapacity * sizeof(uint16_t));
+    copyPointedMemory(record, offsetof(JavaClass, fieldTable), jc->fieldTable,
+                      jc->fieldTableCapacity * sizeof(uint16_t));
+
+    return !record->data.failed && !record->fixups.failed && !record->symbolFixups.failed;
+}
+
+/// @brief Initializes a builder of archives without classes.
+void initClassArchiveBuilder(ClassArchiveBuilder* builder)
+{
+    builder->records = NULL;
+    builder->recordCount = 0;
+    builder->recordCapacity = 0;
+    builder->symbols = NULL;
+    builder->symbolCount = 0;
+    builder->symbolCapacity = 0;
+    builder->symbolTable = NULL;
+    builder->symbolTableCapacity = 0;
+}
+
+static void freeArchiveRecord(struct ArchiveRecord* record)
+{
+    if (record->name)
+        free(record->name);
+
+    if (record->source)
+        free(record->source);
+
+    freeByteBuffer(&record->data);
+    freeByteBuffer(&record->fixups);
+    freeByteBuffer(&record->symbolFixups);
+}
+
+/// @brief Releases all classes recorded by a builder.
+void freeClassArchiveBuilder(ClassArchiveBuilder* builder)
+{
+    uint32_t index;
+
+    for (index = 0; index < builder->recordCount; index++)
+        freeArchiveRecord(builder->records + index);
+
+    if (builder->records)
+        free(builder->records);
+
+    if (builder->symbols)
+        free(builder->symbols);
+
+    if (builder->symbolTable)
+        free(builder->symbolTable);
+
+    initClassArchiveBuilder(builder);
+}
+
+/// @brief Records a copy of a class to be written to an archive.
+/// @param ClassArchiveBuilder* builder - the builder of the archive
+/// @param JavaClass* jc - the class, which must have just been parsed,
+/// before it was resolved by the JVM
+/// @param const uint8_t* className_utf8_bytes - name of the class
+/// @param int32_t utf8_len - length of the name in bytes
+/// @param const char* source - where the class file was found
+/// @param const ClassFingerprint* fingerprint - fingerprint of the class file
+/// @return 0 if memory couldn't be allocated or an attribute of a method
+/// that wasn't parsed yet is invalid, in which case the class isn't
+/// recorded, otherwise 1.
+uint8_t recordArchivedClass(ClassArchiveBuilder* builder, JavaClass* jc, const uint8_t* className_utf8_bytes,
+                            int32_t utf8_len, const char* source, const ClassFingerprint* fingerprint)
+{
+    struct ArchiveRecord* record;
+    size_t sourceLength = strlen(source);
+    uint16_t index;
+
+    // The class file isn't archived, so attributes that were
+    // left to be parsed when needed must be parsed now.
+    for (index = 0; index < jc->methodCount; index++)
+    {
+        if (!loadMethodAttributes(jc, jc->methods + index))
+            return 0;
+    }
+
+    if (builder->recordCount == builder->recordCapacity)
+    {
+        uint32_t capacity = builder->recordCapacity ? 2 * builder->recordCapacity : 64;
+        struct ArchiveRecord* records = (struct ArchiveRecord*)malloc(capacity * sizeof(struct ArchiveRecord));
+
+        if (!records)
+            return 0;
+
+        if (builder->records)
+        {
+            memcpy(records, builder->records, builder->recordCount * sizeof(struct ArchiveRecord));
+            free(builder->records);
+        }
+
+        builder->records = records;
+        builder->recordCapacity = capacity;
+    }
+
+    record = builder->records + builder->recordCount;
+    memset(record, 0, sizeof(struct ArchiveRecord));
+    record->name = (uint8_t*)malloc(utf8_len ? utf8_len : 1);
+    record->source = (char*)malloc(sourceLength + 1);
+
+    if (!record->name || !record->source || !recordClassData(builder, record, jc))
+    {
+        freeArchiveRecord(record);
+        return 0;
+    }
+
+    memcpy(record->name, className_utf8_bytes, utf8_len);
+    memcpy(record->source, source, sourceLength + 1);
+    record->nameLength = (uint32_t)utf8_len;
+    record->hash = hashUTF8(className_utf8_bytes, utf8_len);
+    record->fingerprint = *fingerprint;
+    builder->recordCount++;
+    return 1;
+}
+
+/// @brief Writes all classes recorded by a builder to an archive file.
+/// @param ClassArchiveBuilder* builder - the builder of the archive
+/// @param const char* path - path of the archive file, which is replaced.
+/// The archive is first written to the same path followed by ".tmp".
+/// @return 0 if the file couldn't be written, otherwise 1.
+uint8_t writeClassArchive(ClassArchiveBuilder* builder, const char* path)
+{
+    ByteBuffer out = {NULL, 0, 0, 0};
+    ArchiveHeader header;
+    ArchivedClass* classes;
+    uint32_t* table;
+    uint32_t index, slot, length;
+    char* tempPath;
+    FILE* file;
+    uint8_t success;
+
+    header.magic = ARCHIVE_MAGIC;
+    header.version = ARCHIVE_VERSION;
+    header.layoutKey = getLayoutKey();
+    header.classCount = builder->recordCount;
+    header.symbolCount = builder->symbolCount;
+    header.tableCapacity = 16;
+
+    while (header.tableCapacity < 2 * header.classCount)
+        header.tableCapacity *= 2;
+
+    appendBytes(&out, NULL, sizeof(ArchiveHeader), ARCHIVE_ALIGNMENT);
+    header.classesOffset = appendBytes(&out, NULL, header.classCount * sizeof(ArchivedClass), ARCHIVE_ALIGNMENT);
+    header.tableOffset = appendBytes(&out, NULL, header.tableCapacity * sizeof(uint32_t), ARCHIVE_ALIGNMENT);
+    header.symbolsOffset = appendBytes(&out, NULL, header.symbolCount * sizeof(uint32_t), ARCHIVE_ALIGNMENT);
+
+    for (index = 0; index < builder->symbolCount; index++)
+    {
+        length = (uint32_t)builder->symbols[index]->length;
+        slot = appendBytes(&out, &length, sizeof(length), sizeof(uint32_t));
+        appendBytes(&out, builder->symbols[index]->bytes, length, 1);
+
+        if (!out.failed)
+            memcpy(out.data + header.symbolsOffset + index * sizeof(uint32_t), &slot, sizeof(slot));
+    }
+
+    for (index = 0; index < builder->recordCount; index++)
+    {
+        struct ArchiveRecord* record = builder->records + index;
+        ArchivedClass archived;
+
+        archived.nameOffset = appendBytes(&out, record->name, record->nameLength, 1);
+        archived.nameLength = record->nameLength;
+        archived.hash = record->hash;
+        archived.sourceLength = (uint32_t)strlen(record->source);
+        archived.sourceOffset = appendBytes(&out, record->source, archived.sourceLength, 1);
+        archived.fingerprint = record->fingerprint;
+        archived.dataSize = record->data.size;
+        archived.dataCRC = record->data.data ? calculateCRC32(record->data.data, record->data.size) : 0;
+        archived.dataOffset = appendBytes(&out, record->data.data, record->data.size, ARCHIVE_ALIGNMENT);
+        archived.fixupCount = record->fixups.size / sizeof(uint32_t);
+        archived.fixupOffset = appendBytes(&out, record->fixups.data, record->fixups.size, sizeof(uint32_t));
+        archived.symbolFixupCount = record->symbolFixups.size / (2 * sizeof(uint32_t));
+        archived.symbolFixupOffset = appendBytes(&out, record->symbolFixups.data, record->symbolFixups.size,
+                                                 sizeof(uint32_t));
+
+        if (!out.failed)
+            memcpy(out.data + header.classesOffset + index * sizeof(ArchivedClass), &archived, sizeof(archived));
+    }
+
+    if (out.failed)
+    {
+        freeByteBuffer(&out);
+        return 0;
+    }
+
+    // Nothing else is appended, so the buffer won't move anymore
+    header.size = out.size;
+    memcpy(out.data, &header, sizeof(header));
+    classes = (ArchivedClass*)(out.data + header.classesOffset);
+    table = (uint32_t*)(out.data + header.tableOffset);
+
+    for (index = 0; index < header.classCount; index++)
+    {
+        slot = classes[index].hash & (header.tableCapacity - 1);
+
+        while (table[slot])
+            slot = (slot + 1) & (header.tableCapacity - 1);
+
+        table[slot] = index + 1;
+    }
+
+    // The archive is written to another file that then replaces it, as the
+    // file being replaced may be the archive the classes were opened from,
+    // which is still mapped and must not change
+    tempPath = (char*)malloc(strlen(path) + 5);
+
+    if (!tempPath)
+    {
+        freeByteBuffer(&out);
+        return 0;
+    }
+
+    sprintf(tempPath, "%s.tmp", path);
+    file = fopen(tempPath, "wb");
+    success = file && fwrite(out.data, 1, out.size, file) == out.size;
+
+    if (file && fclose(file) != 0)
+        success = 0;
+
+#ifdef _WIN32
+    // On Windows, rename() doesn't replace files
+    if (success)
+        remove(path);
+#endif
+
+    if (file && (!success || rename(tempPath, path) != 0))
+    {
+        remove(tempPath);
+        success = 0;
+    }
+
+    free(tempPath);
+    freeByteBuffer(&out);
+    return success;
+}
+
+/// @brief Releases an archive and the memory where it was loaded.
+/// @note Classes opened from the archive point into it, so
+/// they must be closed before the archive is.
+void closeClassArchive(ClassArchive* archive)
+{
+    if (!archive)
+        return;
+
+    if (archive->data)
+    {
+#ifndef _WIN32
+        if (archive->mapped)
+            munmap(archive->data, archive->size);
+        else
+#endif
+            free(archive->data);
+    }
+
+    if (archive->symbols)
+        free(archive->symbols);
+
+    if (archive->openedClasses)
+        free(archive->openedClasses);
+
+    pthread_mutex_destroy(&archive->lock);
+    free(archive);
+}
+
+/// @brief Loads the whole content of an archive file to memory, mapping
+/// it when possible, or reading it to a buffer otherwise.
+/// @return 0 if the file couldn't be read, otherwise 1.
+static uint8_t loadArchiveData(ClassArchive* archive, const char* path)
+{
+    FILE* file;
+    long size;
+
+#ifndef _WIN32
+    struct stat st;
+    void* data;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return 0;
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (uint64_t)st.st_size > UINT32_MAX)
+    {
+        close(fd);
+        return 0;
+    }
+
+    // The mapping is private and writable, as classes are relocated
+    // where they are. Only pages of classes that are opened get copied.
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data != MAP_FAILED)
+    {
+        archive->data = (uint8_t*)data;
+        archive->size = (uint32_t)st.st_size;
+        archive->mapped = 1;
+        return 1;
+    }
+#endif
+
+    file = fopen(path, "rb");
+
+    if (!file)
+        return 0;
+
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) <= 0 ||
+        (unsigned long)size > UINT32_MAX || fseek(file, 0, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return 0;
+    }
+
+    archive->data = (uint8_t*)malloc((size_t)size);
+
+    if (!archive->data || fread(archive->data, 1, (size_t)size, file) != (size_t)size)
+    {
+        fclose(file);
+        return 0;
+    }
+
+    fclose(file);
+    archive->size = (uint32_t)size;
+    archive->mapped = 0;
+    return 1;
+}
+
+/// @brief Tells if a range of bytes is inside an archive.
+static uint8_t isInArchive(const ClassArchive* archive, uint32_t offset, uint64_t size)
+{
+    return offset <= archive->size && size <= archive->size - offset;
+}
+
+/// @brief Opens an archive of classes written by writeClassArchive().
+/// @param const char* path - path of the archive file
+/// @return The archive, or NULL if it couldn't be read, isn't an archive
+/// or was written by a build of the JVM with a different structure layout.
+ClassArchive* openClassArchive(const char* path)
+{
+    ClassArchive* archive = (ClassArchive*)malloc(sizeof(ClassArchive));
+    const ArchiveHeader* header;
+
+    if (!archive)
+        return NULL;
+
+    archive->data = NULL;
+    archive->size = 0;
+    archive->mapped = 0;
+    archive->symbols = NULL;
+    archive->openedClasses = NULL;
+    pthread_mutex_init(&archive->lock, NULL);
+
+    if (!loadArchiveData(archive, path) || archive->size < sizeof(ArchiveHeader))
+    {
+        closeClassArchive(archive);
+        return NULL;
+    }
+
+    header = (const ArchiveHeader*)archive->data;
+
+    if (header->magic != ARCHIVE_MAGIC || header->version != ARCHIVE_VERSION ||
+        header->layoutKey != getLayoutKey() || header->size != archive->size ||
+        header->tableCapacity == 0 || (header->tableCapacity & (header->tableCapacity - 1)) ||
+        !isInArchive(archive, header->classesOffset, (uint64_t)header->classCount * sizeof(ArchivedClass)) ||
+        !isInArchive(archive, header->tableOffset, (uint64_t)header->tableCapacity * sizeof(uint32_t)) ||
+        !isInArchive(archive, header->symbolsOffset, (uint64_t)header->symbolCount * sizeof(uint32_t)))
+    {
+        closeClassArchive(archive);
+        return NULL;
+    }
+
+    archive->symbols = (const Symbol**)malloc((header->symbolCount + 1) * sizeof(Symbol*));
+    archive->openedClasses = (uint8_t*)malloc(header->classCount + 1);
+
+    if (!archive->symbols || !archive->openedClasses)
+    {
+        closeClassArchive(archive);
+        return NULL;
+    }
+
+    memset(archive->symbols, 0, (header->symbolCount + 1) * sizeof(Symbol*));
+    memset(archive->openedClasses, 0, header->classCount + 1);
+    return archive;
+}
+
+/// @brief Gets the interned symbol of a string of an archive.
+/// @return The symbol, or NULL if the string is damaged or memory couldn't be allocated.
+static const Symbol* getArchivedSymbol(ClassArchive* archive, uint32_t index)
+{
+    const ArchiveHeader* header = (const ArchiveHeader*)archive->data;
+    uint32_t offset, length;
+
+    if (index >= header->symbolCount)
+        return NULL;
+
+    if (!archive->symbols[index])
+    {
+        memcpy(&offset, archive->data + header->symbolsOffset + index * sizeof(uint32_t), sizeof(offset));
+
+        if (!isInArchive(archive, offset, sizeof(uint32_t)))
+            return NULL;
+
+        memcpy(&length, archive->data + offset, sizeof(length));
+
+        if (!isInArchive(archive, offset + sizeof(uint32_t), length))
+            return NULL;
+
+        archive->symbols[index] = internSymbol(archive->data + offset + sizeof(uint32_t), (int32_t)length);
+    }
+
+    return archive->symbols[index];
+}
+
+/// @brief Finds and relocates the copy of a class, see openArchivedClass().
+static uint8_t relocateArchivedClass(ClassArchive* archive, JavaClass* jc, const uint8_t* className_utf8_bytes,
+                                     int32_t utf8_len, const char* source, const ClassFingerprint* fingerprint)
+{
+    const ArchiveHeader* header = (const ArchiveHeader*)archive->data;
+    const uint32_t* table = (const uint32_t*)(archive->data + header->tableOffset);
+    const ArchivedClass* classes = (const ArchivedClass*)(archive->data + header->classesOffset);
+    const ArchivedClass* archived = NULL;
+    const uint32_t* fixups;
+    const uint32_t* symbolFixups;
+    uint32_t hash = hashUTF8(className_utf8_bytes, utf8_len);
+    uint32_t mask = header->tableCapacity - 1;
+    uint32_t slot = hash & mask;
+    uint32_t index, probes = 0;
+    uintptr_t pointer;
+    uint8_t* data;
+    cp_info* entry;
+    const Symbol* symbol;
+
+    // The probes are limited, as a damaged table may have no empty slot
+    while (table[slot] && probes++ < header->tableCapacity)
+    {
+        archived = classes + table[slot] - 1;
+
+        if (table[slot] <= header->classCount && archived->hash == hash && archived->nameLength == (uint32_t)utf8_len &&
+            isInArchive(archive, archived->nameOffset, archived->nameLength) &&
+            !memcmp(archive->data + archived->nameOffset, className_utf8_bytes, utf8_len))
+        {
+            break;
+        }
+
+        archived = NULL;
+        slot = (slot + 1) & mask;
+    }
+
+    if (!archived || archive->openedClasses[table[slot] - 1] ||
+        archived->fingerprint.size != fingerprint->size ||
+        archived->fingerprint.crc != fingerprint->crc ||
+        archived->fingerprint.modificationTime != fingerprint->modificationTime ||
+        archived->sourceLength != strlen(source) ||
+        !isInArchive(archive, archived->sourceOffset, archived->sourceLength) ||
+        memcmp(archive->data + archived->sourceOffset, source, archived->sourceLength))
+    {
+        return 0;
+    }
+
+    if (archived->dataSize < sizeof(JavaClass) ||
+        !isInArchive(archive, archived->dataOffset, archived->dataSize) ||
+        !isInArchive(archive, archived->fixupOffset, (uint64_t)archived->fixupCount * sizeof(uint32_t)) ||
+        !isInArchive(archive, archived->symbolFixupOffset, (uint64_t)archived->symbolFixupCount * 2 * sizeof(uint32_t)) ||
+        calculateCRC32(archive->data + archived->dataOffset, archived->dataSize) != archived->dataCRC)
+    {
+        return 0;
+    }
+
+    data = archive->data + archived->dataOffset;
+    fixups = (const uint32_t*)(archive->data + archived->fixupOffset);
+    symbolFixups = (const uint32_t*)(archive->data + archived->symbolFixupOffset);
+
+    // Everything is checked before the copy is changed, so it
+    // stays untouched if it can't be used
+    for (index = 0; index < archived->fixupCount; index++)
+    {
+        if (fixups[index] > archived->dataSize - sizeof(uintptr_t))
+            return 0;
+
+        memcpy(&pointer, data + fixups[index], sizeof(pointer));
+
+        // Empty arrays copied last point right past the end of the copy
+        if (pointer > archived->dataSize)
+            return 0;
+    }
+
+    for (index = 0; index < archived->symbolFixupCount; index++)
+    {
+        if (symbolFixups[2 * index] > archived->dataSize - sizeof(cp_info) ||
+            !getArchivedSymbol(archive, symbolFixups[2 * index + 1]))
+        {
+            return 0;
+        }
+    }
+
+    for (index = 0; index < archived->fixupCount; index++)
+    {
+        memcpy(&pointer, data + fixups[index], sizeof(pointer));
+        pointer += (uintptr_t)data;
+        memcpy(data + fixups[index], &pointer, sizeof(pointer));
+    }
+
+    for (index = 0; index < archived->symbolFixupCount; index++)
+    {
+        entry = (cp_info*)(data + symbolFixups[2 * index]);
+        symbol = archive->symbols[symbolFixups[2 * index + 1]];
+        entry->Utf8.symbol = symbol;
+        entry->Utf8.bytes = symbol->bytes;
+    }
+
+    archive->openedClasses[table[slot] - 1] = 1;
+    memcpy(jc, data, sizeof(JavaClass));
+    jc->dataSource = CLASS_DATA_ARCHIVED;
+    jc->status = CLASS_STATUS_OK;
+    return 1;
+}
+
+/// @brief Opens the copy of a class stored in an archive.
+/// @param ClassArchive* archive - the archive
+/// @param JavaClass* jc - where the class will be opened
+/// @param const uint8_t* className_utf8_bytes - name of the class
+/// @param int32_t utf8_len - length of the name in bytes
+/// @param const char* source - where the class file was found in the class path
+/// @param const ClassFingerprint* fingerprint - fingerprint of that class file
+///
+/// The copy is only used if it was archived from the same source and the
+/// class file has the same fingerprint. The copy is relocated where it is,
+/// and \c jc receives its JavaClass structure, already parsed and validated.
+///
+/// @return 1 if the class was opened, or 0 if the archive has no usable copy of it.
+uint8_t openArchivedClass(ClassArchive* archive, JavaClass* jc, const uint8_t* className_utf8_bytes, int32_t utf8_len,
+                          const char* source, const ClassFingerprint* fingerprint)
+{
+    uint8_t success;
+
+    pthread_mutex_lock(&archive->lock);
+    success = relocateArchivedClass(archive, jc, className_utf8_bytes, utf8_len, source, fingerprint);
+    pthread_mutex_unlock(&archive->lock);
+    return success;
+}
+
+/// @brief Releases what the JVM created for a class opened from an archive,
+/// leaving the structures of the class, which belong to the archive.
+/// @param JavaClass* jc - the class, opened by openArchivedClass()
+void releaseArchivedClass(JavaClass* jc)
+{
+    attribute_info* attribute;
+    uint16_t index;
+
+    for (index = 0; index < jc->methodCount; index++)
+    {
+        attribute = getAttributeByType(jc->methods[index].attributes, jc->methods[index].attributes_count, ATTR_Code);
+
+        if (attribute)
+        {
+            att_Code_info* info = (att_Code_info*)attribute->info;
+            freeInlineCaches(info->instructions, info->instruction_count);
+        }
+    }
+
+    jc->constantPool = NULL;
+    jc->constantPoolCount = 0;
+    jc->interfaces = NULL;
+    jc->interfaceCount = 0;
+    jc->fields = NULL;
+    jc->fieldCount = 0;
+    jc->methods = NULL;
+    jc->methodCount = 0;
+    jc->attributes = NULL;
+    jc->attributeCount = 0;
+    jc->methodTable = NULL;
+    jc->methodTableCapacity = 0;
+    jc->fieldTable = NULL;
+    jc->fieldTableCapacity = 0;
+    jc->dataSource = CLASS_DATA_BORROWED;
+}
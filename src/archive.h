@@ -0,0 +1,102 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "javaclass.h"
+
+/// @brief Identifies the content of a class file without reading it, so a copy
+/// of the class kept in an archive can be checked against the file.
+typedef struct ClassFingerprint
+{
+    /// @brief Size of the class file, in bytes.
+    uint32_t size;
+
+    /// @brief CRC-32 of the class file, for classes in JAR files, otherwise 0.
+    uint32_t crc;
+
+    /// @brief Modification time of the class file, for classes
+    /// in directories, otherwise 0.
+    int64_t modificationTime;
+} ClassFingerprint;
+
+/// @brief An archive of classes, mapped to memory, whose classes
+/// can be opened without parsing their class files.
+/// @see openClassArchive(), openArchivedClass()
+typedef struct ClassArchive
+{
+    uint8_t* data;
+    uint32_t size;
+    uint8_t mapped;
+
+    /// @brief Interned symbol of each string of the archive,
+    /// NULL until a class that uses the string is opened.
+    const Symbol** symbols;
+
+    /// @brief Tells, for each class of the archive, if it has already
+    /// been opened. The copy in the archive is then modified by the JVM,
+    /// so it can't be opened again.
+    uint8_t* openedClasses;
+
+    /// @brief Protects \c symbols and \c openedClasses, as classes
+    /// can be opened by loader threads.
+    pthread_mutex_t lock;
+} ClassArchive;
+
+/// @brief Classes recorded to be written to an archive.
+/// @see recordArchivedClass(), writeClassArchive()
+typedef struct ClassArchiveBuilder
+{
+    struct ArchiveRecord* records;
+    uint32_t recordCount;
+    uint32_t recordCapacity;
+
+    /// @brief Distinct symbols used by the recorded classes.
+    const Symbol** symbols;
+    uint32_t symbolCount;
+    uint32_t symbolCapacity;
+
+    /// @brief Open addressing hash table with the index of each
+    /// symbol plus one, keyed by the symbol pointer.
+    uint32_t* symbolTable;
+    uint32_t symbolTableCapacity;
+} ClassArchiveBuilder;
+
+ClassArchive* openClassArchive(const char* path);
+void closeClassArchive(ClassArchive* archive);
+uint8_t openArchivedClass(ClassArchive* archive, JavaClass* jc, const uint8_t* className_utf8_bytes, int32_t utf8_len,
+                          const char* source, const ClassFingerprint* fingerprint);
+void releaseArchivedClass(JavaClass* jc);
+
+void initClassArchiveBuilder(ClassArchiveBuilder* builder);
+void freeClassArchiveBuilder(ClassArchiveBuilder* builder);
+uint8_t recordArchivedClass(ClassArchiveBuilder* builder, JavaClass* jc, const uint8_t* className_utf8_bytes,
+                            int32_t utf8_len, const char* source, const ClassFingerprint* fingerprint);
+uint8_t writeClassArchive(ClassArchiveBuilder* builder, const char* path);
+
+#endif // ARCHIVE_H
+
+/// @defgroup archive Class archive module
+///
+/// @brief Keeps classes that have already been parsed and validated in a file,
+/// so later runs of the JVM can open them without reading their class files.
+///
+/// A training run records every class it loads (see recordArchivedClass()) and
+/// writes them to an archive at exit. Each class is stored as a copy of its
+/// JavaClass structure followed by everything it points to (constant pool, fields,
+/// methods, attributes and decoded instructions), with pointers replaced by offsets
+/// from the start of the copy. A list of those pointers is stored with the class,
+/// so opening it only adds the address of the copy to each of them, and sets the
+/// symbols of the UTF-8 constants, which are stored once for the whole archive.
+///
+/// Later runs map the archive (see openClassArchive()). When a class is found
+/// in the class path, the archived copy is used instead of the class file if it
+/// came from the same place and the file didn't change, which is told by its size
+/// and modification time, or its CRC-32 for classes in JAR files.
+///
+/// The structures are stored as they are in memory, so an archive can only be used
+/// by a build of the JVM with the same structure layout, which is checked when the
+/// archive is opened. The content of the archive is trusted: only the offsets of
+/// pointers are checked.
+///
+/// @see archive.c, openClassFromClassPath()
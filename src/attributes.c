@@ -3,6 +3,7 @@
 #include "utf8.h"
 #include "opcodes.h"
 #include "debugging.h"
+#include "exceptions.h"
 #include <inttypes.h> // Usage of macro "PRId64" to print 64 bit integer
 
 #define DECLARE_ATTR_FUNCS(attr) \
@@ -18,9 +19,12 @@ DECLARE_ATTR_FUNCS(Code)
 DECLARE_ATTR_FUNCS(Deprecated)
 DECLARE_ATTR_FUNCS(Exceptions)
 
-char readAttribute(JavaClass* jc, attribute_info* entry)
+/// @brief Reads the name and length of an attribute, and tells its type.
+/// @return 0 if the header couldn't be read or the name is invalid, otherwise 1.
+static uint8_t readAttributeHeader(JavaClass* jc, attribute_info* entry)
 {
     entry->info = NULL;
+    entry->dataOffset = 0;
 
     if (!readu2(jc, &entry->name_index) ||
         !readu4(jc, &entry->length))
@@ -42,13 +46,8 @@ char readAttribute(JavaClass* jc, attribute_info* entry)
     }
 
     #define IF_ATTR_CHECK(name) \
-        if (cmp_UTF8_Ascii(cp->Utf8.bytes, cp->Utf8.length, (uint8_t*)#name, sizeof(#name) - 1)) { \
-            entry->attributeType = ATTR_##name; \
-            result = readAttribute##name(jc, entry); \
-        }
-
-    uint32_t totalBytesRead = jc->totalBytesRead;
-    char result;
+        if (cmp_UTF8_Ascii(cp->Utf8.bytes, cp->Utf8.length, (uint8_t*)#name, sizeof(#name) - 1)) \
+            entry->attributeType = ATTR_##name;
 
     IF_ATTR_CHECK(ConstantValue)
     else IF_ATTR_CHECK(SourceFile)
@@ -58,34 +57,114 @@ char readAttribute(JavaClass* jc, attribute_info* entry)
     else IF_ATTR_CHECK(Deprecated)
     else IF_ATTR_CHECK(Exceptions)
     else
-    {
-        uint32_t u32;
+        entry->attributeType = ATTR_Unknown;
 
-        for (u32 = 0; u32 < entry->length; u32++)
-        {
-            if (fgetc(jc->file) == EOF)
+    #undef IF_ATTR_CHECK
+    return 1;
+}
+
+/// @brief Reads the information of an attribute whose header has
+/// been read, which must take exactly the length of the attribute.
+static char readAttributeInfo(JavaClass* jc, attribute_info* entry)
+{
+    #define ATTR_CASE(attr) case ATTR_##attr: result = readAttribute##attr(jc, entry); break;
+
+    uint32_t totalBytesRead = jc->totalBytesRead;
+    char result;
+
+    switch (entry->attributeType)
+    {
+        ATTR_CASE(ConstantValue)
+        ATTR_CASE(SourceFile)
+        ATTR_CASE(InnerClasses)
+        ATTR_CASE(Code)
+        ATTR_CASE(LineNumberTable)
+        ATTR_CASE(Deprecated)
+        ATTR_CASE(Exceptions)
+        default:
+            if (!readBytes(jc, entry->length))
             {
                 jc->status = UNEXPECTED_EOF_READING_ATTRIBUTE_INFO;
                 return 0;
             }
 
-            jc->totalBytesRead++;
-        }
-
-        result = 1;
-        entry->attributeType = ATTR_Unknown;
+            result = 1;
+            break;
     }
 
-    if (jc->totalBytesRead - totalBytesRead != entry->length)
+    #undef ATTR_CASE
+
+    if (result && jc->totalBytesRead - totalBytesRead != entry->length)
     {
         jc->status = ATTRIBUTE_LENGTH_MISMATCH;
         return 0;
     }
 
-    #undef ATTR_CHECK
     return result;
 }
 
+char readAttribute(JavaClass* jc, attribute_info* entry)
+{
+    return readAttributeHeader(jc, entry) && readAttributeInfo(jc, entry);
+}
+
+/// @brief Reads the header of an attribute and skips its information,
+/// which is parsed later by loadAttribute(), when it is needed.
+///
+/// @return 0 if the attribute couldn't be read, otherwise 1.
+/// @note Only the name and the length of the attribute are checked,
+/// so errors in the information are found when it is loaded.
+char readAttributeLazily(JavaClass* jc, attribute_info* entry)
+{
+    if (!readAttributeHeader(jc, entry))
+        return 0;
+
+    entry->dataOffset = jc->totalBytesRead;
+
+    if (!readBytes(jc, entry->length))
+    {
+        entry->dataOffset = 0;
+        jc->status = UNEXPECTED_EOF_READING_ATTRIBUTE_INFO;
+        return 0;
+    }
+
+    return 1;
+}
+
+/// @brief Parses the information of an attribute that was skipped
+/// by readAttributeLazily(). Does nothing if it was already parsed.
+///
+/// @param JavaClass* jc - the class that has the attribute, whose
+/// file data is still in memory.
+/// @param attribute_info* entry - the attribute to be parsed.
+///
+/// @return 0 if the information of the attribute is invalid, in which
+/// case the status of the class tells why, otherwise 1.
+uint8_t loadAttribute(JavaClass* jc, attribute_info* entry)
+{
+    if (!entry->dataOffset)
+        return 1;
+
+    // The class was read already, so the read cursor is moved
+    // to the attribute, and restored afterwards.
+    uint32_t totalBytesRead = jc->totalBytesRead;
+    uint8_t result;
+
+    jc->totalBytesRead = entry->dataOffset;
+    result = readAttributeInfo(jc, entry);
+    jc->totalBytesRead = totalBytesRead;
+
+    if (!result)
+    {
+        // Kept as not parsed, so it keeps failing if loaded again
+        freeAttributeInfo(entry);
+        return 0;
+    }
+
+    entry->dataOffset = 0;
+    return 1;
+}
+
 void ident(int level)
 {
     while (level-- > 0)
@@ -468,7 +547,12 @@ uint8_t readAttributeCode(JavaClass* jc, attribute_info* entry)
     }
 
     info->code = NULL;
+    info->instructions = NULL;
     info->exception_table = NULL;
+    info->exception_ranges = NULL;
+    info->exception_range_count = 0;
+    info->exception_handlers = NULL;
+    info->attributes = NULL;
 
     if (!readu2(jc, &info->max_stack) ||
         !readu2(jc, &info->max_locals) ||
@@ -484,23 +568,17 @@ uint8_t readAttributeCode(JavaClass* jc, attribute_info* entry)
         return 0;
     }
 
-    info->code = (uint8_t*)malloc(info->code_length);
+    // The bytecode isn't copied, it stays in the class file data
+    info->code = readBytes(jc, info->code_length);
 
     if (!info->code)
-    {
-        jc->status = MEMORY_ALLOCATION_FAILED;
-        return 0;
-    }
-
-    if (fread(info->code, sizeof(uint8_t), info->code_length, jc->file) != info->code_length)
     {
         jc->status = UNEXPECTED_EOF_READING_ATTRIBUTE_INFO;
         return 0;
     }
 
-    jc->totalBytesRead += info->code_length;
-
-    // TODO: check if all instructions are valid and have correct parameters.
+    if (!decodeBytecode(jc, info->code, info->code_length, &info->instructions, &info->instruction_count))
+        return 0;
 
     if (!readu2(jc, &info->exception_table_length))
     {
@@ -508,14 +586,15 @@ uint8_t readAttributeCode(JavaClass* jc, attribute_info* entry)
         return 0;
     }
 
-    // TODO: check if exception_table_length isn't 0, as that could lead to a crash
-
-    info->exception_table = (ExceptionTableEntry*)malloc(info->exception_table_length * sizeof(ExceptionTableEntry));
-
-    if (!info->exception_table)
+    if (info->exception_table_length > 0)
     {
-        jc->status = MEMORY_ALLOCATION_FAILED;
-        return 0;
+        info->exception_table = (ExceptionTableEntry*)malloc(info->exception_table_length * sizeof(ExceptionTableEntry));
+
+        if (!info->exception_table)
+        {
+            jc->status = MEMORY_ALLOCATION_FAILED;
+            return 0;
+        }
     }
 
     ExceptionTableEntry* except = info->exception_table;
@@ -532,11 +611,14 @@ uint8_t readAttributeCode(JavaClass* jc, attribute_info* entry)
         }
 
         except++;
-        // TODO: check if start_pc, end_pc and handler_pc are valid program counters inside
-        // the code. Also check if catch_type is a pointer to a valid class with Throwable as
-        // parent, or if it is NULL (finally block).
     }
 
+    // Also checks that the pcs of the table are valid and that catch
+    // types are classes. Whether they extend Throwable is only known
+    // when they are resolved, as an exception is being caught.
+    if (!buildExceptionIndex(jc, info))
+        return 0;
+
     if (!readu2(jc, &info->attributes_count))
     {
         jc->status = UNEXPECTED_EOF_READING_ATTRIBUTE_INFO;
@@ -1112,12 +1194,18 @@ void freeAttributeCode(attribute_info* entry)
 
     if (info)
     {
-        if (info->code)
-            free(info->code);
+        if (info->instructions)
+            freeInstructions(info->instructions, info->instruction_count);
 
         if (info->exception_table)
             free(info->exception_table);
 
+        if (info->exception_ranges)
+            free(info->exception_ranges);
+
+        if (info->exception_handlers)
+            free(info->exception_handlers);
+
         if (info->attributes)
         {
             uint16_t u16;
@@ -1245,6 +1333,14 @@ void printAttribute(JavaClass* jc, attribute_info* entry, int identationLevel)
 {
     #define ATTR_CASE(attr) case ATTR_##attr: printAttribute##attr(jc, entry, identationLevel); break;
 
+    // Attributes that were read lazily are parsed to be printed
+    if (!loadAttribute(jc, entry))
+    {
+        ident(identationLevel);
+        printf("Attribute couldn't be parsed: %s.\n", decodeJavaClassStatus(jc->status));
+        return;
+    }
+
     switch (entry->attributeType)
     {
         ATTR_CASE(Code)
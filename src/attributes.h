@@ -2,15 +2,22 @@
 #define ATTRIBUTES_H
 
 typedef struct attribute_info attribute_info;
+typedef struct att_Code_info att_Code_info;
 
 #include <stdint.h>
 #include "javaclass.h"
+#include "bytecode.h"
 
 struct attribute_info {
     uint16_t name_index;
     uint32_t length;
     void* info;
     uint8_t attributeType;
+
+    /// @brief Offset in the class file data of the information of the
+    /// attribute, if it was skipped by readAttributeLazily() and hasn't
+    /// been parsed yet, otherwise 0. @see loadAttribute()
+    uint32_t dataOffset;
 };
 
 enum AttributeType {
@@ -59,18 +66,62 @@ typedef struct {
     uint16_t end_pc;
     uint16_t handler_pc;
     uint16_t catch_type;
+
+    /// @brief Index of the decoded instruction at \c handler_pc.
+    uint32_t handler_index;
 } ExceptionTableEntry;
 
+/// @brief Range of the bytecode of a method where the same
+/// exception handlers are active.
+/// @see buildExceptionIndex(), findExceptionRange()
 typedef struct {
+    /// @brief Offset of the first byte of the range.
+    uint16_t start_pc;
+
+    /// @brief Offset right after the last byte of the range.
+    uint16_t end_pc;
+
+    /// @brief Position in \c exception_handlers of the first
+    /// handler of the range.
+    uint32_t first_handler;
+
+    /// @brief Number of handlers of the range.
+    uint16_t handler_count;
+} ExceptionRange;
+
+struct att_Code_info {
     uint16_t max_stack;
     uint16_t max_locals;
     uint32_t code_length;
-    uint8_t* code;
+
+    /// @brief The bytes of the code, pointing into the
+    /// class file data, which is kept while the class is open.
+    const uint8_t* code;
+
+    /// @brief The bytecode of the method, decoded when the
+    /// attribute is read, so it can be executed without having
+    /// to decode instructions again at every step.
+    /// @see decodeBytecode()
+    Instruction* instructions;
+    uint32_t instruction_count;
+
     uint16_t exception_table_length;
     ExceptionTableEntry* exception_table;
+
+    /// @brief Ranges of the bytecode covered by exception handlers,
+    /// sorted and disjoint, so the handlers of an instruction are
+    /// found with a binary search.
+    /// @see buildExceptionIndex()
+    ExceptionRange* exception_ranges;
+    uint32_t exception_range_count;
+
+    /// @brief Indexes in \c exception_table of the handlers of each
+    /// range, in the order of the table, which is the order they are tried.
+    uint16_t* exception_handlers;
+
     uint16_t attributes_count;
     attribute_info* attributes;
-} att_Code_info;
+};
 
 typedef struct {
     uint16_t number_of_exceptions;
@@ -78,6 +129,8 @@ typedef struct {
 } att_Exceptions_info;
 
 char readAttribute(JavaClass* jc, attribute_info* entry);
+char readAttributeLazily(JavaClass* jc, attribute_info* entry);
+uint8_t loadAttribute(JavaClass* jc, attribute_info* entry);
 void freeAttributeInfo(attribute_info* entry);
 void printAttribute(JavaClass* jc, attribute_info* entry, int identationLevel);
 void printAllAttributes(JavaClass* jc);
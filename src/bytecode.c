@@ -0,0 +1,414 @@
+#include "bytecode.h"
+#include "opcodes.h"
+#include "debugging.h"
+
+/// @brief Value used to mark offsets of the bytecode that aren't
+/// the beginning of an instruction.
+#define NOT_AN_INSTRUCTION 0xFFFFFFFF
+
+#define READ_S2(offset) ((int16_t)(((uint16_t)code[offset] << 8) | code[(offset) + 1]))
+#define READ_U2(offset) ((uint16_t)(((uint16_t)code[offset] << 8) | code[(offset) + 1]))
+#define READ_S4(offset) ((int32_t)(((uint32_t)code[offset] << 24) | ((uint32_t)code[(offset) + 1] << 16) | \
+                                   ((uint32_t)code[(offset) + 2] << 8) | code[(offset) + 3]))
+
+/// @brief Gets how many bytes an instruction takes in the bytecode,
+/// including its opcode and operands.
+/// @param const uint8_t* code - the bytecode of the method
+/// @param uint32_t offset - offset of the instruction in the bytecode
+/// @param uint32_t code_length - length of the bytecode
+/// @return The length of the instruction, or 0 if the instruction
+/// is truncated or has invalid operands.
+static uint32_t getInstructionLength(const uint8_t* code, uint32_t offset, uint32_t code_length)
+{
+    uint8_t opcode = code[offset];
+    int64_t length;
+
+    #define OPCODE_INTERVAL(begin, end) (opcode >= opcode_##begin && opcode <= opcode_##end)
+
+    if (opcode == opcode_bipush || opcode == opcode_ldc || opcode == opcode_newarray ||
+        opcode == opcode_ret || OPCODE_INTERVAL(iload, aload) || OPCODE_INTERVAL(istore, astore))
+    {
+        length = 2;
+    }
+    else if (opcode == opcode_sipush || opcode == opcode_ldc_w || opcode == opcode_ldc2_w ||
+             opcode == opcode_iinc || OPCODE_INTERVAL(ifeq, jsr) || OPCODE_INTERVAL(getstatic, invokestatic) ||
+             opcode == opcode_new || opcode == opcode_anewarray || OPCODE_INTERVAL(checkcast, instanceof) ||
+             OPCODE_INTERVAL(ifnull, ifnonnull))
+    {
+        length = 3;
+    }
+    else if (opcode == opcode_multianewarray)
+    {
+        length = 4;
+    }
+    else if (OPCODE_INTERVAL(invokeinterface, invokedynamic) || OPCODE_INTERVAL(goto_w, jsr_w))
+    {
+        length = 5;
+    }
+    else if (opcode == opcode_wide)
+    {
+        if (offset + 1 >= code_length)
+            return 0;
+
+        opcode = code[offset + 1];
+
+        if (opcode == opcode_iinc)
+            length = 6;
+        else if (opcode == opcode_ret || OPCODE_INTERVAL(iload, aload) || OPCODE_INTERVAL(istore, astore))
+            length = 4;
+        else
+            return 0;
+    }
+    else if (opcode == opcode_tableswitch || opcode == opcode_lookupswitch)
+    {
+        // Operands start after 0 to 3 padding bytes, at an offset
+        // that is a multiple of 4.
+        uint32_t operands = (offset + 4) & ~3;
+
+        if ((uint64_t)operands + 12 > code_length)
+            return 0;
+
+        if (opcode == opcode_tableswitch)
+        {
+            int32_t lowValue = READ_S4(operands + 4);
+            int32_t highValue = READ_S4(operands + 8);
+
+            if (lowValue > highValue)
+                return 0;
+
+            length = operands + 12 - offset + 4 * ((int64_t)highValue - lowValue + 1);
+        }
+        else
+        {
+            int32_t npairs = READ_S4(operands + 4);
+
+            if (npairs < 0)
+                return 0;
+
+            length = operands + 8 - offset + 8 * (int64_t)npairs;
+        }
+    }
+    else if (OPCODE_INTERVAL(getstatic_quick, instanceof_quick))
+    {
+        // Internal opcodes can only be created by the JVM itself
+        return 0;
+    }
+    else
+    {
+        // Instructions without operands, and also unknown
+        // instructions, which will be reported when executed.
+        length = 1;
+    }
+
+    #undef OPCODE_INTERVAL
+
+    if (offset + length > code_length)
+        return 0;
+
+    return (uint32_t)length;
+}
+
+/// @brief Translates the bytecode of a method into an array of
+/// decoded instructions.
+/// @param JavaClass* jc - pointer to the class being read, whose
+/// status is set in case of errors.
+/// @param const uint8_t* code - the bytecode of the method.
+/// @param uint32_t code_length - length of the bytecode, in bytes.
+/// @param [out] Instruction** outInstructions - receives the array of
+/// decoded instructions, which must be released with freeInstructions().
+/// @param [out] uint32_t* outCount - receives the number of instructions.
+///
+/// This is done once for each method, when its Code attribute is read,
+/// so the interpreter doesn't need to assemble the operands of the
+/// instructions byte by byte every time they are executed. Branch offsets
+/// are converted to the index of the target instruction, and the jump
+/// tables of tableswitch and lookupswitch are extracted.
+///
+/// @return 1 if the bytecode was successfully decoded, otherwise 0. Decoding
+/// fails if an instruction is truncated or uses an internal opcode (such as
+/// getfield_quick), a wide prefix is followed by an instruction that can't be
+/// widened, a switch has invalid operands, a branch target isn't the beginning
+/// of an instruction or if memory allocation fails.
+/// @see Instruction, executeFrame()
+uint8_t decodeBytecode(JavaClass* jc, const uint8_t* code, uint32_t code_length, Instruction** outInstructions, uint32_t* outCount)
+{
+    uint32_t* indexes = (uint32_t*)malloc(code_length * sizeof(uint32_t));
+    Instruction* instructions = NULL;
+    uint32_t count = 0;
+    uint32_t offset, length, index;
+
+    if (!indexes)
+    {
+        jc->status = MEMORY_ALLOCATION_FAILED;
+        return 0;
+    }
+
+    // First pass: find where each instruction begins, so
+    // that branch offsets can be converted to instruction indexes.
+    for (offset = 0; offset < code_length; offset += length)
+    {
+        length = getInstructionLength(code, offset, code_length);
+
+        if (length == 0)
+        {
+            free(indexes);
+            jc->status = ATTRIBUTE_INVALID_CODE;
+            return 0;
+        }
+
+        indexes[offset] = count++;
+
+        for (index = 1; index < length; index++)
+            indexes[offset + index] = NOT_AN_INSTRUCTION;
+    }
+
+    instructions = (Instruction*)malloc(count * sizeof(Instruction));
+
+    if (!instructions)
+    {
+        free(indexes);
+        jc->status = MEMORY_ALLOCATION_FAILED;
+        return 0;
+    }
+
+    for (index = 0; index < count; index++)
+        instructions[index].switchTable = NULL;
+
+    #define BRANCH_TARGET(target, out) \
+        { \
+            int64_t address = (int64_t)(target); \
+            if (address < 0 || address >= code_length || indexes[address] == NOT_AN_INSTRUCTION) \
+                goto invalid_code; \
+            out = (int32_t)indexes[address]; \
+        }
+
+    // Second pass: decode the operands of each instruction.
+    Instruction* instruction = instructions;
+
+    for (offset = 0; offset < code_length; offset += length, instruction++)
+    {
+        uint8_t opcode = code[offset];
+
+        length = getInstructionLength(code, offset, code_length);
+        instruction->opcode = opcode;
+        instruction->offset = (uint16_t)offset;
+        instruction->operand1 = 0;
+        instruction->operand2 = 0;
+
+        switch (opcode)
+        {
+            case opcode_bipush:
+                instruction->operand1 = (int8_t)code[offset + 1];
+                break;
+
+            case opcode_sipush:
+                instruction->operand1 = READ_S2(offset + 1);
+                break;
+
+            case opcode_ldc:
+            case opcode_iload:
+            case opcode_lload:
+            case opcode_fload:
+            case opcode_dload:
+            case opcode_aload:
+            case opcode_istore:
+            case opcode_lstore:
+            case opcode_fstore:
+            case opcode_dstore:
+            case opcode_astore:
+            case opcode_ret:
+            case opcode_newarray:
+                instruction->operand1 = code[offset + 1];
+                break;
+
+            case opcode_ldc_w:
+            case opcode_ldc2_w:
+            case opcode_getstatic:
+            case opcode_putstatic:
+            case opcode_getfield:
+            case opcode_putfield:
+            case opcode_invokevirtual:
+            case opcode_invokespecial:
+            case opcode_invokestatic:
+            case opcode_invokeinterface:
+            case opcode_invokedynamic:
+            case opcode_new:
+            case opcode_anewarray:
+            case opcode_checkcast:
+            case opcode_instanceof:
+                instruction->operand1 = READ_U2(offset + 1);
+                break;
+
+            case opcode_multianewarray:
+                instruction->operand1 = READ_U2(offset + 1);
+                instruction->operand2 = code[offset + 3];
+                break;
+
+            case opcode_iinc:
+                instruction->operand1 = code[offset + 1];
+                instruction->operand2 = (int8_t)code[offset + 2];
+                break;
+
+            case opcode_wide:
+                instruction->opcode = code[offset + 1];
+                instruction->operand1 = READ_U2(offset + 2);
+
+                if (instruction->opcode == opcode_iinc)
+                    instruction->operand2 = READ_S2(offset + 4);
+
+                break;
+
+            case opcode_ifeq:
+            case opcode_ifne:
+            case opcode_iflt:
+            case opcode_ifge:
+            case opcode_ifgt:
+            case opcode_ifle:
+            case opcode_if_icmpeq:
+            case opcode_if_icmpne:
+            case opcode_if_icmplt:
+            case opcode_if_icmpge:
+            case opcode_if_icmpgt:
+            case opcode_if_icmple:
+            case opcode_if_acmpeq:
+            case opcode_if_acmpne:
+            case opcode_goto:
+            case opcode_jsr:
+            case opcode_ifnull:
+            case opcode_ifnonnull:
+                BRANCH_TARGET(offset + READ_S2(offset + 1), instruction->operand1)
+                break;
+
+            case opcode_goto_w:
+            case opcode_jsr_w:
+                BRANCH_TARGET(offset + (int64_t)READ_S4(offset + 1), instruction->operand1)
+                break;
+
+            case opcode_tableswitch:
+            {
+                uint32_t operands = (offset + 4) & ~3;
+                int32_t lowValue = READ_S4(operands + 4);
+                int32_t highValue = READ_S4(operands + 8);
+                uint32_t targets = (uint32_t)((int64_t)highValue - lowValue + 1);
+
+                instruction->operand1 = lowValue;
+                instruction->operand2 = highValue;
+                instruction->switchTable = (int32_t*)malloc((1 + targets) * sizeof(int32_t));
+
+                if (!instruction->switchTable)
+                    goto out_of_memory;
+
+                BRANCH_TARGET(offset + (int64_t)READ_S4(operands), instruction->switchTable[0])
+
+                for (index = 0; index < targets; index++)
+                    BRANCH_TARGET(offset + (int64_t)READ_S4(operands + 12 + 4 * index), instruction->switchTable[1 + index])
+
+                break;
+            }
+
+            case opcode_lookupswitch:
+            {
+                uint32_t operands = (offset + 4) & ~3;
+                int32_t npairs = READ_S4(operands + 4);
+
+                instruction->operand1 = npairs;
+                instruction->switchTable = (int32_t*)malloc((1 + 2 * npairs) * sizeof(int32_t));
+
+                if (!instruction->switchTable)
+                    goto out_of_memory;
+
+                BRANCH_TARGET(offset + (int64_t)READ_S4(operands), instruction->switchTable[0])
+
+                for (index = 0; index < (uint32_t)npairs; index++)
+                {
+                    int32_t match = READ_S4(operands + 8 + 8 * index);
+
+                    // Matches must be sorted, so they can be binary searched
+                    if (index > 0 && match <= instruction->switchTable[2 * index - 1])
+                        goto invalid_code;
+
+                    instruction->switchTable[1 + 2 * index] = match;
+                    BRANCH_TARGET(offset + (int64_t)READ_S4(operands + 12 + 8 * index), instruction->switchTable[2 + 2 * index])
+                }
+
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    #undef BRANCH_TARGET
+
+    free(indexes);
+    *outInstructions = instructions;
+    *outCount = count;
+    return 1;
+
+invalid_code:
+    jc->status = ATTRIBUTE_INVALID_CODE;
+    free(indexes);
+    freeInstructions(instructions, count);
+    return 0;
+
+out_of_memory:
+    jc->status = MEMORY_ALLOCATION_FAILED;
+    free(indexes);
+    freeInstructions(instructions, count);
+    return 0;
+}
+
+/// @brief Releases an array of decoded instructions, including
+/// their jump tables and inline caches.
+/// @param Instruction* instructions - the array returned by decodeBytecode().
+/// @param uint32_t count - number of instructions in the array.
+void freeInstructions(Instruction* instructions, uint32_t count)
+{
+    uint32_t index;
+
+    if (!instructions)
+        return;
+
+    for (index = 0; index < count; index++)
+    {
+        if (instructions[index].switchTable)
+            free(instructions[index].switchTable);
+    }
+
+    free(instructions);
+}
+
+/// @brief Releases the inline caches of an array of decoded instructions,
+/// leaving their jump tables, which aren't owned by the array.
+/// @param Instruction* instructions - the decoded instructions.
+/// @param uint32_t count - number of instructions in the array.
+/// @see releaseArchivedClass()
+void freeInlineCaches(Instruction* instructions, uint32_t count)
+{
+    uint32_t index;
+
+    for (index = 0; instructions && index < count; index++)
+    {
+        switch (instructions[index].opcode)
+        {
+            case opcode_invokevirtual_quick:
+            case opcode_invokeinterface_quick:
+            case opcode_invokenative_quick:
+            case opcode_invokestatic_quick:
+            case opcode_invokespecial_quick:
+                free(instructions[index].inlineCache);
+                instructions[index].inlineCache = NULL;
+                break;
+
+            case opcode_checkcast_quick:
+            case opcode_instanceof_quick:
+                free(instructions[index].typeCheckCache);
+                instructions[index].typeCheckCache = NULL;
+                break;
+
+            default:
+                break;
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+typedef struct Instruction Instruction;
+typedef struct InlineCache InlineCache;
+typedef struct TypeCheckCache TypeCheckCache;
+
+#include <stdint.h>
+#include "javaclass.h"
+
+/// @brief An instruction of a method, decoded from the method's
+/// bytecode when its Code attribute is read.
+///
+/// The operands of the instruction are already assembled from the
+/// big-endian bytes of the bytecode, and branch offsets are replaced
+/// by the absolute index of the target instruction in the array of
+/// decoded instructions of the method.
+/// @see decodeBytecode()
+struct Instruction
+{
+    /// @brief Opcode of the instruction.
+    ///
+    /// Instructions prefixed by "wide" are decoded with the
+    /// opcode of the instruction being widened.
+    /// Field and invoke instructions are rewritten into their
+    /// quick variants once their constant pool entry is resolved.
+    uint8_t opcode;
+
+    /// @brief Offset of the instruction in the original bytecode.
+    uint16_t offset;
+
+    /// @brief First operand of the instruction.
+    ///
+    /// Depending on the instruction, this is a local variable index,
+    /// a constant pool index, an immediate value, the index of the
+    /// target instruction of a branch, the type of a newarray, the
+    /// lowest index of a tableswitch or the number of pairs of a
+    /// lookupswitch.
+    int32_t operand1;
+
+    /// @brief Second operand of the instruction.
+    ///
+    /// This is the increment of an iinc, the number of dimensions
+    /// of a multianewarray or the highest index of a tableswitch.
+    int32_t operand2;
+
+    union {
+        /// @brief Jump table of tableswitch and lookupswitch.
+        ///
+        /// The first element is the index of the default target instruction.
+        /// For tableswitch, it is followed by the target of each index, from
+        /// the lowest to the highest. For lookupswitch, it is followed by
+        /// the pairs of match and target, sorted by match.
+        int32_t* switchTable;
+
+        /// @brief Inline cache of invoke instructions, allocated
+        /// when the instruction is quickened.
+        struct InlineCache* inlineCache;
+
+        /// @brief Cache of checkcast and instanceof, allocated
+        /// when the instruction is quickened.
+        struct TypeCheckCache* typeCheckCache;
+    };
+};
+
+uint8_t decodeBytecode(JavaClass* jc, const uint8_t* code, uint32_t code_length, Instruction** outInstructions, uint32_t* outCount);
+void freeInstructions(Instruction* instructions, uint32_t count);
+void freeInlineCaches(Instruction* instructions, uint32_t count);
+
+#endif // BYTECODE_H
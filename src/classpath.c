@@ -0,0 +1,519 @@
+// Needed for the POSIX file functions in strict C99 mode
+#define _DEFAULT_SOURCE
+
+#include <string.h>
+#include <sys/stat.h>
+#include "classpath.h"
+#include "inflate.h"
+#include "symbols.h"
+#include "debugging.h"
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+/// @cond
+#define ZIP_LOCAL_HEADER_SIGNATURE 0x04034B50u
+#define ZIP_CENTRAL_HEADER_SIGNATURE 0x02014B50u
+#define ZIP_END_SIGNATURE 0x06054B50u
+
+#define ZIP_LOCAL_HEADER_SIZE 30
+#define ZIP_CENTRAL_HEADER_SIZE 46
+#define ZIP_END_SIZE 22
+#define ZIP_MAX_COMMENT_SIZE 0xFFFF
+
+#define ZIP_METHOD_STORED 0
+#define ZIP_METHOD_DEFLATE 8
+#define ZIP_FLAG_ENCRYPTED 0x0001
+
+// ZIP files are little-endian
+#define READ_LE16(p) ((uint16_t)((p)[0] | ((p)[1] << 8)))
+#define READ_LE32(p) ((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+/// @endcond
+
+/// @brief Initializes an empty class path.
+void initClassPath(ClassPath* cp)
+{
+    cp->entries = NULL;
+    cp->entryCount = 0;
+    cp->archive = NULL;
+    cp->parseMode = CLASS_PARSE_LAZY;
+}
+
+/// @brief Makes the whole content of a JAR file available in memory,
+/// mapping it when possible, or reading it to a buffer otherwise.
+/// @return 0 if the file couldn't be read, otherwise 1.
+static uint8_t loadJarData(JarFile* jar, const char* path)
+{
+    FILE* file;
+    long size;
+    uint8_t* buffer;
+
+#ifndef _WIN32
+    struct stat st;
+    void* data;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return 0;
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (uint64_t)st.st_size > UINT32_MAX)
+    {
+        close(fd);
+        return 0;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data != MAP_FAILED)
+    {
+        jar->data = (const uint8_t*)data;
+        jar->size = (uint32_t)st.st_size;
+        jar->mapped = 1;
+        return 1;
+    }
+#endif
+
+    file = fopen(path, "rb");
+
+    if (!file)
+        return 0;
+
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) <= 0 ||
+        (unsigned long)size > UINT32_MAX || fseek(file, 0, SEEK_SET) != 0)
+    {
+        fclose(file);
+        return 0;
+    }
+
+    buffer = (uint8_t*)malloc((size_t)size);
+
+    if (!buffer || fread(buffer, 1, (size_t)size, file) != (size_t)size)
+    {
+        if (buffer)
+            free(buffer);
+
+        fclose(file);
+        return 0;
+    }
+
+    fclose(file);
+    jar->data = buffer;
+    jar->size = (uint32_t)size;
+    jar->mapped = 0;
+    return 1;
+}
+
+/// @brief Releases a JAR file and its index.
+static void freeJarFile(JarFile* jar)
+{
+    if (jar->data)
+    {
+#ifndef _WIN32
+        if (jar->mapped)
+            munmap((void*)jar->data, jar->size);
+        else
+#endif
+            free((void*)jar->data);
+    }
+
+    if (jar->entries)
+        free(jar->entries);
+
+    if (jar->table)
+        free(jar->table);
+
+    free(jar);
+}
+
+/// @brief Finds the slot of the index of a JAR where an entry is,
+/// or where it should be inserted.
+/// @return Index of the slot, which is empty if no entry has that name.
+static uint32_t findJarSlot(const JarFile* jar, const uint8_t* name, uint16_t nameLength, uint32_t hash)
+{
+    uint32_t mask = jar->tableCapacity - 1;
+    uint32_t slot = hash & mask;
+    const JarEntry* entry;
+
+    while (jar->table[slot])
+    {
+        entry = jar->entries + jar->table[slot] - 1;
+
+        if (entry->hash == hash && entry->nameLength == nameLength && !memcmp(entry->name, name, nameLength))
+            break;
+
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/// @brief Maps a JAR file and indexes the entries of its central directory.
+/// @param const char* path - path of the JAR file
+/// @return The JAR file, or NULL if it couldn't be read or isn't a valid ZIP file.
+static JarFile* openJarFile(const char* path)
+{
+    JarFile* jar = (JarFile*)malloc(sizeof(JarFile));
+    const uint8_t* end;
+    const uint8_t* header;
+    const uint8_t* directoryEnd;
+    JarEntry* entry;
+    uint32_t offset, count, directorySize, directoryOffset, index, slot;
+    uint16_t extraLength, commentLength;
+
+    if (!jar)
+        return NULL;
+
+    jar->data = NULL;
+    jar->size = 0;
+    jar->entries = NULL;
+    jar->entryCount = 0;
+    jar->table = NULL;
+    jar->tableCapacity = 0;
+
+    if (!loadJarData(jar, path) || jar->size < ZIP_END_SIZE)
+    {
+        freeJarFile(jar);
+        return NULL;
+    }
+
+    // The end of central directory record is the last structure of
+    // the file, followed only by a comment of variable length.
+    offset = jar->size - ZIP_END_SIZE;
+
+    while (READ_LE32(jar->data + offset) != ZIP_END_SIGNATURE)
+    {
+        if (offset == 0 || jar->size - offset >= ZIP_END_SIZE + ZIP_MAX_COMMENT_SIZE)
+        {
+            freeJarFile(jar);
+            return NULL;
+        }
+
+        offset--;
+    }
+
+    end = jar->data + offset;
+    count = READ_LE16(end + 10);
+    directorySize = READ_LE32(end + 12);
+    directoryOffset = READ_LE32(end + 16);
+
+    if (directoryOffset > offset || directorySize > offset - directoryOffset)
+    {
+        freeJarFile(jar);
+        return NULL;
+    }
+
+    jar->tableCapacity = 16;
+
+    while (jar->tableCapacity < 2 * count)
+        jar->tableCapacity <<= 1;
+
+    jar->entries = (JarEntry*)malloc((count ? count : 1) * sizeof(JarEntry));
+    jar->table = (uint32_t*)malloc(jar->tableCapacity * sizeof(uint32_t));
+
+    if (!jar->entries || !jar->table)
+    {
+        freeJarFile(jar);
+        return NULL;
+    }
+
+    memset(jar->table, 0, jar->tableCapacity * sizeof(uint32_t));
+
+    header = jar->data + directoryOffset;
+    directoryEnd = header + directorySize;
+
+    for (index = 0; index < count; index++)
+    {
+        if (directoryEnd - header < ZIP_CENTRAL_HEADER_SIZE || READ_LE32(header) != ZIP_CENTRAL_HEADER_SIGNATURE)
+        {
+            freeJarFile(jar);
+            return NULL;
+        }
+
+        entry = jar->entries + jar->entryCount;
+        entry->nameLength = READ_LE16(header + 28);
+        extraLength = READ_LE16(header + 30);
+        commentLength = READ_LE16(header + 32);
+
+        if ((uint32_t)(directoryEnd - header - ZIP_CENTRAL_HEADER_SIZE) <
+            (uint32_t)entry->nameLength + extraLength + commentLength)
+        {
+            freeJarFile(jar);
+            return NULL;
+        }
+
+        entry->name = header + ZIP_CENTRAL_HEADER_SIZE;
+        entry->compression = READ_LE16(header + 10);
+        entry->crc = READ_LE32(header + 16);
+        entry->compressedSize = READ_LE32(header + 20);
+        entry->uncompressedSize = READ_LE32(header + 24);
+        entry->localHeaderOffset = READ_LE32(header + 42);
+        entry->hash = hashUTF8(entry->name, entry->nameLength);
+
+        // Directories and encrypted files are left out of the index. If a name
+        // is repeated, the first entry with that name is the one that is used.
+        if (!(READ_LE16(header + 8) & ZIP_FLAG_ENCRYPTED) &&
+            entry->nameLength > 0 && entry->name[entry->nameLength - 1] != '/')
+        {
+            slot = findJarSlot(jar, entry->name, entry->nameLength, entry->hash);
+
+            if (!jar->table[slot])
+                jar->table[slot] = ++jar->entryCount;
+        }
+
+        header += ZIP_CENTRAL_HEADER_SIZE + entry->nameLength + extraLength + commentLength;
+    }
+
+    return jar;
+}
+
+/// @brief Opens a class file stored in a JAR.
+/// @param JarFile* jar - the JAR file
+/// @param const JarEntry* entry - the entry of the class file
+/// @param JavaClass* jc - where the class will be opened
+/// @param const char* path - name of the entry, compared with the name of the class
+/// @param enum ClassParseMode mode - see openClassFile()
+/// @return 0 if the entry is damaged or uses an unsupported compression
+/// method, in which case the class isn't opened, otherwise 1.
+static uint8_t openJarEntry(JarFile* jar, const JarEntry* entry, JavaClass* jc, const char* path,
+                            enum ClassParseMode mode)
+{
+    const uint8_t* header;
+    const uint8_t* fileData;
+    uint8_t* buffer;
+    uint32_t offset = entry->localHeaderOffset;
+
+    if (jar->size < ZIP_LOCAL_HEADER_SIZE || offset > jar->size - ZIP_LOCAL_HEADER_SIZE)
+        return 0;
+
+    header = jar->data + offset;
+
+    if (READ_LE32(header) != ZIP_LOCAL_HEADER_SIGNATURE)
+        return 0;
+
+    // The local header has its own name and extra field lengths,
+    // which may differ from the ones in the central directory.
+    offset += ZIP_LOCAL_HEADER_SIZE + READ_LE16(header + 26) + READ_LE16(header + 28);
+
+    if (offset > jar->size || entry->compressedSize > jar->size - offset)
+        return 0;
+
+    fileData = jar->data + offset;
+
+    if (entry->compression == ZIP_METHOD_STORED)
+    {
+        if (entry->compressedSize != entry->uncompressedSize)
+            return 0;
+
+        // Parsed in place, the JAR stays mapped while the class path exists
+        openClassBuffer(jc, fileData, entry->uncompressedSize, path, 0, mode);
+        return 1;
+    }
+
+    if (entry->compression != ZIP_METHOD_DEFLATE)
+        return 0;
+
+    buffer = (uint8_t*)malloc(entry->uncompressedSize ? entry->uncompressedSize : 1);
+
+    if (!buffer)
+        return 0;
+
+    if (!inflateData(fileData, entry->compressedSize, buffer, entry->uncompressedSize) ||
+        calculateCRC32(buffer, entry->uncompressedSize) != entry->crc)
+    {
+        free(buffer);
+        return 0;
+    }
+
+    openClassBuffer(jc, buffer, entry->uncompressedSize, path, 1, mode);
+    return 1;
+}
+
+/// @brief Adds a directory or a JAR file to the end of a class path.
+/// @param ClassPath* cp - the class path
+/// @param const char* path - path of the directory or JAR file. Doesn't
+/// need to be null terminated.
+/// @param size_t pathLength - number of characters of \c path
+///
+/// Paths that are regular files are opened as JAR files and their central
+/// directory is indexed. Any other path is taken as a directory, even if it
+/// doesn't exist. An empty path, or ".", is the current directory.
+///
+/// @return 0 if the JAR file couldn't be read or memory couldn't be allocated,
+/// in which case the class path isn't changed, otherwise 1.
+uint8_t addClassPathEntry(ClassPath* cp, const char* path, size_t pathLength)
+{
+    ClassPathEntry* entries;
+    JarFile* jar = NULL;
+    struct stat st;
+    char* copy = (char*)malloc(pathLength + 2);
+
+    if (!copy)
+        return 0;
+
+    memcpy(copy, path, pathLength);
+    copy[pathLength] = '\0';
+
+    if (pathLength > 0 && stat(copy, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        jar = openJarFile(copy);
+
+        if (!jar)
+        {
+            free(copy);
+            return 0;
+        }
+    }
+    else if (pathLength == 1 && copy[0] == '.')
+    {
+        copy[0] = '\0';
+    }
+    else if (pathLength > 0 && copy[pathLength - 1] != '/' && copy[pathLength - 1] != '\\')
+    {
+        copy[pathLength] = '/';
+        copy[pathLength + 1] = '\0';
+    }
+
+    entries = (ClassPathEntry*)malloc((cp->entryCount + 1) * sizeof(ClassPathEntry));
+
+    if (!entries)
+    {
+        if (jar)
+            freeJarFile(jar);
+
+        free(copy);
+        return 0;
+    }
+
+    if (cp->entries)
+    {
+        memcpy(entries, cp->entries, cp->entryCount * sizeof(ClassPathEntry));
+        free(cp->entries);
+    }
+
+    entries[cp->entryCount].path = copy;
+    entries[cp->entryCount].jar = jar;
+    cp->entries = entries;
+    cp->entryCount++;
+    return 1;
+}
+
+/// @brief Releases all entries of a class path.
+/// @note Classes opened from stored JAR entries or from the archive point
+/// into them, so they must be closed before the class path is released.
+void freeClassPath(ClassPath* cp)
+{
+    uint32_t index;
+
+    for (index = 0; index < cp->entryCount; index++)
+    {
+        if (cp->entries[index].jar)
+            freeJarFile(cp->entries[index].jar);
+
+        free(cp->entries[index].path);
+    }
+
+    if (cp->entries)
+        free(cp->entries);
+
+    closeClassArchive(cp->archive);
+    initClassPath(cp);
+}
+
+/// @brief Looks for a class in the entries of a class path, in order, and opens it.
+/// @param ClassPath* cp - the class path
+/// @param JavaClass* jc - where the class will be opened
+/// @param const uint8_t* className_utf8_bytes - name of the class, like "java/lang/Object"
+/// @param int32_t utf8_len - length of the name in bytes
+/// @param [out] char* outPath - receives the path the class was opened from. For classes
+/// in JAR files, it is the path of the JAR followed by "!/" and the name of the entry.
+/// @param size_t outPathSize - size of the \c outPath buffer
+/// @param [out] ClassFingerprint* outFingerprint - if not NULL, receives the
+/// fingerprint of the class file, to be recorded in an archive
+///
+/// The first entry that has a file for the class is used. If that file can't be parsed,
+/// the search stops there and the status of \c jc tells what went wrong.
+///
+/// @return 1 if the class file was found and opened, even if it couldn't be parsed,
+/// or 0 if it wasn't found, in which case \c jc doesn't need to be closed.
+uint8_t openClassFromClassPath(ClassPath* cp, JavaClass* jc, const uint8_t* className_utf8_bytes, int32_t utf8_len,
+                               char* outPath, size_t outPathSize, ClassFingerprint* outFingerprint)
+{
+    ClassPathEntry* entry;
+    JarFile* jar;
+    JarEntry* jarEntry;
+    ClassFingerprint fingerprint;
+    struct stat st;
+    uint32_t index, slot, hash;
+    int32_t nameLength = utf8_len + 6;
+
+    for (index = 0; index < cp->entryCount; index++)
+    {
+        entry = cp->entries + index;
+        jar = entry->jar;
+
+        if (!jar)
+        {
+            snprintf(outPath, outPathSize, "%s%.*s.class", entry->path, utf8_len, className_utf8_bytes);
+
+            // The fingerprint of files in directories costs a system call,
+            // so it's only taken when an archive is used or written.
+            if ((cp->archive || outFingerprint) && stat(outPath, &st) == 0)
+            {
+                fingerprint.size = (uint32_t)st.st_size;
+                fingerprint.crc = 0;
+                fingerprint.modificationTime = (int64_t)st.st_mtime;
+
+                if (outFingerprint)
+                    *outFingerprint = fingerprint;
+
+                if (cp->archive && openArchivedClass(cp->archive, jc, className_utf8_bytes, utf8_len,
+                                                     outPath, &fingerprint))
+                {
+                    return 1;
+                }
+            }
+
+            openClassFile(jc, outPath, cp->parseMode);
+
+            if (jc->status != CLASS_STATUS_FILE_COULDNT_BE_OPENED)
+                return 1;
+
+            continue;
+        }
+
+        if (nameLength > UINT16_MAX || (size_t)nameLength >= outPathSize)
+            continue;
+
+        // The name of the entry is the class name followed by ".class"
+        memcpy(outPath, className_utf8_bytes, utf8_len);
+        memcpy(outPath + utf8_len, ".class", 7);
+        hash = hashUTF8((const uint8_t*)outPath, nameLength);
+        slot = findJarSlot(jar, (const uint8_t*)outPath, (uint16_t)nameLength, hash);
+
+        if (!jar->table[slot])
+            continue;
+
+        jarEntry = jar->entries + jar->table[slot] - 1;
+        snprintf(outPath, outPathSize, "%s!/%.*s.class", entry->path, utf8_len, className_utf8_bytes);
+
+        // JAR entries carry the size and CRC-32 of the file, which makes a free fingerprint
+        fingerprint.size = jarEntry->uncompressedSize;
+        fingerprint.crc = jarEntry->crc;
+        fingerprint.modificationTime = 0;
+
+        if (outFingerprint)
+            *outFingerprint = fingerprint;
+
+        if (cp->archive && openArchivedClass(cp->archive, jc, className_utf8_bytes, utf8_len, outPath, &fingerprint))
+            return 1;
+
+        if (openJarEntry(jar, jarEntry, jc, outPath, cp->parseMode))
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#ifndef CLASSPATH_H
+#define CLASSPATH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "javaclass.h"
+#include "archive.h"
+
+/// @brief Character that separates the entries of a class path.
+#ifdef _WIN32
+    #define CLASSPATH_SEPARATOR ';'
+#else
+    #define CLASSPATH_SEPARATOR ':'
+#endif
+
+/// @brief A file stored in a JAR, as described by the central directory.
+typedef struct JarEntry
+{
+    /// @brief Name of the file, pointing into the JAR data. Not null terminated.
+    const uint8_t* name;
+    uint16_t nameLength;
+
+    /// @brief Compression method: 0 for stored, 8 for deflate.
+    uint16_t compression;
+
+    uint32_t hash;
+    uint32_t crc;
+    uint32_t compressedSize;
+    uint32_t uncompressedSize;
+
+    /// @brief Offset of the local file header, which precedes the file data.
+    uint32_t localHeaderOffset;
+} JarEntry;
+
+/// @brief A JAR (or ZIP) file whose central directory has been indexed.
+///
+/// The whole file is mapped to memory, so stored entries can be
+/// parsed where they are, without being copied.
+typedef struct JarFile
+{
+    const uint8_t* data;
+    uint32_t size;
+    uint8_t mapped;
+
+    JarEntry* entries;
+    uint32_t entryCount;
+
+    /// @brief Open addressing hash table of entries, keyed by their names.
+    ///
+    /// Each slot holds the index of an entry plus one, or 0 if the slot is empty.
+    /// The number of slots is a power of two, at least twice the number of entries.
+    uint32_t* table;
+    uint32_t tableCapacity;
+} JarFile;
+
+/// @brief An element of the class path: a directory or a JAR file.
+typedef struct ClassPathEntry
+{
+    /// @brief Path given for the entry. For directories, it ends with
+    /// a slash, or is empty for the current directory.
+    char* path;
+
+    /// @brief The indexed JAR file, or NULL if the entry is a directory.
+    JarFile* jar;
+} ClassPathEntry;
+
+/// @brief List of places where classes are looked for, in order.
+typedef struct ClassPath
+{
+    ClassPathEntry* entries;
+    uint32_t entryCount;
+
+    /// @brief Archive with copies of classes that are opened instead of their
+    /// class files when possible, or NULL. Released with the class path.
+    ClassArchive* archive;
+
+    /// @brief How class files are parsed, CLASS_PARSE_LAZY by default.
+    enum ClassParseMode parseMode;
+} ClassPath;
+
+void initClassPath(ClassPath* cp);
+void freeClassPath(ClassPath* cp);
+uint8_t addClassPathEntry(ClassPath* cp, const char* path, size_t pathLength);
+uint8_t openClassFromClassPath(ClassPath* cp, JavaClass* jc, const uint8_t* className_utf8_bytes, int32_t utf8_len,
+                               char* outPath, size_t outPathSize, ClassFingerprint* outFingerprint);
+
+#endif // CLASSPATH_H
+
+/// @defgroup classpath Class path module
+///
+/// @brief Finds the class files to be loaded, in directories and JAR files.
+///
+/// The class path is a list of entries searched in order. For directories,
+/// the class file is opened from the directory. For JAR files, the central
+/// directory is read once, when the entry is added, into a hash table of
+/// entries, so looking up a class costs no system call. Stored entries are
+/// parsed straight from the mapping of the JAR, and deflated entries are
+/// decompressed to a buffer first (see inflateData()).
+///
+/// If the class path has an archive, classes whose files didn't change since
+/// the archive was written are opened from it instead (see openArchivedClass()).
+///
+/// ZIP64 archives, encryption and compression methods other than
+/// deflate aren't supported.
+///
+/// @see classpath.c, resolveClass()
@@ -150,6 +150,10 @@ char readConstantPool_Long(JavaClass* jc, cp_info* entry)
 
 /// @brief Reads a cp_info of type CONSTANT_Utf8 from the file
 ///
+/// The string is interned, so the entry doesn't own its bytes,
+/// which are shared with every other UTF-8 entry equal to it.
+/// @see internSymbol()
+///
 /// @param JavaClass* jc - pointer to the structure to be
 /// read.
 /// @param cp_info* entry - where the data read is written
@@ -164,46 +168,41 @@ char readConstantPool_Utf8(JavaClass* jc, cp_info* entry)
         return 0;
     }
 
-    if (entry->Utf8.length > 0)
+    const uint8_t* bytes;
+    uint16_t i;
+
+    entry->Utf8.bytes = NULL;
+    entry->Utf8.symbol = NULL;
+
+    // The bytes are checked and interned right where they are in the
+    // class file data, without being copied first.
+    bytes = readBytes(jc, entry->Utf8.length);
+
+    if (!bytes)
     {
-        entry->Utf8.bytes = (uint8_t*)malloc(entry->Utf8.length);
+        jc->status = UNEXPECTED_EOF_READING_UTF8;
+        return 0;
+    }
 
-        if (!entry->Utf8.bytes)
+    for (i = 0; i < entry->Utf8.length; i++)
+    {
+        // UTF-8 byte values can't be null and must not be in the range [0xF0, 0xFF].
+        if (bytes[i] == 0 || bytes[i] >= 0xF0)
         {
-            jc->status = MEMORY_ALLOCATION_FAILED;
+            jc->status = INVALID_UTF8_BYTES;
             return 0;
         }
+    }
 
-        uint16_t i;
-        uint8_t* bytes = entry->Utf8.bytes;
-
-        for (i = 0; i < entry->Utf8.length; i++)
-        {
-            int byte = fgetc(jc->file);
-
-            if (byte == EOF)
-            {
-                jc->status = UNEXPECTED_EOF_READING_UTF8;
-                return 0;
-            }
-
-            jc->totalBytesRead++;
-
-            // UTF-8 byte values can't be null and must not be in the range [0xF0, 0xFF].
-            if (byte == 0 || (byte >= 0xF0))
-            {
-                jc->status = INVALID_UTF8_BYTES;
-                return 0;
-            }
+    entry->Utf8.symbol = internSymbol(bytes, entry->Utf8.length);
 
-            *bytes++ = (uint8_t)byte;
-        }
-    }
-    else
+    if (!entry->Utf8.symbol)
     {
-        entry->Utf8.bytes = NULL;
+        jc->status = MEMORY_ALLOCATION_FAILED;
+        return 0;
     }
 
+    entry->Utf8.bytes = entry->Utf8.symbol->bytes;
     return 1;
 }
 
@@ -221,18 +220,13 @@ char readConstantPool_Utf8(JavaClass* jc, cp_info* entry)
 char readConstantPoolEntry(JavaClass* jc, cp_info* entry)
 {
     // Gets the entry tag
-    int byte = fgetc(jc->file);
-
-    if (byte == EOF)
+    if (!readu1(jc, &entry->tag))
     {
         jc->status = UNEXPECTED_EOF_READING_CONSTANT_POOL;
         entry->tag = 0xFF;
         return 0;
     }
 
-    entry->tag = (uint8_t)byte;
-
-    jc->totalBytesRead++;
     jc->lastTagRead = entry->tag;
 
     switch(entry->tag)
@@ -263,14 +257,12 @@ char readConstantPoolEntry(JavaClass* jc, cp_info* entry)
         // Compatibility with Java 8
         case CONSTANT_MethodHandle:
 
-            if (!readu2(jc, NULL) || fgetc(jc->file) == EOF)
+            if (!readu1(jc, NULL) || !readu2(jc, NULL))
             {
                 jc->status = UNEXPECTED_EOF_READING_CONSTANT_POOL;
                 return 0;
             }
 
-            jc->totalBytesRead++;
-
             break;
 
         default:
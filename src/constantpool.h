@@ -5,6 +5,7 @@ typedef struct cp_info cp_info;
 
 #include <stdint.h>
 #include "javaclass.h"
+#include "symbols.h"
 
 struct cp_info {
 
@@ -23,16 +24,56 @@ struct cp_info {
         struct {
             uint16_t class_index;
             uint16_t name_and_type_index;
+
+            /// @brief Class that declares the field, set the first time
+            /// a field instruction resolves this entry. NULL while the
+            /// field hasn't been resolved.
+            struct LoadedClasses* resolvedClass;
+
+            /// @brief Offset of the field in the static data of
+            /// resolvedClass, or in the data of its instances.
+            uint16_t resolvedOffset;
+
+            /// @brief OperandType of the value of the field.
+            uint8_t resolvedType;
         } Fieldref;
 
         struct {
             uint16_t class_index;
             uint16_t name_and_type_index;
+
+            /// @brief Number of operands taken by the parameters of
+            /// the method, set when the method is resolved.
+            uint8_t parameterCount;
+
+            /// @brief Index of the method in the vtable of the class
+            /// (or in the methods of the interface, resolvedInterface)
+            /// that declares it. Set the first time the method is invoked
+            /// by invokevirtual or invokeinterface, -1 until then.
+            int32_t resolvedIndex;
+
+            /// @brief Interface that declares the method, set together
+            /// with resolvedIndex by invokeinterface.
+            struct JavaClass* resolvedInterface;
         } Methodref;
 
         struct {
             uint16_t class_index;
             uint16_t name_and_type_index;
+
+            /// @brief Number of operands taken by the parameters of
+            /// the method, set when the method is resolved.
+            uint8_t parameterCount;
+
+            /// @brief Index of the method in the vtable of the class
+            /// (or in the methods of the interface, resolvedInterface)
+            /// that declares it. Set the first time the method is invoked
+            /// by invokevirtual or invokeinterface, -1 until then.
+            int32_t resolvedIndex;
+
+            /// @brief Interface that declares the method, set together
+            /// with resolvedIndex by invokeinterface.
+            struct JavaClass* resolvedInterface;
         } InterfaceMethodref;
 
         struct {
@@ -60,7 +101,14 @@ struct cp_info {
 
         struct {
             uint16_t length;
-            uint8_t* bytes;
+
+            /// @brief The bytes of the string, owned by \c symbol.
+            const uint8_t* bytes;
+
+            /// @brief The interned string. Entries of any class with
+            /// the same bytes share the same symbol, so they can be
+            /// compared by pointer.
+            const Symbol* symbol;
         } Utf8;
 
     };
@@ -3,6 +3,7 @@
 #include "debugging.h"
 #include "utf8.h"
 #include <stdint.h>
+#include <pthread.h>
 
 #undef malloc
 #undef free
@@ -21,6 +22,9 @@ typedef struct MemoryPtrStack
 
 MemoryPtrStack* _MEMSTACK = NULL;
 
+// Loader threads allocate memory too
+static pthread_mutex_t _MEMLOCK = PTHREAD_MUTEX_INITIALIZER;
+
 void checkMemoryLeak(void)
 {
     printf("\n#### Memory Inspect Report ####\n");
@@ -64,8 +68,10 @@ void* memalloc(size_t bytes, const char* file, int line, const char* call)
             node->line = line;
             node->ptr = ptr;
             node->bytes = bytes;
+            pthread_mutex_lock(&_MEMLOCK);
             node->next = _MEMSTACK;
             _MEMSTACK = node;
+            pthread_mutex_unlock(&_MEMLOCK);
         }
         else
         {
@@ -79,9 +85,12 @@ void* memalloc(size_t bytes, const char* file, int line, const char* call)
 
 void memfree(void* ptr, const char* file, int line, const char* call)
 {
-    MemoryPtrStack* node = _MEMSTACK;
+    MemoryPtrStack* node;
     MemoryPtrStack* previous = NULL;
 
+    pthread_mutex_lock(&_MEMLOCK);
+    node = _MEMSTACK;
+
     while (node)
     {
         if (node->ptr == ptr)
@@ -91,6 +100,7 @@ void memfree(void* ptr, const char* file, int line, const char* call)
             else
                 previous->next = node->next;
 
+            pthread_mutex_unlock(&_MEMLOCK);
             _free(node);
             _free(ptr);
             return;
@@ -100,6 +110,7 @@ void memfree(void* ptr, const char* file, int line, const char* call)
         node = node->next;
     }
 
+    pthread_mutex_unlock(&_MEMLOCK);
     printf("\n\n#### Memory Inspect Warning ####\nAttempt to free invalid pointer\n");
     printf(" At %s:%d, call: %s\n\n", file, line, call);
     _free(ptr);
@@ -162,11 +173,11 @@ void debugPrintMethodFieldRef(JavaClass* jc, cp_info* cpi)
     printf("%s", buffer);
 }
 
-void debugPrintOperandStack(OperandStack* node)
+void debugPrintOperandStack(OperandStack* os)
 {
     printf("Operand stack:");
 
-    if (!node)
+    if (os->top == 0)
     {
         printf(" empty.\n");
         return;
@@ -174,20 +185,21 @@ void debugPrintOperandStack(OperandStack* node)
 
     printf("\n");
     char separate = 0;
+    uint16_t index = os->top;
 
-    while (node)
+    while (index-- > 0)
     {
         if (separate)
             printf(" -> ");
         else
             separate = 1;
 
-        switch (node->type)
+        switch (os->types[index])
         {
             case OP_REFERENCE:
             {
-                Reference* obj = (Reference*)node->value;
-                printf("obj:%d", node->value);
+                Reference* obj = DECODE_REFERENCE(os->values[index]);
+                printf("obj:%d", os->values[index]);
 
                 if (obj)
                 {
@@ -206,10 +218,8 @@ void debugPrintOperandStack(OperandStack* node)
             }
 
             default:
-                printf("%d", node->value);
+                printf("%d", os->values[index]);
         }
-
-        node = node->next;
     }
 
     printf("\n");
@@ -244,7 +254,7 @@ void debugPrintLocalVariables(int32_t* localVars, uint16_t count)
 
 void debugPrintNewObject(Reference* obj)
 {
-    printf("New object created, obj:%d", (int32_t)obj);
+    printf("New object created, obj:%d", ENCODE_REFERENCE(obj));
 
     switch(obj->type)
     {
@@ -0,0 +1,807 @@
+#include "exceptions.h"
+#include "utf8.h"
+#include "debugging.h"
+#include <stdio.h>
+#include <string.h>
+
+/// @brief Number of values stored in the backtrace of a Throwable
+/// for each frame: its class, its method and its bytecode offset.
+#define BACKTRACE_ENTRY_SIZE 3
+
+/// @brief Position of the fields declared by the simulated Throwable.
+/// @see getThrowableField()
+enum ThrowableField {
+    THROWABLE_FIELD_MESSAGE,
+    THROWABLE_FIELD_BACKTRACE
+};
+
+/// @brief Finds the decoded instruction at an offset of the bytecode.
+/// @return Index of the instruction, or -1 if no instruction starts at that offset.
+static int32_t findInstructionAt(const att_Code_info* info, uint32_t offset)
+{
+    int32_t low = 0, high = (int32_t)info->instruction_count - 1, middle;
+
+    while (low <= high)
+    {
+        middle = (low + high) / 2;
+
+        if (info->instructions[middle].offset < offset)
+            low = middle + 1;
+        else if (info->instructions[middle].offset > offset)
+            high = middle - 1;
+        else
+            return middle;
+    }
+
+    return -1;
+}
+
+static int compareOffsets(const void* a, const void* b)
+{
+    return (int)*(const uint16_t*)a - (int)*(const uint16_t*)b;
+}
+
+/// @brief Tells if an entry of an exception table covers the whole range
+/// of the bytecode that starts at \c start and ends before \c end.
+#define ENTRY_COVERS(entry, start, end) ((entry)->start_pc <= (start) && (end) <= (entry)->end_pc)
+
+/// @brief Checks the exception table of a Code attribute and builds its index.
+/// @param JavaClass* jc - the class of the method
+/// @param att_Code_info* info - the Code attribute, with its bytecode
+/// already decoded and its exception table read.
+///
+/// The start and end offsets of all handlers split the bytecode in ranges,
+/// and each range that is covered by some handler is stored, in order, with
+/// the handlers that cover it, in the order of the table. Only the order of
+/// the handlers of the range an instruction is in matters to find the handler
+/// that catches an exception, so it can be found with a binary search over the
+/// ranges rather than by walking the whole table. The index of the instruction
+/// each handler starts at is also stored in the table.
+///
+/// @return 0 if a handler has an invalid range, handler offset or catch type,
+/// or if memory couldn't be allocated, in which case the status of the class
+/// tells why, otherwise 1.
+/// @see findExceptionRange()
+uint8_t buildExceptionIndex(JavaClass* jc, att_Code_info* info)
+{
+    ExceptionTableEntry* entry;
+    ExceptionRange* range;
+    uint16_t* bounds;
+    uint32_t boundCount = 0, handlerCount = 0;
+    uint32_t index, bound, covering;
+    int32_t handler;
+
+    if (info->exception_table_length == 0)
+        return 1;
+
+    for (index = 0; index < info->exception_table_length; index++)
+    {
+        entry = info->exception_table + index;
+        handler = findInstructionAt(info, entry->handler_pc);
+
+        // end_pc is exclusive, so it may also be the end of the code
+        if (entry->start_pc >= entry->end_pc || entry->end_pc > info->code_length ||
+            findInstructionAt(info, entry->start_pc) < 0 ||
+            (entry->end_pc < info->code_length && findInstructionAt(info, entry->end_pc) < 0) ||
+            handler < 0 ||
+            (entry->catch_type && (entry->catch_type >= jc->constantPoolCount ||
+                                   jc->constantPool[entry->catch_type - 1].tag != CONSTANT_Class)))
+        {
+            jc->status = ATTRIBUTE_INVALID_EXCEPTION_TABLE;
+            return 0;
+        }
+
+        entry->handler_index = (uint32_t)handler;
+    }
+
+    bounds = (uint16_t*)malloc(2 * info->exception_table_length * sizeof(uint16_t));
+
+    if (!bounds)
+    {
+        jc->status = MEMORY_ALLOCATION_FAILED;
+        return 0;
+    }
+
+    for (index = 0; index < info->exception_table_length; index++)
+    {
+        bounds[2 * index] = info->exception_table[index].start_pc;
+        bounds[2 * index + 1] = info->exception_table[index].end_pc;
+    }
+
+    qsort(bounds, 2 * info->exception_table_length, sizeof(uint16_t), compareOffsets);
+
+    for (index = 0; index < 2 * info->exception_table_length; index++)
+    {
+        if (boundCount == 0 || bounds[boundCount - 1] != bounds[index])
+            bounds[boundCount++] = bounds[index];
+    }
+
+    // Ranges and handlers are counted first, so they are allocated at once
+    for (bound = 0; bound + 1 < boundCount; bound++)
+    {
+        covering = 0;
+
+        for (index = 0; index < info->exception_table_length; index++)
+            covering += ENTRY_COVERS(info->exception_table + index, bounds[bound], bounds[bound + 1]);
+
+        info->exception_range_count += covering > 0;
+        handlerCount += covering;
+    }
+
+    info->exception_ranges = (ExceptionRange*)malloc(info->exception_range_count * sizeof(ExceptionRange));
+    info->exception_handlers = (uint16_t*)malloc(handlerCount * sizeof(uint16_t));
+
+    if (!info->exception_ranges || !info->exception_handlers)
+    {
+        free(bounds);
+        jc->status = MEMORY_ALLOCATION_FAILED;
+        return 0;
+    }
+
+    range = info->exception_ranges;
+    handlerCount = 0;
+
+    for (bound = 0; bound + 1 < boundCount; bound++)
+    {
+        range->start_pc = bounds[bound];
+        range->end_pc = bounds[bound + 1];
+        range->first_handler = handlerCount;
+        range->handler_count = 0;
+
+        for (index = 0; index < info->exception_table_length; index++)
+        {
+            if (ENTRY_COVERS(info->exception_table + index, range->start_pc, range->end_pc))
+            {
+                info->exception_handlers[handlerCount++] = (uint16_t)index;
+                range->handler_count++;
+            }
+        }
+
+        if (range->handler_count > 0)
+            range++;
+    }
+
+    free(bounds);
+    return 1;
+}
+
+/// @brief Finds the range of the exception index of a Code attribute
+/// that holds an offset of the bytecode.
+/// @return The range, or NULL if no handler covers the offset.
+/// @see buildExceptionIndex()
+const ExceptionRange* findExceptionRange(const att_Code_info* info, uint16_t offset)
+{
+    int32_t low = 0, high = (int32_t)info->exception_range_count - 1, middle;
+    const ExceptionRange* range;
+
+    while (low <= high)
+    {
+        middle = (low + high) / 2;
+        range = info->exception_ranges + middle;
+
+        if (range->end_pc <= offset)
+            low = middle + 1;
+        else if (range->start_pc > offset)
+            high = middle - 1;
+        else
+            return range;
+    }
+
+    return NULL;
+}
+
+/// @brief Throwable and the exceptions thrown by the JVM, which are
+/// generated when they can't be found in the class path.
+static const struct {
+    const char* name;
+    const char* super;
+} simulatedThrowables[] = {
+    {"java/lang/Throwable", "java/lang/Object"},
+    {"java/lang/Exception", "java/lang/Throwable"},
+    {"java/lang/Error", "java/lang/Throwable"},
+    {"java/lang/RuntimeException", "java/lang/Exception"},
+    {"java/lang/ArithmeticException", "java/lang/RuntimeException"},
+    {"java/lang/ArrayStoreException", "java/lang/RuntimeException"},
+    {"java/lang/ClassCastException", "java/lang/RuntimeException"},
+    {"java/lang/IllegalArgumentException", "java/lang/RuntimeException"},
+    {"java/lang/IllegalStateException", "java/lang/RuntimeException"},
+    {"java/lang/IndexOutOfBoundsException", "java/lang/RuntimeException"},
+    {"java/lang/ArrayIndexOutOfBoundsException", "java/lang/IndexOutOfBoundsException"},
+    {"java/lang/NegativeArraySizeException", "java/lang/RuntimeException"},
+    {"java/lang/NullPointerException", "java/lang/RuntimeException"},
+    {"java/lang/UnsupportedOperationException", "java/lang/RuntimeException"},
+    {"java/lang/LinkageError", "java/lang/Error"},
+    {"java/lang/IncompatibleClassChangeError", "java/lang/LinkageError"},
+    {"java/lang/AbstractMethodError", "java/lang/IncompatibleClassChangeError"},
+    {"java/lang/IllegalAccessError", "java/lang/IncompatibleClassChangeError"},
+    {"java/lang/NoSuchFieldError", "java/lang/IncompatibleClassChangeError"},
+    {"java/lang/NoSuchMethodError", "java/lang/IncompatibleClassChangeError"},
+};
+
+/// @brief Size of the buffer where a simulated class file is written,
+/// which is enough for the longest names of the table above.
+#define SIMULATED_CLASS_CAPACITY 1024
+
+/// @brief Class file being written to a buffer of fixed size.
+typedef struct ClassWriter
+{
+    uint8_t* data;
+    uint32_t size;
+
+    /// @brief Set if something didn't fit in the buffer.
+    uint8_t overflow;
+} ClassWriter;
+
+static void writeBytes(ClassWriter* writer, const void* bytes, uint32_t count)
+{
+    if (writer->size + count > SIMULATED_CLASS_CAPACITY)
+    {
+        writer->overflow = 1;
+        return;
+    }
+
+    memcpy(writer->data + writer->size, bytes, count);
+    writer->size += count;
+}
+
+static void writeU1(ClassWriter* writer, uint8_t value)
+{
+    writeBytes(writer, &value, 1);
+}
+
+static void writeU2(ClassWriter* writer, uint16_t value)
+{
+    uint8_t bytes[2] = {value >> 8, value & 0xFF};
+    writeBytes(writer, bytes, 2);
+}
+
+static void writeU4(ClassWriter* writer, uint32_t value)
+{
+    writeU2(writer, value >> 16);
+    writeU2(writer, value & 0xFFFF);
+}
+
+static void writeUtf8(ClassWriter* writer, const char* string)
+{
+    writeU1(writer, CONSTANT_Utf8);
+    writeU2(writer, (uint16_t)strlen(string));
+    writeBytes(writer, string, strlen(string));
+}
+
+static void writeClassConstant(ClassWriter* writer, uint16_t name)
+{
+    writeU1(writer, CONSTANT_Class);
+    writeU2(writer, name);
+}
+
+/// @brief Writes a constant pool entry made of a tag and two indexes,
+/// like a Methodref or a NameAndType.
+static void writeConstant(ClassWriter* writer, uint8_t tag, uint16_t index1, uint16_t index2)
+{
+    writeU1(writer, tag);
+    writeU2(writer, index1);
+    writeU2(writer, index2);
+}
+
+/// @brief Constant pool of the simulated classes. The entries after
+/// CP_CODE are only used by Throwable.
+enum SimulatedConstant {
+    CP_THIS_NAME = 1, CP_THIS_CLASS, CP_SUPER_NAME, CP_SUPER_CLASS,
+    CP_INIT, CP_VOID_DESCRIPTOR, CP_INIT_TYPE, CP_SUPER_INIT,
+    CP_STRING_DESCRIPTOR, CP_INIT_STRING_TYPE, CP_SUPER_INIT_STRING, CP_CODE,
+    CP_MESSAGE, CP_MESSAGE_DESCRIPTOR, CP_MESSAGE_TYPE, CP_MESSAGE_FIELD,
+    CP_BACKTRACE, CP_BACKTRACE_DESCRIPTOR,
+    CP_FILL_IN_STACK_TRACE, CP_THROWABLE_DESCRIPTOR, CP_FILL_IN_STACK_TRACE_TYPE, CP_FILL_IN_STACK_TRACE_METHOD,
+    CP_PRINT_STACK_TRACE, CP_PRINT_STACK_TRACE_TYPE, CP_PRINT_STACK_TRACE_METHOD,
+    CP_GET_MESSAGE, CP_GET_MESSAGE_DESCRIPTOR, CP_GET_LOCALIZED_MESSAGE,
+    CP_THROWABLE_COUNT
+};
+
+#define CP_EXCEPTION_COUNT (CP_CODE + 1)
+
+/// @brief Writes a method with a Code attribute.
+static void writeMethod(ClassWriter* writer, uint16_t name, uint16_t descriptor, uint16_t maxStack, uint16_t maxLocals,
+                        const uint8_t* code, uint32_t codeLength)
+{
+    writeU2(writer, ACC_PUBLIC);
+    writeU2(writer, name);
+    writeU2(writer, descriptor);
+    writeU2(writer, 1);
+
+    writeU2(writer, CP_CODE);
+    writeU4(writer, 12 + codeLength);
+    writeU2(writer, maxStack);
+    writeU2(writer, maxLocals);
+    writeU4(writer, codeLength);
+    writeBytes(writer, code, codeLength);
+    writeU2(writer, 0);     // exception_table_length
+    writeU2(writer, 0);     // attributes_count
+}
+
+/// @brief Writes the class file of Throwable or of one of its subclasses.
+///
+/// Subclasses only have the constructors Exception() and Exception(String),
+/// which call the constructor of their super class. Throwable declares the
+/// message and the backtrace, which its constructors fill in, getMessage(),
+/// getLocalizedMessage() and printStackTrace(). The backtrace is captured
+/// and printed by static natives of Throwable (see getNative()).
+static void writeSimulatedThrowable(ClassWriter* writer, const char* name, const char* super)
+{
+    uint8_t isThrowable = !strcmp(name, "java/lang/Throwable");
+
+    writeU4(writer, 0xCAFEBABE);
+    writeU2(writer, 0);
+    writeU2(writer, 49);
+    writeU2(writer, isThrowable ? CP_THROWABLE_COUNT : CP_EXCEPTION_COUNT);
+
+    writeUtf8(writer, name);
+    writeClassConstant(writer, CP_THIS_NAME);
+    writeUtf8(writer, super);
+    writeClassConstant(writer, CP_SUPER_NAME);
+    writeUtf8(writer, "<init>");
+    writeUtf8(writer, "()V");
+    writeConstant(writer, CONSTANT_NameAndType, CP_INIT, CP_VOID_DESCRIPTOR);
+    writeConstant(writer, CONSTANT_Methodref, CP_SUPER_CLASS, CP_INIT_TYPE);
+    writeUtf8(writer, "(Ljava/lang/String;)V");
+    writeConstant(writer, CONSTANT_NameAndType, CP_INIT, CP_STRING_DESCRIPTOR);
+    writeConstant(writer, CONSTANT_Methodref, CP_SUPER_CLASS, CP_INIT_STRING_TYPE);
+    writeUtf8(writer, "Code");
+
+    if (isThrowable)
+    {
+        writeUtf8(writer, "message");
+        writeUtf8(writer, "Ljava/lang/String;");
+        writeConstant(writer, CONSTANT_NameAndType, CP_MESSAGE, CP_MESSAGE_DESCRIPTOR);
+        writeConstant(writer, CONSTANT_Fieldref, CP_THIS_CLASS, CP_MESSAGE_TYPE);
+        writeUtf8(writer, "backtrace");
+        writeUtf8(writer, "[J");
+        writeUtf8(writer, "fillInStackTrace");
+        writeUtf8(writer, "(Ljava/lang/Throwable;)V");
+        writeConstant(writer, CONSTANT_NameAndType, CP_FILL_IN_STACK_TRACE, CP_THROWABLE_DESCRIPTOR);
+        writeConstant(writer, CONSTANT_Methodref, CP_THIS_CLASS, CP_FILL_IN_STACK_TRACE_TYPE);
+        writeUtf8(writer, "printStackTrace");
+        writeConstant(writer, CONSTANT_NameAndType, CP_PRINT_STACK_TRACE, CP_THROWABLE_DESCRIPTOR);
+        writeConstant(writer, CONSTANT_Methodref, CP_THIS_CLASS, CP_PRINT_STACK_TRACE_TYPE);
+        writeUtf8(writer, "getMessage");
+        writeUtf8(writer, "()Ljava/lang/String;");
+        writeUtf8(writer, "getLocalizedMessage");
+    }
+
+    writeU2(writer, ACC_PUBLIC | ACC_SUPER);
+    writeU2(writer, CP_THIS_CLASS);
+    writeU2(writer, CP_SUPER_CLASS);
+    writeU2(writer, 0);     // interfaces_count
+
+    if (isThrowable)
+    {
+        // The order of the fields must match ThrowableField
+        writeU2(writer, 2);
+        writeU2(writer, ACC_PRIVATE);
+        writeU2(writer, CP_MESSAGE);
+        writeU2(writer, CP_MESSAGE_DESCRIPTOR);
+        writeU2(writer, 0);
+        writeU2(writer, ACC_PRIVATE | ACC_TRANSIENT);
+        writeU2(writer, CP_BACKTRACE);
+        writeU2(writer, CP_BACKTRACE_DESCRIPTOR);
+        writeU2(writer, 0);
+
+        // Throwable() { super(); fillInStackTrace(this); }
+        const uint8_t init[] = {0x2A, 0xB7, 0, CP_SUPER_INIT, 0x2A, 0xB8, 0, CP_FILL_IN_STACK_TRACE_METHOD, 0xB1};
+
+        // Throwable(String message) { super(); this.message = message; fillInStackTrace(this); }
+        const uint8_t initString[] = {0x2A, 0xB7, 0, CP_SUPER_INIT, 0x2A, 0x2B, 0xB5, 0, CP_MESSAGE_FIELD,
+                                      0x2A, 0xB8, 0, CP_FILL_IN_STACK_TRACE_METHOD, 0xB1};
+
+        // String getMessage() { return message; }
+        const uint8_t getMessage[] = {0x2A, 0xB4, 0, CP_MESSAGE_FIELD, 0xB0};
+
+        // void printStackTrace() { printStackTrace(this); }
+        const uint8_t printStackTrace[] = {0x2A, 0xB8, 0, CP_PRINT_STACK_TRACE_METHOD, 0xB1};
+
+        writeU2(writer, 5);
+        writeMethod(writer, CP_INIT, CP_VOID_DESCRIPTOR, 1, 1, init, sizeof(init));
+        writeMethod(writer, CP_INIT, CP_STRING_DESCRIPTOR, 2, 2, initString, sizeof(initString));
+        writeMethod(writer, CP_GET_MESSAGE, CP_GET_MESSAGE_DESCRIPTOR, 1, 1, getMessage, sizeof(getMessage));
+        writeMethod(writer, CP_GET_LOCALIZED_MESSAGE, CP_GET_MESSAGE_DESCRIPTOR, 1, 1, getMessage, sizeof(getMessage));
+        writeMethod(writer, CP_PRINT_STACK_TRACE, CP_VOID_DESCRIPTOR, 1, 1, printStackTrace, sizeof(printStackTrace));
+    }
+    else
+    {
+        // Exception() { super(); }
+        const uint8_t init[] = {0x2A, 0xB7, 0, CP_SUPER_INIT, 0xB1};
+
+        // Exception(String message) { super(message); }
+        const uint8_t initString[] = {0x2A, 0x2B, 0xB7, 0, CP_SUPER_INIT_STRING, 0xB1};
+
+        writeU2(writer, 0);     // fields_count
+        writeU2(writer, 2);
+        writeMethod(writer, CP_INIT, CP_VOID_DESCRIPTOR, 1, 1, init, sizeof(init));
+        writeMethod(writer, CP_INIT, CP_STRING_DESCRIPTOR, 2, 2, initString, sizeof(initString));
+    }
+
+    writeU2(writer, 0);     // attributes_count
+}
+
+/// @brief Opens the class file of Throwable, or of one of the exceptions
+/// thrown by the JVM, generating it in memory.
+/// @param const uint8_t* className_utf8_bytes - name of the class
+/// @param int32_t utf8_len - length of the name in bytes
+/// @param [out] JavaClass** outClass - receives the class, allocated with malloc(),
+/// which must be closed and released by the caller
+/// @param [out] char* outPath - receives the path of the class file it would have
+/// @param size_t outPathSize - size of the \c outPath buffer
+/// @return 1 if the class is simulated and was opened, even if it couldn't be parsed,
+/// or 0 if it isn't simulated or memory couldn't be allocated.
+/// @see resolveClass()
+uint8_t openSimulatedThrowable(const uint8_t* className_utf8_bytes, int32_t utf8_len, JavaClass** outClass,
+                               char* outPath, size_t outPathSize)
+{
+    ClassWriter writer;
+    uint32_t index;
+
+    for (index = 0; index < sizeof(simulatedThrowables) / sizeof(*simulatedThrowables); index++)
+    {
+        if (cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)simulatedThrowables[index].name,
+                     strlen(simulatedThrowables[index].name)))
+        {
+            break;
+        }
+    }
+
+    if (index == sizeof(simulatedThrowables) / sizeof(*simulatedThrowables))
+        return 0;
+
+    writer.data = (uint8_t*)malloc(SIMULATED_CLASS_CAPACITY);
+    writer.size = 0;
+    writer.overflow = 0;
+    *outClass = (JavaClass*)malloc(sizeof(JavaClass));
+
+    if (!writer.data || !*outClass)
+    {
+        if (writer.data)
+            free(writer.data);
+
+        if (*outClass)
+            free(*outClass);
+
+        return 0;
+    }
+
+    writeSimulatedThrowable(&writer, simulatedThrowables[index].name, simulatedThrowables[index].super);
+    snprintf(outPath, outPathSize, "%s.class", simulatedThrowables[index].name);
+
+    // The class keeps the data, which is released when it is closed
+    openClassBuffer(*outClass, writer.data, writer.overflow ? 0 : writer.size, outPath, 1, CLASS_PARSE_EAGER);
+    return 1;
+}
+
+/// @brief Gets the data of a field declared by the simulated Throwable
+/// in an instance of Throwable or of one of its subclasses.
+/// @return Pointer to the field in the data of the object, or NULL if
+/// Throwable isn't the simulated one.
+static int32_t* getThrowableField(Reference* throwable, enum ThrowableField index)
+{
+    LoadedClasses* lc = throwable->ci.c->loadedClass;
+    field_info* field;
+    cp_info* cpi;
+
+    // Throwable is the class right below Object
+    while (lc->super && lc->super->super)
+        lc = lc->super;
+
+    if (index >= lc->jc->fieldCount)
+        return NULL;
+
+    field = lc->jc->fields + index;
+    cpi = lc->jc->constantPool + field->name_index - 1;
+
+    if (!cmp_UTF8(UTF8(cpi), (const uint8_t*)(index == THROWABLE_FIELD_MESSAGE ? "message" : "backtrace"),
+                  index == THROWABLE_FIELD_MESSAGE ? 7 : 9))
+    {
+        return NULL;
+    }
+
+    return INSTANCE_FIELDS(throwable) + field->offset;
+}
+
+/// @brief Tells if a frame runs a constructor of an exception,
+/// or of one of the super classes of its class.
+static uint8_t isConstructorOf(Frame* frame, Reference* throwable)
+{
+    cp_info* cpi = frame->jc->constantPool + frame->method->name_index - 1;
+
+    return cmp_UTF8(UTF8(cpi), (const uint8_t*)"<init>", 6) && isClassAssignableTo(throwable->ci.c, frame->jc);
+}
+
+/// @brief Stores the class, method and bytecode offset of the frames of the JVM
+/// in the backtrace of a Throwable, from the top of the stack to its bottom.
+/// @param uint8_t skipConstructors - if non-zero, frames on the top of the stack
+/// that are running constructors of the exception are left out.
+/// @return 0 if memory couldn't be allocated, otherwise 1.
+static uint8_t captureBacktrace(JavaVirtualMachine* jvm, Reference* throwable, uint8_t skipConstructors)
+{
+    FrameStack* fs = &jvm->frames;
+    uint32_t top = fs->frameCount;
+    uint32_t index;
+    Reference* backtrace;
+    int64_t* entry;
+    int32_t* field;
+    Frame* frame;
+
+    while (skipConstructors && top > 0 && isConstructorOf(fs->frames + top - 1, throwable))
+        top--;
+
+    backtrace = newArray(jvm, top * BACKTRACE_ENTRY_SIZE, T_LONG);
+
+    if (!backtrace)
+    {
+        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+        return 0;
+    }
+
+    entry = (int64_t*)ARRAY_DATA(backtrace);
+
+    for (index = top; index > 0; index--, entry += BACKTRACE_ENTRY_SIZE)
+    {
+        frame = fs->frames + index - 1;
+
+        // The pc of a frame is the instruction after the one being executed,
+        // which is the one that threw or invoked the frame above
+        entry[0] = (intptr_t)frame->jc;
+        entry[1] = (intptr_t)frame->method;
+        entry[2] = frame->pc > 0 ? frame->instructions[frame->pc - 1].offset : -1;
+    }
+
+    field = getThrowableField(throwable, THROWABLE_FIELD_BACKTRACE);
+
+    if (field)
+        *field = ENCODE_REFERENCE(backtrace);
+
+    return 1;
+}
+
+/// @brief Fills in the backtrace of a Throwable that is being created.
+///
+/// Called by the constructors of Throwable, whose frames, as well as those
+/// of the constructors of its subclasses, aren't part of the backtrace.
+///
+/// @return 0 if memory couldn't be allocated, otherwise 1.
+/// @see printStackTrace()
+uint8_t fillInStackTrace(JavaVirtualMachine* jvm, Reference* throwable)
+{
+    return captureBacktrace(jvm, throwable, 1);
+}
+
+/// @brief Throws an exception from an instruction.
+/// @param JavaVirtualMachine* jvm - the JVM
+/// @param const char* className - class of the exception, like "java/lang/NullPointerException"
+/// @param const char* message - message of the exception, or NULL
+///
+/// An instance of the exception is created, without running its constructor, with
+/// the message and the backtrace of the frames of the JVM. It is then stored in the
+/// JVM as the exception being thrown, to be caught by catchException().
+///
+/// @return Always 0, so instructions can return its result. If the exception couldn't
+/// be created, the status of the JVM is set instead.
+uint8_t throwException(JavaVirtualMachine* jvm, const char* className, const char* message)
+{
+    LoadedClasses* lc;
+    Reference* throwable;
+    Reference* string;
+    int32_t* field;
+
+#ifdef DEBUG
+    printf("   throwing %s%s%s\n", className, message ? ": " : "", message ? message : "");
+#endif // DEBUG
+
+    if (!resolveClass(jvm, (const uint8_t*)className, strlen(className), &lc) || !lc)
+    {
+        jvm->status = JVM_STATUS_CLASS_RESOLUTION_FAILED;
+        return 0;
+    }
+
+    throwable = newClassInstance(jvm, lc);
+
+    if (!throwable)
+    {
+        if (jvm->status == JVM_STATUS_OK)
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+
+        return 0;
+    }
+
+    // Objects are only collected at safepoints, so the
+    // exception can't be collected while it isn't stored
+    if (message)
+    {
+        string = newString(jvm, (const uint8_t*)message, strlen(message));
+        field = getThrowableField(throwable, THROWABLE_FIELD_MESSAGE);
+
+        if (!string)
+        {
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+            return 0;
+        }
+
+        if (field)
+            *field = ENCODE_REFERENCE(string);
+    }
+
+    if (!captureBacktrace(jvm, throwable, 0))
+        return 0;
+
+    jvm->exception = throwable;
+    return 0;
+}
+
+/// @brief Throws an ArrayIndexOutOfBoundsException for an index of an array.
+/// @return Always 0, as throwException().
+uint8_t throwArrayIndexOutOfBounds(JavaVirtualMachine* jvm, int32_t index, uint32_t length)
+{
+    char message[64];
+    snprintf(message, sizeof(message), "Index %d out of bounds for length %u", index, length);
+    return throwException(jvm, "java/lang/ArrayIndexOutOfBoundsException", message);
+}
+
+/// @brief Throws a NegativeArraySizeException for the size of an array.
+/// @return Always 0, as throwException().
+uint8_t throwNegativeArraySize(JavaVirtualMachine* jvm, int32_t count)
+{
+    char message[16];
+    snprintf(message, sizeof(message), "%d", count);
+    return throwException(jvm, "java/lang/NegativeArraySizeException", message);
+}
+
+/// @brief Looks for a handler of the exception being thrown in a frame.
+/// @param JavaVirtualMachine* jvm - the JVM, whose \c exception is being thrown
+/// @param Frame* frame - the frame where the exception was thrown, either by the
+/// instruction that was just executed or by a method that it invoked.
+///
+/// The handlers of the range of the instruction are tried in order, and the first
+/// one whose catch type is a super class of the exception, or that catches any
+/// exception, is chosen. The operand stack of the frame is then cleared, the exception
+/// is pushed, and execution continues at the handler.
+///
+/// Called by the dispatch loop only when an instruction returns 0, so executing
+/// instructions that don't throw costs nothing more.
+///
+/// @return 1 if the exception was caught, 0 if there is no exception being thrown,
+/// if the frame has no handler for it, or if a catch type couldn't be resolved.
+/// @see executeFrame(), throwException()
+uint8_t catchException(JavaVirtualMachine* jvm, Frame* frame)
+{
+    Reference* exception = jvm->exception;
+    const ExceptionRange* range;
+    ExceptionTableEntry* entry;
+    LoadedClasses* catchClass;
+    cp_info* cpi;
+    uint32_t index;
+
+    if (!exception || jvm->status != JVM_STATUS_OK || !frame->code || frame->code->exception_range_count == 0)
+        return 0;
+
+    range = findExceptionRange(frame->code, frame->instructions[frame->pc - 1].offset);
+
+    if (!range)
+        return 0;
+
+    for (index = 0; index < range->handler_count; index++)
+    {
+        entry = frame->code->exception_table + frame->code->exception_handlers[range->first_handler + index];
+
+        if (entry->catch_type)
+        {
+            cpi = frame->jc->constantPool + entry->catch_type - 1;
+            cpi = frame->jc->constantPool + cpi->Class.name_index - 1;
+
+            if (!resolveClass(jvm, UTF8(cpi), &catchClass))
+                return 0;
+
+            if (!catchClass || !isClassAssignableTo(exception->ci.c, catchClass->jc))
+                continue;
+        }
+
+#ifdef DEBUG
+    printf("   exception caught by the handler at offset %u\n", entry->handler_pc);
+#endif // DEBUG
+
+        frame->operands.top = 0;
+
+        if (!pushOperand(&frame->operands, ENCODE_REFERENCE(exception), OP_REFERENCE))
+        {
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+            return 0;
+        }
+
+        frame->pc = entry->handler_index;
+        jvm->exception = NULL;
+        return 1;
+    }
+
+    return 0;
+}
+
+/// @brief Prints a class name with dots instead of slashes, like Java does.
+static void printClassName(JavaClass* jc)
+{
+    cp_info* cpi = jc->constantPool + jc->thisClass - 1;
+    uint16_t index;
+
+    cpi = jc->constantPool + cpi->Class.name_index - 1;
+
+    for (index = 0; index < cpi->Utf8.length; index++)
+        putchar(cpi->Utf8.bytes[index] == '/' ? '.' : cpi->Utf8.bytes[index]);
+}
+
+/// @brief Prints an exception, with its message, followed by the class, method,
+/// source file and line of each frame of its backtrace, like Java does.
+///
+/// Line numbers are looked up in the LineNumberTable of each method only now.
+///
+/// @see fillInStackTrace()
+void printStackTrace(Reference* throwable)
+{
+    att_SourceFile_info* source;
+    attribute_info* attribute;
+    Reference* message = NULL;
+    Reference* backtrace = NULL;
+    int32_t* field;
+    int64_t* entry;
+    JavaClass* jc;
+    method_info* method;
+    cp_info* cpi;
+    int32_t line;
+    uint32_t index;
+
+    field = getThrowableField(throwable, THROWABLE_FIELD_MESSAGE);
+
+    if (field)
+        message = DECODE_REFERENCE(*field);
+
+    field = getThrowableField(throwable, THROWABLE_FIELD_BACKTRACE);
+
+    if (field)
+        backtrace = DECODE_REFERENCE(*field);
+
+    printClassName(throwable->ci.c);
+
+    if (message && message->type == REFTYPE_STRING)
+        printf(": %.*s", message->str.len, STRING_BYTES(message));
+
+    printf("\n");
+
+    for (index = 0; backtrace && index < backtrace->arr.length; index += BACKTRACE_ENTRY_SIZE)
+    {
+        entry = (int64_t*)ARRAY_DATA(backtrace) + index;
+        jc = (JavaClass*)(intptr_t)entry[0];
+        method = (method_info*)(intptr_t)entry[1];
+        cpi = jc->constantPool + method->name_index - 1;
+
+        printf("\tat ");
+        printClassName(jc);
+        printf(".%.*s(", PRINT_UTF8(cpi));
+
+        attribute = getAttributeByType(jc->attributes, jc->attributeCount, ATTR_SourceFile);
+        source = attribute && loadAttribute(jc, attribute) ? (att_SourceFile_info*)attribute->info : NULL;
+        line = getMethodLineNumber(jc, method, entry[2]);
+
+        if (method->access_flags & ACC_NATIVE)
+        {
+            printf("Native Method");
+        }
+        else if (source)
+        {
+            cpi = jc->constantPool + source->sourcefile_index - 1;
+            printf("%.*s", PRINT_UTF8(cpi));
+
+            if (line >= 0)
+                printf(":%d", line);
+        }
+        else
+        {
+            printf("Unknown Source");
+        }
+
+        printf(")\n");
+    }
+}
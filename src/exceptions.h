@@ -0,0 +1,47 @@
+#ifndef EXCEPTIONS_H
+#define EXCEPTIONS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "jvm.h"
+
+uint8_t buildExceptionIndex(JavaClass* jc, att_Code_info* info);
+const ExceptionRange* findExceptionRange(const att_Code_info* info, uint16_t offset);
+
+uint8_t openSimulatedThrowable(const uint8_t* className_utf8_bytes, int32_t utf8_len, JavaClass** outClass,
+                               char* outPath, size_t outPathSize);
+
+uint8_t throwException(JavaVirtualMachine* jvm, const char* className, const char* message);
+uint8_t throwArrayIndexOutOfBounds(JavaVirtualMachine* jvm, int32_t index, uint32_t length);
+uint8_t throwNegativeArraySize(JavaVirtualMachine* jvm, int32_t count);
+uint8_t catchException(JavaVirtualMachine* jvm, Frame* frame);
+uint8_t fillInStackTrace(JavaVirtualMachine* jvm, Reference* throwable);
+void printStackTrace(Reference* throwable);
+
+#endif // EXCEPTIONS_H
+
+/// @defgroup exceptions Exceptions module
+///
+/// @brief Throws exceptions and finds the handlers that catch them.
+///
+/// When the exception table of a Code attribute is read, it is turned into a
+/// list of sorted, disjoint ranges of the bytecode, each with the handlers that
+/// cover it (see buildExceptionIndex()), so the handlers of an instruction are
+/// found with a binary search.
+///
+/// Instructions throw an exception by storing it in the JVM and returning 0,
+/// just like when they fail (see throwException()). Only then does the dispatch
+/// loop look for a handler in the frame (see catchException()). If there is none,
+/// the frame returns 0 to runMethod(), which pops it, and the invoke instruction
+/// of the caller frame returns 0 in turn, so the exception is passed on from frame
+/// to frame until it is caught or reaches executeJVM(). Instructions that don't
+/// throw pay nothing for this.
+///
+/// While System and String are simulated, Throwable and the exceptions thrown by the
+/// JVM are generated as small class files when they aren't found in the class path
+/// (see openSimulatedThrowable()), so programs can create, extend and catch them.
+/// Throwable keeps the message and a backtrace, with the class, method and bytecode
+/// offset of each frame, captured when the exception is created. Line numbers and
+/// source files are only looked up when the stack trace is printed.
+///
+/// @see exceptions.c
@@ -2,6 +2,7 @@
 #include "readfunctions.h"
 #include "validity.h"
 #include "utf8.h"
+#include <string.h>
 #include "debugging.h"
 
 /// @brief Reads a field_info from the file
@@ -157,34 +158,94 @@ void printAllFields(JavaClass* jc)
     printf("\n");
 }
 
-field_info* getFieldMatching(JavaClass* jc, const uint8_t* name, int32_t name_len, const uint8_t* descriptor,
-                             int32_t descriptor_len, uint16_t flag_mask)
+/// @brief Builds the hash table used to find the fields of a class by
+/// their names and descriptors, see JavaClass::fieldTable.
+/// @param JavaClass* jc - the class, whose fields have been read.
+/// @return 0 if memory couldn't be allocated, otherwise 1.
+uint8_t buildFieldTable(JavaClass* jc)
 {
-    field_info* field = jc->fields;
-    cp_info* cpi;
+    const cp_info* constantPool = jc->constantPool;
+    const field_info* field;
+    uint32_t capacity = 4, mask, slot;
     uint16_t index;
 
-    for (index = jc->fieldCount; index > 0; index--, field++)
+    if (jc->fieldCount == 0)
+        return 1;
+
+    // The table is kept at most half full
+    while (capacity < 2 * (uint32_t)jc->fieldCount)
+        capacity *= 2;
+
+    jc->fieldTable = (uint16_t*)malloc(capacity * sizeof(uint16_t));
+
+    if (!jc->fieldTable)
+        return 0;
+
+    memset(jc->fieldTable, 0, capacity * sizeof(uint16_t));
+
+    jc->fieldTableCapacity = capacity;
+    mask = capacity - 1;
+
+    for (index = 0; index < jc->fieldCount; index++)
     {
-        // Check if flags match
-        if ((field->access_flags & flag_mask) != flag_mask)
-            continue;
+        field = jc->fields + index;
+        slot = HASH_SYMBOL_PAIR(constantPool[field->name_index - 1].Utf8.symbol,
+                                constantPool[field->descriptor_index - 1].Utf8.symbol) & mask;
 
-        // Get the field name
-        cpi = jc->constantPool + field->name_index - 1;
-        // And check if it matches
-        if (!cmp_UTF8_Ascii(cpi->Utf8.bytes, cpi->Utf8.length, name, name_len))
-            continue;
+        while (jc->fieldTable[slot])
+            slot = (slot + 1) & mask;
 
-        // Get the field descriptor
-        cpi = jc->constantPool + field->descriptor_index - 1;
-        // And check if it matches
-        if (!cmp_UTF8_Ascii(cpi->Utf8.bytes, cpi->Utf8.length, descriptor, descriptor_len))
-            continue;
+        jc->fieldTable[slot] = index + 1;
+    }
 
+    return 1;
+}
 
-        return field;
+/// @brief Finds a field of a class by its name and descriptor.
+/// @param JavaClass* jc - the class that declares the field.
+/// @param const Symbol* name - interned name of the field.
+/// @param const Symbol* descriptor - interned descriptor of the field.
+/// @param uint16_t flag_mask - access flags that the field must have.
+/// @return The field that matches, or NULL if there is none.
+field_info* getFieldMatchingSymbols(JavaClass* jc, const Symbol* name, const Symbol* descriptor, uint16_t flag_mask)
+{
+    const cp_info* constantPool = jc->constantPool;
+    field_info* field;
+    uint32_t mask = jc->fieldTableCapacity - 1;
+    uint32_t slot;
+
+    if (!jc->fieldTable)
+        return NULL;
+
+    for (slot = HASH_SYMBOL_PAIR(name, descriptor) & mask; jc->fieldTable[slot]; slot = (slot + 1) & mask)
+    {
+        field = jc->fields + jc->fieldTable[slot] - 1;
+
+        // Names and descriptors are interned, so they can be compared by pointer
+        if (constantPool[field->name_index - 1].Utf8.symbol == name &&
+            constantPool[field->descriptor_index - 1].Utf8.symbol == descriptor)
+        {
+            // Check if flags match
+            return (field->access_flags & flag_mask) == flag_mask ? field : NULL;
+        }
     }
 
     return NULL;
 }
+
+/// @brief Finds a field of a class by its name and descriptor.
+///
+/// Same as getFieldMatchingSymbols(), for names and descriptors
+/// that aren't interned, such as string literals.
+field_info* getFieldMatching(JavaClass* jc, const uint8_t* name, int32_t name_len, const uint8_t* descriptor,
+                             int32_t descriptor_len, uint16_t flag_mask)
+{
+    // If a string hasn't been interned, no class has a field with that name or descriptor
+    const Symbol* nameSymbol = findSymbol(name, name_len);
+    const Symbol* descriptorSymbol = findSymbol(descriptor, descriptor_len);
+
+    if (!nameSymbol || !descriptorSymbol)
+        return NULL;
+
+    return getFieldMatchingSymbols(jc, nameSymbol, descriptorSymbol, flag_mask);
+}
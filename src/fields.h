@@ -6,6 +6,7 @@ typedef struct field_info field_info;
 #include <stdint.h>
 #include "javaclass.h"
 #include "attributes.h"
+#include "symbols.h"
 
 struct field_info {
     uint16_t access_flags;
@@ -25,6 +26,8 @@ char readField(JavaClass* jc, field_info* entry);
 void freeFieldAttributes(field_info* entry);
 void printAllFields(JavaClass* jc);
 
+uint8_t buildFieldTable(JavaClass* jc);
+field_info* getFieldMatchingSymbols(JavaClass* jc, const Symbol* name, const Symbol* descriptor, uint16_t flag_mask);
 field_info* getFieldMatching(JavaClass* jc, const uint8_t* name, int32_t name_len, const uint8_t* descriptor,
                              int32_t descriptor_len, uint16_t flag_mask);
 
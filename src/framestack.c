@@ -1,124 +1,144 @@
 #include "framestack.h"
 #include "debugging.h"
 
-///@brief A new frame is created each time a method is invoked.
+///@brief Allocates the memory used by the FrameStack passed as parameter by reference.
 ///
+///@param FrameStack* fs - pointer to the FrameStack to be initialized.
+///
+///@return 0 if the memory couldn't be allocated, 1 otherwise.
+uint8_t initFrameStack(FrameStack* fs)
+{
+    fs->frameCount = 0;
+    fs->frames = (Frame*)malloc(FRAMESTACK_MAX_FRAMES * sizeof(Frame));
+    fs->values = (int32_t*)malloc(FRAMESTACK_MAX_SLOTS * sizeof(int32_t));
+    fs->types = (OperandType*)malloc(FRAMESTACK_MAX_SLOTS * sizeof(OperandType));
+
+    if (!fs->frames || !fs->values || !fs->types)
+    {
+        freeFrameStack(fs);
+        return 0;
+    }
+
+    return 1;
+}
+
+///@brief A new frame is pushed each time a method is invoked.
+///
+///@param FrameStack* fs - pointer to the FrameStack where the Frame will be pushed.
 ///@param JavaClass* jc - pointer to the javaClass holding the method.
 ///@param method_info* method - pointer to the method
+///@param att_Code_info* code - the code of the method, already parsed
+/// (see loadMethodCode()), or NULL if the method has no code.
+///@param uint8_t numberOfParameters - number of operands on the top of the caller
+/// frame that are passed as parameters to the method.
 ///
-///@return pointer to the Frame created.
-Frame* newFrame(JavaClass* jc, method_info* method)
+/// The parameters are removed from the operand stack of the caller frame
+/// and become the first local variables of the new frame, without being copied.
+///
+///@return pointer to the Frame created, or NULL if there is no space left in the stack.
+Frame* pushFrame(FrameStack* fs, JavaClass* jc, method_info* method, att_Code_info* code, uint8_t numberOfParameters)
 {
-    Frame* frame = (Frame*)malloc(sizeof(Frame));
+    Frame* caller = getTopFrame(fs);
+    uint32_t base = 0;
+    uint16_t max_locals = numberOfParameters;
+    uint16_t max_stack = 0;
+
+    if (fs->frameCount >= FRAMESTACK_MAX_FRAMES)
+        return NULL;
 
-    if (frame)
+    if (caller)
+        base = caller->operands.values - fs->values + caller->operands.top - numberOfParameters;
+
+    if (code)
     {
-        attribute_info* codeAttribute = getAttributeByType(method->attributes, method->attributes_count, ATTR_Code);
-        att_Code_info* code;
+        if (code->max_locals > max_locals)
+            max_locals = code->max_locals;
 
-        if (codeAttribute)
-        {
-            code = (att_Code_info*)codeAttribute->info;
-            frame->code = code->code;
-            frame->code_length = code->code_length;
+        max_stack = code->max_stack;
+    }
 
-            if (code->max_locals > 0)
-                frame->localVariables = (int32_t*)malloc(code->max_locals * sizeof(int32_t));
-            else
-                frame->localVariables = NULL;
+    if (base + max_locals + max_stack > FRAMESTACK_MAX_SLOTS)
+        return NULL;
 
-#ifdef DEBUG
-            frame->max_locals = code->max_locals;
-#endif // DEBUG
+    if (caller)
+        caller->operands.top -= numberOfParameters;
+
+    Frame* frame = fs->frames + fs->frameCount++;
 
-        }
-        else
-        {
-            frame->code = NULL;
-            frame->code_length = 0;
-            frame->localVariables = NULL;
-        }
-
-        frame->operands = NULL;
-        frame->jc = jc;
-        frame->pc = 0;
-        //frame->fp_strict = (method->access_flags & ACC_STRICT) != 0;
+    if (code)
+    {
+        frame->instructions = code->instructions;
+        frame->instructionCount = code->instruction_count;
+    }
+    else
+    {
+        frame->instructions = NULL;
+        frame->instructionCount = 0;
     }
 
-    return frame;
-}
+    frame->localVariables = max_locals > 0 ? fs->values + base : NULL;
+    frame->localVariableTypes = max_locals > 0 ? fs->types + base : NULL;
+    frame->operands.values = fs->values + base + max_locals;
+    frame->operands.types = fs->types + base + max_locals;
+    frame->operands.top = 0;
+    frame->operands.capacity = max_stack;
 
-///@brief Free the Frame passed as parameter.
-///
-///@param Frame* frame - pointer to Frame to be freed.
-void freeFrame(Frame* frame)
-{
-    if (frame->localVariables)
-        free(frame->localVariables);
+    // The parameters already have the types they were pushed with. Other local
+    // variables may have types left by previous frames, which are cleared.
+    uint16_t index;
+
+    for (index = numberOfParameters; index < max_locals; index++)
+        frame->localVariableTypes[index] = OP_NULL;
+
+#ifdef DEBUG
+    frame->max_locals = max_locals;
+#endif // DEBUG
 
-    if (frame->operands)
-        freeOperandStack(&frame->operands);
+    frame->jc = jc;
+    frame->method = method;
+    frame->code = code;
+    frame->pc = 0;
+    frame->returnCount = 0;
+    //frame->fp_strict = (method->access_flags & ACC_STRICT) != 0;
 
-    free(frame);
+    return frame;
 }
 
-///@brief Push the Frame into the FrameStack passed as parameter by reference
-///
-///@param FrameStack** fs - pointer to the FrameStack where the Frame will be pushed.
-///@param Frame* frame - pointer to Frame to be pushed.
+///@brief Pop the Frame on the top of the FrameStack passed as parameter by reference
 ///
-///@return 0 if node is NULL, in other words, if the push was not successful, any other integer value otherwise
-uint8_t pushFrame(FrameStack** fs, Frame* frame)
+///@param FrameStack* fs - pointer to the FrameStack.
+void popFrame(FrameStack* fs)
 {
-    FrameStack* node = (FrameStack*)malloc(sizeof(FrameStack));
-
-    if (node)
-    {
-        node->frame = frame;
-        node->next = *fs;
-        *fs = node;
-    }
-
-    return node != NULL;
+    if (fs->frameCount > 0)
+        fs->frameCount--;
 }
 
-///@brief Pop the Frame passed as parameter by reference
+///@brief Gets the Frame on the top of the FrameStack passed as parameter by reference
 ///
-///@param FrameStack** fs - pointer to the FrameStack.
-///@param Frame* outPtr - pointer to Frame that will be popped.
+///@param FrameStack* fs - pointer to the FrameStack.
 ///
-///@return 1 if the pop operation was sucessful, 0 otherwise.
-uint8_t popFrame(FrameStack** fs, Frame* outPtr)
+///@return pointer to the Frame on the top of the stack, or NULL if the stack is empty.
+Frame* getTopFrame(FrameStack* fs)
 {
-    FrameStack* node = *fs;
-
-    if (node)
-    {
-        if (outPtr)
-            *outPtr = *node->frame;
-
-        *fs = node->next;
-        free(node);
-    }
-
-    return node != NULL;
+    return fs->frameCount > 0 ? fs->frames + fs->frameCount - 1 : NULL;
 }
 
-///@brief Free all the elements of the FrameStack passed as parameter by reference
+///@brief Free the memory used by the FrameStack passed as parameter by reference
 ///
-///@param FrameStack** fs - pointer to the FrameStack.
-void freeFrameStack(FrameStack** fs)
+///@param FrameStack* fs - pointer to the FrameStack.
+void freeFrameStack(FrameStack* fs)
 {
-    FrameStack* node = *fs;
-    FrameStack* tmp;
+    if (fs->frames)
+        free(fs->frames);
 
-    while (node)
-    {
-        tmp = node;
-        node = node->next;
-        freeFrame(tmp->frame);
-        free(tmp);
-    }
+    if (fs->values)
+        free(fs->values);
+
+    if (fs->types)
+        free(fs->types);
 
-    *fs = NULL;
+    fs->frames = NULL;
+    fs->values = NULL;
+    fs->types = NULL;
+    fs->frameCount = 0;
 }
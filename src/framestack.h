@@ -7,6 +7,14 @@ typedef struct FrameStack FrameStack;
 #include "operandstack.h"
 #include "attributes.h"
 
+/// @brief Maximum number of frames (nested method calls) the
+/// stack of the JVM can hold.
+#define FRAMESTACK_MAX_FRAMES 4096
+
+/// @brief Number of 32-bit slots available to hold the local
+/// variables and operands of all frames of the stack.
+#define FRAMESTACK_MAX_SLOTS 262144
+
 /// @brief Structure that will be associated with a method and
 /// holds the information necessary to run the method.
 struct Frame
@@ -14,26 +22,43 @@ struct Frame
     /// @brief Class of the method associated with this frame.
     JavaClass* jc;
 
+    /// @brief The method associated with this frame.
+    method_info* method;
+
+    /// @brief Code of the method, or NULL for native methods. Its exception
+    /// table is looked up when an exception reaches this frame.
+    att_Code_info* code;
+
     /// @brief Number of operands that should be moved from this frame to
     /// the caller frame when the method returns.
     uint8_t returnCount;
 
-    /// @brief Index of the current bytecode being read from the
-    /// method's instructions, Program Counter.
+    /// @brief Index of the next instruction to be executed from the
+    /// method's decoded instructions, Program Counter.
     uint32_t pc;
 
-    /// @brief Number of bytes the bytecode of the method contains.
-    uint32_t code_length;
+    /// @brief Number of decoded instructions of the method.
+    uint32_t instructionCount;
 
-    /// @brief Bytecode of the method.
-    uint8_t* code;
+    /// @brief Decoded instructions of the method.
+    /// @see decodeBytecode()
+    Instruction* instructions;
 
     /// @brief Stack of operands used by the method.
-    OperandStack* operands;
+    OperandStack operands;
 
     /// @brief Array of local variables used by the method.
+    ///
+    /// The first local variables overlap the operands
+    /// that the caller frame passed as parameters.
     int32_t* localVariables;
 
+    /// @brief Types of the local variables, parallel to localVariables.
+    ///
+    /// They are kept by the store instructions so the garbage
+    /// collector can tell which local variables hold references.
+    OperandType* localVariableTypes;
+
 #ifdef DEBUG
     uint16_t max_locals;
 #endif
@@ -41,19 +66,34 @@ struct Frame
 
 /// @brief Stack of frames to store all frames created
 /// by method calling during execution of the JVM.
+///
+/// The stack is allocated once, when the JVM is initialized.
+/// Frames are stored back to back in an array, and the local
+/// variables and operands of all frames share a single array
+/// of slots. The local variables of a frame start where the
+/// parameters were pushed in the operand stack of the caller
+/// frame, so parameters don't need to be copied, and its operand
+/// stack starts right after its local variables.
 struct FrameStack
 {
-    /// @brief The node value of the stack.
-    Frame* frame;
+    /// @brief Array of frames. The frame on the top of the
+    /// stack is the one at index frameCount - 1.
+    Frame* frames;
+
+    /// @brief Number of frames currently in the stack.
+    uint32_t frameCount;
+
+    /// @brief Values of the slots used by local variables and operands.
+    int32_t* values;
 
-    /// @brief Pointer to the next element of the stack.
-    struct FrameStack* next;
+    /// @brief Types of the slots, parallel to the values array.
+    OperandType* types;
 };
 
-Frame* newFrame(JavaClass* jc, method_info* method);
-void freeFrame(Frame* frame);
-uint8_t pushFrame(FrameStack** fs, Frame* frame);
-uint8_t popFrame(FrameStack** fs, Frame* outPtr);
-void freeFrameStack(FrameStack** fs);
+uint8_t initFrameStack(FrameStack* fs);
+Frame* pushFrame(FrameStack* fs, JavaClass* jc, method_info* method, att_Code_info* code, uint8_t numberOfParameters);
+void popFrame(FrameStack* fs);
+Frame* getTopFrame(FrameStack* fs);
+void freeFrameStack(FrameStack* fs);
 
 #endif // FRAMESTACK_H
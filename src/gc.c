@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "gc.h"
+#include "debugging.h"
+
+/// @brief Initial number of objects the mark stack can hold.
+#define MARK_STACK_INITIAL_CAPACITY 256
+
+/// @brief Stack of objects that have been marked but whose
+/// references haven't been followed yet.
+typedef struct MarkStack
+{
+    Reference** objects;
+    uint32_t count;
+    uint32_t capacity;
+} MarkStack;
+
+/// @brief Marks an object as reachable, adding it to the mark stack
+/// so its references are followed later.
+/// @param MarkStack* ms - the mark stack
+/// @param Reference* obj - the object to be marked. Can be NULL.
+/// @return 0 if the mark stack couldn't grow, otherwise 1.
+static uint8_t markReference(MarkStack* ms, Reference* obj)
+{
+    if (!obj || obj->marked)
+        return 1;
+
+    if (ms->count == ms->capacity)
+    {
+        uint32_t newCapacity = ms->capacity ? 2 * ms->capacity : MARK_STACK_INITIAL_CAPACITY;
+        Reference** objects = (Reference**)malloc(newCapacity * sizeof(Reference*));
+
+        if (!objects)
+            return 0;
+
+        if (ms->objects)
+        {
+            memcpy(objects, ms->objects, ms->count * sizeof(Reference*));
+            free(ms->objects);
+        }
+
+        ms->objects = objects;
+        ms->capacity = newCapacity;
+    }
+
+    obj->marked = 1;
+    ms->objects[ms->count++] = obj;
+    return 1;
+}
+
+/// @brief Marks the objects referenced by the fields of a class that
+/// have a reference type (descriptors starting with 'L' or '[').
+/// @param MarkStack* ms - the mark stack
+/// @param JavaClass* jc - the class that declares the fields
+/// @param int32_t* data - the static data of the class, or the data of an instance
+/// @param uint16_t isStatic - ACC_STATIC to mark static fields, 0 to mark instance fields
+/// @return 0 if the mark stack couldn't grow, otherwise 1.
+static uint8_t markFields(MarkStack* ms, JavaClass* jc, int32_t* data, uint16_t isStatic)
+{
+    field_info* field = jc->fields;
+    uint16_t index;
+    uint8_t descriptor;
+
+    for (index = jc->fieldCount; index > 0; index--, field++)
+    {
+        if ((field->access_flags & ACC_STATIC) != isStatic)
+            continue;
+
+        descriptor = *jc->constantPool[field->descriptor_index - 1].Utf8.bytes;
+
+        if ((descriptor == 'L' || descriptor == '[') &&
+            !markReference(ms, DECODE_REFERENCE(data[field->offset])))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/// @brief Marks all objects that are reachable from the roots: the references
+/// in the frames of the JVM, the exception being thrown and the static fields
+/// of all loaded classes.
+/// @return 0 if the mark stack couldn't grow, otherwise 1.
+static uint8_t markRoots(JavaVirtualMachine* jvm, MarkStack* ms)
+{
+    FrameStack* fs = &jvm->frames;
+    Frame* frame;
+    LoadedClasses* lc;
+    uint32_t index, slot, end;
+
+    for (index = 0; index < fs->frameCount; index++)
+    {
+        frame = fs->frames + index;
+
+        // Local variables are followed by the operands of the frame
+        slot = (frame->localVariables ? frame->localVariables : frame->operands.values) - fs->values;
+        end = frame->operands.values + frame->operands.top - fs->values;
+
+        for (; slot < end; slot++)
+        {
+            if (fs->types[slot] == OP_REFERENCE &&
+                !markReference(ms, DECODE_REFERENCE(fs->values[slot])))
+            {
+                return 0;
+            }
+        }
+    }
+
+    // The exception being thrown isn't in any frame while it is passed on
+    if (!markReference(ms, jvm->exception))
+        return 0;
+
+    for (index = 0; index < jvm->classTableCapacity; index++)
+    {
+        lc = jvm->classes[index];
+
+        if (lc && lc->staticFieldsData && !markFields(ms, lc->jc, lc->staticFieldsData, ACC_STATIC))
+            return 0;
+    }
+
+    return 1;
+}
+
+/// @brief Follows the references of all objects in the mark stack until
+/// it is empty, marking every object that they reach.
+/// @return 0 if the mark stack couldn't grow, otherwise 1.
+static uint8_t markReachableObjects(MarkStack* ms)
+{
+    Reference* obj;
+    LoadedClasses* lc;
+    uint32_t index;
+
+    while (ms->count > 0)
+    {
+        obj = ms->objects[--ms->count];
+
+        switch (obj->type)
+        {
+            case REFTYPE_CLASSINSTANCE:
+
+                // Fields of the super classes are stored in the same data
+                for (lc = obj->ci.c->loadedClass; lc; lc = lc->super)
+                {
+                    if (!markFields(ms, lc->jc, INSTANCE_FIELDS(obj), 0))
+                        return 0;
+                }
+
+                break;
+
+            case REFTYPE_OBJARRAY:
+
+                for (index = 0; index < obj->oar.length; index++)
+                {
+                    if (!markReference(ms, DECODE_REFERENCE(OBJECT_ARRAY_ELEMENTS(obj)[index])))
+                        return 0;
+                }
+
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return 1;
+}
+
+/// @brief Sets the minimum heap size that triggers a garbage collection.
+/// @param JavaVirtualMachine* jvm - the JVM whose heap threshold will be set
+/// @param size_t bytes - number of bytes used by objects that triggers a collection.
+/// @see collectGarbage()
+void setHeapThreshold(JavaVirtualMachine* jvm, size_t bytes)
+{
+    jvm->minGcThreshold = bytes;
+    jvm->gcThreshold = bytes;
+}
+
+/// @brief Deletes all objects that can't be reached by the program.
+/// @param JavaVirtualMachine* jvm - the JVM whose objects will be collected.
+///
+/// Objects that are reachable from the roots are marked, then the heap
+/// is swept, deleting the objects that weren't marked (see sweepHeap()).
+/// After the collection, the threshold for the next one is set to twice the
+/// size of the surviving objects, or to the minimum threshold if that is larger.
+/// The duration of the collection and the amount of memory reclaimed are added to
+/// the statistics of the JVM, and also printed if \c verboseGC is set.
+///
+/// @pre All live references must be stored in frames, static fields or other
+/// objects, see GC_SAFEPOINT.
+/// @return 1 if the collection was made, or 0 if there wasn't enough memory
+/// to mark the objects, in which case no object is deleted.
+/// @see setHeapThreshold()
+uint8_t collectGarbage(JavaVirtualMachine* jvm)
+{
+    clock_t startTime = clock();
+    MarkStack ms = {NULL, 0, 0};
+    size_t heapSizeBefore = jvm->heapSize;
+    size_t reclaimedBytes = 0;
+    uint32_t reclaimedObjects = 0;
+    uint8_t success = markRoots(jvm, &ms) && markReachableObjects(&ms);
+
+    if (ms.objects)
+        free(ms.objects);
+
+    // Sweep, deleting the objects that weren't marked. Empty regions are kept
+    // up to the current threshold, as the heap will likely grow that much
+    // again before the next collection. If marking couldn't be completed,
+    // the marks are just cleared.
+    if (success)
+        sweepHeap(&jvm->heap, jvm->gcThreshold, &reclaimedBytes, &reclaimedObjects);
+    else
+        clearHeapMarks(&jvm->heap);
+
+    jvm->heapSize -= reclaimedBytes;
+    jvm->gcThreshold = 2 * jvm->heapSize;
+
+    if (jvm->gcThreshold < jvm->minGcThreshold)
+        jvm->gcThreshold = jvm->minGcThreshold;
+
+    double pause = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+    GarbageCollectorStats* stats = &jvm->gcStats;
+
+    stats->collections++;
+    stats->reclaimedObjects += reclaimedObjects;
+    stats->reclaimedBytes += heapSizeBefore - jvm->heapSize;
+    stats->totalPause += pause;
+
+    if (pause > stats->maxPause)
+        stats->maxPause = pause;
+
+    if (jvm->verboseGC)
+    {
+        printf("[GC #%u: %luK -> %luK, %u objects reclaimed, %.3f ms]\n", stats->collections,
+               (unsigned long)(heapSizeBefore / 1024), (unsigned long)(jvm->heapSize / 1024),
+               reclaimedObjects, 1000 * pause);
+    }
+
+    return success;
+}
@@ -0,0 +1,40 @@
+#ifndef GC_H
+#define GC_H
+
+#include <stddef.h>
+#include "jvm.h"
+
+/// @brief Default heap size, in bytes, that triggers a garbage collection.
+#define GC_DEFAULT_HEAP_THRESHOLD (4 * 1024 * 1024)
+
+/// @brief Collects garbage if the heap has grown past its threshold.
+///
+/// Garbage can only be collected at points where every live reference
+/// is stored in a frame, a static field or another object. This macro
+/// is used by instructions that create objects right before creating
+/// them, when no reference is held by local C variables.
+#define GC_SAFEPOINT(jvm) \
+    if ((jvm)->heapSize >= (jvm)->gcThreshold) \
+        collectGarbage(jvm);
+
+void setHeapThreshold(JavaVirtualMachine* jvm, size_t bytes);
+uint8_t collectGarbage(JavaVirtualMachine* jvm);
+
+#endif // GC_H
+
+/// @defgroup gc Garbage collector module
+///
+/// @brief Releases objects that can't be reached by the program anymore.
+///
+/// The collector is a precise mark-sweep collector. Collections are
+/// triggered when the number of bytes used by objects reaches a threshold,
+/// which is then adjusted to twice the amount of bytes that survived the
+/// collection, but never less than the value given to setHeapThreshold().
+///
+/// The roots are the local variables and operands of all frames tagged with
+/// OP_REFERENCE, the exception being thrown and the reference fields in the
+/// static data of all loaded classes. From them, reference fields of class
+/// instances and elements of object arrays are followed. All objects that
+/// weren't reached are deleted.
+///
+/// @see gc.c, GC_SAFEPOINT
@@ -0,0 +1,440 @@
+// Needed for MAP_ANONYMOUS and MAP_NORESERVE in strict C99 mode
+#define _DEFAULT_SOURCE
+
+#include <string.h>
+#include "heap.h"
+#include "jvm.h"
+#include "debugging.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+
+    #ifndef MAP_ANONYMOUS
+        #define MAP_ANONYMOUS MAP_ANON
+    #endif
+
+    #ifndef MAP_NORESERVE
+        #define MAP_NORESERVE 0
+    #endif
+#endif
+
+/// @brief Gets the address of the first block of a region.
+#define REGION_START(region) ((uint8_t*)(region) + HEAP_ALIGN(sizeof(HeapRegion)))
+
+/// @brief Start of the address space reserved by the heap. References are
+/// offsets from this address.
+/// @see ENCODE_REFERENCE(), DECODE_REFERENCE()
+uint8_t* heapBase = NULL;
+
+/// @brief Reserves a range of addresses, without committing memory to it.
+/// @return The start of the range, or NULL if it couldn't be reserved.
+static uint8_t* reserveAddressSpace(size_t size)
+{
+#ifdef _WIN32
+    return (uint8_t*)VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void* address = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return address == MAP_FAILED ? NULL : (uint8_t*)address;
+#endif
+}
+
+/// @brief Releases a range of addresses reserved by reserveAddressSpace().
+static void releaseAddressSpace(uint8_t* address, size_t size)
+{
+#ifdef _WIN32
+    VirtualFree(address, 0, MEM_RELEASE);
+#else
+    munmap(address, size);
+#endif
+}
+
+/// @brief Commits memory to part of the reserved addresses, so it can be used.
+/// @return 1 on success, 0 if there isn't enough memory.
+static uint8_t commitMemory(uint8_t* address, size_t size)
+{
+#ifdef _WIN32
+    return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    return mprotect(address, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+/// @brief Gives memory committed by commitMemory() back to the system,
+/// keeping its addresses reserved.
+static void decommitMemory(uint8_t* address, size_t size)
+{
+#ifdef _WIN32
+    VirtualFree(address, size, MEM_DECOMMIT);
+#else
+    mmap(address, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+#endif
+}
+
+/// @brief Initializes an empty heap, reserving its address space.
+/// @param Heap* heap - the heap to be initialized
+/// @return 1 on success, 0 if the address space couldn't be reserved.
+/// @note Only one heap can be initialized at a time.
+uint8_t initHeap(Heap* heap)
+{
+    size_t size = HEAP_MAX_RESERVED_SIZE;
+
+    heap->regions = NULL;
+    heap->top = NULL;
+    heap->end = NULL;
+    heap->freeBlocks = NULL;
+    heap->regionCount = 0;
+    heap->firstFreeSlot = 0;
+
+    while ((heapBase = reserveAddressSpace(size)) == NULL && size > HEAP_MIN_RESERVED_SIZE)
+        size /= 2;
+
+    heap->reservedSize = heapBase ? size : 0;
+    heap->slotCount = heap->reservedSize / HEAP_REGION_SIZE;
+    heap->usedSlots = heapBase ? (uint8_t*)malloc(heap->slotCount) : NULL;
+
+    if (!heap->usedSlots)
+    {
+        if (heapBase)
+            releaseAddressSpace(heapBase, size);
+
+        heapBase = NULL;
+        heap->reservedSize = 0;
+        heap->slotCount = 0;
+        return 0;
+    }
+
+    memset(heap->usedSlots, 0, heap->slotCount);
+    return 1;
+}
+
+/// @brief Releases all regions of a heap, and therefore all of its objects,
+/// as well as its address space.
+/// @param Heap* heap - the heap to be released
+void freeHeap(Heap* heap)
+{
+    if (heapBase)
+        releaseAddressSpace(heapBase, heap->reservedSize);
+
+    if (heap->usedSlots)
+        free(heap->usedSlots);
+
+    heapBase = NULL;
+    heap->regions = NULL;
+    heap->top = NULL;
+    heap->end = NULL;
+    heap->freeBlocks = NULL;
+    heap->regionCount = 0;
+    heap->reservedSize = 0;
+    heap->usedSlots = NULL;
+    heap->slotCount = 0;
+    heap->firstFreeSlot = 0;
+}
+
+/// @brief Turns a range of memory into a free block.
+static void makeFreeBlock(uint8_t* address, size_t size)
+{
+    Reference* block = (Reference*)address;
+    block->type = REFTYPE_FREE;
+    block->marked = 0;
+    block->size = size;
+}
+
+/// @brief Gets the number of slots used by a region.
+static uint32_t getRegionSlotCount(HeapRegion* region)
+{
+    return (region->end - (uint8_t*)region + HEAP_REGION_SIZE - 1) / HEAP_REGION_SIZE;
+}
+
+/// @brief Allocates a new region and adds it to the heap.
+/// @param Heap* heap - the heap that will hold the region
+/// @param size_t size - number of bytes available for blocks in the region
+/// @return The new region, or NULL if there are no free slots left in the
+/// reserved space or memory couldn't be committed.
+static HeapRegion* newRegion(Heap* heap, size_t size)
+{
+    size_t bytes = HEAP_ALIGN(sizeof(HeapRegion)) + size;
+    uint32_t slots = (bytes + HEAP_REGION_SIZE - 1) / HEAP_REGION_SIZE;
+    uint32_t first = heap->firstFreeSlot;
+    uint32_t count = 0;
+    HeapRegion* region;
+
+    // Finds the first run of free slots that is long enough
+    while (count < slots)
+    {
+        if (first + count >= heap->slotCount)
+            return NULL;
+
+        if (heap->usedSlots[first + count])
+        {
+            first += count + 1;
+            count = 0;
+        }
+        else
+        {
+            count++;
+        }
+    }
+
+    region = (HeapRegion*)(heapBase + (size_t)first * HEAP_REGION_SIZE);
+
+    if (!commitMemory((uint8_t*)region, (size_t)slots * HEAP_REGION_SIZE))
+        return NULL;
+
+    memset(heap->usedSlots + first, 1, slots);
+
+    if (first == heap->firstFreeSlot)
+        heap->firstFreeSlot = first + slots;
+
+    region->end = REGION_START(region) + size;
+    region->next = heap->regions;
+    heap->regions = region;
+    heap->regionCount++;
+
+    return region;
+}
+
+/// @brief Releases the memory of a region, which must have already been
+/// removed from the list of regions of the heap.
+static void releaseRegion(Heap* heap, HeapRegion* region)
+{
+    uint32_t first = ((uint8_t*)region - heapBase) / HEAP_REGION_SIZE;
+    uint32_t slots = getRegionSlotCount(region);
+
+    decommitMemory((uint8_t*)region, (size_t)slots * HEAP_REGION_SIZE);
+    memset(heap->usedSlots + first, 0, slots);
+
+    if (first < heap->firstFreeSlot)
+        heap->firstFreeSlot = first;
+
+    heap->regionCount--;
+}
+
+/// @brief Turns the unused part of the current allocation
+/// range into a free block, so regions remain walkable.
+static void retireAllocationRange(Heap* heap)
+{
+    if (heap->top < heap->end)
+        makeFreeBlock(heap->top, heap->end - heap->top);
+
+    heap->top = NULL;
+    heap->end = NULL;
+}
+
+/// @brief Replaces the current allocation range by one that has at least \c size bytes.
+///
+/// Free blocks found by the last sweep are used first. Free blocks that are too
+/// small are skipped and stay in the heap until a sweep merges them. If no free block
+/// is large enough, a new region is allocated.
+/// @return 1 on success, 0 if memory allocation failed.
+static uint8_t nextAllocationRange(Heap* heap, size_t size)
+{
+    Reference* block;
+    HeapRegion* region;
+
+    retireAllocationRange(heap);
+
+    while (heap->freeBlocks)
+    {
+        block = heap->freeBlocks;
+        heap->freeBlocks = block->nextFree;
+
+        if (block->size >= size)
+        {
+            heap->top = (uint8_t*)block;
+            heap->end = heap->top + block->size;
+            return 1;
+        }
+    }
+
+    region = newRegion(heap, HEAP_REGION_SIZE - HEAP_ALIGN(sizeof(HeapRegion)));
+
+    if (!region)
+        return 0;
+
+    heap->top = REGION_START(region);
+    heap->end = region->end;
+    return 1;
+}
+
+/// @brief Allocates a block of memory for an object.
+/// @param Heap* heap - the heap where the block will be allocated
+/// @param size_t size - number of bytes of the object, including its Reference header
+/// @return The block, with all bytes set to zero and the \c size of its header set,
+/// or NULL if memory allocation failed.
+///
+/// The block is carved from the current allocation range by bumping its top. Blocks
+/// larger than HEAP_LARGE_OBJECT_SIZE are given a region of their own instead.
+Reference* allocateBlock(Heap* heap, size_t size)
+{
+    Reference* block;
+    HeapRegion* region;
+
+    if (size > UINT32_MAX - HEAP_ALIGNMENT)
+        return NULL;
+
+    size = HEAP_ALIGN(size);
+
+    if ((size_t)(heap->end - heap->top) >= size)
+    {
+        block = (Reference*)heap->top;
+        heap->top += size;
+    }
+    else if (size > HEAP_LARGE_OBJECT_SIZE)
+    {
+        region = newRegion(heap, size);
+
+        if (!region)
+            return NULL;
+
+        block = (Reference*)REGION_START(region);
+    }
+    else
+    {
+        if (!nextAllocationRange(heap, size))
+            return NULL;
+
+        block = (Reference*)heap->top;
+        heap->top += size;
+    }
+
+    memset(block, 0, size);
+    block->size = size;
+    return block;
+}
+
+/// @brief Deletes all objects of the heap that haven't been marked, and clears
+/// the marks of the other objects.
+/// @param Heap* heap - the heap to be swept
+/// @param size_t spareBytes - how many bytes of empty regions to keep for later allocations
+/// @param size_t* reclaimedBytes - incremented by the size of the deleted objects
+/// @param uint32_t* reclaimedObjects - incremented by the number of deleted objects
+///
+/// Every region is walked block by block. Unmarked objects become free blocks, which
+/// are merged with adjacent free blocks. Free blocks that have at least HEAP_MIN_FREE_BLOCK_SIZE
+/// bytes are used by the next allocations. Regions left without objects are released,
+/// except for up to \c spareBytes bytes of regions, which are kept to be reused without
+/// asking the system for memory again.
+void sweepHeap(Heap* heap, size_t spareBytes, size_t* reclaimedBytes, uint32_t* reclaimedObjects)
+{
+    HeapRegion** link = &heap->regions;
+    HeapRegion* region;
+    Reference* block;
+    Reference* freeBlock;
+    uint8_t* address;
+    uint8_t hasObjects;
+    size_t keptBytes = 0;
+
+    retireAllocationRange(heap);
+    heap->freeBlocks = NULL;
+
+    while ((region = *link) != NULL)
+    {
+        freeBlock = NULL;
+        hasObjects = 0;
+
+        for (address = REGION_START(region); address < region->end; address += block->size)
+        {
+            block = (Reference*)address;
+
+            if (block->type != REFTYPE_FREE && block->marked)
+            {
+                block->marked = 0;
+                hasObjects = 1;
+
+                if (freeBlock && freeBlock->size >= HEAP_MIN_FREE_BLOCK_SIZE)
+                {
+                    freeBlock->nextFree = heap->freeBlocks;
+                    heap->freeBlocks = freeBlock;
+                }
+
+                freeBlock = NULL;
+                continue;
+            }
+
+            if (block->type != REFTYPE_FREE)
+            {
+                *reclaimedBytes += block->size;
+                (*reclaimedObjects)++;
+            }
+
+            if (freeBlock)
+            {
+                freeBlock->size += block->size;
+            }
+            else
+            {
+                makeFreeBlock(address, block->size);
+                freeBlock = block;
+            }
+        }
+
+        if (!hasObjects &&
+            (keptBytes + HEAP_REGION_SIZE > spareBytes || getRegionSlotCount(region) > 1))
+        {
+            *link = region->next;
+            releaseRegion(heap, region);
+            continue;
+        }
+
+        if (!hasObjects)
+            keptBytes += HEAP_REGION_SIZE;
+
+        if (freeBlock && freeBlock->size >= HEAP_MIN_FREE_BLOCK_SIZE)
+        {
+            freeBlock->nextFree = heap->freeBlocks;
+            heap->freeBlocks = freeBlock;
+        }
+
+        link = &region->next;
+    }
+}
+
+/// @brief Clears the marks of all objects of the heap, without deleting any object.
+/// @param Heap* heap - the heap whose objects will be unmarked
+void clearHeapMarks(Heap* heap)
+{
+    HeapRegion* region;
+    Reference* block;
+    uint8_t* address;
+
+    retireAllocationRange(heap);
+
+    for (region = heap->regions; region; region = region->next)
+    {
+        for (address = REGION_START(region); address < region->end; address += block->size)
+        {
+            block = (Reference*)address;
+            block->marked = 0;
+        }
+    }
+}
+
+/// @brief Calls a function for every object of the heap, skipping free blocks.
+/// @param Heap* heap - the heap whose objects will be visited
+/// @param HeapVisitor visit - function called with each object and \c context.
+/// If it returns 0, the walk stops.
+/// @param void* context - passed to \c visit
+/// @return 1 if every object was visited, 0 if \c visit stopped the walk.
+uint8_t walkHeap(Heap* heap, HeapVisitor visit, void* context)
+{
+    HeapRegion* region;
+    Reference* block;
+    uint8_t* address;
+
+    retireAllocationRange(heap);
+
+    for (region = heap->regions; region; region = region->next)
+    {
+        for (address = REGION_START(region); address < region->end; address += block->size)
+        {
+            block = (Reference*)address;
+
+            if (block->type != REFTYPE_FREE && !visit(block, context))
+                return 0;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,142 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// @brief Size, in bytes, of each region of the heap.
+#define HEAP_REGION_SIZE (256 * 1024)
+
+/// @brief Objects larger than this get a region of their own.
+#define HEAP_LARGE_OBJECT_SIZE (HEAP_REGION_SIZE / 4)
+
+/// @brief Alignment, in bytes, of all blocks of the heap.
+#define HEAP_ALIGNMENT 8
+
+/// @brief Number of bits a reference is shifted to the left to
+/// become an offset in the heap. Equal to log2(HEAP_ALIGNMENT).
+#define HEAP_REFERENCE_SHIFT 3
+
+/// @brief Free blocks smaller than this aren't reused for allocation
+/// until they are merged with neighbouring free blocks.
+#define HEAP_MIN_FREE_BLOCK_SIZE 128
+
+/// @brief Largest and smallest amount of address space reserved for the heap.
+///
+/// The heap tries to reserve the largest size, halving it until the reservation
+/// succeeds. References are 32-bit offsets in units of HEAP_ALIGNMENT, so at most
+/// 32 GB can be addressed.
+#if UINTPTR_MAX > 0xFFFFFFFFu
+    #define HEAP_MAX_RESERVED_SIZE ((size_t)32 * 1024 * 1024 * 1024)
+#else
+    #define HEAP_MAX_RESERVED_SIZE ((size_t)1024 * 1024 * 1024)
+#endif
+#define HEAP_MIN_RESERVED_SIZE ((size_t)64 * 1024 * 1024)
+
+/// @brief Rounds a number of bytes up to the alignment of the heap.
+#define HEAP_ALIGN(bytes) (((bytes) + HEAP_ALIGNMENT - 1) & ~(size_t)(HEAP_ALIGNMENT - 1))
+
+/// @brief Converts a reference, as stored in operands, local variables,
+/// fields and array elements, to a pointer to the object.
+/// @note The reference 0 is null.
+#define DECODE_REFERENCE(ref) \
+    ((ref) ? (struct Reference*)(heapBase + ((uintptr_t)(uint32_t)(ref) << HEAP_REFERENCE_SHIFT)) : NULL)
+
+/// @brief Converts a pointer to an object to the 32-bit reference that is
+/// stored in operands, local variables, fields and array elements.
+#define ENCODE_REFERENCE(obj) \
+    ((obj) ? (int32_t)(uint32_t)(((uint8_t*)(obj) - heapBase) >> HEAP_REFERENCE_SHIFT) : 0)
+
+struct Reference;
+
+/// @brief A contiguous piece of memory where objects are allocated.
+///
+/// The bytes between the first block and \c end are entirely covered by
+/// blocks, each one starting with a Reference header that contains the
+/// size of the block, so the region can be walked from start to end.
+typedef struct HeapRegion
+{
+    /// @brief Next region of the heap.
+    struct HeapRegion* next;
+
+    /// @brief End of the last block of the region.
+    uint8_t* end;
+} HeapRegion;
+
+/// @brief Memory where all objects of a JVM are allocated.
+///
+/// The heap reserves a contiguous range of addresses starting at \c heapBase,
+/// divided in slots of HEAP_REGION_SIZE bytes. Each region takes one slot,
+/// or more for large objects, and memory is only committed for slots in use.
+///
+/// Objects are allocated by bumping a pointer inside the current
+/// allocation range, which is either the unused part of a new region
+/// or a free block left by the garbage collector.
+/// @see allocateBlock(), sweepHeap()
+typedef struct Heap
+{
+    /// @brief Linked list of all regions of the heap.
+    HeapRegion* regions;
+
+    /// @brief Address where the next block will be allocated.
+    uint8_t* top;
+
+    /// @brief End of the current allocation range.
+    uint8_t* end;
+
+    /// @brief Linked list of free blocks, found by the last sweep,
+    /// that can be used as allocation ranges.
+    struct Reference* freeBlocks;
+
+    /// @brief Number of regions of the heap.
+    uint32_t regionCount;
+
+    /// @brief Number of bytes of address space reserved for the heap.
+    size_t reservedSize;
+
+    /// @brief Array telling, for each slot of the reserved
+    /// space, whether it is used by a region or not.
+    uint8_t* usedSlots;
+
+    /// @brief Number of slots in the reserved space.
+    uint32_t slotCount;
+
+    /// @brief Index of the first slot that might be free.
+    uint32_t firstFreeSlot;
+} Heap;
+
+/// @brief Function called for each object by walkHeap().
+/// @return 1 to continue the walk, 0 to stop it.
+typedef uint8_t (*HeapVisitor)(struct Reference* obj, void* context);
+
+extern uint8_t* heapBase;
+
+uint8_t initHeap(Heap* heap);
+void freeHeap(Heap* heap);
+struct Reference* allocateBlock(Heap* heap, size_t size);
+void sweepHeap(Heap* heap, size_t spareBytes, size_t* reclaimedBytes, uint32_t* reclaimedObjects);
+void clearHeapMarks(Heap* heap);
+uint8_t walkHeap(Heap* heap, HeapVisitor visit, void* context);
+
+#endif // HEAP_H
+
+/// @defgroup heap Heap module
+///
+/// @brief Allocates the memory of objects.
+///
+/// Each object is a single block of memory that holds its Reference header
+/// followed by its data (fields, array elements or string bytes). Blocks are
+/// carved from large regions by bumping a pointer, so creating an object costs
+/// no system call unless a new region is needed.
+///
+/// All regions lie in a single range of addresses, so objects are referred to
+/// by 32-bit offsets from the start of that range (see ENCODE_REFERENCE() and
+/// DECODE_REFERENCE()), whatever the size of pointers is. Since there is a single
+/// range, only one heap can exist at a time.
+///
+/// Objects are never moved. The garbage collector calls sweepHeap(), which
+/// walks every region, turning unmarked objects into free blocks. Adjacent free
+/// blocks are merged, and the ones that are large enough become allocation ranges.
+/// Regions without objects left are released.
+///
+/// @see heap.c, gc.c
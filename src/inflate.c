@@ -0,0 +1,435 @@
+#include <pthread.h>
+#include "inflate.h"
+
+/// @brief Maximum number of bits of a Huffman code.
+#define MAX_CODE_BITS 15
+
+/// @brief Number of literal/length and distance codes.
+#define MAX_LITERAL_CODES 288
+#define MAX_DISTANCE_CODES 30
+
+/// @brief State of the decompression of a deflate stream.
+typedef struct InflateState
+{
+    const uint8_t* input;
+    uint32_t inputLength;
+    uint32_t inputPosition;
+
+    /// @brief Bits read from the input that haven't been used yet,
+    /// starting at the least significant bit.
+    uint32_t bitBuffer;
+    uint32_t bitCount;
+
+    uint8_t* output;
+    uint32_t outputLength;
+    uint32_t outputPosition;
+
+    /// @brief Set when the input ends before the stream does.
+    uint8_t error;
+} InflateState;
+
+/// @brief A canonical Huffman code, given by the number of codes of each
+/// length and the symbols ordered by their codes.
+typedef struct Huffman
+{
+    uint16_t counts[MAX_CODE_BITS + 1];
+    uint16_t symbols[MAX_LITERAL_CODES];
+} Huffman;
+
+static const uint16_t lengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const uint8_t lengthExtraBits[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const uint16_t distanceBase[MAX_DISTANCE_CODES] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const uint8_t distanceExtraBits[MAX_DISTANCE_CODES] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/// @brief Order in which the lengths of the code length code are stored.
+static const uint8_t codeLengthOrder[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+/// @brief Reads a number of bits from the input, least significant bit first.
+/// @return The bits read, or 0 if the input ended, in which case
+/// InflateState::error is set.
+static uint32_t readBits(InflateState* s, uint32_t count)
+{
+    uint32_t value;
+
+    while (s->bitCount < count)
+    {
+        if (s->inputPosition == s->inputLength)
+        {
+            s->error = 1;
+            return 0;
+        }
+
+        s->bitBuffer |= (uint32_t)s->input[s->inputPosition++] << s->bitCount;
+        s->bitCount += 8;
+    }
+
+    value = s->bitBuffer & ((1u << count) - 1);
+    s->bitBuffer >>= count;
+    s->bitCount -= count;
+    return value;
+}
+
+/// @brief Builds a canonical Huffman code from the code length of each symbol.
+/// @return 0 if the lengths describe more codes than there can be, otherwise 1.
+/// Incomplete codes are accepted, and fail only if an unused code is found.
+static uint8_t buildHuffman(Huffman* h, const uint8_t* lengths, uint32_t symbolCount)
+{
+    uint16_t offsets[MAX_CODE_BITS + 1];
+    int32_t left = 1;
+    uint32_t index;
+
+    for (index = 0; index <= MAX_CODE_BITS; index++)
+        h->counts[index] = 0;
+
+    for (index = 0; index < symbolCount; index++)
+        h->counts[lengths[index]]++;
+
+    for (index = 1; index <= MAX_CODE_BITS; index++)
+    {
+        left = (left << 1) - h->counts[index];
+
+        if (left < 0)
+            return 0;
+    }
+
+    offsets[1] = 0;
+
+    for (index = 1; index < MAX_CODE_BITS; index++)
+        offsets[index + 1] = offsets[index] + h->counts[index];
+
+    for (index = 0; index < symbolCount; index++)
+    {
+        if (lengths[index])
+            h->symbols[offsets[lengths[index]]++] = (uint16_t)index;
+    }
+
+    return 1;
+}
+
+/// @brief Decodes one symbol from the input, reading one bit at a time.
+/// @return The symbol, or -1 if the input ended or the code is unused.
+static int32_t decodeSymbol(InflateState* s, const Huffman* h)
+{
+    int32_t code = 0, first = 0, index = 0, count;
+    uint32_t length;
+
+    for (length = 1; length <= MAX_CODE_BITS; length++)
+    {
+        code |= (int32_t)readBits(s, 1);
+
+        if (s->error)
+            return -1;
+
+        count = h->counts[length];
+
+        if (code - count < first)
+            return h->symbols[index + code - first];
+
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+
+    return -1;
+}
+
+/// @brief Decodes the literals and matches of a compressed block,
+/// until the end of block symbol.
+/// @return 1 in case of success, 0 if the data is invalid.
+static uint8_t inflateCodes(InflateState* s, const Huffman* literals, const Huffman* distances)
+{
+    int32_t symbol;
+    uint32_t length, distance;
+
+    while (1)
+    {
+        symbol = decodeSymbol(s, literals);
+
+        if (symbol < 0)
+            return 0;
+
+        if (symbol < 256)
+        {
+            if (s->outputPosition == s->outputLength)
+                return 0;
+
+            s->output[s->outputPosition++] = (uint8_t)symbol;
+            continue;
+        }
+
+        if (symbol == 256)
+            return 1;
+
+        symbol -= 257;
+
+        if (symbol >= 29)
+            return 0;
+
+        length = lengthBase[symbol] + readBits(s, lengthExtraBits[symbol]);
+        symbol = decodeSymbol(s, distances);
+
+        if (symbol < 0 || symbol >= MAX_DISTANCE_CODES)
+            return 0;
+
+        distance = distanceBase[symbol] + readBits(s, distanceExtraBits[symbol]);
+
+        if (s->error || distance > s->outputPosition || length > s->outputLength - s->outputPosition)
+            return 0;
+
+        // The copy may overlap the bytes being written, so it goes byte by byte
+        while (length-- > 0)
+        {
+            s->output[s->outputPosition] = s->output[s->outputPosition - distance];
+            s->outputPosition++;
+        }
+    }
+}
+
+/// @brief Copies a block that was stored without compression.
+static uint8_t inflateStored(InflateState* s)
+{
+    uint32_t length, complement;
+
+    // Stored blocks start at a byte boundary
+    s->bitBuffer = 0;
+    s->bitCount = 0;
+
+    if (s->inputLength - s->inputPosition < 4)
+        return 0;
+
+    length = s->input[s->inputPosition] | ((uint32_t)s->input[s->inputPosition + 1] << 8);
+    complement = s->input[s->inputPosition + 2] | ((uint32_t)s->input[s->inputPosition + 3] << 8);
+    s->inputPosition += 4;
+
+    if (length != (~complement & 0xFFFF) ||
+        length > s->inputLength - s->inputPosition ||
+        length > s->outputLength - s->outputPosition)
+    {
+        return 0;
+    }
+
+    while (length-- > 0)
+        s->output[s->outputPosition++] = s->input[s->inputPosition++];
+
+    return 1;
+}
+
+// The fixed codes are the same for every block, so they are built once
+static Huffman fixedLiterals, fixedDistances;
+static pthread_once_t fixedCodesOnce = PTHREAD_ONCE_INIT;
+
+/// @brief Builds the fixed Huffman codes.
+static void buildFixedCodes(void)
+{
+    uint8_t lengths[MAX_LITERAL_CODES];
+    uint32_t index;
+
+    for (index = 0; index < 144; index++)
+        lengths[index] = 8;
+    for (; index < 256; index++)
+        lengths[index] = 9;
+    for (; index < 280; index++)
+        lengths[index] = 7;
+    for (; index < MAX_LITERAL_CODES; index++)
+        lengths[index] = 8;
+
+    buildHuffman(&fixedLiterals, lengths, MAX_LITERAL_CODES);
+
+    for (index = 0; index < MAX_DISTANCE_CODES; index++)
+        lengths[index] = 5;
+
+    buildHuffman(&fixedDistances, lengths, MAX_DISTANCE_CODES);
+}
+
+/// @brief Decodes a block compressed with the fixed Huffman codes.
+static uint8_t inflateFixed(InflateState* s)
+{
+    // Loader threads may inflate classes at the same time
+    pthread_once(&fixedCodesOnce, buildFixedCodes);
+    return inflateCodes(s, &fixedLiterals, &fixedDistances);
+}
+
+/// @brief Decodes a block compressed with Huffman codes that
+/// are described at the start of the block.
+static uint8_t inflateDynamic(InflateState* s)
+{
+    uint8_t lengths[MAX_LITERAL_CODES + MAX_DISTANCE_CODES];
+    Huffman literals, distances;
+    uint32_t literalCount, distanceCount, codeLengthCount;
+    uint32_t index, repeat;
+    uint8_t length;
+    int32_t symbol;
+
+    literalCount = readBits(s, 5) + 257;
+    distanceCount = readBits(s, 5) + 1;
+    codeLengthCount = readBits(s, 4) + 4;
+
+    if (s->error || literalCount > 286 || distanceCount > MAX_DISTANCE_CODES)
+        return 0;
+
+    // The code lengths are themselves Huffman coded
+    for (index = 0; index < 19; index++)
+        lengths[codeLengthOrder[index]] = index < codeLengthCount ? (uint8_t)readBits(s, 3) : 0;
+
+    if (s->error || !buildHuffman(&literals, lengths, 19))
+        return 0;
+
+    for (index = 0; index < literalCount + distanceCount; )
+    {
+        symbol = decodeSymbol(s, &literals);
+
+        if (symbol < 0)
+            return 0;
+
+        if (symbol < 16)
+        {
+            lengths[index++] = (uint8_t)symbol;
+            continue;
+        }
+
+        length = 0;
+
+        if (symbol == 16)
+        {
+            if (index == 0)
+                return 0;
+
+            length = lengths[index - 1];
+            repeat = 3 + readBits(s, 2);
+        }
+        else if (symbol == 17)
+            repeat = 3 + readBits(s, 3);
+        else
+            repeat = 11 + readBits(s, 7);
+
+        if (s->error || index + repeat > literalCount + distanceCount)
+            return 0;
+
+        while (repeat-- > 0)
+            lengths[index++] = length;
+    }
+
+    // The end of block symbol must have a code
+    if (lengths[256] == 0)
+        return 0;
+
+    if (!buildHuffman(&literals, lengths, literalCount) ||
+        !buildHuffman(&distances, lengths + literalCount, distanceCount))
+    {
+        return 0;
+    }
+
+    return inflateCodes(s, &literals, &distances);
+}
+
+/// @brief Decompresses data compressed with the deflate method.
+/// @param const uint8_t* input - the compressed data
+/// @param uint32_t inputLength - number of bytes of \c input
+/// @param uint8_t* output - buffer that receives the decompressed data
+/// @param uint32_t outputLength - exact number of bytes the data has
+/// once decompressed
+/// @return 1 if the data was decompressed to exactly \c outputLength bytes,
+/// otherwise 0 (invalid or truncated data, or a size mismatch).
+uint8_t inflateData(const uint8_t* input, uint32_t inputLength, uint8_t* output, uint32_t outputLength)
+{
+    InflateState s = {input, inputLength, 0, 0, 0, output, outputLength, 0, 0};
+    uint32_t lastBlock, blockType;
+    uint8_t success;
+
+    do
+    {
+        lastBlock = readBits(&s, 1);
+        blockType = readBits(&s, 2);
+
+        if (s.error)
+            return 0;
+
+        switch (blockType)
+        {
+            case 0: success = inflateStored(&s); break;
+            case 1: success = inflateFixed(&s); break;
+            case 2: success = inflateDynamic(&s); break;
+            default: success = 0; break;
+        }
+
+        if (!success)
+            return 0;
+
+    } while (!lastBlock);
+
+    return s.outputPosition == outputLength;
+}
+
+/// @brief Tables of the CRC-32 of each byte followed by 0 to 7 zero bytes,
+/// so 8 bytes are processed at a time (slicing-by-8).
+static uint32_t crcTable[8][256];
+static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+/// @brief Builds the tables of the CRC-32 of each byte.
+static void buildCRCTable(void)
+{
+    uint32_t crc, index, bit, slice;
+
+    for (index = 0; index < 256; index++)
+    {
+        crc = index;
+
+        for (bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+
+        crcTable[0][index] = crc;
+    }
+
+    for (index = 0; index < 256; index++)
+    {
+        for (slice = 1; slice < 8; slice++)
+        {
+            crc = crcTable[slice - 1][index];
+            crcTable[slice][index] = (crc >> 8) ^ crcTable[0][crc & 0xFF];
+        }
+    }
+}
+
+/// @brief Calculates the CRC-32 of some bytes, as used by ZIP files.
+/// @param const uint8_t* bytes - pointer to the bytes
+/// @param uint32_t length - number of bytes
+/// @return The CRC-32 of the bytes.
+uint32_t calculateCRC32(const uint8_t* bytes, uint32_t length)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+
+    pthread_once(&crcTableOnce, buildCRCTable);
+
+    while (length >= 8)
+    {
+        crc ^= bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+        crc = crcTable[7][crc & 0xFF] ^ crcTable[6][(crc >> 8) & 0xFF] ^
+              crcTable[5][(crc >> 16) & 0xFF] ^ crcTable[4][crc >> 24] ^
+              crcTable[3][bytes[4]] ^ crcTable[2][bytes[5]] ^
+              crcTable[1][bytes[6]] ^ crcTable[0][bytes[7]];
+        bytes += 8;
+        length -= 8;
+    }
+
+    while (length-- > 0)
+        crc = crcTable[0][(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+
+    return crc ^ 0xFFFFFFFFu;
+}
@@ -0,0 +1,20 @@
+#ifndef INFLATE_H
+#define INFLATE_H
+
+#include <stdint.h>
+
+uint8_t inflateData(const uint8_t* input, uint32_t inputLength, uint8_t* output, uint32_t outputLength);
+uint32_t calculateCRC32(const uint8_t* bytes, uint32_t length);
+
+#endif // INFLATE_H
+
+/// @defgroup inflate Inflate module
+///
+/// @brief Decompresses data stored with the deflate method (RFC 1951),
+/// the compression used by JAR and ZIP files.
+///
+/// Only decompression is supported, and the whole input and output must
+/// be in memory. The decoder favors simplicity over speed, as it is only
+/// used for class files that were stored compressed.
+///
+/// @see inflate.c, classpath.c
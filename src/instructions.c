@@ -2,21 +2,41 @@
 #include "utf8.h"
 #include "jvm.h"
 #include "natives.h"
+#include "gc.h"
+#include "exceptions.h"
 #include <math.h>
+#include <string.h>
 
 // TODO: replace all 'out of memory' status errors with
 // exception OutOfMemory.
 
-#define NEXT_BYTE (*(frame->code + frame->pc++))
+/// @brief The instruction being executed. The program counter
+/// already points to the next instruction when the function of an
+/// instruction is called.
+#define CURRENT_INSTRUCTION (frame->instructions + frame->pc - 1)
+#define OPERAND1 (CURRENT_INSTRUCTION->operand1)
+#define OPERAND2 (CURRENT_INSTRUCTION->operand2)
 #define HIWORD(x) ((int32_t)(x >> 32))
 #define LOWORD(x) ((int32_t)(x & 0xFFFFFFFFll))
 
-uint8_t instfunc_nop(JavaVirtualMachine* jvm, Frame* frame)
+/// @brief Throws a linkage error, like NoSuchFieldError, whose
+/// message is the name of the field or method that wasn't found.
+/// @param className - the name of the error class.
+/// @param name - the UTF-8 constant pool entry with the name of the member.
+/// @return Always 0, as throwException().
+static uint8_t throwMemberError(JavaVirtualMachine* jvm, const char* className, cp_info* name)
+{
+    char message[256];
+    snprintf(message, sizeof(message), "%.*s", PRINT_UTF8(name));
+    return throwException(jvm, className, message);
+}
+
+static inline uint8_t instfunc_nop(JavaVirtualMachine* jvm, Frame* frame)
 {
     return 1;
 }
 
-uint8_t instfunc_aconst_null(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_aconst_null(JavaVirtualMachine* jvm, Frame* frame)
 {
     if (!pushOperand(&frame->operands, 0, OP_REFERENCE))
     {
@@ -30,7 +50,7 @@ uint8_t instfunc_aconst_null(JavaVirtualMachine* jvm, Frame* frame)
 /// @brief Used to automatically generate instructions "iconst_<n>" and
 /// fconst_<n>.
 #define DECLR_CONST_CAT_1_FAMILY(instructionprefix, value, type) \
-    uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         if (!pushOperand(&frame->operands, value, type)) \
         { \
@@ -43,7 +63,7 @@ uint8_t instfunc_aconst_null(JavaVirtualMachine* jvm, Frame* frame)
 /// @brief Used to automatically generate instructions "lconst_<n>" and
 /// dconst_<n>.
 #define DECLR_CONST_CAT_2_FAMILY(instructionprefix, highvalue, lowvalue, type) \
-    uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         if (!pushOperand(&frame->operands, highvalue, type) || \
             !pushOperand(&frame->operands, lowvalue,  type)) \
@@ -73,9 +93,9 @@ DECLR_CONST_CAT_2_FAMILY(dconst_0, 0x00000000, 0x00000000, OP_DOUBLE)
 DECLR_CONST_CAT_2_FAMILY(dconst_1, 0x3FF00000, 0x00000000, OP_DOUBLE)
 
 
-uint8_t instfunc_bipush(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_bipush(JavaVirtualMachine* jvm, Frame* frame)
 {
-    if (!pushOperand(&frame->operands, (int8_t)NEXT_BYTE, OP_INTEGER))
+    if (!pushOperand(&frame->operands, OPERAND1, OP_INTEGER))
     {
         jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
@@ -84,13 +104,9 @@ uint8_t instfunc_bipush(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_sipush(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_sipush(JavaVirtualMachine* jvm, Frame* frame)
 {
-    int16_t immediate = (int16_t)NEXT_BYTE;
-    immediate <<= 8;
-    immediate |= NEXT_BYTE;
-
-    if (!pushOperand(&frame->operands, immediate, OP_INTEGER))
+    if (!pushOperand(&frame->operands, OPERAND1, OP_INTEGER))
     {
         jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
@@ -99,9 +115,9 @@ uint8_t instfunc_sipush(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_ldc(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_ldc(JavaVirtualMachine* jvm, Frame* frame)
 {
-    uint32_t value = (uint32_t)NEXT_BYTE;
+    uint32_t value = (uint32_t)OPERAND1;
 
     enum OperandType type;
 
@@ -123,6 +139,8 @@ uint8_t instfunc_ldc(JavaVirtualMachine* jvm, Frame* frame)
         {
             cpi = frame->jc->constantPool + cpi->String.string_index - 1;
 
+            GC_SAFEPOINT(jvm)
+
             Reference* str = newString(jvm, UTF8(cpi));
 
             if (!str)
@@ -131,7 +149,7 @@ uint8_t instfunc_ldc(JavaVirtualMachine* jvm, Frame* frame)
                 return 0;
             }
 
-            value = (int32_t)str;
+            value = ENCODE_REFERENCE(str);
             type = OP_REFERENCE;
             break;
         }
@@ -149,6 +167,8 @@ uint8_t instfunc_ldc(JavaVirtualMachine* jvm, Frame* frame)
                 return 0;
             }
 
+            GC_SAFEPOINT(jvm)
+
             Reference* obj = newClassInstance(jvm, loadedClass);
 
             if (!obj)
@@ -157,7 +177,7 @@ uint8_t instfunc_ldc(JavaVirtualMachine* jvm, Frame* frame)
                 return 0;
             }
 
-            value = (int32_t)obj;
+            value = ENCODE_REFERENCE(obj);
             type = OP_REFERENCE;
             break;
         }
@@ -184,11 +204,9 @@ uint8_t instfunc_ldc(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_ldc_w(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_ldc_w(JavaVirtualMachine* jvm, Frame* frame)
 {
-    uint32_t value = (uint32_t)NEXT_BYTE;
-    value <<= 8;
-    value |= NEXT_BYTE;
+    uint32_t value = (uint32_t)OPERAND1;
 
     enum OperandType type;
 
@@ -210,6 +228,8 @@ uint8_t instfunc_ldc_w(JavaVirtualMachine* jvm, Frame* frame)
         {
             cpi = frame->jc->constantPool + cpi->String.string_index - 1;
 
+            GC_SAFEPOINT(jvm)
+
             Reference* str = newString(jvm, UTF8(cpi));
 
             if (!str)
@@ -218,7 +238,7 @@ uint8_t instfunc_ldc_w(JavaVirtualMachine* jvm, Frame* frame)
                 return 0;
             }
 
-            value = (int32_t)str;
+            value = ENCODE_REFERENCE(str);
             type = OP_REFERENCE;
             break;
         }
@@ -236,6 +256,8 @@ uint8_t instfunc_ldc_w(JavaVirtualMachine* jvm, Frame* frame)
                 return 0;
             }
 
+            GC_SAFEPOINT(jvm)
+
             Reference* obj = newClassInstance(jvm, loadedClass);
 
             if (!obj)
@@ -244,7 +266,7 @@ uint8_t instfunc_ldc_w(JavaVirtualMachine* jvm, Frame* frame)
                 return 0;
             }
 
-            value = (int32_t)obj;
+            value = ENCODE_REFERENCE(obj);
             type = OP_REFERENCE;
             break;
         }
@@ -271,12 +293,10 @@ uint8_t instfunc_ldc_w(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_ldc2_w(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_ldc2_w(JavaVirtualMachine* jvm, Frame* frame)
 {
     uint32_t highvalue;
-    uint32_t lowvalue = (uint32_t)NEXT_BYTE;
-    lowvalue <<= 8;
-    lowvalue |= NEXT_BYTE;
+    uint32_t lowvalue = (uint32_t)OPERAND1;
 
     enum OperandType type;
 
@@ -314,9 +334,9 @@ uint8_t instfunc_ldc2_w(JavaVirtualMachine* jvm, Frame* frame)
 /// @brief Used to automatically generate instructions "iload",
 /// "fload" and "aload".
 #define DECLR_LOAD_CAT_1_FAMILY(instructionprefix, type) \
-    uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
     { \
-        if (!pushOperand(&frame->operands, *(frame->localVariables + NEXT_BYTE), type)) \
+        if (!pushOperand(&frame->operands, *(frame->localVariables + OPERAND1), type)) \
         { \
             jvm->status = JVM_STATUS_OUT_OF_MEMORY; \
             return 0; \
@@ -327,40 +347,9 @@ uint8_t instfunc_ldc2_w(JavaVirtualMachine* jvm, Frame* frame)
 /// @brief Used to automatically generate instructions "lload",
 /// and "dload".
 #define DECLR_LOAD_CAT_2_FAMILY(instructionprefix, type) \
-    uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
-    { \
-        uint8_t index = NEXT_BYTE; \
-        if (!pushOperand(&frame->operands, *(frame->localVariables + index), type) || \
-            !pushOperand(&frame->operands, *(frame->localVariables + index + 1), type)) \
-        { \
-            jvm->status = JVM_STATUS_OUT_OF_MEMORY; \
-            return 0; \
-        } \
-        return 1; \
-    }
-
-/// @brief Used to automatically generate instructions "iload",
-/// "fload" and "aload" that are widened.
-#define DECLR_WIDE_LOAD_CAT_1_FAMILY(instructionprefix, type) \
-    uint8_t instfunc_wide_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
-    { \
-        uint16_t index = NEXT_BYTE; \
-        index = (index << 8) | NEXT_BYTE; \
-        if (!pushOperand(&frame->operands, *(frame->localVariables + index), type)) \
-        { \
-            jvm->status = JVM_STATUS_OUT_OF_MEMORY; \
-            return 0; \
-        } \
-        return 1; \
-    }
-
-/// @brief Used to automatically generate instructions "lload",
-/// and "dload" that are widened.
-#define DECLR_WIDE_LOAD_CAT_2_FAMILY(instructionprefix, type) \
-    uint8_t instfunc_wide_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
     { \
-        uint16_t index = NEXT_BYTE; \
-        index = (index << 8) | NEXT_BYTE; \
+        int32_t index = OPERAND1; \
         if (!pushOperand(&frame->operands, *(frame->localVariables + index), type) || \
             !pushOperand(&frame->operands, *(frame->localVariables + index + 1), type)) \
         { \
@@ -376,16 +365,10 @@ DECLR_LOAD_CAT_1_FAMILY(fload, OP_FLOAT)
 DECLR_LOAD_CAT_2_FAMILY(dload, OP_DOUBLE)
 DECLR_LOAD_CAT_1_FAMILY(aload, OP_REFERENCE)
 
-DECLR_WIDE_LOAD_CAT_1_FAMILY(iload, OP_INTEGER)
-DECLR_WIDE_LOAD_CAT_2_FAMILY(lload, OP_LONG)
-DECLR_WIDE_LOAD_CAT_1_FAMILY(fload, OP_FLOAT)
-DECLR_WIDE_LOAD_CAT_2_FAMILY(dload, OP_DOUBLE)
-DECLR_WIDE_LOAD_CAT_1_FAMILY(aload, OP_REFERENCE)
-
 /// @brief Used to automatically generate instructions "iload_<n>",
 /// "fload_<n>" and "aload_<n>".
 #define DECLR_CAT_1_LOAD_N_FAMILY(instructionprefix, value, type) \
-    uint8_t instfunc_##instructionprefix##_##value(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionprefix##_##value(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         if (!pushOperand(&frame->operands, *(frame->localVariables + value), type)) \
         { \
@@ -398,7 +381,7 @@ DECLR_WIDE_LOAD_CAT_1_FAMILY(aload, OP_REFERENCE)
 /// @brief Used to automatically generate instructions "dload_<n>"
 /// and "lload_<n>".
 #define DECLR_CAT_2_LOAD_N_FAMILY(instructionprefix, value, type) \
-    uint8_t instfunc_##instructionprefix##_##value(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionprefix##_##value(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         if (!pushOperand(&frame->operands, *(frame->localVariables + value), type) || \
             !pushOperand(&frame->operands, *(frame->localVariables + value + 1), type)) \
@@ -437,27 +420,19 @@ DECLR_CAT_1_LOAD_N_FAMILY(aload, 3, OP_REFERENCE)
 /// @brief Used to automatically generate instructions "iaload", "faload",
 /// "baload", "saload" and "caload".
 #define DECLR_ALOAD_CAT_1_FAMILY(instructionname, type, op_type) \
-    uint8_t instfunc_##instructionname(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionname(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         int32_t index; \
         int32_t arrayref; \
         Reference* obj; \
         popOperand(&frame->operands, &index, NULL); \
         popOperand(&frame->operands, &arrayref, NULL); \
-        obj = (Reference*)arrayref; \
+        obj = DECODE_REFERENCE(arrayref); \
         if (obj == NULL) \
-        { \
-            /* TODO: throw NullPointerException*/ \
-            DEBUG_REPORT_INSTRUCTION_ERROR \
-            return 0; \
-        } \
+            return throwException(jvm, "java/lang/NullPointerException", NULL); \
         if (index < 0 || (uint32_t)index >= obj->arr.length) \
-        { \
-            /* TODO: throw ArrayIndexOutOfBoundsException*/ \
-            DEBUG_REPORT_INSTRUCTION_ERROR \
-            return 0; \
-        } \
-        type* ptr = (type*)obj->arr.data; \
+            return throwArrayIndexOutOfBounds(jvm, index, obj->arr.length); \
+        type* ptr = (type*)ARRAY_DATA(obj); \
         if (!pushOperand(&frame->operands, ptr[index], op_type)) \
         { \
             jvm->status = JVM_STATUS_OUT_OF_MEMORY; \
@@ -469,27 +444,19 @@ DECLR_CAT_1_LOAD_N_FAMILY(aload, 3, OP_REFERENCE)
 /// @brief Used to automatically generate instructions "laload" and
 /// "daload".
 #define DECLR_ALOAD_CAT_2_FAMILY(instructionname, type, op_type) \
-    uint8_t instfunc_##instructionname(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionname(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         int32_t index; \
         int32_t arrayref; \
         Reference* obj; \
         popOperand(&frame->operands, &index, NULL); \
         popOperand(&frame->operands, &arrayref, NULL); \
-        obj = (Reference*)arrayref; \
+        obj = DECODE_REFERENCE(arrayref); \
         if (obj == NULL) \
-        { \
-            /* TODO: throw NullPointerException*/ \
-            DEBUG_REPORT_INSTRUCTION_ERROR \
-            return 0; \
-        } \
+            return throwException(jvm, "java/lang/NullPointerException", NULL); \
         if (index < 0 || (uint32_t)index >= obj->arr.length) \
-        { \
-            /* TODO: throw ArrayIndexOutOfBoundsException*/ \
-            DEBUG_REPORT_INSTRUCTION_ERROR \
-            return 0; \
-        } \
-        type* ptr = (type*)obj->arr.data; \
+            return throwArrayIndexOutOfBounds(jvm, index, obj->arr.length); \
+        type* ptr = (type*)ARRAY_DATA(obj); \
         if (!pushOperand(&frame->operands, HIWORD(ptr[index]), op_type) || \
             !pushOperand(&frame->operands, LOWORD(ptr[index]), op_type)) \
         { \
@@ -507,7 +474,7 @@ DECLR_ALOAD_CAT_1_FAMILY(baload, int8_t, OP_INTEGER)
 DECLR_ALOAD_CAT_1_FAMILY(saload, int16_t, OP_INTEGER)
 DECLR_ALOAD_CAT_1_FAMILY(caload, int16_t, OP_INTEGER)
 
-uint8_t instfunc_aaload(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_aaload(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t index;
     int32_t arrayref;
@@ -516,25 +483,15 @@ uint8_t instfunc_aaload(JavaVirtualMachine* jvm, Frame* frame)
     popOperand(&frame->operands, &index, NULL);
     popOperand(&frame->operands, &arrayref, NULL);
 
-    obj = (Reference*)arrayref;
+    obj = DECODE_REFERENCE(arrayref);
 
     if (obj == NULL)
-    {
-        /* TODO: throw NullPointerException*/
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
+        return throwException(jvm, "java/lang/NullPointerException", NULL);
 
     if (index < 0 || (uint32_t)index >= obj->oar.length)
-    {
-        /* TODO: throw ArrayIndexOutOfBoundsException*/
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
-
-    Reference** ptr = (Reference**)obj->oar.elements;
+        return throwArrayIndexOutOfBounds(jvm, index, obj->oar.length);
 
-    if (!pushOperand(&frame->operands, (int32_t)ptr[index], OP_REFERENCE))
+    if (!pushOperand(&frame->operands, OBJECT_ARRAY_ELEMENTS(obj)[index], OP_REFERENCE))
     {
         jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
@@ -546,55 +503,31 @@ uint8_t instfunc_aaload(JavaVirtualMachine* jvm, Frame* frame)
 /// @brief Used to automatically generate instructions "istore", "fstore"
 /// and "astore".
 #define DECLR_STORE_CAT_1_FAMILY(instructionprefix) \
-    uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
-    { \
-        int32_t operand; \
-        popOperand(&frame->operands, &operand, NULL); \
-        *(frame->localVariables + NEXT_BYTE) = operand; \
-        return 1; \
-    }
-
-/// @brief Used to automatically generate instructions "istore", "fstore"
-/// and "astore" that are widened.
-#define DECLR_WIDE_STORE_CAT_1_FAMILY(instructionprefix) \
-    uint8_t instfunc_wide_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
     { \
-        uint16_t index = NEXT_BYTE; \
-        index = (index << 8) | NEXT_BYTE; \
         int32_t operand; \
-        popOperand(&frame->operands, &operand, NULL); \
-        *(frame->localVariables + index) = operand; \
+        OperandType type; \
+        popOperand(&frame->operands, &operand, &type); \
+        *(frame->localVariables + OPERAND1) = operand; \
+        *(frame->localVariableTypes + OPERAND1) = type; \
         return 1; \
     }
 
 /// @brief Used to automatically generate instructions "l" and
 /// "dstore".
 #define DECLR_STORE_CAT_2_FAMILY(instructionprefix) \
-    uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
-    { \
-        uint8_t index = NEXT_BYTE; \
-        int32_t highoperand; \
-        int32_t lowoperand; \
-        popOperand(&frame->operands, &lowoperand, NULL); \
-        popOperand(&frame->operands, &highoperand, NULL); \
-        *(frame->localVariables + index) = highoperand; \
-        *(frame->localVariables + index + 1) = lowoperand; \
-        return 1; \
-    }
-
-/// @brief Used to automatically generate instructions "l" and
-/// "dstore" that are widened.
-#define DECLR_WIDE_STORE_CAT_2_FAMILY(instructionprefix) \
-    uint8_t instfunc_wide_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionprefix(JavaVirtualMachine* jvm, Frame* frame) \
     { \
-        uint16_t index = NEXT_BYTE; \
-        index = (index << 8) | NEXT_BYTE; \
+        int32_t index = OPERAND1; \
         int32_t highoperand; \
         int32_t lowoperand; \
-        popOperand(&frame->operands, &lowoperand, NULL); \
+        OperandType type; \
+        popOperand(&frame->operands, &lowoperand, &type); \
         popOperand(&frame->operands, &highoperand, NULL); \
         *(frame->localVariables + index) = highoperand; \
         *(frame->localVariables + index + 1) = lowoperand; \
+        *(frame->localVariableTypes + index) = type; \
+        *(frame->localVariableTypes + index + 1) = type; \
         return 1; \
     }
 
@@ -604,34 +537,33 @@ DECLR_STORE_CAT_1_FAMILY(fstore)
 DECLR_STORE_CAT_2_FAMILY(dstore)
 DECLR_STORE_CAT_1_FAMILY(astore)
 
-DECLR_WIDE_STORE_CAT_1_FAMILY(istore)
-DECLR_WIDE_STORE_CAT_2_FAMILY(lstore)
-DECLR_WIDE_STORE_CAT_1_FAMILY(fstore)
-DECLR_WIDE_STORE_CAT_2_FAMILY(dstore)
-DECLR_WIDE_STORE_CAT_1_FAMILY(astore)
-
 /// @brief Used to automatically generate instructions "istore_<n>", "fstore_<n>"
 /// and "astore_<n>".
 #define DECLR_STORE_N_CAT_1_FAMILY(instructionprefix, N) \
-    uint8_t instfunc_##instructionprefix##_##N(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionprefix##_##N(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         int32_t operand; \
-        popOperand(&frame->operands, &operand, NULL); \
+        OperandType type; \
+        popOperand(&frame->operands, &operand, &type); \
         *(frame->localVariables + N) = operand; \
+        *(frame->localVariableTypes + N) = type; \
         return 1; \
     }
 
 /// @brief Used to automatically generate instructions "lstore_<n>" and
 /// "dstore_<n>".
 #define DECLR_STORE_N_CAT_2_FAMILY(instructionprefix, N) \
-    uint8_t instfunc_##instructionprefix##_##N(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionprefix##_##N(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         int32_t highoperand; \
         int32_t lowoperand; \
-        popOperand(&frame->operands, &lowoperand, NULL); \
+        OperandType type; \
+        popOperand(&frame->operands, &lowoperand, &type); \
         popOperand(&frame->operands, &highoperand, NULL); \
         *(frame->localVariables + N) = highoperand; \
         *(frame->localVariables + N + 1) = lowoperand; \
+        *(frame->localVariableTypes + N) = type; \
+        *(frame->localVariableTypes + N + 1) = type; \
         return 1; \
     }
 
@@ -663,7 +595,7 @@ DECLR_STORE_N_CAT_1_FAMILY(astore, 3)
 /// @brief Used to automatically generate instructions "bastore", "castore",
 /// "sastore", "iastore" and "fastore".
 #define DECLR_ASTORE_CAT_1_FAMILY(instructionname, type) \
-    uint8_t instfunc_##instructionname(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionname(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         int32_t operand; \
         int32_t index; \
@@ -672,20 +604,12 @@ DECLR_STORE_N_CAT_1_FAMILY(astore, 3)
         popOperand(&frame->operands, &operand, NULL); \
         popOperand(&frame->operands, &index, NULL); \
         popOperand(&frame->operands, &arrayref, NULL); \
-        obj = (Reference*)arrayref; \
+        obj = DECODE_REFERENCE(arrayref); \
         if (obj == NULL) \
-        { \
-            /* TODO: throw NullPointerException*/ \
-            DEBUG_REPORT_INSTRUCTION_ERROR \
-            return 0; \
-        } \
+            return throwException(jvm, "java/lang/NullPointerException", NULL); \
         if (index < 0 || (uint32_t)index >= obj->arr.length) \
-        { \
-            /* TODO: throw ArrayIndexOutOfBoundsException*/ \
-            DEBUG_REPORT_INSTRUCTION_ERROR \
-            return 0; \
-        } \
-        type* ptr = (type*)obj->arr.data; \
+            return throwArrayIndexOutOfBounds(jvm, index, obj->arr.length); \
+        type* ptr = (type*)ARRAY_DATA(obj); \
         ptr[index] = (type)operand; \
         return 1; \
     }
@@ -699,7 +623,7 @@ DECLR_ASTORE_CAT_1_FAMILY(fastore, int32_t)
 /// @brief Used to automatically generate instructions "dastore" and
 /// "lastore".
 #define DECLR_ASTORE_CAT_2_FAMILY(instructionname) \
-    uint8_t instfunc_##instructionname(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instructionname(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         int32_t highoperand; \
         int32_t lowoperand; \
@@ -710,20 +634,12 @@ DECLR_ASTORE_CAT_1_FAMILY(fastore, int32_t)
         popOperand(&frame->operands, &highoperand, NULL); \
         popOperand(&frame->operands, &index, NULL); \
         popOperand(&frame->operands, &arrayref, NULL); \
-        obj = (Reference*)arrayref; \
+        obj = DECODE_REFERENCE(arrayref); \
         if (obj == NULL) \
-        { \
-            /* TODO: throw NullPointerException*/ \
-            DEBUG_REPORT_INSTRUCTION_ERROR \
-            return 0; \
-        } \
+            return throwException(jvm, "java/lang/NullPointerException", NULL); \
         if (index < 0 || (uint32_t)index >= obj->arr.length) \
-        { \
-            /* TODO: throw ArrayIndexOutOfBoundsException*/ \
-            DEBUG_REPORT_INSTRUCTION_ERROR \
-            return 0; \
-        } \
-        int64_t* ptr = (int64_t*)obj->arr.data; \
+            return throwArrayIndexOutOfBounds(jvm, index, obj->arr.length); \
+        int64_t* ptr = (int64_t*)ARRAY_DATA(obj); \
         ptr[index] = ((int64_t)highoperand << 32) | (uint32_t)lowoperand; \
         return 1; \
     }
@@ -731,59 +647,51 @@ DECLR_ASTORE_CAT_1_FAMILY(fastore, int32_t)
 DECLR_ASTORE_CAT_2_FAMILY(dastore)
 DECLR_ASTORE_CAT_2_FAMILY(lastore)
 
-uint8_t instfunc_aastore(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_aastore(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t operand;
     int32_t index;
     int32_t arrayref;
 
     Reference* arrayobj;
-    Reference* element;
 
     popOperand(&frame->operands, &operand, NULL);
     popOperand(&frame->operands, &index, NULL);
     popOperand(&frame->operands, &arrayref, NULL);
 
-    arrayobj = (Reference*)arrayref;
-    element = (Reference*)operand;
+    arrayobj = DECODE_REFERENCE(arrayref);
 
     if (arrayobj == NULL)
-    {
-        // TODO: throw NullPointerException
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0; \
-    }
+        return throwException(jvm, "java/lang/NullPointerException", NULL);
 
     if (index < 0 || (uint32_t)index >= arrayobj->oar.length)
-    {
-        // TODO: throw ArrayIndexOutOfBoundsException
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
+        return throwArrayIndexOutOfBounds(jvm, index, arrayobj->oar.length);
 
     // TODO: throw ArrayStoreException in case of incompatible
     // element/array type.
 
-    arrayobj->oar.elements[index] = element;
+    OBJECT_ARRAY_ELEMENTS(arrayobj)[index] = operand;
     return 1;
 }
 
-uint8_t instfunc_pop(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_pop(JavaVirtualMachine* jvm, Frame* frame)
 {
     popOperand(&frame->operands, NULL, NULL);
     return 1;
 }
 
-uint8_t instfunc_pop2(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_pop2(JavaVirtualMachine* jvm, Frame* frame)
 {
     popOperand(&frame->operands, NULL, NULL);
     popOperand(&frame->operands, NULL, NULL);
     return 1;
 }
 
-uint8_t instfunc_dup(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_dup(JavaVirtualMachine* jvm, Frame* frame)
 {
-    if (!pushOperand(&frame->operands, frame->operands->value, frame->operands->type))
+    uint16_t top = frame->operands.top - 1;
+
+    if (!pushOperand(&frame->operands, frame->operands.values[top], frame->operands.types[top]))
     {
         jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
@@ -791,79 +699,65 @@ uint8_t instfunc_dup(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_dup_x1(JavaVirtualMachine* jvm, Frame* frame)
+/// @brief Moves the operand on the top of the stack \c depth slots
+/// down, shifting the operands above that position up by one.
+///
+/// Used by dup_x1 and dup_x2 after the top operand has been
+/// duplicated.
+static void moveTopOperandDown(OperandStack* os, uint16_t depth)
 {
-    // Suppose our stack is: A -> B -> ...
-    // We want to duplicate A (top node), but moving it down 2 slots
-    // The stack should look like: A -> B -> A -> ...
-
+    uint16_t top = os->top - 1;
+    int32_t value = os->values[top];
+    OperandType type = os->types[top];
+    uint16_t index;
 
-    // We duplicate the top operand, so the stack will be: A -> A -> B -> ...
-    // Calling one of the duplicated A as C, the stack is: A -> C -> B -> ...
-    // And our objective (using node C terminology) is:    A -> B -> C -> ...
-    if (!pushOperand(&frame->operands, frame->operands->value, frame->operands->type))
+    for (index = top; index > top - depth; index--)
     {
-        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
-        return 0;
+        os->values[index] = os->values[index - 1];
+        os->types[index] = os->types[index - 1];
     }
 
-    // Current stack is: A -> C -> B -> ...
-    OperandStack* nodeA = frame->operands;
-    OperandStack* nodeC = nodeA->next;
-    OperandStack* nodeB = nodeC->next;
+    os->values[index] = value;
+    os->types[index] = type;
+}
 
-    // Switching node C and node B:
-    nodeA->next = nodeB;        // Stack: A -> B -> ...  |  C -> B -> ...
-    nodeC->next = nodeB->next;  // Stack: A -> B -> ...  |  C -> ...
-    nodeB->next = nodeC;        // Stack: A -> B -> C -> ...
+static inline uint8_t instfunc_dup_x1(JavaVirtualMachine* jvm, Frame* frame)
+{
+    // Suppose our stack is: ... B A (A at the top)
+    // We want to duplicate A (top slot), but moving it down 2 slots
+    // The stack should look like: ... A B A
 
-    // Another implementation (changing content instead of pointers):
-    /*
-    OperandStack temp = *nodeC;
-    *nodeC = *nodeB;
-    *nodeB = temp;
-    */
+    // We duplicate the top operand, so the stack will be: ... B A A
+    if (!instfunc_dup(jvm, frame))
+        return 0;
 
+    // Then the new top is moved two slots down: ... A B A
+    moveTopOperandDown(&frame->operands, 2);
     return 1;
 }
 
-uint8_t instfunc_dup_x2(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_dup_x2(JavaVirtualMachine* jvm, Frame* frame)
 {
-    // Suppose our stack is: A -> B -> C -> ...
-    // We want to duplicate A (top node), but moving it down 3 slots
-    // The stack should look like: A -> B -> C -> A -> ...
-
-
-    // We duplicate the top operand, so the stack will be: A -> A -> B -> C -> ...
-    // Calling one of the duplicated A as D, the stack is: A -> D -> B -> C -> ...
-    // And our objective (using node D terminology) is:    A -> B -> C -> D -> ...
-    if (!pushOperand(&frame->operands, frame->operands->value, frame->operands->type))
-    {
-        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+    // Suppose our stack is: ... C B A (A at the top)
+    // We want to duplicate A (top slot), but moving it down 3 slots
+    // The stack should look like: ... A C B A
+    if (!instfunc_dup(jvm, frame))
         return 0;
-    }
-
-    // Current stack is: A -> D -> B -> C -> ...
-    OperandStack* nodeA = frame->operands;
-    OperandStack* nodeD = nodeA->next;
-    OperandStack* nodeB = nodeD->next;
-    OperandStack* nodeC = nodeB->next;
-
-    // Switching node D and node C:
-    nodeA->next = nodeB;        // Stack: A -> B -> C -> ...  |  D -> B -> C -> ...
-    nodeD->next = nodeC->next;  // Stack: A -> B -> C -> ...  |  D -> ...
-    nodeC->next = nodeD;        // Stack: A -> B -> C -> D -> ...
 
+    moveTopOperandDown(&frame->operands, 3);
     return 1;
 }
 
-uint8_t instfunc_dup2(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_dup2(JavaVirtualMachine* jvm, Frame* frame)
 {
-    OperandStack* node1 = frame->operands;
-    OperandStack* node2 = node1->next;
+    uint16_t top = frame->operands.top - 1;
+    int32_t value1 = frame->operands.values[top];
+    int32_t value2 = frame->operands.values[top - 1];
+    OperandType type1 = frame->operands.types[top];
+    OperandType type2 = frame->operands.types[top - 1];
 
-    if (!pushOperand(&frame->operands, node2->value, node2->type) ||
-        !pushOperand(&frame->operands, node1->value, node1->type))
+    if (!pushOperand(&frame->operands, value2, type2) ||
+        !pushOperand(&frame->operands, value1, type1))
     {
         jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
@@ -872,15 +766,12 @@ uint8_t instfunc_dup2(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_dup2_x1(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_dup2_x1(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t operand1, operand2, operand3;
     OperandType type1, type2, type3;
 
     // Pop the operand and then push them again.
-    // This method is easier to implement, but it is
-    // less efficient, since there is the need to free
-    // and malloc memory again.
     popOperand(&frame->operands, &operand1, &type1);
     popOperand(&frame->operands, &operand2, &type2);
     popOperand(&frame->operands, &operand3, &type3);
@@ -898,15 +789,12 @@ uint8_t instfunc_dup2_x1(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_dup2_x2(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_dup2_x2(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t operand1, operand2, operand3, operand4;
     OperandType type1, type2, type3, type4;
 
     // Pop the operand and then push them again.
-    // This method is easier to implement, but it is
-    // less efficient, since there is the need to free
-    // and malloc memory again.
     popOperand(&frame->operands, &operand1, &type1);
     popOperand(&frame->operands, &operand2, &type2);
     popOperand(&frame->operands, &operand3, &type3);
@@ -926,21 +814,23 @@ uint8_t instfunc_dup2_x2(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_swap(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_swap(JavaVirtualMachine* jvm, Frame* frame)
 {
-    OperandStack* node1 = frame->operands;
-    OperandStack* node2 = node1->next;
+    uint16_t top = frame->operands.top - 1;
+    int32_t value = frame->operands.values[top];
+    OperandType type = frame->operands.types[top];
 
-    frame->operands = node2;
-    node1->next = node2->next;
-    node2->next = node1;
+    frame->operands.values[top] = frame->operands.values[top - 1];
+    frame->operands.types[top] = frame->operands.types[top - 1];
+    frame->operands.values[top - 1] = value;
+    frame->operands.types[top - 1] = type;
     return 1;
 }
 
 /// @brief Used to automatically generate instructions "iadd", "isub",
-/// "imul", "idiv", "irem", "iand", "ior" and "ixor".
+/// "imul", "iand", "ior" and "ixor".
 #define DECLR_INTEGER_MATH_OP(instruction, op) \
-    uint8_t instfunc_##instruction(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instruction(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         int32_t value1, value2; \
         popOperand(&frame->operands, &value2, NULL); \
@@ -956,13 +846,35 @@ uint8_t instfunc_swap(JavaVirtualMachine* jvm, Frame* frame)
 DECLR_INTEGER_MATH_OP(iadd, +)
 DECLR_INTEGER_MATH_OP(isub, -)
 DECLR_INTEGER_MATH_OP(imul, *)
-DECLR_INTEGER_MATH_OP(idiv, /)
-DECLR_INTEGER_MATH_OP(irem, %)
 DECLR_INTEGER_MATH_OP(iand, &)
 DECLR_INTEGER_MATH_OP(ior, |)
 DECLR_INTEGER_MATH_OP(ixor, ^)
 
-uint8_t instfunc_ishl(JavaVirtualMachine* jvm, Frame* frame)
+/// @brief Used to automatically generate instructions "idiv" and "irem",
+/// which throw ArithmeticException when dividing by zero. Dividing the
+/// smallest integer by -1 overflows in C, so a divisor of -1 is handled
+/// separately: the quotient is the negated dividend (which wraps around
+/// like in Java) and the remainder is 0.
+#define DECLR_INTEGER_DIVISION_OP(instruction, op, minusOneResult) \
+    static inline uint8_t instfunc_##instruction(JavaVirtualMachine* jvm, Frame* frame) \
+    { \
+        int32_t value1, value2; \
+        popOperand(&frame->operands, &value2, NULL); \
+        popOperand(&frame->operands, &value1, NULL); \
+        if (value2 == 0) \
+            return throwException(jvm, "java/lang/ArithmeticException", "/ by zero"); \
+        if (!pushOperand(&frame->operands, value2 == -1 ? (minusOneResult) : value1 op value2, OP_INTEGER)) \
+        { \
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY; \
+            return 0; \
+        } \
+        return 1; \
+    }
+
+DECLR_INTEGER_DIVISION_OP(idiv, /, (int32_t)(0u - (uint32_t)value1))
+DECLR_INTEGER_DIVISION_OP(irem, %, 0)
+
+static inline uint8_t instfunc_ishl(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t value1, value2;
 
@@ -978,7 +890,7 @@ uint8_t instfunc_ishl(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_ishr(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_ishr(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t value1, value2;
 
@@ -994,7 +906,7 @@ uint8_t instfunc_ishr(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_iushr(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_iushr(JavaVirtualMachine* jvm, Frame* frame)
 {
     uint32_t value1, value2;
 
@@ -1011,9 +923,9 @@ uint8_t instfunc_iushr(JavaVirtualMachine* jvm, Frame* frame)
 }
 
 /// @brief Used to automatically generate instructions "ladd", "lsub",
-/// "lmul", "ldiv", "lrem", "land", "lor" and "lxor".
+/// "lmul", "land", "lor" and "lxor".
 #define DECLR_LONG_MATH_OP(instruction, op) \
-    uint8_t instfunc_##instruction(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instruction(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         int64_t value1, value2; \
         int32_t high, low; \
@@ -1038,13 +950,41 @@ uint8_t instfunc_iushr(JavaVirtualMachine* jvm, Frame* frame)
 DECLR_LONG_MATH_OP(ladd, +)
 DECLR_LONG_MATH_OP(lsub, -)
 DECLR_LONG_MATH_OP(lmul, *)
-DECLR_LONG_MATH_OP(ldiv, /)
-DECLR_LONG_MATH_OP(lrem, %)
 DECLR_LONG_MATH_OP(land, &)
 DECLR_LONG_MATH_OP(lor, |)
 DECLR_LONG_MATH_OP(lxor, ^)
 
-uint8_t instfunc_lshl(JavaVirtualMachine* jvm, Frame* frame)
+/// @brief Used to automatically generate instructions "ldiv" and "lrem",
+/// like DECLR_INTEGER_DIVISION_OP.
+#define DECLR_LONG_DIVISION_OP(instruction, op, minusOneResult) \
+    static inline uint8_t instfunc_##instruction(JavaVirtualMachine* jvm, Frame* frame) \
+    { \
+        int64_t value1, value2; \
+        int32_t high, low; \
+        popOperand(&frame->operands, &low, NULL); \
+        popOperand(&frame->operands, &high, NULL); \
+        value2 = high; \
+        value2 = value2 << 32 | (uint32_t)low; \
+        popOperand(&frame->operands, &low, NULL); \
+        popOperand(&frame->operands, &high, NULL); \
+        value1 = high; \
+        value1 = value1 << 32 | (uint32_t)low; \
+        if (value2 == 0) \
+            return throwException(jvm, "java/lang/ArithmeticException", "/ by zero"); \
+        value1 = value2 == -1 ? (minusOneResult) : value1 op value2; \
+        if (!pushOperand(&frame->operands, HIWORD(value1), OP_LONG) || \
+            !pushOperand(&frame->operands, LOWORD(value1), OP_LONG)) \
+        { \
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY; \
+            return 0; \
+        } \
+        return 1; \
+    }
+
+DECLR_LONG_DIVISION_OP(ldiv, /, (int64_t)(0ull - (uint64_t)value1))
+DECLR_LONG_DIVISION_OP(lrem, %, 0)
+
+static inline uint8_t instfunc_lshl(JavaVirtualMachine* jvm, Frame* frame)
 {
     int64_t value1;
     int32_t value2;
@@ -1068,7 +1008,7 @@ uint8_t instfunc_lshl(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_lshr(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_lshr(JavaVirtualMachine* jvm, Frame* frame)
 {
     int64_t value1;
     int32_t value2;
@@ -1092,7 +1032,7 @@ uint8_t instfunc_lshr(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_lushr(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_lushr(JavaVirtualMachine* jvm, Frame* frame)
 {
     uint64_t value1;
     uint32_t value2;
@@ -1119,7 +1059,7 @@ uint8_t instfunc_lushr(JavaVirtualMachine* jvm, Frame* frame)
 /// @brief Used to automatically generate instructions "fadd", "fsub",
 /// "fmul" and "fdiv".
 #define DECLR_FLOAT_MATH_OP(instruction, op) \
-    uint8_t instfunc_##instruction(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instruction(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         union { \
             float f; \
@@ -1144,7 +1084,7 @@ DECLR_FLOAT_MATH_OP(fdiv, /)
 /// @brief Used to automatically generate instructions "dadd", "dsub",
 /// "dmul" and "ddiv".
 #define DECLR_DOUBLE_MATH_OP(instruction, op) \
-    uint8_t instfunc_##instruction(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instruction(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         union { \
             double d; \
@@ -1174,7 +1114,7 @@ DECLR_DOUBLE_MATH_OP(dsub, -)
 DECLR_DOUBLE_MATH_OP(dmul, *)
 DECLR_DOUBLE_MATH_OP(ddiv, /)
 
-uint8_t instfunc_frem(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_frem(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         float f;
@@ -1200,7 +1140,7 @@ uint8_t instfunc_frem(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_drem(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_drem(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         double d;
@@ -1238,7 +1178,7 @@ uint8_t instfunc_drem(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_ineg(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_ineg(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t value;
     popOperand(&frame->operands, &value, NULL);
@@ -1253,7 +1193,7 @@ uint8_t instfunc_ineg(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_lneg(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_lneg(JavaVirtualMachine* jvm, Frame* frame)
 {
     int64_t value;
     int32_t high, low;
@@ -1275,7 +1215,7 @@ uint8_t instfunc_lneg(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_fneg(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_fneg(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         float f;
@@ -1295,7 +1235,7 @@ uint8_t instfunc_fneg(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_dneg(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_dneg(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         double d;
@@ -1321,25 +1261,13 @@ uint8_t instfunc_dneg(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_iinc(JavaVirtualMachine* jvm, Frame* frame)
-{
-    uint8_t index = NEXT_BYTE;
-    int8_t immediate = (int8_t)NEXT_BYTE;
-    frame->localVariables[index] += (int32_t)immediate;
-    return 1;
-}
-
-uint8_t instfunc_wide_iinc(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_iinc(JavaVirtualMachine* jvm, Frame* frame)
 {
-    uint16_t index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
-    int16_t immediate = NEXT_BYTE;
-    immediate = (immediate << 8) | NEXT_BYTE;
-    frame->localVariables[index] += (int32_t)immediate;
+    frame->localVariables[OPERAND1] += OPERAND2;
     return 1;
 }
 
-uint8_t instfunc_i2l(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_i2l(JavaVirtualMachine* jvm, Frame* frame)
 {
     int64_t value;
     int32_t temp;
@@ -1358,7 +1286,7 @@ uint8_t instfunc_i2l(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_i2f(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_i2f(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         float f;
@@ -1377,7 +1305,7 @@ uint8_t instfunc_i2f(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_i2d(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_i2d(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         double d;
@@ -1399,7 +1327,7 @@ uint8_t instfunc_i2d(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_l2i(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_l2i(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t temp;
 
@@ -1415,7 +1343,7 @@ uint8_t instfunc_l2i(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_l2f(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_l2f(JavaVirtualMachine* jvm, Frame* frame)
 {
     int64_t lval;
 
@@ -1442,7 +1370,7 @@ uint8_t instfunc_l2f(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_l2d(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_l2d(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         double d;
@@ -1470,7 +1398,7 @@ uint8_t instfunc_l2d(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_f2i(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_f2i(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         float f;
@@ -1489,7 +1417,7 @@ uint8_t instfunc_f2i(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_f2l(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_f2l(JavaVirtualMachine* jvm, Frame* frame)
 {
     int64_t lval;
 
@@ -1512,7 +1440,7 @@ uint8_t instfunc_f2l(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_f2d(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_f2d(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         double d;
@@ -1538,7 +1466,7 @@ uint8_t instfunc_f2d(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_d2i(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_d2i(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         double d;
@@ -1564,7 +1492,7 @@ uint8_t instfunc_d2i(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_d2l(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_d2l(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         double d;
@@ -1590,7 +1518,7 @@ uint8_t instfunc_d2l(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_d2f(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_d2f(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         double d;
@@ -1621,7 +1549,7 @@ uint8_t instfunc_d2f(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_i2b(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_i2b(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t value;
     int8_t byte;
@@ -1639,7 +1567,7 @@ uint8_t instfunc_i2b(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_i2c(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_i2c(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t value;
     uint16_t character;
@@ -1657,7 +1585,7 @@ uint8_t instfunc_i2c(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_i2s(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_i2s(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t value;
     int16_t sval;
@@ -1675,7 +1603,7 @@ uint8_t instfunc_i2s(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_lcmp(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_lcmp(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t high, low;
     int64_t value1, value2;
@@ -1708,7 +1636,7 @@ uint8_t instfunc_lcmp(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_fcmpl(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_fcmpl(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         int32_t i;
@@ -1734,7 +1662,7 @@ uint8_t instfunc_fcmpl(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_fcmpg(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_fcmpg(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         int32_t i;
@@ -1760,7 +1688,7 @@ uint8_t instfunc_fcmpg(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_dcmpl(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_dcmpl(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         int64_t i;
@@ -1797,7 +1725,7 @@ uint8_t instfunc_dcmpl(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_dcmpg(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_dcmpg(JavaVirtualMachine* jvm, Frame* frame)
 {
     union {
         int64_t i;
@@ -1837,14 +1765,12 @@ uint8_t instfunc_dcmpg(JavaVirtualMachine* jvm, Frame* frame)
 /// @brief Used to automatically generate instructions "ifeq", "ifne",
 /// "iflt", "ifle", "ifgt" and "ifge".
 #define DECLR_IF_FAMILY(inst, op) \
-    uint8_t instfunc_##inst(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##inst(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         int32_t value; \
-        int16_t offset = NEXT_BYTE; \
-        offset = (offset << 8) | NEXT_BYTE; \
         popOperand(&frame->operands, &value, NULL); \
         if (value op 0) \
-            frame->pc += offset - 3; \
+            frame->pc = OPERAND1; \
         return 1; \
     }
 
@@ -1858,15 +1784,13 @@ DECLR_IF_FAMILY(ifge, >=)
 /// @brief Used to automatically generate instructions "if_icmpeq", "if_icmpne",
 /// "if_icmplt", "if_icmple", "if_icmpgt", "if_icmpge", "if_acmpeq" and "if_acmpne".
 #define DECLR_IF_ICMP_FAMILY(inst, op) \
-    uint8_t instfunc_##inst(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##inst(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         int32_t value1, value2; \
-        int16_t offset = NEXT_BYTE; \
-        offset = (offset << 8) | NEXT_BYTE; \
         popOperand(&frame->operands, &value2, NULL); \
         popOperand(&frame->operands, &value1, NULL); \
         if (value1 op value2) \
-            frame->pc += offset - 3; \
+            frame->pc = OPERAND1; \
         return 1; \
     }
 
@@ -1880,136 +1804,83 @@ DECLR_IF_ICMP_FAMILY(if_icmpge, >=)
 DECLR_IF_ICMP_FAMILY(if_acmpeq, ==)
 DECLR_IF_ICMP_FAMILY(if_acmpne, !=)
 
-uint8_t instfunc_goto(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_goto(JavaVirtualMachine* jvm, Frame* frame)
 {
-    int16_t offset = NEXT_BYTE;
-    offset = (offset << 8) | NEXT_BYTE;
-    frame->pc += offset - 3;
+    frame->pc = OPERAND1;
     return 1;
 }
 
-uint8_t instfunc_jsr(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_jsr(JavaVirtualMachine* jvm, Frame* frame)
 {
-    int16_t offset = NEXT_BYTE;
-    offset = (offset << 8) | NEXT_BYTE;
-
     if (!pushOperand(&frame->operands, (int32_t)frame->pc, OP_RETURNADDRESS))
     {
         jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
     }
 
-    frame->pc += offset - 3;
-    return 1;
-}
-
-uint8_t instfunc_ret(JavaVirtualMachine* jvm, Frame* frame)
-{
-    uint8_t index = NEXT_BYTE;
-    frame->pc = (uint32_t)frame->localVariables[index];
+    frame->pc = OPERAND1;
     return 1;
 }
 
-uint8_t instfunc_wide_ret(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_ret(JavaVirtualMachine* jvm, Frame* frame)
 {
-    uint16_t index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
-    frame->pc = (uint32_t)frame->localVariables[index];
+    frame->pc = (uint32_t)frame->localVariables[OPERAND1];
     return 1;
 }
 
-uint8_t instfunc_tableswitch(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_tableswitch(JavaVirtualMachine* jvm, Frame* frame)
 {
-    uint32_t base = frame->pc - 1;
-
-    // Skip padding bytes
-    frame->pc += 4 - (frame->pc % 4);
-
-    int32_t defaultValue = NEXT_BYTE;
-    defaultValue = (defaultValue << 8) | NEXT_BYTE;
-    defaultValue = (defaultValue << 8) | NEXT_BYTE;
-    defaultValue = (defaultValue << 8) | NEXT_BYTE;
-
-    int32_t lowValue = NEXT_BYTE;
-    lowValue = (lowValue << 8) | NEXT_BYTE;
-    lowValue = (lowValue << 8) | NEXT_BYTE;
-    lowValue = (lowValue << 8) | NEXT_BYTE;
-
-    int32_t highValue = NEXT_BYTE;
-    highValue = (highValue << 8) | NEXT_BYTE;
-    highValue = (highValue << 8) | NEXT_BYTE;
-    highValue = (highValue << 8) | NEXT_BYTE;
-
+    Instruction* instruction = CURRENT_INSTRUCTION;
     int32_t index;
     popOperand(&frame->operands, &index, NULL);
 
-    if (index >= lowValue && index <= highValue)
-    {
-        frame->pc += 4 * (index - lowValue);
-        defaultValue = NEXT_BYTE;
-        defaultValue = (defaultValue << 8) | NEXT_BYTE;
-        defaultValue = (defaultValue << 8) | NEXT_BYTE;
-        defaultValue = (defaultValue << 8) | NEXT_BYTE;
-    }
-
-    frame->pc = base + defaultValue;
+    if (index >= instruction->operand1 && index <= instruction->operand2)
+        frame->pc = instruction->switchTable[1 + index - instruction->operand1];
+    else
+        frame->pc = instruction->switchTable[0];
 
     return 1;
 }
 
-uint8_t instfunc_lookupswitch(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_lookupswitch(JavaVirtualMachine* jvm, Frame* frame)
 {
-    uint32_t base = frame->pc - 1;
-
-    // Skip padding bytes
-    frame->pc += 4 - (frame->pc % 4);
+    Instruction* instruction = CURRENT_INSTRUCTION;
+    int32_t* pairs = instruction->switchTable + 1;
+    int32_t lower = 0;
+    int32_t upper = instruction->operand1 - 1;
+    int32_t key;
 
-    int32_t defaultValue = NEXT_BYTE;
-    defaultValue = (defaultValue << 8) | NEXT_BYTE;
-    defaultValue = (defaultValue << 8) | NEXT_BYTE;
-    defaultValue = (defaultValue << 8) | NEXT_BYTE;
-
-    int32_t npairs = NEXT_BYTE;
-    npairs = (npairs << 8) | NEXT_BYTE;
-    npairs = (npairs << 8) | NEXT_BYTE;
-    npairs = (npairs << 8) | NEXT_BYTE;
-
-    int32_t key, match;
     popOperand(&frame->operands, &key, NULL);
 
-    while (npairs-- > 0)
+    // Pairs are sorted by match, so a binary search is done
+    while (lower <= upper)
     {
-        match = NEXT_BYTE;
-        match = (match << 8) | NEXT_BYTE;
-        match = (match << 8) | NEXT_BYTE;
-        match = (match << 8) | NEXT_BYTE;
+        int32_t middle = (lower + upper) / 2;
+        int32_t match = pairs[2 * middle];
 
         if (key == match)
         {
-            defaultValue = NEXT_BYTE;
-            defaultValue = (defaultValue << 8) | NEXT_BYTE;
-            defaultValue = (defaultValue << 8) | NEXT_BYTE;
-            defaultValue = (defaultValue << 8) | NEXT_BYTE;
-            break;
+            frame->pc = pairs[2 * middle + 1];
+            return 1;
         }
+
+        if (key < match)
+            upper = middle - 1;
         else
-        {
-            frame->pc += 4;
-        }
+            lower = middle + 1;
     }
 
-    frame->pc = base + defaultValue;
-
+    frame->pc = instruction->switchTable[0];
     return 1;
 }
 
 /// @brief Used to automatically generate instructions "ireturn", "lreturn",
 /// "freturn", "dreturn", "areturn" and "return".
 #define DECLR_RETURN_FAMILY(instname, retcount) \
-    uint8_t instfunc_##instname(JavaVirtualMachine* jvm, Frame* frame) \
+    static inline uint8_t instfunc_##instname(JavaVirtualMachine* jvm, Frame* frame) \
     { \
         /* This will finish the frame, forcing it to return */ \
-        frame->pc = frame->code_length; \
+        frame->pc = frame->instructionCount; \
         /*
          Set the returnCount to 1, so the caller frame will know \
          that one operand (the top one obviously) must be popped \
@@ -2027,60 +1898,55 @@ DECLR_RETURN_FAMILY(dreturn, 2)
 DECLR_RETURN_FAMILY(areturn, 1)
 DECLR_RETURN_FAMILY(return, 0)
 
-uint8_t instfunc_getstatic(JavaVirtualMachine* jvm, Frame* frame)
+/// @brief Resolves the field referenced by a Fieldref entry of the
+/// constant pool of the frame's class.
+/// @param JavaVirtualMachine* jvm - pointer to the JVM structure that is running.
+/// @param Frame* frame - the frame executing the field instruction.
+/// @param cp_info* field - the Fieldref entry to be resolved.
+/// @param uint8_t isStatic - boolean telling if the field is accessed by
+/// getstatic/putstatic. Instance fields are also looked for in the super
+/// classes of the class referenced by the Fieldref.
+///
+/// The class of the field, the offset of the field and its operand type are
+/// stored in the Fieldref, so the field doesn't need to be looked up by name
+/// and descriptor again. Field instructions call this function only once for
+/// each Fieldref, and then are rewritten into their quick variants.
+///
+/// @return 1 if the field was resolved, otherwise 0.
+/// @see instfunc_getstatic_quick(), instfunc_getfield_quick()
+static uint8_t resolveFieldReference(JavaVirtualMachine* jvm, Frame* frame, cp_info* field, uint8_t isStatic)
 {
-    // Get the parameter of the instruction
-    uint16_t index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
-
-    // Get the Fieldref CP entry
-    cp_info* field = frame->jc->constantPool + index - 1;
     cp_info* cpi1, *cpi2;
 
-    if (jvm->simulatingSystemAndStringClasses)
-    {
-        cpi1 = frame->jc->constantPool + field->Fieldref.class_index - 1;
-        cpi1 = frame->jc->constantPool + cpi1->Class.name_index - 1;
-
-        // All static fields from java/lang/System will be replaced
-        // with null object in simulation mode.
-        if (cmp_UTF8(UTF8(cpi1), (const uint8_t*)"java/lang/System", 16))
-        {
-            if (!pushOperand(&frame->operands, 0, OP_NULL))
-            {
-                jvm->status = JVM_STATUS_OUT_OF_MEMORY;
-                return 0;
-            }
-
-            return 1;
-        }
-    }
-
     LoadedClasses* fieldLoadedClass;
 
     // Resolve the field, i.e, load the class that field belongs to
-    if (!resolveField(jvm, frame->jc, field, &fieldLoadedClass) ||
-        !fieldLoadedClass || !initClass(jvm, fieldLoadedClass))
+    if (!resolveField(jvm, frame->jc, field, &fieldLoadedClass) || !fieldLoadedClass)
     {
-        // TODO: throw NoSuchFieldError
+        // TODO: throw NoSuchFieldError or other linkage exception
         DEBUG_REPORT_INSTRUCTION_ERROR
         return 0;
     }
 
+    if (!initClass(jvm, fieldLoadedClass))
+        return 0;
+
     // Get the name of the field and its descriptor
     cpi2 = frame->jc->constantPool + field->Fieldref.name_and_type_index - 1;
     cpi1 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;          // name
     cpi2 = frame->jc->constantPool + cpi2->NameAndType.descriptor_index - 1;    // descriptor
 
-    // Find in the field's class the field_info that matches the name and the descriptor
-    field_info* fi = getFieldMatching(fieldLoadedClass->jc, UTF8(cpi1), UTF8(cpi2), 0);
+    // Find in the field's class the field_info that matches the name and the descriptor.
+    // Instance fields may also be declared by a super class.
+    field_info* fi;
+
+    if (isStatic)
+        fi = getFieldMatchingSymbols(fieldLoadedClass->jc, cpi1->Utf8.symbol, cpi2->Utf8.symbol, 0);
+    else
+        fi = findFieldInClassHierarchy(fieldLoadedClass, cpi1->Utf8.symbol, cpi2->Utf8.symbol, NULL);
 
     if (!fi)
-    {
-        // TODO: throw NoSuchFieldError
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
+        return throwMemberError(jvm, "java/lang/NoSuchFieldError", cpi1);
 
     OperandType type;
 
@@ -2109,450 +1975,522 @@ uint8_t instfunc_getstatic(JavaVirtualMachine* jvm, Frame* frame)
             return 0;
     }
 
-    if (!pushOperand(&frame->operands, fieldLoadedClass->staticFieldsData[fi->offset], type))
-    {
-        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
-        return 0;
-    }
-
-    // If the field is category 2, push the second part operand from the static data
-    if (type == OP_LONG || type == OP_DOUBLE)
-    {
-        if (!pushOperand(&frame->operands, fieldLoadedClass->staticFieldsData[fi->offset + 1], type))
-        {
-            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
-            return 0;
-        }
-    }
-
-    // TODO: check if the field isn't static and isn't in an interface,
-    // throwing IncompatibleClassChangeError
+    // TODO: check if the field is static for getstatic/putstatic and
+    // isn't static for getfield/putfield, throwing IncompatibleClassChangeError
 
     // TODO: check if this class can access the field, i.e:
     //   1) If the field is private, then throw IllegalAccessError.
     //   2) If the field is protected and this class isn't a subclass
     //      of the field's class, throw IllegalAccessError.
 
+    // TODO: check if the field can be written by putfield/putstatic, ie:
+    //   1) If the field is final and this instruction isn't
+    //      being executed in the method '<clinit>', then
+    //      throw IllegalAccessError
+
+    field->Fieldref.resolvedClass = fieldLoadedClass;
+    field->Fieldref.resolvedOffset = fi->offset;
+    field->Fieldref.resolvedType = type;
     return 1;
 }
 
-uint8_t instfunc_putstatic(JavaVirtualMachine* jvm, Frame* frame)
-{
-    // Get the parameter of the instruction
-    uint16_t index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
+/// @brief Resolves the Fieldref used by the field instruction being executed,
+/// if it hasn't been resolved yet, and then rewrites the instruction into
+/// its quick variant (according to the category of the field) and executes it.
+#define QUICKEN_FIELD_INSTRUCTION(inst, isStatic) \
+    cp_info* field = frame->jc->constantPool + OPERAND1 - 1; \
+    if (!field->Fieldref.resolvedClass && !resolveFieldReference(jvm, frame, field, isStatic)) \
+        return 0; \
+    if (field->Fieldref.resolvedType == OP_LONG || field->Fieldref.resolvedType == OP_DOUBLE) \
+    { \
+        CURRENT_INSTRUCTION->opcode = opcode_##inst##2_quick; \
+        return instfunc_##inst##2_quick(jvm, frame); \
+    } \
+    CURRENT_INSTRUCTION->opcode = opcode_##inst##_quick; \
+    return instfunc_##inst##_quick(jvm, frame);
 
-    // Get the Fieldref CP entry
-    cp_info* field = frame->jc->constantPool + index - 1;
-    cp_info* cpi1, *cpi2;
+/// @brief The Fieldref used by the quick field instruction being executed,
+/// which has already been resolved.
+#define RESOLVED_FIELD (frame->jc->constantPool[OPERAND1 - 1].Fieldref)
 
-    LoadedClasses* fieldLoadedClass;
+static inline uint8_t instfunc_getstatic_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
+    int32_t* data = RESOLVED_FIELD.resolvedClass->staticFieldsData + RESOLVED_FIELD.resolvedOffset;
 
-    // Resolve the field, i.e, load the class that field belongs to
-    if (!resolveField(jvm, frame->jc, field, &fieldLoadedClass) ||
-        !fieldLoadedClass || !initClass(jvm, fieldLoadedClass))
+    if (!pushOperand(&frame->operands, data[0], RESOLVED_FIELD.resolvedType))
     {
-        // TODO: throw NoSuchFieldError
-        DEBUG_REPORT_INSTRUCTION_ERROR
+        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
     }
 
-    // Get the name of the field and its descriptor
-    cpi2 = frame->jc->constantPool + field->Fieldref.name_and_type_index - 1;
-    cpi1 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;          // name
-    cpi2 = frame->jc->constantPool + cpi2->NameAndType.descriptor_index - 1;    // descriptor
+    return 1;
+}
 
-    // Find in the field's class the field_info that matches the name and the descriptor
-    field_info* fi = getFieldMatching(fieldLoadedClass->jc, UTF8(cpi1), UTF8(cpi2), 0);
+static inline uint8_t instfunc_getstatic2_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
+    int32_t* data = RESOLVED_FIELD.resolvedClass->staticFieldsData + RESOLVED_FIELD.resolvedOffset;
 
-    if (!fi)
+    if (!pushOperand(&frame->operands, data[0], RESOLVED_FIELD.resolvedType) ||
+        !pushOperand(&frame->operands, data[1], RESOLVED_FIELD.resolvedType))
     {
-        // TODO: throw NoSuchFieldError
-        DEBUG_REPORT_INSTRUCTION_ERROR
+        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
     }
 
-    OperandType type;
+    return 1;
+}
 
-    switch (*cpi2->Utf8.bytes)
-    {
-        case 'J': type = OP_LONG; break;
-        case 'D': type = OP_DOUBLE; break;
-        case 'F': type = OP_FLOAT; break;
+static inline uint8_t instfunc_putstatic_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
+    int32_t* data = RESOLVED_FIELD.resolvedClass->staticFieldsData + RESOLVED_FIELD.resolvedOffset;
 
-        case 'L':
-        case '[':
-            type = OP_REFERENCE;
-            break;
+    popOperand(&frame->operands, data, NULL);
+    return 1;
+}
 
-        case 'B': // byte
-        case 'C': // char
-        case 'I': // int
-        case 'S': // short
-        case 'Z': // boolean
-            type = OP_INTEGER;
-            break;
-
-        default:
-            // todo: throw exception maybe?
-            DEBUG_REPORT_INSTRUCTION_ERROR
-            return 0;
-    }
-
-    int32_t operand;
-
-    popOperand(&frame->operands, &operand, NULL);
-
-    // If the field is category 2, set the following index too
-    if (type == OP_LONG || type == OP_DOUBLE)
-    {
-        fieldLoadedClass->staticFieldsData[fi->offset + 1] = operand;
-        popOperand(&frame->operands, &operand, NULL);
-        fieldLoadedClass->staticFieldsData[fi->offset] = operand;
-    }
-    else
-    {
-        fieldLoadedClass->staticFieldsData[fi->offset] = operand;
-    }
-
-
-    // TODO: check if the field isn't static and isn't in an interface,
-    // throwing IncompatibleClassChangeError
-
-    // TODO: check if this class can access the field, i.e:
-    //   1) If the field is private, then throw IllegalAccessError.
-    //   2) If the field is protected and this class isn't a subclass
-    //      of the field's class, throw IllegalAccessError.
-
-    // TODO: check if the field can be written, ie:
-    //   1) If the field is final and this instruction isn't
-    //      being executed in the method '<clinit>', then
-    //      throw IllegalAccessError
+static inline uint8_t instfunc_putstatic2_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
+    int32_t* data = RESOLVED_FIELD.resolvedClass->staticFieldsData + RESOLVED_FIELD.resolvedOffset;
 
+    popOperand(&frame->operands, data + 1, NULL);
+    popOperand(&frame->operands, data, NULL);
     return 1;
 }
 
-uint8_t instfunc_getfield(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_getfield_quick(JavaVirtualMachine* jvm, Frame* frame)
 {
-    // Get the parameter of the instruction
-    uint16_t index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
+    Reference* object;
+    int32_t object_address;
 
-    // Get the Fieldref CP entry
-    cp_info* field = frame->jc->constantPool + index - 1;
-    cp_info* cpi1, *cpi2;
+    // Get the objectref
+    popOperand(&frame->operands, &object_address, NULL);
+    object = DECODE_REFERENCE(object_address);
 
-    LoadedClasses* fieldLoadedClass;
+    if (!object)
+        return throwException(jvm, "java/lang/NullPointerException", NULL);
 
-    // Resolve the field, i.e, load the class that field belongs to and
-    // the class of the that field, if its type is class.
-    if (!resolveField(jvm, frame->jc, field, &fieldLoadedClass) ||
-        !fieldLoadedClass || !initClass(jvm, fieldLoadedClass))
+    if (!pushOperand(&frame->operands, INSTANCE_FIELDS(object)[RESOLVED_FIELD.resolvedOffset], RESOLVED_FIELD.resolvedType))
     {
-        // TODO: throw Error or other linkage exception
-        DEBUG_REPORT_INSTRUCTION_ERROR
+        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
     }
 
-    // Get the name of the field and its descriptor
-    cpi2 = frame->jc->constantPool + field->Fieldref.name_and_type_index - 1;
-    cpi1 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;          // name
-    cpi2 = frame->jc->constantPool + cpi2->NameAndType.descriptor_index - 1;    // descriptor
-
-    field_info* fi = getFieldMatching(fieldLoadedClass->jc, UTF8(cpi1), UTF8(cpi2), 0);
+    return 1;
+}
 
-    if (!fi)
-    {
-        // maybe it is located in the super class
-        JavaClass* super = getSuperClass(jvm, fieldLoadedClass->jc);
+static inline uint8_t instfunc_getfield2_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
+    Reference* object;
+    int32_t object_address;
 
-        while (super)
-        {
-            fi = getFieldMatching(super, UTF8(cpi1), UTF8(cpi2), 0);
+    // Get the objectref
+    popOperand(&frame->operands, &object_address, NULL);
+    object = DECODE_REFERENCE(object_address);
 
-            if (fi)
-                break;
+    if (!object)
+        return throwException(jvm, "java/lang/NullPointerException", NULL);
 
-            super = getSuperClass(jvm, super);
-        }
-    }
+    int32_t* data = INSTANCE_FIELDS(object) + RESOLVED_FIELD.resolvedOffset;
 
-    if (!fi)
+    if (!pushOperand(&frame->operands, data[0], RESOLVED_FIELD.resolvedType) ||
+        !pushOperand(&frame->operands, data[1], RESOLVED_FIELD.resolvedType))
     {
-        // TODO: throw NoSuchFieldError
-        DEBUG_REPORT_INSTRUCTION_ERROR
+        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
     }
 
-    OperandType type;
+    return 1;
+}
 
-    switch (*cpi2->Utf8.bytes)
-    {
-        case 'J': type = OP_LONG; break;
-        case 'D': type = OP_DOUBLE; break;
-        case 'F': type = OP_FLOAT; break;
+static inline uint8_t instfunc_putfield_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
+    Reference* object;
+    int32_t operand;
+    int32_t object_address;
 
-        case 'L':
-        case '[':
-            type = OP_REFERENCE;
-            break;
+    popOperand(&frame->operands, &operand, NULL);
 
-        case 'B': // byte
-        case 'C': // char
-        case 'I': // int
-        case 'S': // short
-        case 'Z': // boolean
-            type = OP_INTEGER;
-            break;
+    // Get the objectref
+    popOperand(&frame->operands, &object_address, NULL);
+    object = DECODE_REFERENCE(object_address);
 
-        default:
-            // todo: throw exception maybe?
-            DEBUG_REPORT_INSTRUCTION_ERROR
-            return 0;
-    }
+    if (!object)
+        return throwException(jvm, "java/lang/NullPointerException", NULL);
 
+    INSTANCE_FIELDS(object)[RESOLVED_FIELD.resolvedOffset] = operand;
+    return 1;
+}
+
+static inline uint8_t instfunc_putfield2_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
     Reference* object;
+    int32_t lo_operand;
+    int32_t hi_operand;
     int32_t object_address;
 
+    popOperand(&frame->operands, &lo_operand, NULL);
+    popOperand(&frame->operands, &hi_operand, NULL);
+
     // Get the objectref
     popOperand(&frame->operands, &object_address, NULL);
-    object = (Reference*)object_address;
+    object = DECODE_REFERENCE(object_address);
 
     if (!object)
-    {
-        // TODO: throw NullPointerException
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
+        return throwException(jvm, "java/lang/NullPointerException", NULL);
 
-    //if (!pushOperand(&frame->operands, *(int32_t*)(object->ci.data + sizeof(int32_t) * fi->offset), type))
-    if (!pushOperand(&frame->operands, object->ci.data[fi->offset], type))
-    {
-        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
-        return 0;
-    }
+    INSTANCE_FIELDS(object)[RESOLVED_FIELD.resolvedOffset] = hi_operand;
+    INSTANCE_FIELDS(object)[RESOLVED_FIELD.resolvedOffset + 1] = lo_operand;
+    return 1;
+}
 
-    if (type == OP_LONG || type == OP_DOUBLE)
+static inline uint8_t instfunc_getstatic(JavaVirtualMachine* jvm, Frame* frame)
+{
+    if (jvm->simulatingSystemAndStringClasses)
     {
-        //if (!pushOperand(&frame->operands, *(int32_t*)(object->ci.data + sizeof(int32_t) * (fi->offset + 1)), type))
-        if (!pushOperand(&frame->operands, object->ci.data[fi->offset + 1], type))
+        cp_info* cpi = frame->jc->constantPool + OPERAND1 - 1;
+        cpi = frame->jc->constantPool + cpi->Fieldref.class_index - 1;
+        cpi = frame->jc->constantPool + cpi->Class.name_index - 1;
+
+        // All static fields from java/lang/System will be replaced
+        // with null object in simulation mode, so the instruction
+        // is rewritten to push null directly.
+        if (cmp_UTF8(UTF8(cpi), (const uint8_t*)"java/lang/System", 16))
         {
-            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
-            return 0;
+            CURRENT_INSTRUCTION->opcode = opcode_aconst_null;
+            return instfunc_aconst_null(jvm, frame);
         }
     }
 
-    return 1;
+    QUICKEN_FIELD_INSTRUCTION(getstatic, 1)
 }
 
-uint8_t instfunc_putfield(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_putstatic(JavaVirtualMachine* jvm, Frame* frame)
 {
-    // Get the parameter of the instruction
-    uint16_t index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
-
-    // Get the Fieldref CP entry
-    cp_info* field = frame->jc->constantPool + index - 1;
-    cp_info* cpi1, *cpi2;
+    QUICKEN_FIELD_INSTRUCTION(putstatic, 1)
+}
 
-    LoadedClasses* fieldLoadedClass;
+static inline uint8_t instfunc_getfield(JavaVirtualMachine* jvm, Frame* frame)
+{
+    QUICKEN_FIELD_INSTRUCTION(getfield, 0)
+}
 
-    // Resolve the field, i.e, load the class that field belongs to and
-    // the class of the that field, if its type is class.
-    if (!resolveField(jvm, frame->jc, field, &fieldLoadedClass) ||
-        !fieldLoadedClass || !initClass(jvm, fieldLoadedClass))
-    {
-        // TODO: throw Error
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
+static inline uint8_t instfunc_putfield(JavaVirtualMachine* jvm, Frame* frame)
+{
+    QUICKEN_FIELD_INSTRUCTION(putfield, 0)
+}
 
-    // Get the name of the field and its descriptor
-    cpi2 = frame->jc->constantPool + field->Methodref.name_and_type_index - 1;
-    cpi1 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;          // name
-    cpi2 = frame->jc->constantPool + cpi2->NameAndType.descriptor_index - 1;    // descriptor
+/// @brief Number of receiver classes an inline cache can remember.
+/// Call sites with more receiver classes than this (megamorphic) just
+/// index the vtable or itable of the receiver.
+#define INLINE_CACHE_SIZE 4
 
-    field_info* fi = getFieldMatching(fieldLoadedClass->jc, UTF8(cpi1), UTF8(cpi2), 0);
+/// @brief Inline cache of an invokevirtual or invokeinterface instruction,
+/// remembering the method invoked for the last receiver classes.
+///
+/// invokestatic_quick and invokespecial_quick always invoke the same
+/// method, which is the only target of their cache.
+struct InlineCache
+{
+    /// @brief Simulated method that replaces the invoked method, used
+    /// by invokenative_quick.
+    NativeFunction nativeFunction;
 
-    if (!fi)
-    {
-        // maybe it is located in the super class
-        JavaClass* super = getSuperClass(jvm, fieldLoadedClass->jc);
+    /// @brief Number of receiver classes in the cache.
+    uint8_t count;
 
-        while (super)
-        {
-            fi = getFieldMatching(super, UTF8(cpi1), UTF8(cpi2), 0);
+    /// @brief Classes of the receivers.
+    JavaClass* receivers[INLINE_CACHE_SIZE];
 
-            if (fi)
-                break;
+    /// @brief Method invoked for each receiver class.
+    VirtualMethod targets[INLINE_CACHE_SIZE];
+};
 
-            super = getSuperClass(jvm, super);
-        }
-    }
+/// @brief Allocates an inline cache for the instruction being executed,
+/// which is then rewritten into its quick variant.
+/// @return 1 if the cache was allocated, otherwise 0.
+static uint8_t quickenInvokeInstruction(JavaVirtualMachine* jvm, Frame* frame, uint8_t quickOpcode)
+{
+    Instruction* instruction = CURRENT_INSTRUCTION;
+    InlineCache* cache = (InlineCache*)malloc(sizeof(InlineCache));
 
-    if (!fi)
+    if (!cache)
     {
-        // TODO: throw NoSuchFieldError
-        DEBUG_REPORT_INSTRUCTION_ERROR
+        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
     }
 
-    OperandType type;
+    cache->nativeFunction = NULL;
+    cache->count = 0;
+    instruction->inlineCache = cache;
+    instruction->opcode = quickOpcode;
+    return 1;
+}
 
-    switch (*cpi2->Utf8.bytes)
-    {
-        case 'J': type = OP_LONG; break;
-        case 'D': type = OP_DOUBLE; break;
-        case 'F': type = OP_FLOAT; break;
+/// @brief Checks if a method invoked by invokevirtual or invokestatic is
+/// simulated, in which case the instruction is rewritten into invokenative_quick.
+/// @return 1 if the method is simulated, otherwise 0.
+static uint8_t quickenNativeInvoke(JavaVirtualMachine* jvm, Frame* frame, cp_info* method)
+{
+    cp_info* cpi1, *cpi2, *cpi3;
 
-        case 'L':
-        case '[':
-            type = OP_REFERENCE;
-            break;
+    if (!jvm->simulatingSystemAndStringClasses)
+        return 0;
 
-        case 'B': // byte
-        case 'C': // char
-        case 'I': // int
-        case 'S': // short
-        case 'Z': // boolean
-            type = OP_INTEGER;
-            break;
+    cpi1 = frame->jc->constantPool + method->Methodref.class_index - 1;
+    cpi1 = frame->jc->constantPool + cpi1->Class.name_index - 1;
 
-        default:
-            // todo: throw exception maybe?
-            DEBUG_REPORT_INSTRUCTION_ERROR
-            return 0;
-    }
+    cpi2 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
+    cpi2 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;
 
-    Reference* object;
-    int32_t lo_operand;
-    int32_t hi_operand;
-    int32_t object_address;
+    cpi3 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
+    cpi3 = frame->jc->constantPool + cpi3->NameAndType.descriptor_index - 1;
 
-    popOperand(&frame->operands, &lo_operand, NULL);
+    NativeFunction nativeFunc = getNative(UTF8(cpi1), UTF8(cpi2), UTF8(cpi3));
 
-    // If the field is category 2, pop the other operand too
-    if (type == OP_LONG || type == OP_DOUBLE)
-        popOperand(&frame->operands, &hi_operand, NULL);
+    if (!nativeFunc || !quickenInvokeInstruction(jvm, frame, opcode_invokenative_quick))
+        return 0;
 
-    // Get the objectref
-    popOperand(&frame->operands, &object_address, NULL);
-    object = (Reference*)object_address;
+    CURRENT_INSTRUCTION->inlineCache->nativeFunction = nativeFunc;
+    return 1;
+}
+
+/// @brief Gets the receiver of an invokevirtual or invokeinterface instruction.
+/// @return The receiver, or NULL if it is null, in which case NullPointerException
+/// is thrown, or if it isn't a class instance.
+static Reference* getInvokeReceiver(JavaVirtualMachine* jvm, Frame* frame, uint8_t parameterCount)
+{
+    Reference* object = DECODE_REFERENCE(frame->operands.values[frame->operands.top - parameterCount - 1]);
 
     if (!object)
     {
-        // TODO: throw NullPointerException
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
+        throwException(jvm, "java/lang/NullPointerException", NULL);
+        return NULL;
     }
 
-    if (type == OP_LONG || type == OP_DOUBLE)
+    if (object->type != REFTYPE_CLASSINSTANCE)
     {
-        //*(int32_t*)(object->ci.data + sizeof(int32_t) * fi->offset) = hi_operand;
-        //*(int32_t*)(object->ci.data + sizeof(int32_t) * (fi->offset + 1)) = lo_operand;
-        object->ci.data[fi->offset] = hi_operand;
-        object->ci.data[fi->offset + 1] = lo_operand;
+        // Methods of arrays and strings are only supported
+        // when they are simulated.
+        DEBUG_REPORT_INSTRUCTION_ERROR
+        return NULL;
     }
-    else
+
+    return object;
+}
+
+/// @brief Looks up an inline cache for a receiver class, setting
+/// \c outTarget to the cached method, or to NULL if the class
+/// isn't in the cache.
+#define INLINE_CACHE_LOOKUP(cache, receiverClass, outTarget) \
+    { \
+        uint8_t entry; \
+        outTarget = NULL; \
+        for (entry = 0; entry < cache->count; entry++) \
+        { \
+            if (cache->receivers[entry] == receiverClass) \
+            { \
+                outTarget = cache->targets + entry; \
+                break; \
+            } \
+        } \
+    }
+
+/// @brief Adds a receiver class and its method to an inline cache,
+/// if the cache isn't full.
+#define INLINE_CACHE_INSERT(cache, receiverClass, target) \
+    if (cache->count < INLINE_CACHE_SIZE) \
+    { \
+        cache->receivers[cache->count] = receiverClass; \
+        cache->targets[cache->count] = *target; \
+        cache->count++; \
+    }
+
+static inline uint8_t instfunc_invokevirtual_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
+    InlineCache* cache = CURRENT_INSTRUCTION->inlineCache;
+    cp_info* method = frame->jc->constantPool + OPERAND1 - 1;
+    uint8_t parameterCount = method->Methodref.parameterCount;
+    Reference* object = getInvokeReceiver(jvm, frame, parameterCount);
+    VirtualMethod* target;
+
+    if (!object)
+        return 0;
+
+    INLINE_CACHE_LOOKUP(cache, object->ci.c, target)
+
+    if (!target)
     {
-        //*(int32_t*)(object->ci.data + sizeof(int32_t) * fi->offset) = lo_operand;
-        object->ci.data[fi->offset] = lo_operand;
-   }
+        if (method->Methodref.resolvedIndex >= object->ci.c->vtableLength)
+            return throwException(jvm, "java/lang/IncompatibleClassChangeError", NULL);
 
-    return 1;
+        target = object->ci.c->vtable + method->Methodref.resolvedIndex;
+
+        if (target->method->access_flags & ACC_ABSTRACT)
+            return throwException(jvm, "java/lang/AbstractMethodError", NULL);
+
+        INLINE_CACHE_INSERT(cache, object->ci.c, target)
+    }
+
+    return runMethod(jvm, target->jc, target->method, 1 + parameterCount);
 }
 
-uint8_t instfunc_invokevirtual(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_invokeinterface_quick(JavaVirtualMachine* jvm, Frame* frame)
 {
-    // Get the parameter of the instruction
-    uint16_t index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
+    InlineCache* cache = CURRENT_INSTRUCTION->inlineCache;
+    cp_info* method = frame->jc->constantPool + OPERAND1 - 1;
+    uint8_t parameterCount = method->InterfaceMethodref.parameterCount;
+    Reference* object = getInvokeReceiver(jvm, frame, parameterCount);
+    VirtualMethod* target;
 
-     // Get the Methodref CP entry
-    cp_info* method = frame->jc->constantPool + index - 1;
-    cp_info* cpi1, *cpi2, *cpi3;
-    method_info* mi = NULL;
+    if (!object)
+        return 0;
 
-    if (jvm->simulatingSystemAndStringClasses)
+    INLINE_CACHE_LOOKUP(cache, object->ci.c, target)
+
+    if (!target)
     {
-        cpi1 = frame->jc->constantPool + method->Methodref.class_index - 1;
-        cpi1 = frame->jc->constantPool + cpi1->Class.name_index - 1;
+        JavaClass* jc = object->ci.c;
+        uint16_t index;
 
-        cpi2 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
-        cpi2 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;
+        for (index = 0; index < jc->itableCount; index++)
+        {
+            if (jc->itables[index].interface == method->InterfaceMethodref.resolvedInterface)
+            {
+                target = jc->itables[index].methods + method->InterfaceMethodref.resolvedIndex;
+                break;
+            }
+        }
+
+        if (!target)
+        {
+            // The class of the receiver doesn't implement the interface
+            return throwException(jvm, "java/lang/IncompatibleClassChangeError", NULL);
+        }
 
-        cpi3 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
-        cpi3 = frame->jc->constantPool + cpi3->NameAndType.descriptor_index - 1;
+        if (target->method->access_flags & ACC_ABSTRACT)
+            return throwException(jvm, "java/lang/AbstractMethodError", NULL);
 
-        NativeFunction nativeFunc = getNative(UTF8(cpi1), UTF8(cpi2), UTF8(cpi3));
+        if ((target->method->access_flags & ACC_PUBLIC) == 0)
+            return throwException(jvm, "java/lang/IllegalAccessError", NULL);
 
-        if (nativeFunc)
-            return nativeFunc(jvm, frame, UTF8(cpi3));
+        INLINE_CACHE_INSERT(cache, object->ci.c, target)
     }
 
-    LoadedClasses* methodLoadedClass;
+    return runMethod(jvm, target->jc, target->method, 1 + parameterCount);
+}
 
-    // Resolve the method, i.e, load the class that method belongs to
-    if (!resolveMethod(jvm, frame->jc, method, &methodLoadedClass) ||
-        !methodLoadedClass || !initClass(jvm, methodLoadedClass))
+static inline uint8_t instfunc_invokenative_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
+    cp_info* method = frame->jc->constantPool + OPERAND1 - 1;
+    cp_info* nameAndType = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
+    cp_info* descriptor = frame->jc->constantPool + nameAndType->NameAndType.descriptor_index - 1;
+
+    if (jvm->profiler)
     {
-        // TODO: throw Error
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
+        cp_info* className = frame->jc->constantPool + method->Methodref.class_index - 1;
+        className = frame->jc->constantPool + className->Class.name_index - 1;
+
+        if (!profileNativeCall(jvm->profiler, className->Utf8.symbol,
+                               frame->jc->constantPool[nameAndType->NameAndType.name_index - 1].Utf8.symbol,
+                               descriptor->Utf8.symbol))
+        {
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+            return 0;
+        }
     }
 
-    // Get the name of the method and its descriptor
-    cpi2 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
-    cpi1 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;          // name
-    cpi2 = frame->jc->constantPool + cpi2->NameAndType.descriptor_index - 1;    // descriptor
+    if (TRACING(TRACE_CATEGORY_NATIVE))
+    {
+        cp_info* className = frame->jc->constantPool + method->Methodref.class_index - 1;
+        className = frame->jc->constantPool + className->Class.name_index - 1;
 
-    uint8_t operandIndex;
-    uint8_t parameterCount = getMethodDescriptorParameterCount(UTF8(cpi2));
-    OperandStack* node = frame->operands;
+        recordTraceEvent(TRACE_NATIVE_CALL, 1, 0, className->Utf8.symbol,
+                         frame->jc->constantPool[nameAndType->NameAndType.name_index - 1].Utf8.symbol,
+                         descriptor->Utf8.symbol);
+    }
 
-    for (operandIndex = 0; operandIndex < parameterCount; operandIndex++)
-        node = node->next;
+    return CURRENT_INSTRUCTION->inlineCache->nativeFunction(jvm, frame, UTF8(descriptor));
+}
 
-    Reference* object = (Reference*)node->value;
-    JavaClass* jc = object->ci.c;
+static inline uint8_t instfunc_invokevirtual(JavaVirtualMachine* jvm, Frame* frame)
+{
+    // Get the parameter of the instruction
+    uint16_t index = OPERAND1;
 
-    if (object)
+     // Get the Methodref CP entry
+    cp_info* method = frame->jc->constantPool + index - 1;
+    cp_info* cpi1, *cpi2;
+
+    if (quickenNativeInvoke(jvm, frame, method))
+        return instfunc_invokenative_quick(jvm, frame);
+
+    if (method->Methodref.resolvedIndex < 0)
     {
-        while (jc)
+        LoadedClasses* methodLoadedClass;
+
+        // Resolve the method, i.e, load the class that method belongs to
+        if (!resolveMethod(jvm, frame->jc, method, &methodLoadedClass) || !methodLoadedClass)
         {
-            mi = getMethodMatching(jc, UTF8(cpi1), UTF8(cpi2), 0);
+            // TODO: throw Error
+            DEBUG_REPORT_INSTRUCTION_ERROR
+            return 0;
+        }
 
-            if (mi)
-                break;
+        if (!initClass(jvm, methodLoadedClass))
+            return 0;
 
-            jc = getSuperClass(jvm, jc);
-        }
+        // Get the name of the method and its descriptor
+        cpi2 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
+        cpi1 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;          // name
+        cpi2 = frame->jc->constantPool + cpi2->NameAndType.descriptor_index - 1;    // descriptor
+
+        method->Methodref.resolvedIndex = getVirtualMethodIndex(methodLoadedClass->jc, cpi1->Utf8.symbol, cpi2->Utf8.symbol);
+
+        if (method->Methodref.resolvedIndex < 0)
+            return throwMemberError(jvm, "java/lang/NoSuchMethodError", cpi1);
     }
-    else
-    {
-        // TODO: throw NullPointerException
-        DEBUG_REPORT_INSTRUCTION_ERROR
+
+    if (!quickenInvokeInstruction(jvm, frame, opcode_invokevirtual_quick))
         return 0;
-    }
 
-    if (!mi)
-    {
-        // TODO: throw AbstractMethodError
-        DEBUG_REPORT_INSTRUCTION_ERROR
+    return instfunc_invokevirtual_quick(jvm, frame);
+}
+
+/// @brief Rewrites an invokestatic or invokespecial instruction into its quick
+/// variant, which always invokes the method found by the instruction.
+/// @return 1 if the instruction was rewritten, otherwise 0.
+static uint8_t quickenDirectInvoke(JavaVirtualMachine* jvm, Frame* frame, uint8_t quickOpcode,
+                                   LoadedClasses* methodClass, method_info* method)
+{
+    if (!quickenInvokeInstruction(jvm, frame, quickOpcode))
         return 0;
-    }
 
+    InlineCache* cache = CURRENT_INSTRUCTION->inlineCache;
+    cache->targets[0].jc = methodClass->jc;
+    cache->targets[0].method = method;
+    cache->count = 1;
+    return 1;
+}
 
-    // TODO: if the method is static, throw IncompatibleClassChangeError
+static inline uint8_t instfunc_invokespecial_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
+    VirtualMethod* target = CURRENT_INSTRUCTION->inlineCache->targets;
 
-    return runMethod(jvm, jc, mi, 1 + parameterCount);
+    // We add one to the parameter count to pop the objectref at the stack as well.
+    return runMethod(jvm, target->jc, target->method, 1 + target->method->signature.parameterSlots);
 }
 
-uint8_t instfunc_invokespecial(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_invokestatic_quick(JavaVirtualMachine* jvm, Frame* frame)
+{
+    VirtualMethod* target = CURRENT_INSTRUCTION->inlineCache->targets;
+
+    return runMethod(jvm, target->jc, target->method, target->method->signature.parameterSlots);
+}
+
+static inline uint8_t instfunc_invokespecial(JavaVirtualMachine* jvm, Frame* frame)
 {
     // Get the parameter of the instruction
-    uint16_t index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
+    uint16_t index = OPERAND1;
 
      // Get the Methodref CP entry
     cp_info* method = frame->jc->constantPool + index - 1;
@@ -2562,14 +2500,16 @@ uint8_t instfunc_invokespecial(JavaVirtualMachine* jvm, Frame* frame)
     LoadedClasses* methodLoadedClass;
 
     // Resolve the method, i.e, load the class that method belongs to
-    if (!resolveMethod(jvm, frame->jc, method, &methodLoadedClass) ||
-        !methodLoadedClass || !initClass(jvm, methodLoadedClass))
+    if (!resolveMethod(jvm, frame->jc, method, &methodLoadedClass) || !methodLoadedClass)
     {
         // TODO: throw Error
         DEBUG_REPORT_INSTRUCTION_ERROR
         return 0;
     }
 
+    if (!initClass(jvm, methodLoadedClass))
+        return 0;
+
     // Get the name of the method and its descriptor
     cpi2 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
     cpi1 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;          // name
@@ -2580,198 +2520,142 @@ uint8_t instfunc_invokespecial(JavaVirtualMachine* jvm, Frame* frame)
     // then it is necessary to lookup the super classes for that method
     if (!cmp_UTF8(UTF8(cpi1), (const uint8_t*)"<init>", 6) &&
         (frame->jc->accessFlags & ACC_SUPER) && isClassSuperOf(jvm, methodLoadedClass->jc, frame->jc))
-    {
-        JavaClass* super = getSuperClass(jvm, frame->jc);
-
-        while (super)
-        {
-            mi = getMethodMatching(super, UTF8(cpi1), UTF8(cpi2), 0);
-
-            if (mi)
-            {
-                methodLoadedClass->jc = super;
-                break;
-            }
-
-            super = getSuperClass(jvm, super);
-        }
-
-        if (!mi)
-        {
-            // TODO: throw AbstractMethodError
-            DEBUG_REPORT_INSTRUCTION_ERROR
-            return 0;
-        }
+    {
+        mi = findMethodInClassHierarchy(frame->jc->loadedClass->super, cpi1->Utf8.symbol, cpi2->Utf8.symbol,
+                                        &methodLoadedClass);
+
+        if (!mi)
+            return throwException(jvm, "java/lang/AbstractMethodError", NULL);
     }
     else
     {
-        mi = getMethodMatching(methodLoadedClass->jc, UTF8(cpi1), UTF8(cpi2), 0);
+        mi = getMethodMatchingSymbols(methodLoadedClass->jc, cpi1->Utf8.symbol, cpi2->Utf8.symbol, 0);
     }
 
     if (!mi)
-    {
-        // TODO: throw Error
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
+        return throwMemberError(jvm, "java/lang/NoSuchMethodError", cpi1);
 
-    // We add one to the parameter count to pop the objectref at the stack as well.
-    uint8_t parameterCount = 1 + getMethodDescriptorParameterCount(UTF8(cpi2));
+    // The method only depends on the class of the frame, so it
+    // is found once for each instruction
+    if (!quickenDirectInvoke(jvm, frame, opcode_invokespecial_quick, methodLoadedClass, mi))
+        return 0;
 
-    return runMethod(jvm, methodLoadedClass->jc, mi, parameterCount);
+    return instfunc_invokespecial_quick(jvm, frame);
 }
 
-uint8_t instfunc_invokestatic(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_invokestatic(JavaVirtualMachine* jvm, Frame* frame)
 {
     // Get the parameter of the instruction
-    uint16_t index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
+    uint16_t index = OPERAND1;
 
     // Get the Methodref CP entry
     cp_info* method = frame->jc->constantPool + index - 1;
-    cp_info* cpi1, *cpi2, *cpi3;
-
-    if (jvm->simulatingSystemAndStringClasses)
-    {
-        cpi1 = frame->jc->constantPool + method->Methodref.class_index - 1;
-        cpi1 = frame->jc->constantPool + cpi1->Class.name_index - 1;
-
-        cpi2 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
-        cpi2 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;
-
-        cpi3 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
-        cpi3 = frame->jc->constantPool + cpi3->NameAndType.descriptor_index - 1;
-
-        NativeFunction nativeFunc = getNative(UTF8(cpi1), UTF8(cpi2), UTF8(cpi3));
+    cp_info* cpi1, *cpi2;
 
-        if (nativeFunc)
-            return nativeFunc(jvm, frame, UTF8(cpi3));
-    }
+    if (quickenNativeInvoke(jvm, frame, method))
+        return instfunc_invokenative_quick(jvm, frame);
 
     LoadedClasses* methodLoadedClass;
 
     // Resolve the method, i.e, load the class that method belongs to
-    if (!resolveMethod(jvm, frame->jc, method, &methodLoadedClass) ||
-        !methodLoadedClass || !initClass(jvm, methodLoadedClass))
+    if (!resolveMethod(jvm, frame->jc, method, &methodLoadedClass) || !methodLoadedClass)
     {
         // TODO: throw Error
         DEBUG_REPORT_INSTRUCTION_ERROR
         return 0;
     }
 
+    if (!initClass(jvm, methodLoadedClass))
+        return 0;
+
     // Get the name of the method and its descriptor
     cpi2 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
     cpi1 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;          // name
     cpi2 = frame->jc->constantPool + cpi2->NameAndType.descriptor_index - 1;    // descriptor
 
     // Find in the method's class the field_info that matches the name and the descriptor
-    method_info* mi = getMethodMatching(methodLoadedClass->jc, UTF8(cpi1), UTF8(cpi2), 0);
+    method_info* mi = getMethodMatchingSymbols(methodLoadedClass->jc, cpi1->Utf8.symbol, cpi2->Utf8.symbol, 0);
 
     if (!mi)
-    {
-        // TODO: throw Error
-        DEBUG_REPORT_INSTRUCTION_ERROR
+        return throwMemberError(jvm, "java/lang/NoSuchMethodError", cpi1);
+
+    // The class is initialized by now, so later
+    // executions go straight to the method
+    if (!quickenDirectInvoke(jvm, frame, opcode_invokestatic_quick, methodLoadedClass, mi))
         return 0;
-    }
 
-    return runMethod(jvm, methodLoadedClass->jc, mi, getMethodDescriptorParameterCount(UTF8(cpi2)));
+    return instfunc_invokestatic_quick(jvm, frame);
 }
 
-uint8_t instfunc_invokeinterface(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_invokeinterface(JavaVirtualMachine* jvm, Frame* frame)
 {
     // Get the parameter of the instruction
-    uint16_t index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
-
-    // Skip the other two parameters
-    frame->pc += 2;
+    uint16_t index = OPERAND1;
 
      // Get the InterfaceMethodref CP entry
     cp_info* method = frame->jc->constantPool + index - 1;
     cp_info* cpi1, *cpi2;
-    method_info* mi = NULL;
-
-    LoadedClasses* methodLoadedClass;
 
-    // Resolve the method, i.e, load the class that method belongs to
-    if (!resolveMethod(jvm, frame->jc, method, &methodLoadedClass) ||
-        !methodLoadedClass || !initClass(jvm, methodLoadedClass))
+    if (method->InterfaceMethodref.resolvedIndex < 0)
     {
-        // TODO: throw Error
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
-
-    // Get the name of the method and its descriptor
-    cpi2 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
-    cpi1 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;          // name
-    cpi2 = frame->jc->constantPool + cpi2->NameAndType.descriptor_index - 1;    // descriptor
-
-    uint8_t operandIndex;
-    uint8_t parameterCount = getMethodDescriptorParameterCount(UTF8(cpi2));
-    OperandStack* node = frame->operands;
+        LoadedClasses* methodLoadedClass;
 
-    for (operandIndex = 0; operandIndex < parameterCount; operandIndex++)
-        node = node->next;
+        // Resolve the method, i.e, load the class that method belongs to
+        if (!resolveMethod(jvm, frame->jc, method, &methodLoadedClass) || !methodLoadedClass)
+        {
+            // TODO: throw Error
+            DEBUG_REPORT_INSTRUCTION_ERROR
+            return 0;
+        }
 
-    Reference* object = (Reference*)node->value;
-    JavaClass* jc = object->ci.c;
+        if (!initClass(jvm, methodLoadedClass))
+            return 0;
 
-    // TODO: check if "jc" implements interface "methodLoadedClass->jc".
-    // If not, throw IncompatibleClassChangeError.
+        // Get the name of the method and its descriptor
+        cpi2 = frame->jc->constantPool + method->Methodref.name_and_type_index - 1;
+        cpi1 = frame->jc->constantPool + cpi2->NameAndType.name_index - 1;          // name
+        cpi2 = frame->jc->constantPool + cpi2->NameAndType.descriptor_index - 1;    // descriptor
 
-    if (object)
-    {
+        // Find the method in the interface, or in one of its super interfaces
+        JavaClass* interface = methodLoadedClass->jc;
+        method_info* mi = getMethodMatchingSymbols(interface, cpi1->Utf8.symbol, cpi2->Utf8.symbol, 0);
 
-        while (jc)
+        for (index = 0; !mi && index < methodLoadedClass->jc->itableCount; index++)
         {
-            mi = getMethodMatching(jc, UTF8(cpi1), UTF8(cpi2), 0);
+            interface = methodLoadedClass->jc->itables[index].interface;
+            mi = getMethodMatchingSymbols(interface, cpi1->Utf8.symbol, cpi2->Utf8.symbol, 0);
+        }
 
-            if (mi)
-                break;
+        if (!mi)
+            return throwMemberError(jvm, "java/lang/NoSuchMethodError", cpi1);
 
-            jc = getSuperClass(jvm, jc);
-        }
-    }
-    else
-    {
-        // TODO: throw NullPointerException
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
+        if (mi->access_flags & ACC_STATIC)
+            return throwException(jvm, "java/lang/IncompatibleClassChangeError", NULL);
 
-    if (!mi || (mi->access_flags & ACC_ABSTRACT))
-    {
-        // TODO: throw AbstractMethodError
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
+        method->InterfaceMethodref.resolvedInterface = interface;
+        method->InterfaceMethodref.resolvedIndex = mi - interface->methods;
     }
 
-    if ((mi->access_flags & ACC_PUBLIC) == 0)
-    {
-        // TODO: throw IllegalAccessError
-        DEBUG_REPORT_INSTRUCTION_ERROR
+    if (!quickenInvokeInstruction(jvm, frame, opcode_invokeinterface_quick))
         return 0;
-    }
 
-    return runMethod(jvm, jc, mi, 1 + parameterCount);
+    return instfunc_invokeinterface_quick(jvm, frame);
 }
 
-uint8_t instfunc_invokedynamic(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_invokedynamic(JavaVirtualMachine* jvm, Frame* frame)
 {
     // This instruction isn't to be implemented
     DEBUG_REPORT_INSTRUCTION_ERROR
     return 0;
 }
 
-uint8_t instfunc_new(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_new(JavaVirtualMachine* jvm, Frame* frame)
 {
     uint16_t index;
     cp_info* cp;
     LoadedClasses* instanceLoadedClass;
 
-    index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
+    index = OPERAND1;
 
     // Get the name of the class of the new instance
     cp = frame->jc->constantPool + index - 1;
@@ -2790,34 +2674,37 @@ uint8_t instfunc_new(JavaVirtualMachine* jvm, Frame* frame)
 
     // TODO: check if class is interface or abstract. If so, throw InstantiationError
 
+    GC_SAFEPOINT(jvm)
+
     Reference* instance = newClassInstance(jvm, instanceLoadedClass);
 
-    if (!instance || !pushOperand(&frame->operands, (int32_t)instance, OP_REFERENCE))
+    if (!instance || !pushOperand(&frame->operands, ENCODE_REFERENCE(instance), OP_REFERENCE))
     {
-        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+        // The <clinit> method of the class may have thrown an exception
+        if (!jvm->exception && jvm->status == JVM_STATUS_OK)
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+
         return 0;
     }
 
     return 1;
 }
 
-uint8_t instfunc_newarray(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_newarray(JavaVirtualMachine* jvm, Frame* frame)
 {
-    uint8_t type = NEXT_BYTE;
+    uint8_t type = (uint8_t)OPERAND1;
     int32_t count;
 
     popOperand(&frame->operands, &count, NULL);
 
     if (count < 0)
-    {
-        // TODO: throw NegativeArraySizeException
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
+        return throwNegativeArraySize(jvm, count);
+
+    GC_SAFEPOINT(jvm)
 
     Reference* arrayref = newArray(jvm, (uint32_t)count, (Opcode_newarray_type)type);
 
-    if (!arrayref || !pushOperand(&frame->operands, (int32_t)arrayref, OP_REFERENCE))
+    if (!arrayref || !pushOperand(&frame->operands, ENCODE_REFERENCE(arrayref), OP_REFERENCE))
     {
         jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
@@ -2826,23 +2713,18 @@ uint8_t instfunc_newarray(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_anewarray(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_anewarray(JavaVirtualMachine* jvm, Frame* frame)
 {
     uint16_t index;
     int32_t count;
     cp_info* cp;
 
-    index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
+    index = OPERAND1;
 
     popOperand(&frame->operands, &count, NULL);
 
     if (count < 0)
-    {
-        // TODO: throw NegativeArraySizeException
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
+        return throwNegativeArraySize(jvm, count);
 
     cp = frame->jc->constantPool + index - 1;
     cp = frame->jc->constantPool + cp->Class.name_index - 1;
@@ -2856,9 +2738,11 @@ uint8_t instfunc_anewarray(JavaVirtualMachine* jvm, Frame* frame)
         return 0;
     }
 
-    Reference* aarray = newObjectArray(jvm, count, UTF8(cp));
+    GC_SAFEPOINT(jvm)
 
-    if (!aarray || !pushOperand(&frame->operands, (int32_t)aarray, OP_REFERENCE))
+    Reference* aarray = newComponentArray(jvm, count, UTF8(cp));
+
+    if (!aarray || !pushOperand(&frame->operands, ENCODE_REFERENCE(aarray), OP_REFERENCE))
     {
         jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
@@ -2867,21 +2751,17 @@ uint8_t instfunc_anewarray(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_arraylength(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_arraylength(JavaVirtualMachine* jvm, Frame* frame)
 {
     int32_t operand;
     Reference* object;
 
     popOperand(&frame->operands, &operand, NULL);
 
-    object = (Reference*)operand;
+    object = DECODE_REFERENCE(operand);
 
     if (!object)
-    {
-        // TODO: throw NullPointerException
-        DEBUG_REPORT_INSTRUCTION_ERROR
-        return 0;
-    }
+        return throwException(jvm, "java/lang/NullPointerException", NULL);
 
     if (object->type == REFTYPE_ARRAY)
     {
@@ -2893,7 +2773,6 @@ uint8_t instfunc_arraylength(JavaVirtualMachine* jvm, Frame* frame)
     }
     else
     {
-        // TODO: maybe throw NullPointerException ?
         DEBUG_REPORT_INSTRUCTION_ERROR
         return 0;
     }
@@ -2907,81 +2786,250 @@ uint8_t instfunc_arraylength(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_athrow(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_athrow(JavaVirtualMachine* jvm, Frame* frame)
 {
-    // TODO: implement this instruction function
-    DEBUG_REPORT_INSTRUCTION_ERROR
+    int32_t operand;
+    Reference* object;
+
+    popOperand(&frame->operands, &operand, NULL);
+
+    object = DECODE_REFERENCE(operand);
+
+    if (!object)
+        return throwException(jvm, "java/lang/NullPointerException", NULL);
+
+    // The exception is caught by this frame or by one of its callers
+    jvm->exception = object;
     return 0;
 }
 
-uint8_t instfunc_checkcast(JavaVirtualMachine* jvm, Frame* frame)
+/// @brief Result of a TypeCheckCache that wasn't computed yet.
+#define TYPE_CHECK_UNKNOWN 0xFF
+
+/// @brief Number of types of arrays of references a TypeCheckCache keeps.
+#define TYPE_CHECK_OBJECT_ARRAY_TYPES 4
+
+/// @brief Cache of a checkcast or instanceof instruction, so that its type is
+/// only resolved once and objects of the types that were already checked
+/// don't have their types compared by name again.
+struct TypeCheckCache
 {
-    // TODO: implement this instruction function
-    DEBUG_REPORT_INSTRUCTION_ERROR
-    return 0;
+    /// @brief The class or interface the instruction checks objects against,
+    /// or NULL if the type is an array type or a class simulated by the JVM,
+    /// which no class instance is an instance of.
+    JavaClass* target;
+
+    /// @brief Class of the last object that passed the check.
+    JavaClass* lastClass;
+
+    /// @brief Descriptors of the last arrays of references that were checked,
+    /// the oldest one being replaced first, and bits of the ones that passed.
+    const Symbol* objectArrayTypes[TYPE_CHECK_OBJECT_ARRAY_TYPES];
+    uint8_t passedObjectArrayTypes;
+    uint8_t nextObjectArrayType;
+
+    /// @brief Bits, indexed by Opcode_newarray_type, of the arrays of primitives
+    /// that were checked, and of the ones among them that passed the check.
+    uint16_t checkedArrayTypes;
+    uint16_t passedArrayTypes;
+
+    /// @brief Result of the check for strings, or TYPE_CHECK_UNKNOWN.
+    uint8_t stringResult;
+};
+
+/// @brief Resolves the type of the checkcast or instanceof instruction being
+/// executed, and rewrites the instruction into its quick variant.
+/// @return 1 if the type was resolved, otherwise 0.
+static uint8_t quickenTypeCheck(JavaVirtualMachine* jvm, Frame* frame, uint8_t quickOpcode)
+{
+    Instruction* instruction = CURRENT_INSTRUCTION;
+    LoadedClasses* loadedClass = NULL;
+    cp_info* cpi;
+
+    cpi = frame->jc->constantPool + OPERAND1 - 1;
+    cpi = frame->jc->constantPool + cpi->Class.name_index - 1;
+
+    if (!resolveClass(jvm, UTF8(cpi), &loadedClass))
+    {
+        // TODO: throw a resolution exception
+        // Could be LinkageError, NoClassDefFoundError or IllegalAccessError
+        DEBUG_REPORT_INSTRUCTION_ERROR
+        return 0;
+    }
+
+    TypeCheckCache* cache = (TypeCheckCache*)malloc(sizeof(TypeCheckCache));
+
+    if (!cache)
+    {
+        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+        return 0;
+    }
+
+    // Arrays and simulated classes aren't loaded
+    cache->target = loadedClass && *cpi->Utf8.bytes != '[' ? loadedClass->jc : NULL;
+    cache->lastClass = NULL;
+    memset(cache->objectArrayTypes, 0, sizeof(cache->objectArrayTypes));
+    cache->passedObjectArrayTypes = 0;
+    cache->nextObjectArrayType = 0;
+    cache->checkedArrayTypes = 0;
+    cache->passedArrayTypes = 0;
+    cache->stringResult = TYPE_CHECK_UNKNOWN;
+    instruction->typeCheckCache = cache;
+    instruction->opcode = quickOpcode;
+    return 1;
 }
 
-uint8_t instfunc_instanceof(JavaVirtualMachine* jvm, Frame* frame)
+/// @brief Checks if an object is an instance of the type of the
+/// checkcast or instanceof instruction being executed.
+/// @param Reference* object - the object, which can't be null.
+///
+/// Class instances are checked with isClassAssignableTo(). Other objects are
+/// checked by name with isObjectInstanceOf() the first time an object of their
+/// type is found, and the result is kept in the cache of the instruction.
+///
+/// @return 1 if the object is an instance of the type, otherwise 0.
+static uint8_t checkObjectType(JavaVirtualMachine* jvm, Frame* frame, Reference* object)
 {
-    // TODO: implement this instruction function
-    DEBUG_REPORT_INSTRUCTION_ERROR
-    return 0;
+    TypeCheckCache* cache = CURRENT_INSTRUCTION->typeCheckCache;
+    const Symbol* type;
+    uint16_t typeBit;
+    uint8_t index, result;
+    cp_info* cpi;
+
+    if (object->type == REFTYPE_CLASSINSTANCE)
+    {
+        if (!cache->target)
+            return 0;
+
+        if (object->ci.c == cache->lastClass)
+            return 1;
+
+        if (!isClassAssignableTo(object->ci.c, cache->target))
+            return 0;
+
+        cache->lastClass = object->ci.c;
+        return 1;
+    }
+
+    cpi = frame->jc->constantPool + OPERAND1 - 1;
+    cpi = frame->jc->constantPool + cpi->Class.name_index - 1;
+
+    switch (object->type)
+    {
+        case REFTYPE_STRING:
+
+            if (cache->stringResult == TYPE_CHECK_UNKNOWN)
+                cache->stringResult = isObjectInstanceOf(jvm, object, UTF8(cpi));
+
+            return cache->stringResult;
+
+        case REFTYPE_ARRAY:
+
+            typeBit = 1u << object->arr.type;
+
+            if (!(cache->checkedArrayTypes & typeBit))
+            {
+                if (isObjectInstanceOf(jvm, object, UTF8(cpi)))
+                    cache->passedArrayTypes |= typeBit;
+
+                cache->checkedArrayTypes |= typeBit;
+            }
+
+            return (cache->passedArrayTypes & typeBit) != 0;
+
+        case REFTYPE_OBJARRAY:
+
+            for (index = 0; index < TYPE_CHECK_OBJECT_ARRAY_TYPES; index++)
+            {
+                type = cache->objectArrayTypes[index];
+
+                if (type && type->length == object->oar.utf8_len &&
+                    !memcmp(type->bytes, OBJECT_ARRAY_CLASS_NAME(object), type->length))
+                {
+                    return (cache->passedObjectArrayTypes >> index) & 1;
+                }
+            }
+
+            result = isObjectInstanceOf(jvm, object, UTF8(cpi));
+            type = internSymbol(OBJECT_ARRAY_CLASS_NAME(object), object->oar.utf8_len);
+
+            // If the symbol can't be created, the next array is checked by name again
+            if (type)
+            {
+                index = cache->nextObjectArrayType;
+                cache->nextObjectArrayType = (index + 1) % TYPE_CHECK_OBJECT_ARRAY_TYPES;
+                cache->objectArrayTypes[index] = type;
+                cache->passedObjectArrayTypes &= ~(1u << index);
+                cache->passedObjectArrayTypes |= result << index;
+            }
+
+            return result;
+
+        default:
+            return isObjectInstanceOf(jvm, object, UTF8(cpi));
+    }
 }
 
-uint8_t instfunc_monitorenter(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_checkcast_quick(JavaVirtualMachine* jvm, Frame* frame)
 {
-    // This instruction isn't to be implemented
+    Reference* object = DECODE_REFERENCE(frame->operands.values[frame->operands.top - 1]);
+
+    // A null reference can be cast to any type
+    if (object && !checkObjectType(jvm, frame, object))
+        return throwException(jvm, "java/lang/ClassCastException", NULL);
+
     return 1;
 }
 
-uint8_t instfunc_monitorexit(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_instanceof_quick(JavaVirtualMachine* jvm, Frame* frame)
 {
-    // This instruction isn't to be implemented
-    return 1;
+    int32_t operand;
+    Reference* object;
+
+    popOperand(&frame->operands, &operand, NULL);
+    object = DECODE_REFERENCE(operand);
+
+    return pushOperand(&frame->operands, object && checkObjectType(jvm, frame, object), OP_INTEGER);
 }
 
-uint8_t instfunc_wide(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_checkcast(JavaVirtualMachine* jvm, Frame* frame)
 {
-    uint8_t opcode = NEXT_BYTE;
-    uint8_t index;
+    if (!quickenTypeCheck(jvm, frame, opcode_checkcast_quick))
+        return 0;
 
-    if (opcode >= opcode_iload && opcode <= opcode_lload)
-        index = opcode - opcode_iload;
-    else if (opcode >= opcode_istore || opcode <= opcode_astore)
-        index = 5 + opcode - opcode_istore;
-    else if (opcode == opcode_ret)
-        index = 10;
-    else if (opcode == opcode_iinc)
-        index = 11;
-    else
-    {
-        // trying to wide an instruction that can't
-        // be widened.
-        DEBUG_REPORT_INSTRUCTION_ERROR
+    return instfunc_checkcast_quick(jvm, frame);
+}
+
+static inline uint8_t instfunc_instanceof(JavaVirtualMachine* jvm, Frame* frame)
+{
+    if (!quickenTypeCheck(jvm, frame, opcode_instanceof_quick))
         return 0;
-    }
 
-    const InstructionFunction funcs[] = {
-        instfunc_wide_iload, instfunc_wide_lload, instfunc_wide_fload,
-        instfunc_wide_dload, instfunc_wide_aload, instfunc_wide_istore,
-        instfunc_wide_lstore, instfunc_wide_fstore, instfunc_wide_dstore,
-        instfunc_wide_dstore, instfunc_wide_ret, instfunc_wide_iinc
-    };
+    return instfunc_instanceof_quick(jvm, frame);
+}
+
+static inline uint8_t instfunc_monitorenter(JavaVirtualMachine* jvm, Frame* frame)
+{
+    // This instruction isn't to be implemented
+    return 1;
+}
 
-    return funcs[index](jvm, frame);
+static inline uint8_t instfunc_monitorexit(JavaVirtualMachine* jvm, Frame* frame)
+{
+    // This instruction isn't to be implemented
+    return 1;
 }
 
-uint8_t instfunc_multianewarray(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_multianewarray(JavaVirtualMachine* jvm, Frame* frame)
 {
     uint16_t index;
     uint8_t numberOfDimensions;
     int32_t* dimensions;
     cp_info* cp;
 
-    index = NEXT_BYTE;
-    index = (index << 8) | NEXT_BYTE;
+    index = OPERAND1;
 
-    numberOfDimensions = NEXT_BYTE;
+    numberOfDimensions = (uint8_t)OPERAND2;
     dimensions = (int32_t*)malloc(sizeof(int32_t) * numberOfDimensions);
 
     if (!dimensions)
@@ -2998,10 +3046,9 @@ uint8_t instfunc_multianewarray(JavaVirtualMachine* jvm, Frame* frame)
 
         if (dimensions[dimensionIndex] < 0)
         {
-            // TODO: throw NegativeArraySizeException
-            DEBUG_REPORT_INSTRUCTION_ERROR
+            int32_t count = dimensions[dimensionIndex];
             free(dimensions);
-            return 0;
+            return throwNegativeArraySize(jvm, count);
         }
         else if (dimensions[dimensionIndex] == 0)
         {
@@ -3027,9 +3074,11 @@ uint8_t instfunc_multianewarray(JavaVirtualMachine* jvm, Frame* frame)
         return 0;
     }
 
+    GC_SAFEPOINT(jvm)
+
     Reference* aarray = newObjectMultiArray(jvm, dimensions, numberOfDimensions, UTF8(cp));
 
-    if (!aarray || !pushOperand(&frame->operands, (int32_t)aarray, OP_REFERENCE))
+    if (!aarray || !pushOperand(&frame->operands, ENCODE_REFERENCE(aarray), OP_REFERENCE))
     {
         free(dimensions);
         jvm->status = JVM_STATUS_OUT_OF_MEMORY;
@@ -3040,62 +3089,134 @@ uint8_t instfunc_multianewarray(JavaVirtualMachine* jvm, Frame* frame)
     return 1;
 }
 
-uint8_t instfunc_ifnull(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_ifnull(JavaVirtualMachine* jvm, Frame* frame)
 {
-    int16_t branch = NEXT_BYTE;
-    branch = (branch << 8) | NEXT_BYTE;
-
     int32_t address;
 
     popOperand(&frame->operands, &address, NULL);
 
     if (!address)
-        frame->pc += branch - 3;
+        frame->pc = OPERAND1;
 
     return 1;
 }
 
-uint8_t instfunc_ifnonnull(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_ifnonnull(JavaVirtualMachine* jvm, Frame* frame)
 {
-    int16_t branch = NEXT_BYTE;
-    branch = (branch << 8) | NEXT_BYTE;
-
     int32_t address;
 
     popOperand(&frame->operands, &address, NULL);
 
     if (address)
-        frame->pc += branch - 3;
+        frame->pc = OPERAND1;
 
     return 1;
 }
 
-uint8_t instfunc_goto_w(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_goto_w(JavaVirtualMachine* jvm, Frame* frame)
 {
-    int32_t offset = NEXT_BYTE;
-    offset = (offset << 8) | NEXT_BYTE;
-    offset = (offset << 8) | NEXT_BYTE;
-    offset = (offset << 8) | NEXT_BYTE;
-    frame->pc += offset - 5;
+    frame->pc = OPERAND1;
     return 1;
 }
 
-uint8_t instfunc_jsr_w(JavaVirtualMachine* jvm, Frame* frame)
+static inline uint8_t instfunc_jsr_w(JavaVirtualMachine* jvm, Frame* frame)
 {
-    int32_t offset = NEXT_BYTE;
-    offset = (offset << 8) | NEXT_BYTE;
-    offset = (offset << 8) | NEXT_BYTE;
-    offset = (offset << 8) | NEXT_BYTE;
-
     if (!pushOperand(&frame->operands, (int32_t)frame->pc, OP_RETURNADDRESS))
     {
         jvm->status = JVM_STATUS_OUT_OF_MEMORY;
         return 0;
     }
 
-    frame->pc += offset - 5;
-    return 1;
-}
+    frame->pc = OPERAND1;
+    return 1;
+}
+
+/// @brief List of all instructions that have an instruction function,
+/// used to generate the opcode table and the dispatch loop.
+/// For each instruction, \c X(name) will be expanded, where
+/// \c opcode_name is the opcode of the instruction and
+/// \c instfunc_name is its instruction function.
+#define INSTRUCTION_LIST(X) \
+    X(nop) X(aconst_null) X(iconst_m1) \
+    X(iconst_0) X(iconst_1) X(iconst_2) \
+    X(iconst_3) X(iconst_4) X(iconst_5) \
+    X(lconst_0) X(lconst_1) X(fconst_0) \
+    X(fconst_1) X(fconst_2) X(dconst_0) \
+    X(dconst_1) X(bipush) X(sipush) \
+    X(ldc) X(ldc_w) X(ldc2_w) \
+    X(iload) X(lload) X(fload) \
+    X(dload) X(aload) X(iload_0) \
+    X(iload_1) X(iload_2) X(iload_3) \
+    X(lload_0) X(lload_1) X(lload_2) \
+    X(lload_3) X(fload_0) X(fload_1) \
+    X(fload_2) X(fload_3) X(dload_0) \
+    X(dload_1) X(dload_2) X(dload_3) \
+    X(aload_0) X(aload_1) X(aload_2) \
+    X(aload_3) X(iaload) X(laload) \
+    X(faload) X(daload) X(aaload) \
+    X(baload) X(caload) X(saload) \
+    X(istore) X(lstore) X(fstore) \
+    X(dstore) X(astore) X(istore_0) \
+    X(istore_1) X(istore_2) X(istore_3) \
+    X(lstore_0) X(lstore_1) X(lstore_2) \
+    X(lstore_3) X(fstore_0) X(fstore_1) \
+    X(fstore_2) X(fstore_3) X(dstore_0) \
+    X(dstore_1) X(dstore_2) X(dstore_3) \
+    X(astore_0) X(astore_1) X(astore_2) \
+    X(astore_3) X(iastore) X(lastore) \
+    X(fastore) X(dastore) X(aastore) \
+    X(bastore) X(castore) X(sastore) \
+    X(pop) X(pop2) X(dup) \
+    X(dup_x1) X(dup_x2) X(dup2) \
+    X(dup2_x1) X(dup2_x2) X(swap) \
+    X(iadd) X(ladd) X(fadd) \
+    X(dadd) X(isub) X(lsub) \
+    X(fsub) X(dsub) X(imul) \
+    X(lmul) X(fmul) X(dmul) \
+    X(idiv) X(ldiv) X(fdiv) \
+    X(ddiv) X(irem) X(lrem) \
+    X(frem) X(drem) X(ineg) \
+    X(lneg) X(fneg) X(dneg) \
+    X(ishl) X(lshl) X(ishr) \
+    X(lshr) X(iushr) X(lushr) \
+    X(iand) X(land) X(ior) \
+    X(lor) X(ixor) X(lxor) \
+    X(iinc) X(i2l) X(i2f) \
+    X(i2d) X(l2i) X(l2f) \
+    X(l2d) X(f2i) X(f2l) \
+    X(f2d) X(d2i) X(d2l) \
+    X(d2f) X(i2b) X(i2c) \
+    X(i2s) X(lcmp) X(fcmpl) \
+    X(fcmpg) X(dcmpl) X(dcmpg) \
+    X(ifeq) X(ifne) X(iflt) \
+    X(ifge) X(ifgt) X(ifle) \
+    X(if_icmpeq) X(if_icmpne) X(if_icmplt) \
+    X(if_icmpge) X(if_icmpgt) X(if_icmple) \
+    X(if_acmpeq) X(if_acmpne) X(goto) \
+    X(jsr) X(ret) X(tableswitch) \
+    X(lookupswitch) X(ireturn) X(lreturn) \
+    X(freturn) X(dreturn) X(areturn) \
+    X(return) X(getstatic) X(putstatic) \
+    X(getfield) X(putfield) X(invokevirtual) \
+    X(invokespecial) X(invokestatic) X(invokeinterface) \
+    X(invokedynamic) X(new) X(newarray) \
+    X(anewarray) X(arraylength) X(athrow) \
+    X(checkcast) X(instanceof) X(monitorenter) \
+    X(monitorexit) X(multianewarray) \
+    X(ifnull) X(ifnonnull) X(goto_w) \
+    X(jsr_w) X(getstatic_quick) X(getstatic2_quick) \
+    X(putstatic_quick) X(putstatic2_quick) X(getfield_quick) \
+    X(getfield2_quick) X(putfield_quick) X(putfield2_quick) \
+    X(invokevirtual_quick) X(invokeinterface_quick) X(invokenative_quick) \
+    X(invokestatic_quick) X(invokespecial_quick) X(checkcast_quick) \
+    X(instanceof_quick)
+
+#define OPCODE_FUNCTION_ENTRY(instruction) [opcode_##instruction] = instfunc_##instruction,
+
+/// @brief Table of instruction functions indexed by opcode.
+static const InstructionFunction opcodeFunctions[256] = {
+    INSTRUCTION_LIST(OPCODE_FUNCTION_ENTRY)
+};
 
 /// @brief Retrieves the instruction function for a given
 /// instruction opcode.
@@ -3105,79 +3226,197 @@ uint8_t instfunc_jsr_w(JavaVirtualMachine* jvm, Frame* frame)
 /// @see Opcodes, getOpcodeMnemonic()
 InstructionFunction fetchOpcodeFunction(uint8_t opcode)
 {
-    const InstructionFunction opcodeFunctions[202] = {
-        instfunc_nop, instfunc_aconst_null, instfunc_iconst_m1,
-        instfunc_iconst_0, instfunc_iconst_1, instfunc_iconst_2,
-        instfunc_iconst_3, instfunc_iconst_4, instfunc_iconst_5,
-        instfunc_lconst_0, instfunc_lconst_1, instfunc_fconst_0,
-        instfunc_fconst_1, instfunc_fconst_2, instfunc_dconst_0,
-        instfunc_dconst_1, instfunc_bipush, instfunc_sipush,
-        instfunc_ldc, instfunc_ldc_w, instfunc_ldc2_w,
-        instfunc_iload, instfunc_lload, instfunc_fload,
-        instfunc_dload, instfunc_aload, instfunc_iload_0,
-        instfunc_iload_1, instfunc_iload_2, instfunc_iload_3,
-        instfunc_lload_0, instfunc_lload_1, instfunc_lload_2,
-        instfunc_lload_3, instfunc_fload_0, instfunc_fload_1,
-        instfunc_fload_2, instfunc_fload_3, instfunc_dload_0,
-        instfunc_dload_1, instfunc_dload_2, instfunc_dload_3,
-        instfunc_aload_0, instfunc_aload_1, instfunc_aload_2,
-        instfunc_aload_3, instfunc_iaload, instfunc_laload,
-        instfunc_faload, instfunc_daload, instfunc_aaload,
-        instfunc_baload, instfunc_caload, instfunc_saload,
-        instfunc_istore, instfunc_lstore, instfunc_fstore,
-        instfunc_dstore, instfunc_astore, instfunc_istore_0,
-        instfunc_istore_1, instfunc_istore_2, instfunc_istore_3,
-        instfunc_lstore_0, instfunc_lstore_1, instfunc_lstore_2,
-        instfunc_lstore_3, instfunc_fstore_0, instfunc_fstore_1,
-        instfunc_fstore_2, instfunc_fstore_3, instfunc_dstore_0,
-        instfunc_dstore_1, instfunc_dstore_2, instfunc_dstore_3,
-        instfunc_astore_0, instfunc_astore_1, instfunc_astore_2,
-        instfunc_astore_3, instfunc_iastore, instfunc_lastore,
-        instfunc_fastore, instfunc_dastore, instfunc_aastore,
-        instfunc_bastore, instfunc_castore, instfunc_sastore,
-        instfunc_pop, instfunc_pop2, instfunc_dup,
-        instfunc_dup_x1, instfunc_dup_x2, instfunc_dup2,
-        instfunc_dup2_x1, instfunc_dup2_x2, instfunc_swap,
-        instfunc_iadd, instfunc_ladd, instfunc_fadd,
-        instfunc_dadd, instfunc_isub, instfunc_lsub,
-        instfunc_fsub, instfunc_dsub, instfunc_imul,
-        instfunc_lmul, instfunc_fmul, instfunc_dmul,
-        instfunc_idiv, instfunc_ldiv, instfunc_fdiv,
-        instfunc_ddiv, instfunc_irem, instfunc_lrem,
-        instfunc_frem, instfunc_drem, instfunc_ineg,
-        instfunc_lneg, instfunc_fneg, instfunc_dneg,
-        instfunc_ishl, instfunc_lshl, instfunc_ishr,
-        instfunc_lshr, instfunc_iushr, instfunc_lushr,
-        instfunc_iand, instfunc_land, instfunc_ior,
-        instfunc_lor, instfunc_ixor, instfunc_lxor,
-        instfunc_iinc, instfunc_i2l, instfunc_i2f,
-        instfunc_i2d, instfunc_l2i, instfunc_l2f,
-        instfunc_l2d, instfunc_f2i, instfunc_f2l,
-        instfunc_f2d, instfunc_d2i, instfunc_d2l,
-        instfunc_d2f, instfunc_i2b, instfunc_i2c,
-        instfunc_i2s, instfunc_lcmp, instfunc_fcmpl,
-        instfunc_fcmpg, instfunc_dcmpl, instfunc_dcmpg,
-        instfunc_ifeq, instfunc_ifne, instfunc_iflt,
-        instfunc_ifge, instfunc_ifgt, instfunc_ifle,
-        instfunc_if_icmpeq, instfunc_if_icmpne, instfunc_if_icmplt,
-        instfunc_if_icmpge, instfunc_if_icmpgt, instfunc_if_icmple,
-        instfunc_if_acmpeq, instfunc_if_acmpne, instfunc_goto,
-        instfunc_jsr, instfunc_ret, instfunc_tableswitch,
-        instfunc_lookupswitch, instfunc_ireturn, instfunc_lreturn,
-        instfunc_freturn, instfunc_dreturn, instfunc_areturn,
-        instfunc_return, instfunc_getstatic, instfunc_putstatic,
-        instfunc_getfield, instfunc_putfield, instfunc_invokevirtual,
-        instfunc_invokespecial, instfunc_invokestatic, instfunc_invokeinterface,
-        instfunc_invokedynamic, instfunc_new, instfunc_newarray,
-        instfunc_anewarray, instfunc_arraylength, instfunc_athrow,
-        instfunc_checkcast, instfunc_instanceof, instfunc_monitorenter,
-        instfunc_monitorexit, instfunc_wide, instfunc_multianewarray,
-        instfunc_ifnull, instfunc_ifnonnull, instfunc_goto_w,
-        instfunc_jsr_w
+    return opcodeFunctions[opcode];
+}
+
+// The dispatch loop uses GCC's labels as values (computed goto) when
+// available, so that each instruction jumps directly to the next one.
+// Defining SWITCH_DISPATCH at build time selects the portable
+// switch-based loop instead.
+#if defined(__GNUC__) && !defined(SWITCH_DISPATCH)
+#define THREADED_DISPATCH
+#endif
+
+#ifdef DEBUG
+#define DEBUG_TRACE_INSTRUCTION \
+    printf("\n"); \
+    debugPrintOperandStack(&frame->operands); \
+    debugPrintLocalVariables(frame->localVariables, frame->max_locals); \
+    printf("   instruction '%s' at offset %u of frame %d\n", getOpcodeMnemonic(frame->instructions[frame->pc].opcode), frame->instructions[frame->pc].offset, debugGetFrameId(frame));
+#else
+#define DEBUG_TRACE_INSTRUCTION
+#endif // DEBUG
+
+/// @brief Executes the bytecode of a frame like executeFrame(), charging
+/// each instruction to the profiler of the JVM, taking the samples
+/// requested by its sampler and printing the heap histograms requested
+/// to its allocation profiler, if they are set.
+/// @see chargeProfileTicks(), takeSample(), takeHeapHistogram()
+static uint8_t executeInstrumentedFrame(JavaVirtualMachine* jvm, Frame* frame)
+{
+    Profiler* profiler = jvm->profiler;
+    Sampler* sampler = jvm->sampler;
+    AllocationProfiler* allocationProfiler = jvm->allocationProfiler;
+    HeapHistogram histogram;
+    MethodProfile* method = NULL;
+    InstructionFunction function;
+    uint8_t opcode;
+
+    if (profiler)
+    {
+        cp_info* className = frame->jc->constantPool + frame->jc->thisClass - 1;
+        className = frame->jc->constantPool + className->Class.name_index - 1;
+
+        method = getMethodProfile(profiler, className->Utf8.symbol,
+                                  frame->jc->constantPool[frame->method->name_index - 1].Utf8.symbol,
+                                  frame->jc->constantPool[frame->method->descriptor_index - 1].Utf8.symbol, 0);
+
+        if (!method)
+        {
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+            return 0;
+        }
+
+        method->invocations++;
+    }
+
+    while (frame->pc < frame->instructionCount)
+    {
+        DEBUG_TRACE_INSTRUCTION
+        opcode = frame->instructions[frame->pc++].opcode;
+        function = opcodeFunctions[opcode];
+        jvm->executedInstructions++;
+
+        if (!function)
+        {
+
+#ifdef DEBUG
+    printf("   unknown instruction '%s'\n", getOpcodeMnemonic(opcode));
+#endif // DEBUG
+
+            jvm->status = JVM_STATUS_UNKNOWN_INSTRUCTION;
+            return 1;
+        }
+
+        // The frame is consistent here, with its pc after the instruction
+        if (sampler && SAMPLE_DUE(sampler) && !takeSample(sampler, &jvm->frames))
+        {
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+            return 0;
+        }
+
+        // Between instructions, all references are in frames, so garbage can be collected
+        if (allocationProfiler && allocationProfiler->histogramRequested)
+        {
+            if (!takeHeapHistogram(jvm, &histogram))
+            {
+                jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+                return 0;
+            }
+
+            printHeapHistogram(&histogram);
+            freeHeapHistogram(&histogram);
+        }
+
+        // Instructions that invoke methods charge them in turn, so the
+        // time of the method is charged back to it by the next instruction
+        if (profiler)
+        {
+            method->instructions++;
+            chargeProfileTicks(profiler, method, profiler->opcodes + opcode);
+        }
+
+        if (!function(jvm, frame) && !catchException(jvm, frame))
+            return 0;
+    }
+
+    return 1;
+}
+
+/// @brief Executes the bytecode of a frame until the end of its code is reached.
+/// @param JavaVirtualMachine* jvm - pointer to the JVM structure that is running.
+/// @param Frame* frame - the frame whose code will be executed.
+///
+/// Decoded instructions are fetched one by one, starting at the current pc of the frame,
+/// and their instruction functions are called. If an unknown instruction is found,
+/// the status of the JVM is set to JVM_STATUS_UNKNOWN_INSTRUCTION and execution stops.
+/// When an instruction fails because it threw an exception, or because a method it
+/// invoked did, execution continues at the handler of the frame that catches it, if any.
+///
+/// With a profiler, a sampler or an allocation profiler, the frame is run by a slower
+/// loop that measures each instruction, takes samples or prints heap histograms when
+/// requested, see @ref profiler, @ref sampler and @ref allocprofiler.
+///
+/// @return Will return 0 if one of the instruction functions failed and no handler of
+/// the frame caught its exception, otherwise 1.
+/// @see runMethod(), fetchOpcodeFunction()
+uint8_t executeFrame(JavaVirtualMachine* jvm, Frame* frame)
+{
+    uint8_t opcode;
+
+    if (jvm->profiler || jvm->sampler || jvm->allocationProfiler)
+        return executeInstrumentedFrame(jvm, frame);
+
+#ifdef THREADED_DISPATCH
+
+#define DISPATCH_LABEL_ENTRY(instruction) [opcode_##instruction] = &&label_##instruction,
+
+    static const void* dispatchTable[256] = {
+        [0 ... 255] = &&label_unknown,
+        INSTRUCTION_LIST(DISPATCH_LABEL_ENTRY)
     };
 
-    if (opcode > 201)
-        return NULL;
+#define DISPATCH_NEXT \
+    if (frame->pc >= frame->instructionCount) \
+        return 1; \
+    DEBUG_TRACE_INSTRUCTION \
+    opcode = frame->instructions[frame->pc++].opcode; \
+    jvm->executedInstructions++; \
+    goto *dispatchTable[opcode];
+
+#define DISPATCH_LABEL(instruction) \
+    label_##instruction: \
+        if (!instfunc_##instruction(jvm, frame) && !catchException(jvm, frame)) \
+            return 0; \
+        DISPATCH_NEXT
 
-    return opcodeFunctions[opcode];
+    DISPATCH_NEXT
+    INSTRUCTION_LIST(DISPATCH_LABEL)
+
+label_unknown:
+
+#else
+
+#define DISPATCH_CASE(instruction) \
+    case opcode_##instruction: \
+        if (!instfunc_##instruction(jvm, frame) && !catchException(jvm, frame)) \
+            return 0; \
+        continue;
+
+    while (frame->pc < frame->instructionCount)
+    {
+        DEBUG_TRACE_INSTRUCTION
+        opcode = frame->instructions[frame->pc++].opcode;
+        jvm->executedInstructions++;
+
+        switch (opcode)
+        {
+            INSTRUCTION_LIST(DISPATCH_CASE)
+            default:
+                goto label_unknown;
+        }
+    }
+
+    return 1;
+
+label_unknown:
+
+#endif // THREADED_DISPATCH
+
+#ifdef DEBUG
+    printf("   unknown instruction '%s'\n", getOpcodeMnemonic(opcode));
+#endif // DEBUG
+
+    jvm->status = JVM_STATUS_UNKNOWN_INSTRUCTION;
+    return 1;
 }
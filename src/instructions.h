@@ -9,5 +9,6 @@
 typedef uint8_t (*InstructionFunction)(JavaVirtualMachine* jvm, Frame* currentFrame);
 
 InstructionFunction fetchOpcodeFunction(uint8_t opcode);
+uint8_t executeFrame(JavaVirtualMachine* jvm, Frame* frame);
 
 #endif // INSTRUCTIONS_H
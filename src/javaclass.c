@@ -1,40 +1,43 @@
+// Needed for the POSIX file functions in strict C99 mode
+#define _DEFAULT_SOURCE
+
+#include <string.h>
 #include "readfunctions.h"
 #include "javaclass.h"
 #include "constantpool.h"
 #include "utf8.h"
 #include "validity.h"
+#include "archive.h"
 #include "debugging.h"
 
-/// @brief Opens a class file and parse it, storing the class
-/// information in the JavaClass structure.
-/// @param JavaClass* jc - pointer to the structure that will
-/// hold the class data
-/// @param const char* path - string containing the path to the
-/// class file to be read
-///
-/// This function opens the .class file and reads its content
-/// from the file by filling in the fields of the JavaClass struct.
-/// A bunch of other functions from different modules are called
-/// to read some pieces of the class file. Various checks are made
-/// during the parsing of the read data.
-///
-/// @see closeClassFile, printClassFileInfo(), printClassFileDebugInfo()
-/// @hidecallergraph
-void openClassFile(JavaClass* jc, const char* path)
-{
-    if (!jc)
-        return;
+/// @brief Class files at least this large are mapped to memory. Smaller ones
+/// are read to a buffer, which is cheaper than setting up and tearing down a mapping.
+#define CLASS_FILE_MAP_THRESHOLD (64 * 1024)
 
-    uint32_t u32;
-    uint16_t u16;
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
 
-    jc->file = fopen(path, "rb");
+/// @brief Resets all fields of a JavaClass, before its data is parsed.
+static void initJavaClass(JavaClass* jc, enum ClassParseMode mode)
+{
+    jc->fileData = NULL;
+    jc->fileSize = 0;
+    jc->dataSource = CLASS_DATA_BORROWED;
+    jc->parseMode = mode;
     jc->minorVersion = jc->majorVersion = jc->constantPoolCount = 0;
     jc->constantPool = NULL;
     jc->interfaces = NULL;
     jc->fields = NULL;
     jc->methods = NULL;
     jc->attributes = NULL;
+    jc->methodTable = NULL;
+    jc->methodTableCapacity = 0;
+    jc->fieldTable = NULL;
+    jc->fieldTableCapacity = 0;
     jc->status = CLASS_STATUS_OK;
     jc->classNameMismatch = 0;
 
@@ -44,6 +47,17 @@ void openClassFile(JavaClass* jc, const char* path)
     jc->staticFieldCount = 0;
     jc->instanceFieldCount = 0;
 
+    jc->vtable = NULL;
+    jc->vtableLength = 0;
+    jc->itables = NULL;
+    jc->itableCount = 0;
+    jc->supers = NULL;
+    jc->superDepth = 0;
+    jc->interfaceId = 0;
+    jc->interfaceBits = NULL;
+    jc->interfaceBitWords = 0;
+    jc->loadedClass = NULL;
+
     jc->lastTagRead = 0;
     jc->totalBytesRead = 0;
     jc->constantPoolEntriesRead = 0;
@@ -53,13 +67,156 @@ void openClassFile(JavaClass* jc, const char* path)
     jc->fieldEntriesRead = 0;
     jc->methodEntriesRead = 0;
     jc->validityEntriesChecked = 0;
+}
+
+/// @brief Reads the whole content of a file to a buffer allocated with malloc().
+/// @return 0 if the file couldn't be read, otherwise 1.
+static uint8_t readClassFileData(JavaClass* jc, const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    uint8_t* data = NULL;
+    size_t size = 0, capacity = 0, bytesRead;
 
-    if (!jc->file)
+    if (!file)
+        return 0;
+
+    // The size isn't known beforehand for files that aren't regular
+    do
     {
-        jc->status = CLASS_STATUS_FILE_COULDNT_BE_OPENED;
-        return;
+        if (size == capacity)
+        {
+            uint8_t* newData;
+
+            capacity = capacity ? 2 * capacity : 4096;
+            newData = capacity <= UINT32_MAX ? (uint8_t*)malloc(capacity) : NULL;
+
+            if (!newData)
+            {
+                if (data)
+                    free(data);
+
+                fclose(file);
+                return 0;
+            }
+
+            if (data)
+            {
+                memcpy(newData, data, size);
+                free(data);
+            }
+
+            data = newData;
+        }
+
+        bytesRead = fread(data + size, 1, capacity - size, file);
+        size += bytesRead;
+    } while (bytesRead > 0);
+
+    fclose(file);
+
+    jc->fileData = data;
+    jc->fileSize = (uint32_t)size;
+    jc->dataSource = CLASS_DATA_ALLOCATED;
+    return 1;
+}
+
+/// @brief Makes the content of a class file available to the parser. Large
+/// regular files are mapped to memory, other files are read to a buffer.
+/// @return 0 if the file couldn't be opened, otherwise 1.
+static uint8_t loadClassFileData(JavaClass* jc, const char* path)
+{
+#ifndef _WIN32
+    struct stat st;
+    void* data;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return 0;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+    {
+        if (st.st_size == 0 || (uint64_t)st.st_size > UINT32_MAX)
+        {
+            // An empty file is left to fail at the signature check
+            close(fd);
+            return st.st_size == 0;
+        }
+
+        if (st.st_size < CLASS_FILE_MAP_THRESHOLD)
+        {
+            uint8_t* buffer = (uint8_t*)malloc((size_t)st.st_size);
+            size_t size = 0;
+            ssize_t bytesRead = 1;
+
+            while (buffer && size < (size_t)st.st_size && bytesRead > 0)
+            {
+                bytesRead = read(fd, buffer + size, (size_t)st.st_size - size);
+                size += bytesRead > 0 ? (size_t)bytesRead : 0;
+            }
+
+            close(fd);
+
+            if (!buffer)
+                return 0;
+
+            jc->fileData = buffer;
+            jc->fileSize = (uint32_t)size;
+            jc->dataSource = CLASS_DATA_ALLOCATED;
+            return 1;
+        }
+
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data != MAP_FAILED)
+        {
+            close(fd);
+            jc->fileData = (const uint8_t*)data;
+            jc->fileSize = (uint32_t)st.st_size;
+            jc->dataSource = CLASS_DATA_MAPPED;
+            return 1;
+        }
+    }
+
+    close(fd);
+#endif
+
+    return readClassFileData(jc, path);
+}
+
+/// @brief Releases the class file data, if it is owned by the class.
+static void releaseClassData(JavaClass* jc)
+{
+    switch (jc->dataSource)
+    {
+        case CLASS_DATA_ALLOCATED:
+            free((void*)jc->fileData);
+            break;
+
+#ifndef _WIN32
+        case CLASS_DATA_MAPPED:
+            munmap((void*)jc->fileData, jc->fileSize);
+            break;
+#endif
+
+        default:
+            break;
     }
 
+    jc->fileData = NULL;
+    jc->fileSize = 0;
+    jc->dataSource = CLASS_DATA_BORROWED;
+}
+
+/// @brief Parses the class file data of a JavaClass, filling
+/// in the rest of its fields.
+/// @param JavaClass* jc - class whose \c fileData will be parsed
+/// @param const char* path - path of the class file, compared with
+/// the name of the class
+static void parseClassData(JavaClass* jc, const char* path)
+{
+    uint32_t u32;
+    uint16_t u16;
+
     if (!readu4(jc, &u32) || u32 != 0xCAFEBABE)
     {
         jc->status = CLASS_STATUS_INVALID_SIGNATURE;
@@ -210,6 +367,12 @@ void openClassFile(JavaClass* jc, const char* path)
 
             jc->fieldEntriesRead++;
         }
+
+        if (!buildFieldTable(jc))
+        {
+            jc->status = MEMORY_ALLOCATION_FAILED;
+            return;
+        }
     }
 
     if (!readu2(jc, &jc->methodCount))
@@ -238,6 +401,12 @@ void openClassFile(JavaClass* jc, const char* path)
 
             jc->methodEntriesRead++;
         }
+
+        if (!buildMethodTable(jc))
+        {
+            jc->status = MEMORY_ALLOCATION_FAILED;
+            return;
+        }
     }
 
     if (!readu2(jc, &jc->attributeCount))
@@ -269,16 +438,67 @@ void openClassFile(JavaClass* jc, const char* path)
         }
     }
 
-    if (fgetc(jc->file) != EOF)
-    {
+    if (jc->totalBytesRead != jc->fileSize)
         jc->status = FILE_CONTAINS_UNEXPECTED_DATA;
-    }
-    else
+}
+
+/// @brief Opens a class file and parse it, storing the class
+/// information in the JavaClass structure.
+/// @param JavaClass* jc - pointer to the structure that will
+/// hold the class data
+/// @param const char* path - string containing the path to the
+/// class file to be read
+/// @param enum ClassParseMode mode - whether the attributes of methods,
+/// such as their code, are parsed now or when they are first needed
+///
+/// The file is mapped to memory (or read to a buffer, where mapping isn't
+/// available) and then parsed in place, filling in the fields of the JavaClass
+/// struct. A bunch of other functions from different modules are called
+/// to read some pieces of the class file. Various checks are made
+/// during the parsing of the read data.
+///
+/// @see openClassBuffer(), closeClassFile(), printClassFileInfo(), printClassFileDebugInfo()
+/// @hidecallergraph
+void openClassFile(JavaClass* jc, const char* path, enum ClassParseMode mode)
+{
+    if (!jc)
+        return;
+
+    initJavaClass(jc, mode);
+
+    if (!loadClassFileData(jc, path))
     {
-        fclose(jc->file);
-        jc->file = NULL;
+        jc->status = CLASS_STATUS_FILE_COULDNT_BE_OPENED;
+        return;
     }
 
+    parseClassData(jc, path);
+}
+
+/// @brief Parses a class file that is already in memory, storing the
+/// class information in the JavaClass structure.
+/// @param JavaClass* jc - pointer to the structure that will
+/// hold the class data
+/// @param const uint8_t* data - content of the class file
+/// @param uint32_t size - number of bytes of \c data
+/// @param const char* path - path of the class file, which is
+/// compared with the name of the class
+/// @param uint8_t freeData - if non-zero, \c data was allocated with malloc()
+/// and is released by closeClassFile(). Otherwise, it is owned by the caller
+/// and must be kept until the class is closed, as the class points into it.
+/// @param enum ClassParseMode mode - see openClassFile()
+/// @see openClassFile(), closeClassFile()
+void openClassBuffer(JavaClass* jc, const uint8_t* data, uint32_t size, const char* path, uint8_t freeData,
+                     enum ClassParseMode mode)
+{
+    if (!jc)
+        return;
+
+    initJavaClass(jc, mode);
+    jc->fileData = data;
+    jc->fileSize = size;
+    jc->dataSource = freeData ? CLASS_DATA_ALLOCATED : CLASS_DATA_BORROWED;
+    parseClassData(jc, path);
 }
 
 /// @brief Closes the .class file and releases resources used by
@@ -294,10 +514,45 @@ void closeClassFile(JavaClass* jc)
 
     uint16_t i;
 
-    if (jc->file)
+    if (jc->vtable)
+    {
+        free(jc->vtable);
+        jc->vtable = NULL;
+        jc->vtableLength = 0;
+    }
+
+    if (jc->itables)
+    {
+        for (i = 0; i < jc->itableCount; i++)
+        {
+            if (jc->itables[i].methods)
+                free(jc->itables[i].methods);
+        }
+
+        free(jc->itables);
+        jc->itables = NULL;
+        jc->itableCount = 0;
+    }
+
+    if (jc->supers)
     {
-        fclose(jc->file);
-        jc->file = NULL;
+        free(jc->supers);
+        jc->supers = NULL;
+        jc->superDepth = 0;
+    }
+
+    if (jc->interfaceBits)
+    {
+        free(jc->interfaceBits);
+        jc->interfaceBits = NULL;
+        jc->interfaceBitWords = 0;
+    }
+
+    // The structures of archived classes belong to the archive
+    if (jc->dataSource == CLASS_DATA_ARCHIVED)
+    {
+        releaseArchivedClass(jc);
+        return;
     }
 
     if (jc->interfaces)
@@ -307,14 +562,10 @@ void closeClassFile(JavaClass* jc)
         jc->interfaceCount = 0;
     }
 
+    // UTF-8 entries don't need to be released, their
+    // bytes are owned by the symbol table.
     if (jc->constantPool)
     {
-        for (i = 0; i < jc->constantPoolCount - 1; i++)
-        {
-            if (jc->constantPool[i].tag == CONSTANT_Utf8 && jc->constantPool[i].Utf8.bytes)
-                free(jc->constantPool[i].Utf8.bytes);
-        }
-
         free(jc->constantPool);
         jc->constantPool = NULL;
         jc->constantPoolCount = 0;
@@ -329,6 +580,13 @@ void closeClassFile(JavaClass* jc)
         jc->methodCount = 0;
     }
 
+    if (jc->methodTable)
+    {
+        free(jc->methodTable);
+        jc->methodTable = NULL;
+        jc->methodTableCapacity = 0;
+    }
+
     if (jc->fields)
     {
         for (i = 0; i < jc->fieldCount; i++)
@@ -338,6 +596,13 @@ void closeClassFile(JavaClass* jc)
         jc->fieldCount = 0;
     }
 
+    if (jc->fieldTable)
+    {
+        free(jc->fieldTable);
+        jc->fieldTable = NULL;
+        jc->fieldTableCapacity = 0;
+    }
+
     if (jc->attributes)
     {
         for (i = 0; i < jc->attributeCount; i++)
@@ -346,6 +611,9 @@ void closeClassFile(JavaClass* jc)
         free(jc->attributes);
         jc->attributeCount = 0;
     }
+
+    // Released last, code attributes point into it
+    releaseClassData(jc);
 }
 
 /// @brief Decodes JavaClassStatus enumeration elements
@@ -395,6 +663,8 @@ const char* decodeJavaClassStatus(enum JavaClassStatus status)
         case ATTRIBUTE_INVALID_INNERCLASS_INDEXES: return "InnerClass has at least one invalid index";
         case ATTRIBUTE_INVALID_EXCEPTIONS_CLASS_INDEX: return "Exceptions has an index that doesn't point to a valid class";
         case ATTRIBUTE_INVALID_CODE_LENGTH: return "Attribute code must have a length greater than 0 and less than 65536 bytes";
+        case ATTRIBUTE_INVALID_CODE: return "Attribute code has a truncated instruction, invalid operands or a branch to an invalid offset";
+        case ATTRIBUTE_INVALID_EXCEPTION_TABLE: return "Attribute code has an exception handler with an invalid range, handler or catch type";
 
         case FILE_CONTAINS_UNEXPECTED_DATA: return "class file contains more data than expected, which wasn't processed";
 
@@ -10,6 +10,29 @@ typedef struct JavaClass JavaClass;
 #include "fields.h"
 #include "methods.h"
 
+/// @brief Entry of a virtual method table, identifying a
+/// method and the class that declares it.
+typedef struct VirtualMethod
+{
+    JavaClass* jc;
+    method_info* method;
+} VirtualMethod;
+
+/// @brief Table that maps each method of an interface to the
+/// method that implements it in a class.
+typedef struct InterfaceTable
+{
+    /// @brief The interface implemented by the class.
+    JavaClass* interface;
+
+    /// @brief Implementation of each method of the interface, indexed
+    /// like the methods of the interface. Static methods have a NULL
+    /// entry, and methods that aren't implemented by the class map to
+    /// the abstract method of the interface. This is NULL if the class
+    /// is itself an interface.
+    VirtualMethod* methods;
+} InterfaceTable;
+
 enum AccessFlagsType {
     ACCT_CLASS,
     ACCT_FIELD,
@@ -50,6 +73,21 @@ enum AccessFlags {
 
 };
 
+/// @brief Where the data of a class file came from, which
+/// tells how it must be released when the class is closed.
+enum ClassDataSource {
+    CLASS_DATA_BORROWED,    // Owned by the caller of openClassBuffer()
+    CLASS_DATA_ALLOCATED,   // Allocated with malloc()
+    CLASS_DATA_MAPPED,      // Memory-mapped file
+    CLASS_DATA_ARCHIVED     // The whole class belongs to a class archive
+};
+
+/// @brief How much of a class file is parsed when it is opened.
+enum ClassParseMode {
+    CLASS_PARSE_EAGER,  // Everything is parsed and checked when the class is opened
+    CLASS_PARSE_LAZY    // Attributes of methods are parsed when first needed, see loadMethodCode()
+};
+
 enum JavaClassStatus {
     CLASS_STATUS_OK,
     CLASS_STATUS_UNSUPPORTED_VERSION,
@@ -89,13 +127,22 @@ enum JavaClassStatus {
     ATTRIBUTE_INVALID_INNERCLASS_INDEXES,
     ATTRIBUTE_INVALID_EXCEPTIONS_CLASS_INDEX,
     ATTRIBUTE_INVALID_CODE_LENGTH,
+    ATTRIBUTE_INVALID_CODE,
+    ATTRIBUTE_INVALID_EXCEPTION_TABLE,
 
     FILE_CONTAINS_UNEXPECTED_DATA
 };
 
 struct JavaClass {
     // General
-    FILE* file;
+
+    /// @brief Contents of the class file. Code attributes point into
+    /// this data, so it is kept until the class is closed.
+    const uint8_t* fileData;
+    uint32_t fileSize;
+    enum ClassDataSource dataSource;
+    enum ClassParseMode parseMode;
+
     enum JavaClassStatus status;
     uint8_t classNameMismatch;
 
@@ -115,11 +162,52 @@ struct JavaClass {
     uint16_t attributeCount;
     attribute_info* attributes;
 
+    // Hash tables of members, built when the class is parsed
+
+    /// @brief Open addressing hash table with the index plus one of each
+    /// method, keyed by its name and descriptor, or NULL if there are no
+    /// methods. Its capacity is a power of two. @see getMethodMatchingSymbols()
+    uint16_t* methodTable;
+    uint32_t methodTableCapacity;
+
+    /// @brief Same as \c methodTable, for fields. @see getFieldMatchingSymbols()
+    uint16_t* fieldTable;
+    uint32_t fieldTableCapacity;
+
     // Class Data Info
     uint16_t staticFieldCount;
     uint16_t instanceFieldCount;
 
+    // Method tables, built when the class is resolved by the JVM
+    VirtualMethod* vtable;
+    uint16_t vtableLength;
+    InterfaceTable* itables;
+    uint16_t itableCount;
+
+    // Type display, built when the class is resolved by the JVM
+
+    /// @brief The super classes of the class, indexed by their depth in
+    /// the class hierarchy, from java/lang/Object at depth 0 to the class
+    /// itself at \c superDepth. @see isClassAssignableTo()
+    JavaClass** supers;
+    uint16_t superDepth;
+
+    /// @brief Number given to interfaces when they are resolved, used
+    /// as index in \c interfaceBits. Not used for classes.
+    uint32_t interfaceId;
+
+    /// @brief Bit set of the interfaces implemented by the class, directly
+    /// or not, indexed by their \c interfaceId. The bit set of an interface
+    /// includes the interface itself.
+    uint32_t* interfaceBits;
+    uint32_t interfaceBitWords;
+
+    // Entry of the JVM's table of loaded classes that holds this class
+    struct LoadedClasses* loadedClass;
+
     // Debug info
+
+    /// @brief Read cursor, offset in \c fileData of the next byte to be read.
     uint32_t totalBytesRead;
     uint8_t lastTagRead;
     int32_t constantPoolEntriesRead;
@@ -131,7 +219,9 @@ struct JavaClass {
 
 };
 
-void openClassFile(JavaClass* jc, const char* path);
+void openClassFile(JavaClass* jc, const char* path, enum ClassParseMode mode);
+void openClassBuffer(JavaClass* jc, const uint8_t* data, uint32_t size, const char* path, uint8_t freeData,
+                     enum ClassParseMode mode);
 void closeClassFile(JavaClass* jc);
 const char* decodeJavaClassStatus(enum JavaClassStatus);
 void decodeAccessFlags(uint16_t flags, char* buffer, int32_t buffer_len, enum AccessFlagsType acctype);
@@ -2,6 +2,8 @@
 #include "utf8.h"
 #include "natives.h"
 #include "instructions.h"
+#include "gc.h"
+#include "exceptions.h"
 
 #include "debugging.h"
 #include <string.h>
@@ -20,6 +22,9 @@ const char* getJvmStatusMessage(enum JVMStatus status)
     case JVM_STATUS_OUT_OF_MEMORY: return "Out of memory";
     case JVM_STATUS_MAIN_METHOD_NOT_FOUND: return "Main method not found";
     case JVM_STATUS_INVALID_INSTRUCTION_PARAMETERS: return "Invalid instruction parameters";
+    case JVM_STATUS_STACK_OVERFLOW: return "Stack overflow";
+    case JVM_STATUS_INVALID_METHOD_CODE: return "Invalid method code";
+    case JVM_STATUS_UNCAUGHT_EXCEPTION: return "Uncaught exception";
   }
 
   return "Unknown status";
@@ -36,17 +41,36 @@ const char* getJvmStatusMessage(enum JVMStatus status)
 void initJVM(JavaVirtualMachine* jvm)
 {
     jvm->status = JVM_STATUS_OK;
-    jvm->frames = NULL;
     jvm->classes = NULL;
-    jvm->objects = NULL;
-
-    jvm->classPath[0] = '\0';
+    jvm->classTableCapacity = 0;
+    jvm->classCount = 0;
+    jvm->lastLoadedClass = NULL;
+    jvm->interfaceCount = 0;
+    jvm->exception = NULL;
+    jvm->heapSize = 0;
+    jvm->verboseGC = 0;
+    memset(&jvm->gcStats, 0, sizeof(jvm->gcStats));
+    setHeapThreshold(jvm, GC_DEFAULT_HEAP_THRESHOLD);
+    jvm->executedInstructions = 0;
+
+    initClassPath(&jvm->classPath);
+    initLoaderPool(&jvm->loaderPool, &jvm->classPath);
+    jvm->archiveBuilder = NULL;
+    jvm->profiler = NULL;
+    jvm->sampler = NULL;
+    jvm->allocationProfiler = NULL;
 
     // We need to simulate those two classes, and their support is
     // highly limited. Reading them from the Oracle .class files
     // requires processing of many other .class, including
     // dealing with native methods.
     jvm->simulatingSystemAndStringClasses = 1;
+
+    if (!initHeap(&jvm->heap))
+        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+
+    if (!initFrameStack(&jvm->frames))
+        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
 }
 
 /// @brief Deallocates all memory used by the JavaVirtualMachine structure.
@@ -62,35 +86,52 @@ void deinitJVM(JavaVirtualMachine* jvm)
 {
     freeFrameStack(&jvm->frames);
 
-    LoadedClasses* classnode = jvm->classes;
-    LoadedClasses* classtmp;
+    // Stopped first, loader threads use the class path and the symbols
+    freeLoaderPool(&jvm->loaderPool);
+
+    LoadedClasses* classnode;
+    uint32_t index;
 
-    while (classnode)
+    for (index = 0; index < jvm->classTableCapacity; index++)
     {
-        classtmp = classnode;
-        classnode = classnode->next;
-        closeClassFile(classtmp->jc);
-        free(classtmp->jc);
+        classnode = jvm->classes[index];
 
-        if (classtmp->staticFieldsData)
-            free(classtmp->staticFieldsData);
+        if (!classnode)
+            continue;
 
-        free(classtmp);
-    }
+        closeClassFile(classnode->jc);
+        free(classnode->jc);
 
-    ReferenceTable* refnode = jvm->objects;
-    ReferenceTable* reftmp;
+        if (classnode->staticFieldsData)
+            free(classnode->staticFieldsData);
 
-    while (refnode)
-    {
-        reftmp = refnode;
-        refnode = refnode->next;
-        deleteReference(reftmp->obj);
-        free(reftmp);
+        free(classnode);
     }
 
-    jvm->objects = NULL;
+    if (jvm->classes)
+        free(jvm->classes);
+
+    freeHeap(&jvm->heap);
+
+    // Released after the classes, which may point into JAR files or the archive
+    freeClassPath(&jvm->classPath);
+
+    jvm->heapSize = 0;
+    jvm->exception = NULL;
     jvm->classes = NULL;
+    jvm->classTableCapacity = 0;
+    jvm->classCount = 0;
+    jvm->lastLoadedClass = NULL;
+}
+
+/// @brief Prints an exception that wasn't caught by any frame, like Java
+/// does, and sets the status of the JVM to JVM_STATUS_UNCAUGHT_EXCEPTION.
+static void reportUncaughtException(JavaVirtualMachine* jvm)
+{
+    printf("Exception in thread \"main\" ");
+    printStackTrace(jvm->exception);
+    jvm->exception = NULL;
+    jvm->status = JVM_STATUS_UNCAUGHT_EXCEPTION;
 }
 
 /// @brief Executes the main method of a given class.
@@ -102,7 +143,7 @@ void deinitJVM(JavaVirtualMachine* jvm)
 /// main method.
 ///
 /// If \c mainClass is a null pointer, the class
-/// at the top of the stack of loaded classes will be
+/// that has been loaded most recently will be
 /// used as entry point. If no classes are loaded, then
 /// the status of the JVM will be changed to
 /// \c JVM_STATUS_MAIN_METHOD_NOT_FOUND.
@@ -114,17 +155,21 @@ void executeJVM(JavaVirtualMachine* jvm, LoadedClasses* mainClass)
 {
     if (!mainClass)
     {
-        if (!jvm->classes || !jvm->classes->jc)
+        if (!jvm->lastLoadedClass || !jvm->lastLoadedClass->jc)
         {
             jvm->status = JVM_STATUS_NO_CLASS_LOADED;
             return;
         }
 
-        mainClass = jvm->classes;
+        mainClass = jvm->lastLoadedClass;
     }
     else if (!initClass(jvm, mainClass))
     {
-        jvm->status = JVM_STATUS_MAIN_CLASS_RESOLUTION_FAILED;
+        if (jvm->exception)
+            reportUncaughtException(jvm);
+        else
+            jvm->status = JVM_STATUS_MAIN_CLASS_RESOLUTION_FAILED;
+
         return;
     }
 
@@ -139,31 +184,385 @@ void executeJVM(JavaVirtualMachine* jvm, LoadedClasses* mainClass)
         return;
     }
 
-    if (!runMethod(jvm, mainClass->jc, method, 0))
-        return;
+    if (!runMethod(jvm, mainClass->jc, method, 0) && jvm->exception)
+        reportUncaughtException(jvm);
 }
 
-/// @brief Will set the path to look for classes when opening them.
+/// @brief Adds directories and JAR files to the path where classes are looked for.
 /// @param JavaVirtualMachine* jvm - The JVM that will load classes.
-/// @param const char* path - The string containing the path.
-/// @note The JVM will always look for the class in the current working
-/// directory first, and then (if the file couldn't be found) look for it
-/// in the class path.
-void setClassPath(JavaVirtualMachine* jvm, const char* path)
+/// @param const char* classPath - list of directories and JAR files, separated
+/// by CLASSPATH_SEPARATOR. They are searched in the order they are given.
+/// @return 0 if some JAR file couldn't be read, otherwise 1. Entries that
+/// could be read are added anyway.
+/// @see addClassPathEntry()
+uint8_t setClassPath(JavaVirtualMachine* jvm, const char* classPath)
 {
-    uint32_t index;
-    uint32_t lastSlash = 0;
+    const char* separator;
+    uint8_t success = 1;
 
-    for (index = 0; path[index]; index++)
+    while (1)
     {
-        if (path[index] == '/' || path[index] == '\\')
-            lastSlash = index;
+        separator = strchr(classPath, CLASSPATH_SEPARATOR);
+
+        if (!separator)
+            separator = classPath + strlen(classPath);
+
+        if (!addClassPathEntry(&jvm->classPath, classPath, separator - classPath))
+            success = 0;
+
+        if (!*separator)
+            break;
+
+        classPath = separator + 1;
     }
 
-    if (lastSlash)
-        memcpy(jvm->classPath, path, lastSlash + 1);
-    else
-        jvm->classPath[0] = '\0';
+    return success;
+}
+
+/// @brief Tells if a method is dispatched through the virtual method table,
+/// which excludes static methods and the methods <init> and <clinit>.
+static uint8_t isVirtualMethod(JavaClass* jc, method_info* method)
+{
+    cp_info* name = jc->constantPool + method->name_index - 1;
+
+    if (method->access_flags & ACC_STATIC)
+        return 0;
+
+    return name->Utf8.length == 0 || *name->Utf8.bytes != '<';
+}
+
+/// @brief Finds an entry of a vtable by the name and descriptor of its method.
+///
+/// Private methods aren't inherited, so their entries are skipped unless they
+/// were declared by \c caller. A class may then have an entry for a private
+/// method of a super class and another one, with the same name and descriptor,
+/// for a method that the class declares or inherits from a closer super class.
+/// @return The index of the entry, or -1 if no method in the table matches.
+static int32_t findVirtualMethod(VirtualMethod* vtable, uint16_t vtableLength, const Symbol* name, const Symbol* descriptor,
+                                 JavaClass* caller)
+{
+    cp_info* constantPool;
+    uint16_t index;
+
+    for (index = 0; index < vtableLength; index++)
+    {
+        constantPool = vtable[index].jc->constantPool;
+
+        if ((vtable[index].method->access_flags & ACC_PRIVATE) && vtable[index].jc != caller)
+            continue;
+
+        if (constantPool[vtable[index].method->name_index - 1].Utf8.symbol == name &&
+            constantPool[vtable[index].method->descriptor_index - 1].Utf8.symbol == descriptor)
+        {
+            return index;
+        }
+    }
+
+    return -1;
+}
+
+/// @brief Finds the entry of the vtable of a class that has the same name
+/// and descriptor of a given method.
+/// @param JavaClass* jc - the class whose vtable will be searched.
+/// @param JavaClass* methodClass - the class that declares the method.
+/// @param method_info* method - the method to be looked for.
+/// @return The index of the entry, or -1 if no method in the table matches.
+static int32_t findOverriddenMethod(JavaClass* jc, JavaClass* methodClass, method_info* method)
+{
+    cp_info* name = methodClass->constantPool + method->name_index - 1;
+    cp_info* descriptor = methodClass->constantPool + method->descriptor_index - 1;
+
+    return findVirtualMethod(jc->vtable, jc->vtableLength, name->Utf8.symbol, descriptor->Utf8.symbol, methodClass);
+}
+
+/// @brief Adds an interface to the interface tables of a class, unless
+/// it is already there.
+static void addInterfaceTable(JavaClass* jc, JavaClass* interface)
+{
+    uint16_t index;
+
+    for (index = 0; index < jc->itableCount; index++)
+    {
+        if (jc->itables[index].interface == interface)
+            return;
+    }
+
+    jc->itables[jc->itableCount].interface = interface;
+    jc->itables[jc->itableCount].methods = NULL;
+    jc->itableCount++;
+}
+
+/// @brief Builds the virtual method table and the interface tables of a class.
+/// @param JavaClass* jc - the class whose tables will be built.
+/// @param JavaClass* super - the super class of \c jc, or NULL if it has none.
+/// @param JavaClass** interfaces - array with the \c jc->interfaceCount interfaces
+/// directly implemented by \c jc.
+/// @pre The super class and the interfaces must have their tables built already.
+///
+/// The vtable of a class starts as a copy of the vtable of its super class. Each
+/// virtual method declared by the class replaces the entry with same name and
+/// descriptor, if there is one, or is appended to the table. Then, methods of the
+/// interfaces that the class doesn't implement are appended too, so that they
+/// can be invoked on abstract classes and default methods are inherited.
+///
+/// The class gets an itable for each interface it implements, directly or through
+/// its super classes and super interfaces, mapping the methods of the interface to
+/// their entries in the vtable. Interfaces have no vtable, and their itables only
+/// list their super interfaces.
+///
+/// This allows invokevirtual and invokeinterface to find the method to be invoked
+/// without comparing method names and descriptors.
+///
+/// @return 1 if the tables were built, or 0 if memory allocation failed.
+/// @see resolveClass(), getVirtualMethodIndex()
+static uint8_t buildMethodTables(JavaClass* jc, JavaClass* super, JavaClass** interfaces)
+{
+    uint32_t capacity = super ? super->itableCount : 0;
+    uint16_t index, u16;
+    int32_t slot;
+
+    for (index = 0; index < jc->interfaceCount; index++)
+        capacity += 1 + interfaces[index]->itableCount;
+
+    if (capacity > 0)
+    {
+        jc->itables = (InterfaceTable*)malloc(capacity * sizeof(InterfaceTable));
+
+        if (!jc->itables)
+            return 0;
+    }
+
+    for (index = 0; super && index < super->itableCount; index++)
+        addInterfaceTable(jc, super->itables[index].interface);
+
+    for (index = 0; index < jc->interfaceCount; index++)
+    {
+        addInterfaceTable(jc, interfaces[index]);
+
+        for (u16 = 0; u16 < interfaces[index]->itableCount; u16++)
+            addInterfaceTable(jc, interfaces[index]->itables[u16].interface);
+    }
+
+    if (jc->accessFlags & ACC_INTERFACE)
+        return 1;
+
+    capacity = jc->methodCount + (super ? super->vtableLength : 0);
+
+    for (index = 0; index < jc->itableCount; index++)
+        capacity += jc->itables[index].interface->methodCount;
+
+    if (capacity > 0)
+    {
+        jc->vtable = (VirtualMethod*)malloc(capacity * sizeof(VirtualMethod));
+
+        if (!jc->vtable)
+            return 0;
+    }
+
+    if (super && super->vtableLength > 0)
+    {
+        memcpy(jc->vtable, super->vtable, super->vtableLength * sizeof(VirtualMethod));
+        jc->vtableLength = super->vtableLength;
+    }
+
+    for (index = 0; index < jc->methodCount; index++)
+    {
+        method_info* method = jc->methods + index;
+
+        if (!isVirtualMethod(jc, method))
+            continue;
+
+        slot = findOverriddenMethod(jc, jc, method);
+
+        // Private methods don't override other methods
+        if (method->access_flags & ACC_PRIVATE)
+            slot = -1;
+
+        if (slot < 0)
+            slot = jc->vtableLength++;
+
+        jc->vtable[slot].jc = jc;
+        jc->vtable[slot].method = method;
+    }
+
+    for (index = 0; index < jc->itableCount; index++)
+    {
+        JavaClass* interface = jc->itables[index].interface;
+
+        for (u16 = 0; u16 < interface->methodCount; u16++)
+        {
+            method_info* method = interface->methods + u16;
+
+            if (!isVirtualMethod(interface, method))
+                continue;
+
+            slot = findOverriddenMethod(jc, interface, method);
+
+            if (slot < 0)
+            {
+                slot = jc->vtableLength++;
+            }
+            else if (!(jc->vtable[slot].jc->accessFlags & ACC_INTERFACE) ||
+                     (method->access_flags & ACC_ABSTRACT) ||
+                     !(jc->vtable[slot].method->access_flags & ACC_ABSTRACT))
+            {
+                // Only an abstract method inherited from an interface
+                // is replaced, by a default method of another interface.
+                continue;
+            }
+
+            jc->vtable[slot].jc = interface;
+            jc->vtable[slot].method = method;
+        }
+    }
+
+    for (index = 0; index < jc->itableCount; index++)
+    {
+        JavaClass* interface = jc->itables[index].interface;
+        VirtualMethod* methods;
+
+        if (interface->methodCount == 0)
+            continue;
+
+        methods = (VirtualMethod*)malloc(interface->methodCount * sizeof(VirtualMethod));
+
+        if (!methods)
+            return 0;
+
+        for (u16 = 0; u16 < interface->methodCount; u16++)
+        {
+            method_info* method = interface->methods + u16;
+
+            if (isVirtualMethod(interface, method))
+            {
+                methods[u16] = jc->vtable[findOverriddenMethod(jc, interface, method)];
+            }
+            else
+            {
+                methods[u16].jc = NULL;
+                methods[u16].method = NULL;
+            }
+        }
+
+        jc->itables[index].methods = methods;
+    }
+
+    return 1;
+}
+
+/// @brief Builds the type display of a class, used to tell in constant
+/// time if the class is a subtype of another class or interface.
+/// @param JavaVirtualMachine* jvm - the JVM that is resolving the class.
+/// @param JavaClass* jc - the class whose display will be built.
+/// @param JavaClass* super - the super class of \c jc, or NULL if it has none.
+/// @pre The super class must have its display built, and \c jc must
+/// have its interface tables built already.
+///
+/// The class gets a copy of the list of super classes of its super class,
+/// followed by itself, so that a class is a subclass of another one if the
+/// other class is found at its own depth in that list. Each interface
+/// gets a number, and each class a bit set with the numbers of all the
+/// interfaces in its interface tables.
+///
+/// @return 1 if the display was built, or 0 if memory allocation failed.
+/// @see resolveClass(), buildMethodTables(), isClassAssignableTo()
+static uint8_t buildTypeDisplay(JavaVirtualMachine* jvm, JavaClass* jc, JavaClass* super)
+{
+    uint32_t maxInterfaceId = 0;
+    uint32_t interfaceId;
+    uint16_t index;
+
+    jc->superDepth = super ? super->superDepth + 1 : 0;
+    jc->supers = (JavaClass**)malloc((jc->superDepth + 1) * sizeof(JavaClass*));
+
+    if (!jc->supers)
+        return 0;
+
+    if (super)
+        memcpy(jc->supers, super->supers, jc->superDepth * sizeof(JavaClass*));
+
+    jc->supers[jc->superDepth] = jc;
+
+    if (jc->accessFlags & ACC_INTERFACE)
+        maxInterfaceId = jc->interfaceId = jvm->interfaceCount++;
+
+    for (index = 0; index < jc->itableCount; index++)
+    {
+        if (jc->itables[index].interface->interfaceId > maxInterfaceId)
+            maxInterfaceId = jc->itables[index].interface->interfaceId;
+    }
+
+    if (jc->itableCount == 0 && !(jc->accessFlags & ACC_INTERFACE))
+        return 1;
+
+    jc->interfaceBitWords = maxInterfaceId / 32 + 1;
+    jc->interfaceBits = (uint32_t*)malloc(jc->interfaceBitWords * sizeof(uint32_t));
+
+    if (!jc->interfaceBits)
+        return 0;
+
+    memset(jc->interfaceBits, 0, jc->interfaceBitWords * sizeof(uint32_t));
+
+    if (jc->accessFlags & ACC_INTERFACE)
+        jc->interfaceBits[jc->interfaceId / 32] |= 1u << (jc->interfaceId % 32);
+
+    for (index = 0; index < jc->itableCount; index++)
+    {
+        interfaceId = jc->itables[index].interface->interfaceId;
+        jc->interfaceBits[interfaceId / 32] |= 1u << (interfaceId % 32);
+    }
+
+    return 1;
+}
+
+/// @brief Gets the index of a method in the virtual method table of a class.
+/// @param JavaClass* jc - the class whose vtable will be searched.
+/// @param const Symbol* name - interned name of the method.
+/// @param const Symbol* descriptor - interned descriptor of the method.
+///
+/// This is used when a method is resolved for the first time by invokevirtual.
+/// From then on, the method is found by indexing the vtable of the receiver.
+///
+/// @return The index of the method in the vtable, or -1 if the class doesn't
+/// have a virtual method with that name and descriptor.
+/// @see buildMethodTables()
+int32_t getVirtualMethodIndex(JavaClass* jc, const Symbol* name, const Symbol* descriptor)
+{
+    return findVirtualMethod(jc->vtable, jc->vtableLength, name, descriptor, jc);
+}
+
+/// @brief Tells if a class is extended or implemented by all arrays.
+static uint8_t isArraySuperClass(const uint8_t* className_utf8_bytes, int32_t utf8_len)
+{
+    return cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)"java/lang/Object", 16) ||
+           cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)"java/lang/Cloneable", 19) ||
+           cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)"java/io/Serializable", 20);
+}
+
+/// @brief Tells if a class is extended or implemented by the simulated
+/// String class, including String itself.
+static uint8_t isStringSuperClass(const uint8_t* className_utf8_bytes, int32_t utf8_len)
+{
+    return cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)"java/lang/String", 16) ||
+           cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)"java/lang/Object", 16) ||
+           cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)"java/lang/CharSequence", 22) ||
+           cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)"java/lang/Comparable", 20) ||
+           cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)"java/io/Serializable", 20);
+}
+
+/// @brief Tells if a class is simulated by the JVM instead of being loaded,
+/// which is the case of String and of the interfaces of strings and arrays.
+static uint8_t isSimulatedClass(JavaVirtualMachine* jvm, const uint8_t* className_utf8_bytes, int32_t utf8_len)
+{
+    // All of them are in the java package, which is checked
+    // first as this is done for every class resolution
+    if (!jvm->simulatingSystemAndStringClasses || utf8_len < 16 || memcmp(className_utf8_bytes, "java/", 5))
+        return 0;
+
+    if (cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)"java/lang/Object", 16))
+        return 0;
+
+    return isStringSuperClass(className_utf8_bytes, utf8_len) || isArraySuperClass(className_utf8_bytes, utf8_len);
 }
 
 /// @brief Loads a .class file without initializing it.
@@ -177,12 +576,14 @@ void setClassPath(JavaVirtualMachine* jvm, const char* path)
 ///
 /// This function will open the class file and read its content. All interfaces
 /// and super classes are also resolved. During class resolution, the amount of
-/// bytes required to hold an instance of that class is determined. The class will
+/// bytes required to hold an instance of that class is determined, and the method tables
+/// used by invokevirtual and invokeinterface are built (see buildMethodTables()), as well as
+/// the type display used by checkcast and instanceof (see buildTypeDisplay()). The class will
 /// not be initialized, which means that the static data won't be allocated and the
 /// method <b><clinit></b> won't be called. To initialize a class, the function
 /// initClass() needs to be called. Class resolution may be triggered by resolution
 /// of fields, methods or some instructions that refer to classes (getstatic, new etc).
-/// All resolved classes will be added to the list of all loaded classes of the JVM.
+/// All resolved classes will be added to the table of all loaded classes of the JVM.
 /// If the parameter @b outClass is not null, it will receive the node containig the
 /// already loaded class that was resolved by a call to this function.
 ///
@@ -193,14 +594,21 @@ void setClassPath(JavaVirtualMachine* jvm, const char* path)
 uint8_t resolveClass(JavaVirtualMachine* jvm, const uint8_t* className_utf8_bytes, int32_t utf8_len, LoadedClasses** outClass)
 {
     JavaClass* jc;
+    LoadedClasses* superClass = NULL;
     cp_info* cpi;
     char path[1024];
+    ClassFingerprint fingerprint;
     uint8_t success = 1;
+    uint8_t simulated = 0;
     uint16_t u16;
 
-    if (jvm->simulatingSystemAndStringClasses &&
-        cmp_UTF8(className_utf8_bytes, utf8_len, (const uint8_t*)"java/lang/String", 16))
+    // The simulated String class and the interfaces of strings
+    // and arrays aren't loaded
+    if (isSimulatedClass(jvm, className_utf8_bytes, utf8_len))
     {
+        if (outClass)
+            *outClass = NULL;
+
         return 1;
     }
 
@@ -250,15 +658,24 @@ uint8_t resolveClass(JavaVirtualMachine* jvm, const uint8_t* className_utf8_byte
     printf("Resolving class %.*s\n", utf8_len, className_utf8_bytes);
 #endif // DEBUG
 
-    snprintf(path, sizeof(path), "%.*s.class", utf8_len, className_utf8_bytes);
+    if (!loadClassFile(&jvm->loaderPool, className_utf8_bytes, utf8_len, &jc, path, sizeof(path),
+                       jvm->archiveBuilder ? &fingerprint : NULL))
+    {
+        // Throwable and the exceptions thrown by the JVM are
+        // generated when they aren't in the class path
+        simulated = jvm->simulatingSystemAndStringClasses &&
+                    openSimulatedThrowable(className_utf8_bytes, utf8_len, &jc, path, sizeof(path));
+
+        if (!simulated)
+        {
 
-    jc = (JavaClass*)malloc(sizeof(JavaClass));
-    openClassFile(jc, path);
+#ifdef DEBUG
+    printf("   class '%.*s' not found in the class path.\n", utf8_len, className_utf8_bytes);
+#endif // DEBUG
 
-    if (jc->status == CLASS_STATUS_FILE_COULDNT_BE_OPENED && jvm->classPath[0])
-    {
-        snprintf(path, sizeof(path), "%s%.*s.class", jvm->classPath, utf8_len, className_utf8_bytes);
-        openClassFile(jc, path);
+            jvm->status = JVM_STATUS_CLASS_RESOLUTION_FAILED;
+            return 0;
+        }
     }
 
     if (jc->status != CLASS_STATUS_OK)
@@ -273,41 +690,86 @@ uint8_t resolveClass(JavaVirtualMachine* jvm, const uint8_t* className_utf8_byte
     }
     else
     {
+        // Recorded as it was parsed, before the JVM changes it. Classes that
+        // can't be recorded are simply missing from the archive.
+        if (jvm->archiveBuilder && !simulated)
+            recordArchivedClass(jvm->archiveBuilder, jc, className_utf8_bytes, utf8_len, path, &fingerprint);
+
+        // Methods and fields are marked as unresolved, and will be
+        // resolved by the first instruction that uses them.
+        for (u16 = 0; u16 < jc->constantPoolCount - 1; u16++)
+        {
+            cpi = jc->constantPool + u16;
+
+            if (cpi->tag == CONSTANT_Methodref || cpi->tag == CONSTANT_InterfaceMethodref)
+                cpi->Methodref.resolvedIndex = -1;
+            else if (cpi->tag == CONSTANT_Fieldref)
+                cpi->Fieldref.resolvedClass = NULL;
+            else if (cpi->tag == CONSTANT_Double || cpi->tag == CONSTANT_Long)
+                u16++;
+        }
+
+        JavaClass** interfaces = NULL;
+
         if (jc->superClass)
         {
             cpi = jc->constantPool + jc->superClass - 1;
             cpi = jc->constantPool + cpi->Class.name_index - 1;
-            success = resolveClass(jvm, UTF8(cpi), &loadedClass);
+            loadedClass = NULL;
+            success = resolveClass(jvm, UTF8(cpi), &loadedClass) && loadedClass;
 
             if (success)
             {
-                jc->instanceFieldCount += loadedClass->jc->instanceFieldCount;
+                superClass = loadedClass;
+                jc->instanceFieldCount += superClass->jc->instanceFieldCount;
 
                 for (u16 = 0; u16 < jc->fieldCount; u16++)
-                    jc->fields[u16].offset += loadedClass->jc->instanceFieldCount;
+                    jc->fields[u16].offset += superClass->jc->instanceFieldCount;
             }
 
         }
 
+        if (success && jc->interfaceCount > 0)
+        {
+            interfaces = (JavaClass**)malloc(jc->interfaceCount * sizeof(JavaClass*));
+            success = interfaces != NULL;
+        }
+
         for (u16 = 0; success && u16 < jc->interfaceCount; u16++)
         {
             cpi = jc->constantPool + jc->interfaces[u16] - 1;
             cpi = jc->constantPool + cpi->Class.name_index - 1;
-            success = resolveClass(jvm, UTF8(cpi), NULL);
+            loadedClass = NULL;
+            success = resolveClass(jvm, UTF8(cpi), &loadedClass) && loadedClass;
+
+            if (success)
+                interfaces[u16] = loadedClass->jc;
         }
+
+        if (success)
+            success = buildMethodTables(jc, superClass ? superClass->jc : NULL, interfaces);
+
+        if (success)
+            success = buildTypeDisplay(jvm, jc, superClass ? superClass->jc : NULL);
+
+        if (interfaces)
+            free(interfaces);
     }
 
     if (success)
     {
         loadedClass = addClassToLoadedClasses(jvm, jc);
         success = loadedClass != NULL;
+
+        if (success)
+            loadedClass->super = superClass;
     }
 
     if (success)
     {
 
 #ifdef DEBUG
-    printf("   class file '%s' loaded.\n", path);
+    printf("   class file '%s' loaded%s.\n", path, jc->dataSource == CLASS_DATA_ARCHIVED ? " from the class archive" : "");
 #endif // DEBUG
 
         if (outClass)
@@ -323,6 +785,32 @@ uint8_t resolveClass(JavaVirtualMachine* jvm, const uint8_t* className_utf8_byte
     return success;
 }
 
+/// @brief Resolves the classes named in a method descriptor.
+/// @return 1 if all classes were resolved, otherwise 0.
+/// @see resolveMethod()
+static uint8_t resolveDescriptorClasses(JavaVirtualMachine* jvm, const uint8_t* descriptor_bytes, int32_t descriptor_len)
+{
+    int32_t index, start;
+
+    for (index = 0; index < descriptor_len; index++)
+    {
+        // Class names start with 'L' and end with ';', also
+        // when they are the type of the elements of an array
+        if (descriptor_bytes[index] != 'L')
+            continue;
+
+        start = ++index;
+
+        while (index < descriptor_len && descriptor_bytes[index] != ';')
+            index++;
+
+        if (index == descriptor_len || !resolveClass(jvm, descriptor_bytes + start, index - start, NULL))
+            return 0;
+    }
+
+    return 1;
+}
+
 /// @brief Resolves a method.
 /// @param JavaVirtualMachine* jvm - pointer to the JVM structure
 /// that is running
@@ -336,9 +824,14 @@ uint8_t resolveClass(JavaVirtualMachine* jvm, const uint8_t* className_utf8_byte
 /// Method resolution means to resolve possible classes in its parameters or return
 /// type, and the class in which the method is defined. All identified classes will
 /// also be resolved, with a call to resolveClass(). All resolved classes will be added
-/// to the list of all loaded classes of the JVM. If the parameter @b outClass is not null,
+/// to the table of all loaded classes of the JVM. If the parameter @b outClass is not null,
 /// it will receive the node containig the already loaded class that declared that method.
 ///
+/// The number of operands taken by the parameters of the method is also set in the
+/// constant pool entry, from the signature of the method. The classes of the descriptor
+/// are only resolved the first time a method is resolved, which is also kept in its
+/// signature.
+///
 /// @return Will return 1 if the resolution was completed successfully, otherwise 0.
 /// Resolution may fail if there was a problem with possible calls to resolveClass().
 /// @see resolveField(), resolveClass()
@@ -350,54 +843,45 @@ uint8_t resolveMethod(JavaVirtualMachine* jvm, JavaClass* jc, cp_info* cp_method
     printf("\n");
 #endif // DEBUG
 
-    cp_info* cpi;
+    LoadedClasses* loadedClass = NULL;
+    method_info* method = NULL;
+    cp_info* cpi, *name, *descriptor;
 
     cpi = jc->constantPool + cp_method->Methodref.class_index - 1;
     cpi = jc->constantPool + cpi->Class.name_index - 1;
 
     // Resolve the class the method belongs to
-    if (!resolveClass(jvm, UTF8(cpi), outClass))
+    if (!resolveClass(jvm, UTF8(cpi), &loadedClass))
         return 0;
 
-    // Get method descriptor
-    cpi = jc->constantPool + cp_method->Methodref.name_and_type_index - 1;
-    cpi = jc->constantPool + cpi->NameAndType.descriptor_index - 1;
-
-    uint8_t* descriptor_bytes = cpi->Utf8.bytes;
-    int32_t descriptor_len = cpi->Utf8.length;
-    int32_t length;
-
-    while (descriptor_len > 0)
-    {
-        // We increment our descriptor here. This will make the first
-        // character to be lost, but the first character in a method
-        // descriptor is a parenthesis, so it doesn't matter.
-        descriptor_bytes++;
-        descriptor_len--;
+    if (outClass)
+        *outClass = loadedClass;
 
-        switch(*descriptor_bytes)
-        {
-            // if the method has a class as parameter or as return type,
-            // that class must be resolved
-            case 'L':
+    // Get method name and descriptor
+    cpi = jc->constantPool + cp_method->Methodref.name_and_type_index - 1;
+    name = jc->constantPool + cpi->NameAndType.name_index - 1;
+    descriptor = jc->constantPool + cpi->NameAndType.descriptor_index - 1;
 
-                length = -1;
+    // Methods inherited from super interfaces aren't found here, so
+    // their descriptor is read again, as is done for unknown methods.
+    if (loadedClass)
+        method = findMethodInClassHierarchy(loadedClass, name->Utf8.symbol, descriptor->Utf8.symbol, NULL);
 
-                do {
-                    descriptor_bytes++;
-                    descriptor_len--;
-                    length++;
-                } while (*descriptor_bytes != ';');
+    if (method)
+        cp_method->Methodref.parameterCount = method->signature.parameterSlots;
+    else
+        cp_method->Methodref.parameterCount = getMethodDescriptorParameterCount(UTF8(descriptor));
 
-                if (!resolveClass(jvm, descriptor_bytes - length, length, NULL))
-                    return 0;
+    if (method && method->signature.classesResolved)
+        return 1;
 
-                break;
+    // If the method has classes as parameters or as return
+    // type, those classes must be resolved
+    if (!resolveDescriptorClasses(jvm, UTF8(descriptor)))
+        return 0;
 
-            default:
-                break;
-        }
-    }
+    if (method)
+        method->signature.classesResolved = 1;
 
     return 1;
 }
@@ -416,7 +900,7 @@ uint8_t resolveMethod(JavaVirtualMachine* jvm, JavaClass* jc, cp_info* cp_method
 /// of the field, if it is a class.
 /// If the type of the field is a class, then it will also be resolved, with a call to
 /// resolveClass(). The resolved classes will be added
-/// to the list of all loaded classes of the JVM. If the parameter @b outClass is not null,
+/// to the table of all loaded classes of the JVM. If the parameter @b outClass is not null,
 /// it will receive the node containig the already loaded class that declared that field.
 ///
 /// @return Will return 1 if the resolution was completed successfully, otherwise 0.
@@ -444,7 +928,7 @@ uint8_t resolveField(JavaVirtualMachine* jvm, JavaClass* jc, cp_info* cp_field,
     cpi = jc->constantPool + cp_field->Fieldref.name_and_type_index - 1;
     cpi = jc->constantPool + cpi->NameAndType.descriptor_index - 1;
 
-    uint8_t* descriptor_bytes = cpi->Utf8.bytes;
+    const uint8_t* descriptor_bytes = cpi->Utf8.bytes;
     int32_t descriptor_len = cpi->Utf8.length;
 
     // Skip '[' characters, in case this field is an array
@@ -471,9 +955,10 @@ uint8_t resolveField(JavaVirtualMachine* jvm, JavaClass* jc, cp_info* cp_field,
 /// @param JavaClass* jc - pointer to the class that contains the method
 /// that will be executed.
 /// @param method_info* method - pointer to method that will be executed.
-/// @param uint8_t numberOfParameters - number of operands that need to be
-/// popped from the top frame and pushed to the frame that will be created to
-/// execute the given method (parameter passing).
+/// @param uint8_t numberOfParameters - number of operands on the top of the
+/// caller frame that are passed to the frame that will be created to execute
+/// the given method (parameter passing). They become the first local variables
+/// of the new frame without being copied.
 ///
 /// This function will create a new frame and push it in the stack of frame of the
 /// JVM (FrameStack). To see what a frame is and why it is necessary, check documentation
@@ -492,31 +977,38 @@ uint8_t runMethod(JavaVirtualMachine* jvm, JavaClass* jc, method_info* method, u
     debugPrintMethod(jc, method);
 #endif // DEBUG
 
-    Frame* callerFrame = jvm->frames ? jvm->frames->frame : NULL;
-    Frame* frame = newFrame(jc, method);
+    Frame* callerFrame = getTopFrame(&jvm->frames);
+    att_Code_info* code;
+
+    // With lazy parsing, the code of the method is parsed the first time it runs
+    if (!loadMethodCode(jc, method, &code))
+    {
 
 #ifdef DEBUG
-    printf(", code len: %u, frame id: %d", frame->code_length, debugGetFrameId(frame));
-    if (frame->code_length == 0)
-        printf(" ### Native Method ###");
-    printf("\n");
+    printf("\n   code of the method couldn't be parsed: %s\n", decodeJavaClassStatus(jc->status));
 #endif // DEBUG
 
-    if (!frame || !pushFrame(&jvm->frames, frame))
-    {
-        jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+        jvm->status = JVM_STATUS_INVALID_METHOD_CODE;
         return 0;
     }
 
-    uint8_t parameterIndex;
-    int32_t parameter;
+    Frame* frame = pushFrame(&jvm->frames, jc, method, code, numberOfParameters);
 
-    for (parameterIndex = 0; parameterIndex < numberOfParameters; parameterIndex++)
+    if (!frame)
     {
-        popOperand(&callerFrame->operands, &parameter, NULL);
-        frame->localVariables[numberOfParameters - parameterIndex - 1] = parameter;
+        jvm->status = JVM_STATUS_STACK_OVERFLOW;
+        return 0;
     }
 
+    TRACE_METHOD_EVENT(TRACE_CATEGORY_METHOD, TRACE_METHOD_ENTER, 0, jc, method)
+
+#ifdef DEBUG
+    printf(", instructions: %u, frame id: %d", frame->instructionCount, debugGetFrameId(frame));
+    if (frame->instructionCount == 0)
+        printf(" ### Native Method ###");
+    printf("\n");
+#endif // DEBUG
+
     if (method->access_flags & ACC_NATIVE)
     {
         cp_info* className = jc->constantPool + jc->thisClass - 1;
@@ -527,223 +1019,203 @@ uint8_t runMethod(JavaVirtualMachine* jvm, JavaClass* jc, method_info* method, u
 
         NativeFunction native = getNative(UTF8(className), UTF8(methodName), UTF8(descriptor));
 
+        if (native && jvm->profiler &&
+            !profileNativeCall(jvm->profiler, className->Utf8.symbol, methodName->Utf8.symbol, descriptor->Utf8.symbol))
+        {
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
+            return 0;
+        }
+
+        TRACE_EVENT(TRACE_CATEGORY_NATIVE, TRACE_NATIVE_CALL, native != NULL, 0, className->Utf8.symbol,
+                    methodName->Utf8.symbol, descriptor->Utf8.symbol)
+
         if (native)
             native(jvm, frame, UTF8(descriptor));
     }
-    else
+    else if (!executeFrame(jvm, frame))
     {
-        InstructionFunction function;
+        TRACE_METHOD_EVENT(TRACE_CATEGORY_METHOD, TRACE_METHOD_EXIT, 0, jc, method)
 
-        while (frame->pc < frame->code_length)
+        // An exception that the method didn't catch is passed on to the caller,
+        // whose instruction that invoked the method fails in turn
+        if (jvm->exception)
         {
+            popFrame(&jvm->frames);
 
 #ifdef DEBUG
-    printf("\n");
-    debugPrintOperandStack(frame->operands);
-    debugPrintLocalVariables(frame->localVariables, frame->max_locals);
+    debugGetFrameId(NULL);
 #endif // DEBUG
+        }
 
-            uint8_t opcode = *(frame->code + frame->pc++);
-            function = fetchOpcodeFunction(opcode);
+        return 0;
+    }
 
-#ifdef DEBUG
-    printf("   instruction '%s' at offset %u of frame %d\n", getOpcodeMnemonic(opcode), frame->pc - 1, debugGetFrameId(frame));
-#endif // DEBUG
+    if (frame->returnCount > 0 && callerFrame)
+    {
+        // At most, two operands can be returned. They are moved
+        // to the top of the caller frame, which is where the
+        // local variables of this frame start.
+        uint16_t index = frame->operands.top - frame->returnCount;
 
-            if (function == NULL)
-            {
-
-#ifdef DEBUG
-    printf("   unknown instruction '%s'\n", getOpcodeMnemonic(opcode));
-#endif // DEBUG
-
-                jvm->status = JVM_STATUS_UNKNOWN_INSTRUCTION;
-                break;
-            }
-            else if (!function(jvm, frame))
-            {
-                return 0;
-            }
-        }
-    }
-
-    if (frame->returnCount > 0 && callerFrame)
-    {
-        // At most, two operands can be returned
-        OperandStack parameters[2];
-        uint8_t index;
-
-        for (index = 0; index < frame->returnCount; index++)
-            popOperand(&frame->operands, &parameters[index].value, &parameters[index].type);
-
-        while (frame->returnCount-- > 0)
-        {
-            if (!pushOperand(&callerFrame->operands, parameters[frame->returnCount].value, parameters[frame->returnCount].type))
+        while (index < frame->operands.top)
+        {
+            if (!pushOperand(&callerFrame->operands, frame->operands.values[index], frame->operands.types[index]))
             {
                 jvm->status = JVM_STATUS_OUT_OF_MEMORY;
                 return 0;
             }
+
+            index++;
         }
     }
 
-    popFrame(&jvm->frames, NULL);
-    freeFrame(frame);
+    popFrame(&jvm->frames);
 
 #ifdef DEBUG
     debugGetFrameId(NULL);
 #endif // DEBUG
 
+    TRACE_METHOD_EVENT(TRACE_CATEGORY_METHOD, TRACE_METHOD_EXIT, jvm->status == JVM_STATUS_OK, jc, method)
     return jvm->status == JVM_STATUS_OK;
 }
 
-/// @brief Gets how many operands a method descriptor requires.
-/// @param const uint8_t* descriptor_utf8 - UTF-8 string containing the method
-/// descriptor
-/// @param int32_t utf8_len - length of the UTF-8 string
-///
-/// This function counts how many operands (which are 32-bit integers) are
-/// needed from a function with the given descriptor. For example, the following
-/// method: @code public int mymethod(long a, byte b) @endcode will have the
-/// following descriptor: (JB)I. When called, this method would require
-/// 3 operands to be passed as parameter, 2 to form the 64-bit long variable, and
-/// another one to form the 32-bit byte variable. A call to this function with that
-/// example descriptor will return 3, meaning that three operands should be popped
-/// from a caller frame and pushed to the callee frame.
-///
-/// @return Number of operands that need to be handled when calling a method
-/// with the given descriptor.
-uint8_t getMethodDescriptorParameterCount(const uint8_t* descriptor_utf8, int32_t utf8_len)
-{
-    uint8_t parameterCount = 0;
-
-    while (utf8_len > 0)
-    {
-        switch (*descriptor_utf8)
-        {
-            case '(': break;
-            case ')': return parameterCount;
-
-            case 'J': case 'D':
-                parameterCount += 2;
-                break;
-
-            case 'L':
-
-                parameterCount++;
+/// @brief Initial number of slots of the table of loaded classes.
+/// Must be a power of two.
+#define CLASS_TABLE_INITIAL_CAPACITY 64
 
-                do {
-                    utf8_len--;
-                    descriptor_utf8++;
-                } while (utf8_len > 0 && *descriptor_utf8 != ';');
-
-                break;
-
-            case '[':
+/// @brief Finds the slot of the table of loaded classes where the class
+/// with a given name is stored, or the empty slot where it should be added.
+static uint32_t findLoadedClassSlot(JavaVirtualMachine* jvm, const Symbol* name)
+{
+    uint32_t mask = jvm->classTableCapacity - 1;
+    uint32_t slot = name->hash & mask;
 
-                parameterCount++;
+    while (jvm->classes[slot] && jvm->classes[slot]->name != name)
+        slot = (slot + 1) & mask;
 
-                do {
-                    utf8_len--;
-                    descriptor_utf8++;
-                } while (utf8_len > 0 && *descriptor_utf8 == '[');
+    return slot;
+}
 
-                if (utf8_len > 0 && *descriptor_utf8 == 'L')
-                {
-                    do {
-                        utf8_len--;
-                        descriptor_utf8++;
-                    } while (utf8_len > 0 && *descriptor_utf8 != ';');
-                }
+/// @brief Doubles the number of slots of the table of loaded classes,
+/// or allocates the table if it is empty.
+/// @return 1 on success, 0 if memory allocation failed.
+static uint8_t growLoadedClassTable(JavaVirtualMachine* jvm)
+{
+    uint32_t oldCapacity = jvm->classTableCapacity;
+    uint32_t newCapacity = oldCapacity ? 2 * oldCapacity : CLASS_TABLE_INITIAL_CAPACITY;
+    LoadedClasses** oldTable = jvm->classes;
+    LoadedClasses** newTable = (LoadedClasses**)malloc(newCapacity * sizeof(LoadedClasses*));
+    uint32_t index;
 
-                break;
+    if (!newTable)
+        return 0;
 
-            case 'F': // float
-            case 'B': // byte
-            case 'C': // char
-            case 'I': // int
-            case 'S': // short
-            case 'Z': // boolean
-                parameterCount++;
-                break;
+    for (index = 0; index < newCapacity; index++)
+        newTable[index] = NULL;
 
-            default:
-                break;
-        }
+    jvm->classes = newTable;
+    jvm->classTableCapacity = newCapacity;
 
-        descriptor_utf8++;
-        utf8_len--;
+    for (index = 0; index < oldCapacity; index++)
+    {
+        if (oldTable[index])
+            newTable[findLoadedClassSlot(jvm, oldTable[index]->name)] = oldTable[index];
     }
 
-    return parameterCount;
+    if (oldTable)
+        free(oldTable);
+
+    return 1;
 }
 
-/// @brief Adds a class to the list of all loaded classes by the JVM.
+/// @brief Adds a class to the table of all loaded classes by the JVM.
 /// @param JavaVirtualMachine* jvm - the JVM that has loaded the given class
 /// @param JavaClass* jc - a class that has already been loaded and will be
-/// added to the list.
-/// @return The node created to store the class.
+/// added to the table.
+///
+/// The class is stored under the interned name of its "this class"
+/// constant pool entry, and \c jc is linked back to the node created.
+/// The super class of the node is initialized with NULL.
+/// @return The node created to store the class, or NULL if memory allocation failed.
 LoadedClasses* addClassToLoadedClasses(JavaVirtualMachine* jvm, JavaClass* jc)
 {
+    cp_info* cpi = jc->constantPool + jc->thisClass - 1;
+    cpi = jc->constantPool + cpi->Class.name_index - 1;
+
+    const Symbol* name = internSymbol(UTF8(cpi));
+
+    // Keep the load factor of the table at most 1/2
+    if (!name || (2 * (jvm->classCount + 1) > jvm->classTableCapacity && !growLoadedClassTable(jvm)))
+        return NULL;
+
     LoadedClasses* node = (LoadedClasses*)malloc(sizeof(LoadedClasses));
 
     if (node)
     {
         node->jc = jc;
+        node->name = name;
+        node->super = NULL;
         node->staticFieldsData = NULL;
         node->requiresInit = 1;
-        node->next = jvm->classes;
 
-        jvm->classes = node;
+        // A class with the same name may only be added twice if it was requested
+        // through a file path. The first one keeps being returned by lookups.
+        uint32_t slot = findLoadedClassSlot(jvm, name);
+
+        while (jvm->classes[slot])
+            slot = (slot + 1) & (jvm->classTableCapacity - 1);
+
+        jvm->classes[slot] = node;
+        jvm->classCount++;
+        jvm->lastLoadedClass = node;
+        jc->loadedClass = node;
     }
 
     return node;
 }
 
 /// @brief Checks if a class has already been loaded by its name.
-/// @param JavaVirtualMachine* jvm - the JVM that contains a loaded clases list.
+/// @param JavaVirtualMachine* jvm - the JVM that contains a loaded clases table.
 /// @param const uint8_t* utf8_bytes - UTF-8 string containing the class name to be
 /// searched.
 /// @param int32_t utf8_len - length of the UTF-8 string.
 /// @return If the class is found, returns the node containing that loaded class. Otherwise,
 /// returns NULL.
-/// @note This function performs a linear search.
+/// @note The name is looked up in the symbol table, and the resulting symbol
+/// in the table of loaded classes, both in constant time on average.
+/// @see getLoadedClass()
 LoadedClasses* isClassLoaded(JavaVirtualMachine* jvm, const uint8_t* utf8_bytes, int32_t utf8_len)
 {
-    LoadedClasses* classes = jvm->classes;
-    JavaClass* jc;
-    cp_info* cpi;
-
-    while (classes)
-    {
-        jc = classes->jc;
-        cpi = jc->constantPool + jc->thisClass - 1;
-        cpi = jc->constantPool + cpi->Class.name_index - 1;
+    const Symbol* name = findSymbol(utf8_bytes, utf8_len);
 
-        if (cmp_UTF8(UTF8(cpi), utf8_bytes, utf8_len))
-            return classes;
+    return name ? getLoadedClass(jvm, name) : NULL;
+}
 
-        classes = classes->next;
-    }
+/// @brief Gets a loaded class by its interned name.
+/// @param JavaVirtualMachine* jvm - the JVM that contains a loaded clases table.
+/// @param const Symbol* name - the interned name of the class.
+/// @return If the class is found, returns the node containing that loaded class. Otherwise,
+/// returns NULL.
+/// @see isClassLoaded()
+LoadedClasses* getLoadedClass(JavaVirtualMachine* jvm, const Symbol* name)
+{
+    if (jvm->classCount == 0)
+        return NULL;
 
-    return NULL;
+    return jvm->classes[findLoadedClassSlot(jvm, name)];
 }
 
 /// @brief Gets the super class of a given class.
 /// @param JavaVirtualMachine* jvm - the JVM that contains the classes
 /// @param JavaClass* jc - the class that will have its super class seached.
-/// @return If the class is found, returns it. Otherwise, returns NULL.
-/// @note This function performs a linear search, by calling isClassLoaded().
+/// @return If the class has a super class, returns it. Otherwise, returns NULL.
+/// @note No lookup is performed, the super class is linked to the
+/// class when it is resolved.
 JavaClass* getSuperClass(JavaVirtualMachine* jvm, JavaClass* jc)
 {
-    LoadedClasses* lc;
-    cp_info* cp1;
-
-    cp1 = jc->constantPool + jc->superClass - 1;
-    cp1 = jc->constantPool + cp1->Class.name_index - 1;
-
-    lc = isClassLoaded(jvm, UTF8(cp1));
+    LoadedClasses* lc = jc->loadedClass;
 
-    return lc ? lc->jc : NULL;
+    return lc && lc->super ? lc->super->jc : NULL;
 }
 
 /// @brief Check if one class is a super class of another.
@@ -759,35 +1231,186 @@ JavaClass* getSuperClass(JavaVirtualMachine* jvm, JavaClass* jc)
 /// @return Will return 1 if @b super is a super class of @b jc. Otherwise, 0.
 uint8_t isClassSuperOf(JavaVirtualMachine* jvm, JavaClass* super, JavaClass* jc)
 {
-    cp_info* cp1;
-    cp_info* cp2;
-    LoadedClasses* classes;
+    return super != jc && !(super->accessFlags & ACC_INTERFACE) && isClassAssignableTo(jc, super);
+}
+
+/// @brief Checks if a class is a subtype of another class or interface.
+/// @param JavaClass* jc - the class that will be checked.
+/// @param JavaClass* target - the class or interface that \c jc should extend
+/// or implement.
+/// @pre Both classes must have been resolved.
+/// @note A class is a subtype of itself.
+///
+/// This takes constant time, using the type display of \c jc: a class
+/// is found at its own depth in the list of super classes of its subclasses,
+/// and an interface has its bit set in the interfaces of its implementers.
+///
+/// @return Will return 1 if @b jc is a subtype of @b target. Otherwise, 0.
+/// @see buildTypeDisplay(), isObjectInstanceOf()
+uint8_t isClassAssignableTo(JavaClass* jc, JavaClass* target)
+{
+    if (target->accessFlags & ACC_INTERFACE)
+    {
+        return target->interfaceId / 32 < jc->interfaceBitWords &&
+               (jc->interfaceBits[target->interfaceId / 32] & (1u << (target->interfaceId % 32)));
+    }
 
-    cp2 = super->constantPool + super->thisClass - 1;
-    cp2 = super->constantPool + cp2->Class.name_index - 1;
+    return target->superDepth <= jc->superDepth && jc->supers[target->superDepth] == target;
+}
 
-    while (jc && jc->superClass)
+/// @brief Checks if values of a type can be assigned to another type,
+/// both given as field descriptors.
+/// @return 1 if the types are compatible, otherwise 0.
+static uint8_t isTypeAssignableTo(JavaVirtualMachine* jvm, const uint8_t* type, int32_t type_len,
+                                  const uint8_t* target, int32_t target_len)
+{
+    LoadedClasses* typeClass = NULL;
+    LoadedClasses* targetClass = NULL;
+
+    if (cmp_UTF8(type, type_len, target, target_len))
+        return 1;
+
+    if (type_len < 2 || target_len < 2)
+        return 0;
+
+    if (*type == '[' && *target == '[')
+        return isTypeAssignableTo(jvm, type + 1, type_len - 1, target + 1, target_len - 1);
+
+    if (*target != 'L')
+        return 0;
+
+    if (*type == '[')
+        return isArraySuperClass(target + 1, target_len - 2);
+
+    if (*type != 'L')
+        return 0;
+
+    if (jvm->simulatingSystemAndStringClasses && cmp_UTF8(type + 1, type_len - 2, (const uint8_t*)"java/lang/String", 16))
+        return isStringSuperClass(target + 1, target_len - 2);
+
+    if (!resolveClass(jvm, type + 1, type_len - 2, &typeClass) || !typeClass ||
+        !resolveClass(jvm, target + 1, target_len - 2, &targetClass) || !targetClass)
     {
-        cp1 = jc->constantPool + jc->superClass - 1;
-        cp1 = jc->constantPool + cp1->Class.name_index - 1;
+        return 0;
+    }
 
-        if (cmp_UTF8(UTF8(cp1), UTF8(cp2)))
-            return 1;
+    return isClassAssignableTo(typeClass->jc, targetClass->jc);
+}
 
-        classes = isClassLoaded(jvm, UTF8(cp1));
+/// @brief Checks if an object is an instance of a class, an interface or an array type.
+/// @param JavaVirtualMachine* jvm - the JVM that holds the object.
+/// @param Reference* object - the object, which can't be null.
+/// @param const uint8_t* className_utf8_bytes - name of the class or interface,
+/// or descriptor of the array type, as given by a CONSTANT_Class entry.
+/// @param int32_t utf8_len - length of the name.
+///
+/// Instances of classes are checked with isClassAssignableTo(), after the class
+/// is resolved. Arrays and simulated strings are checked by their names, which
+/// is slower, so instructions that check class instances cache their class.
+///
+/// @return Will return 1 if @b object is an instance of the type, otherwise 0.
+/// @see isClassAssignableTo()
+uint8_t isObjectInstanceOf(JavaVirtualMachine* jvm, Reference* object, const uint8_t* className_utf8_bytes, int32_t utf8_len)
+{
+    // Descriptors of the element types of arrays, indexed by
+    // Opcode_newarray_type minus T_BOOLEAN
+    static const uint8_t primitiveTypes[] = "ZCFDBSIJ";
 
-        if (classes)
-            jc = classes->jc;
-        else
-            break;
+    LoadedClasses* targetClass = NULL;
+    uint8_t descriptor[2];
+
+    switch (object->type)
+    {
+        case REFTYPE_CLASSINSTANCE:
+
+            if (utf8_len > 0 && *className_utf8_bytes == '[')
+                return 0;
+
+            if (!resolveClass(jvm, className_utf8_bytes, utf8_len, &targetClass) || !targetClass)
+                return 0;
+
+            return isClassAssignableTo(object->ci.c, targetClass->jc);
+
+        case REFTYPE_STRING:
+            return isStringSuperClass(className_utf8_bytes, utf8_len);
+
+        case REFTYPE_ARRAY:
+
+            if (utf8_len > 0 && *className_utf8_bytes != '[')
+                return isArraySuperClass(className_utf8_bytes, utf8_len);
+
+            descriptor[0] = '[';
+            descriptor[1] = primitiveTypes[object->arr.type - T_BOOLEAN];
+            return cmp_UTF8(descriptor, 2, className_utf8_bytes, utf8_len);
+
+        case REFTYPE_OBJARRAY:
+
+            if (utf8_len > 0 && *className_utf8_bytes != '[')
+                return isArraySuperClass(className_utf8_bytes, utf8_len);
+
+            return isTypeAssignableTo(jvm, OBJECT_ARRAY_CLASS_NAME(object), object->oar.utf8_len, className_utf8_bytes, utf8_len);
+
+        default:
+            return 0;
+    }
+}
+
+/// @brief Finds a method by its name and descriptor in a class or, if the
+/// class doesn't declare it, in its super classes, the closest one first.
+/// @param LoadedClasses* lc - the class where the lookup starts, can be NULL.
+/// @param const Symbol* name - interned name of the method.
+/// @param const Symbol* descriptor - interned descriptor of the method.
+/// @param LoadedClasses** outClass - if not NULL, receives the class that
+/// declares the method, when it is found.
+/// @return The method, or NULL if no class of the hierarchy declares it.
+/// @see getMethodMatchingSymbols()
+method_info* findMethodInClassHierarchy(LoadedClasses* lc, const Symbol* name, const Symbol* descriptor,
+                                        LoadedClasses** outClass)
+{
+    method_info* method;
+
+    for (; lc; lc = lc->super)
+    {
+        method = getMethodMatchingSymbols(lc->jc, name, descriptor, 0);
+
+        if (method)
+        {
+            if (outClass)
+                *outClass = lc;
+
+            return method;
+        }
     }
 
-    return 0;
+    return NULL;
+}
+
+/// @brief Finds a field by its name and descriptor in a class or in its
+/// super classes. Same as findMethodInClassHierarchy(), for fields.
+field_info* findFieldInClassHierarchy(LoadedClasses* lc, const Symbol* name, const Symbol* descriptor,
+                                      LoadedClasses** outClass)
+{
+    field_info* field;
+
+    for (; lc; lc = lc->super)
+    {
+        field = getFieldMatchingSymbols(lc->jc, name, descriptor, 0);
+
+        if (field)
+        {
+            if (outClass)
+                *outClass = lc;
+
+            return field;
+        }
+    }
+
+    return NULL;
 }
 
 /// @brief Initializes a class.
 /// @param JavaVirtualMachine* jvm - the JVM that is being executed
-/// @param LoadedClasses* lc - node of the list of loaded classes that holds
+/// @param LoadedClasses* lc - node of the table of loaded classes that holds
 /// the class to be initialized.
 ///
 /// Class initialization is done by allocating memory for the class static data.
@@ -807,12 +1430,22 @@ uint8_t initClass(JavaVirtualMachine* jvm, LoadedClasses* lc)
     else
         return 1;
 
+    uint64_t startTicks = TRACING(TRACE_CATEGORY_CLASS_INIT) ? getProfilerTicks() : 0;
+    uint8_t success = 1;
+
     if (lc->jc->staticFieldCount > 0)
     {
         lc->staticFieldsData = (int32_t*)malloc(sizeof(int32_t) * lc->jc->staticFieldCount);
 
         if (!lc->staticFieldsData)
+        {
+            jvm->status = JVM_STATUS_OUT_OF_MEMORY;
             return 0;
+        }
+
+        // Fields start with their default values, and references
+        // must be null so the garbage collector can scan them.
+        memset(lc->staticFieldsData, 0, sizeof(int32_t) * lc->jc->staticFieldCount);
 
         uint16_t index;
         attribute_info* att;
@@ -852,7 +1485,7 @@ uint8_t initClass(JavaVirtualMachine* jvm, LoadedClasses* lc)
 
                 case CONSTANT_String:
                     cp = lc->jc->constantPool + cp->String.string_index - 1;
-                    lc->staticFieldsData[field->offset] = (int32_t)newString(jvm, UTF8(cp));
+                    lc->staticFieldsData[field->offset] = ENCODE_REFERENCE(newString(jvm, UTF8(cp)));
                     break;
 
                 default:
@@ -863,49 +1496,64 @@ uint8_t initClass(JavaVirtualMachine* jvm, LoadedClasses* lc)
 
     method_info* clinit = getMethodMatching(lc->jc, (uint8_t*)"<clinit>", 8, (uint8_t*)"()V", 3, ACC_STATIC);
 
-    if (clinit && !runMethod(jvm, lc->jc, clinit, 0))
-        return 0;
+    if (clinit)
+        success = runMethod(jvm, lc->jc, clinit, 0);
 
-    return 1;
+    TRACE_EVENT(TRACE_CATEGORY_CLASS_INIT, TRACE_CLASS_INIT, success, getTraceDuration(startTicks), lc->name, NULL, NULL)
+    return success;
 }
 
-Reference* newString(JavaVirtualMachine* jvm, const uint8_t* str, int32_t strlen)
+/// @brief Allocates the heap block of a new object.
+/// @param JavaVirtualMachine* jvm - the JVM where the object will be created
+/// @param ReferenceType type - type of the object
+/// @param size_t dataSize - number of bytes of the data stored after the header of the object
+/// @return The object, with its data set to zero, or NULL if memory allocation failed.
+static Reference* newReference(JavaVirtualMachine* jvm, ReferenceType type, size_t dataSize)
 {
-    Reference* r = (Reference*)malloc(sizeof(Reference));
-    ReferenceTable* node = (ReferenceTable*)malloc(sizeof(ReferenceTable));
-
-    if (!node || !r)
-    {
-        if (node) free(node);
-        if (r) free(r);
+    Reference* r = allocateBlock(&jvm->heap, sizeof(Reference) + dataSize);
 
+    if (!r)
         return NULL;
-    }
 
-    r->type = REFTYPE_STRING;
-    r->str.len = strlen;
+    r->type = type;
+    jvm->heapSize += r->size;
+    return r;
+}
 
-    if (strlen)
-    {
-        r->str.utf8_bytes = (uint8_t*)malloc(strlen);
+/// @brief Records an object that was just created in the trace and in the
+/// allocation profiler of the JVM, if they are enabled.
+/// @return 1 on success, 0 if memory allocation failed.
+static uint8_t recordNewObject(JavaVirtualMachine* jvm, Reference* r)
+{
+    const Symbol* className = NULL;
+    cp_info* cpi;
 
-        if (!r->str.utf8_bytes)
+    if (TRACING(TRACE_CATEGORY_ALLOCATION))
+    {
+        if (r->type == REFTYPE_CLASSINSTANCE)
         {
-            free(r);
-            free(node);
-            return NULL;
+            cpi = r->ci.c->constantPool + r->ci.c->thisClass - 1;
+            className = r->ci.c->constantPool[cpi->Class.name_index - 1].Utf8.symbol;
         }
 
-        memcpy(r->str.utf8_bytes, str, strlen);
-    }
-    else
-    {
-        r->str.utf8_bytes = NULL;
+        recordTraceEvent(TRACE_ALLOCATION, r->type, r->size, className, NULL, NULL);
     }
 
-    node->next = jvm->objects;
-    node->obj = r;
-    jvm->objects = node;
+    return !jvm->allocationProfiler || profileAllocation(jvm->allocationProfiler, &jvm->frames, r);
+}
+
+Reference* newString(JavaVirtualMachine* jvm, const uint8_t* str, int32_t strlen)
+{
+    Reference* r = newReference(jvm, REFTYPE_STRING, strlen);
+
+    if (!r)
+        return NULL;
+
+    r->str.len = strlen;
+    memcpy(STRING_BYTES(r), str, strlen);
+
+    if (!recordNewObject(jvm, r))
+        return NULL;
 
 #ifdef DEBUG
     debugPrintNewObject(r);
@@ -920,39 +1568,15 @@ Reference* newClassInstance(JavaVirtualMachine* jvm, LoadedClasses* lc)
         return 0;
 
     JavaClass* jc = lc->jc;
-    Reference* r = (Reference*)malloc(sizeof(Reference));
-    ReferenceTable* node = (ReferenceTable*)malloc(sizeof(ReferenceTable));
-
-    if (!node || !r)
-    {
-        if (node) free(node);
-        if (r) free(r);
+    Reference* r = newReference(jvm, REFTYPE_CLASSINSTANCE, sizeof(int32_t) * jc->instanceFieldCount);
 
+    if (!r)
         return NULL;
-    }
 
-    r->type = REFTYPE_CLASSINSTANCE;
     r->ci.c = jc;
 
-    if (jc->instanceFieldCount)
-    {
-        r->ci.data = (int32_t*)malloc(sizeof(int32_t) * jc->instanceFieldCount);
-
-        if (!r->ci.data)
-        {
-            free(r);
-            free(node);
-            return NULL;
-        }
-    }
-    else
-    {
-        r->ci.data = NULL;
-    }
-
-    node->next = jvm->objects;
-    node->obj = r;
-    jvm->objects = node;
+    if (!recordNewObject(jvm, r))
+        return NULL;
 
 #ifdef DEBUG
     debugPrintNewObject(r);
@@ -961,80 +1585,87 @@ Reference* newClassInstance(JavaVirtualMachine* jvm, LoadedClasses* lc)
     return r;
 }
 
-Reference* newArray(JavaVirtualMachine* jvm, uint32_t length, Opcode_newarray_type type)
+/// @brief Gets the size, in bytes, of the elements of an array
+/// of a primitive type.
+/// @return The size of the elements, or 0 if the type is invalid.
+static size_t getArrayElementSize(Opcode_newarray_type type)
 {
-    size_t elementSize;
-
     switch (type)
     {
         case T_BOOLEAN:
         case T_BYTE:
-            elementSize = sizeof(uint8_t);
-            break;
+            return sizeof(uint8_t);
 
         case T_SHORT:
         case T_CHAR:
-            elementSize = sizeof(uint16_t);
-            break;
+            return sizeof(uint16_t);
 
         case T_FLOAT:
         case T_INT:
-            elementSize = sizeof(uint32_t);
-            break;
+            return sizeof(uint32_t);
 
         case T_DOUBLE:
         case T_LONG:
-            elementSize = sizeof(uint64_t);
-            break;
+            return sizeof(uint64_t);
 
         default:
-            // Can't create array of other data type
-            return NULL;
+            return 0;
     }
+}
 
-    Reference* r = (Reference*)malloc(sizeof(Reference));
-    ReferenceTable* node = (ReferenceTable*)malloc(sizeof(ReferenceTable));
+Reference* newArray(JavaVirtualMachine* jvm, uint32_t length, Opcode_newarray_type type)
+{
+    size_t elementSize = getArrayElementSize(type);
 
-    if (!node || !r)
-    {
-        if (node) free(node);
-        if (r) free(r);
+    // Can't create array of other data type
+    if (elementSize == 0)
+        return NULL;
 
+    // The size of the object must fit in the header of its block
+    if (length > (UINT32_MAX - sizeof(Reference)) / elementSize)
+        return NULL;
+
+    Reference* r = newReference(jvm, REFTYPE_ARRAY, elementSize * length);
+
+    if (!r)
         return NULL;
-    }
 
-    r->type = REFTYPE_ARRAY;
     r->arr.length = length;
     r->arr.type = type;
 
-    if (length > 0)
-    {
-        r->arr.data = (uint8_t*)malloc(elementSize * length);
+    if (!recordNewObject(jvm, r))
+        return NULL;
 
-        if (!r->arr.data)
-        {
-            free(r);
-            free(node);
-            return NULL;
-        }
+#ifdef DEBUG
+    debugPrintNewObject(r);
+#endif // DEBUG
 
-        uint8_t* data = (uint8_t*)r->arr.data;
+    return r;
+}
 
-        while (length-- > 0)
-            *data++ = 0;
-    }
-    else
-    {
-        r->arr.data = NULL;
-    }
+/// @brief Creates an array of references, without creating its elements.
+///
+/// The elements are stored in the block of the object, followed by
+/// a copy of the name of the class of the array, which is its descriptor.
+/// If \c utf8_className is NULL, the space for the name is left for
+/// the caller to fill in.
+/// @return The array, with all elements set to null, or NULL if memory allocation failed.
+static Reference* newReferenceArray(JavaVirtualMachine* jvm, uint32_t length, const uint8_t* utf8_className, int32_t utf8_len)
+{
+    // The size of the object must fit in the header of its block
+    if (length > (UINT32_MAX - sizeof(Reference) - utf8_len) / sizeof(int32_t))
+        return NULL;
 
-    node->next = jvm->objects;
-    node->obj = r;
-    jvm->objects = node;
+    Reference* r = newReference(jvm, REFTYPE_OBJARRAY, length * sizeof(int32_t) + utf8_len);
 
-#ifdef DEBUG
-    debugPrintNewObject(r);
-#endif // DEBUG
+    if (!r)
+        return NULL;
+
+    r->oar.length = length;
+    r->oar.utf8_len = utf8_len;
+
+    if (utf8_className)
+        memcpy(OBJECT_ARRAY_CLASS_NAME(r), utf8_className, utf8_len);
 
     return r;
 }
@@ -1058,58 +1689,48 @@ Reference* newObjectArray(JavaVirtualMachine* jvm, uint32_t length, const uint8_
             break;
     }
 
-    Reference* r = (Reference*)malloc(sizeof(Reference));
-    ReferenceTable* node = (ReferenceTable*)malloc(sizeof(ReferenceTable));
-
-    if (!node || !r)
-    {
-        if (node) free(node);
-        if (r) free(r);
+    Reference* r = newReferenceArray(jvm, length, utf8_className, utf8_len);
 
+    if (r && !recordNewObject(jvm, r))
         return NULL;
-    }
 
-    r->type = REFTYPE_OBJARRAY;
-    r->oar.length = length;
-    r->oar.utf8_className = (uint8_t*)malloc(utf8_len);
-    r->oar.utf8_len = utf8_len;
+#ifdef DEBUG
+    if (r)
+        debugPrintNewObject(r);
+#endif // DEBUG
 
-    if (!r->oar.utf8_className)
-    {
-        free(r);
-        free(node);
-        return NULL;
-    }
+    return r;
+}
 
-    if (length > 0)
-    {
-        r->oar.elements = (Reference**)malloc(length * sizeof(Reference));
+/// @brief Creates an array of references whose elements are of a given class or
+/// array type, as done by anewarray.
+/// @param const uint8_t* utf8_componentName - name of the class of the elements,
+/// or their descriptor if they are arrays.
+/// @return The array, with all elements set to null, or NULL if memory allocation failed.
+Reference* newComponentArray(JavaVirtualMachine* jvm, uint32_t length, const uint8_t* utf8_componentName, int32_t utf8_len)
+{
+    uint8_t isArray = utf8_len > 0 && *utf8_componentName == '[';
+    Reference* r = newReferenceArray(jvm, length, NULL, utf8_len + (isArray ? 1 : 3));
 
-        if (!r->oar.elements)
-        {
-            free(r->oar.utf8_className);
-            free(r);
-            free(node);
-            return NULL;
-        }
+    if (!r)
+        return NULL;
 
-        // Initializes all references to null
-        while (length-- > 0)
-            r->oar.elements[length] = NULL;
+    // The name of the array is its descriptor
+    OBJECT_ARRAY_CLASS_NAME(r)[0] = '[';
 
+    if (isArray)
+    {
+        memcpy(OBJECT_ARRAY_CLASS_NAME(r) + 1, utf8_componentName, utf8_len);
     }
     else
     {
-        r->oar.elements = NULL;
+        OBJECT_ARRAY_CLASS_NAME(r)[1] = 'L';
+        memcpy(OBJECT_ARRAY_CLASS_NAME(r) + 2, utf8_componentName, utf8_len);
+        OBJECT_ARRAY_CLASS_NAME(r)[utf8_len + 2] = ';';
     }
 
-    // Copy class name
-    while (utf8_len-- > 0)
-        r->oar.utf8_className[utf8_len] = utf8_className[utf8_len];
-
-    node->next = jvm->objects;
-    node->obj = r;
-    jvm->objects = node;
+    if (!recordNewObject(jvm, r))
+        return NULL;
 
 #ifdef DEBUG
     debugPrintNewObject(r);
@@ -1130,59 +1751,19 @@ Reference* newObjectMultiArray(JavaVirtualMachine* jvm, int32_t* dimensions, uin
     if (utf8_len <= 0)
         return NULL;
 
-    Reference* r = (Reference*)malloc(sizeof(Reference));
-    ReferenceTable* node = (ReferenceTable*)malloc(sizeof(ReferenceTable));
-
-    if (!node || !r)
-    {
-        if (node) free(node);
-        if (r) free(r);
+    Reference* r = newReferenceArray(jvm, dimensions[0], utf8_className, utf8_len);
 
+    if (!r)
         return NULL;
-    }
 
-    r->type = REFTYPE_OBJARRAY;
-    r->oar.length = dimensions[0];
-    r->oar.utf8_className = (uint8_t*)malloc(utf8_len);
-    r->oar.utf8_len = utf8_len;
+    uint32_t dimensionLength = r->oar.length;
 
-    if (!r->oar.utf8_className)
-    {
-        free(r);
-        free(node);
-        return NULL;
-    }
+    // Initializes all references to subarrays
+    while (dimensionLength-- > 0)
+        OBJECT_ARRAY_ELEMENTS(r)[dimensionLength] = ENCODE_REFERENCE(newObjectMultiArray(jvm, dimensions + 1, dimensionsSize - 1, utf8_className + 1, utf8_len - 1));
 
-    if (dimensions[0] > 0)
-    {
-        r->oar.elements = (Reference**)malloc(dimensions[0] * sizeof(Reference));
-
-        if (!r->oar.elements)
-        {
-            free(r->oar.utf8_className);
-            free(r);
-            free(node);
-            return NULL;
-        }
-
-        uint32_t dimensionLength = dimensions[0];
-
-        // Initializes all references to subarrays
-        while (dimensionLength-- > 0)
-            r->oar.elements[dimensionLength] = newObjectMultiArray(jvm, dimensions + 1, dimensionsSize - 1, utf8_className + 1, utf8_len - 1);
-
-    }
-    else
-    {
-        r->oar.elements = NULL;
-    }
-
-    // Copy class name
-    memcpy(r->oar.utf8_className, utf8_className, utf8_len);
-
-    node->next = jvm->objects;
-    node->obj = r;
-    jvm->objects = node;
+    if (!recordNewObject(jvm, r))
+        return NULL;
 
 #ifdef DEBUG
     debugPrintNewObject(r);
@@ -1190,43 +1771,3 @@ Reference* newObjectMultiArray(JavaVirtualMachine* jvm, int32_t* dimensions, uin
 
     return r;
 }
-
-void deleteReference(Reference* obj)
-{
-    switch (obj->type)
-    {
-        case REFTYPE_STRING:
-            if (obj->str.utf8_bytes)
-                free(obj->str.utf8_bytes);
-            break;
-
-        case REFTYPE_ARRAY:
-            if (obj->arr.data)
-                free(obj->arr.data);
-            break;
-
-        case REFTYPE_CLASSINSTANCE:
-            if (obj->ci.data)
-                free(obj->ci.data);
-            break;
-
-        case REFTYPE_OBJARRAY:
-        {
-            free(obj->oar.utf8_className);
-
-            if (obj->oar.elements)
-                free(obj->oar.elements);
-
-            // There is no need to delete the references created by this
-            // object array, because they are all added to the created
-            // objects table inside the JVM, which will be deleted later.
-
-            break;
-        }
-
-        default:
-            return;
-    }
-
-    free(obj);
-}
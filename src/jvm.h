@@ -5,9 +5,18 @@ typedef struct JavaVirtualMachine JavaVirtualMachine;
 typedef struct Reference Reference;
 
 #include <stdint.h>
+#include <stddef.h>
 #include "javaclass.h"
 #include "opcodes.h"
 #include "framestack.h"
+#include "symbols.h"
+#include "heap.h"
+#include "classpath.h"
+#include "loaderpool.h"
+#include "profiler.h"
+#include "sampler.h"
+#include "allocprofiler.h"
+#include "tracer.h"
 
 enum JVMStatus {
     JVM_STATUS_OK,
@@ -19,7 +28,10 @@ enum JVMStatus {
     JVM_STATUS_UNKNOWN_INSTRUCTION,
     JVM_STATUS_OUT_OF_MEMORY,
     JVM_STATUS_MAIN_METHOD_NOT_FOUND,
-    JVM_STATUS_INVALID_INSTRUCTION_PARAMETERS
+    JVM_STATUS_INVALID_INSTRUCTION_PARAMETERS,
+    JVM_STATUS_STACK_OVERFLOW,
+    JVM_STATUS_INVALID_METHOD_CODE,
+    JVM_STATUS_UNCAUGHT_EXCEPTION
 };
 
 const char* getJvmStatusMessage(enum JVMStatus status);
@@ -27,62 +39,102 @@ const char* getJvmStatusMessage(enum JVMStatus status);
 typedef struct ClassInstance
 {
     JavaClass* c;
-    int32_t* data;
 } ClassInstance;
 
 typedef struct String
 {
-    uint8_t* utf8_bytes;
     uint32_t len;
 } String;
 
 typedef struct Array
 {
     uint32_t length;
-    uint8_t* data;
     Opcode_newarray_type type;
 } Array;
 
 typedef struct ObjectArray
 {
     uint32_t length;
-    uint8_t* utf8_className;
+
+    /// @brief Length of the name of the class of the array.
+    /// @see OBJECT_ARRAY_CLASS_NAME()
     int32_t utf8_len;
-    Reference** elements;
 } ObjectArray;
 
 typedef enum ReferenceType {
      REFTYPE_ARRAY,
      REFTYPE_CLASSINSTANCE,
      REFTYPE_OBJARRAY,
-     REFTYPE_STRING
+     REFTYPE_STRING,
+     REFTYPE_FREE
 } ReferenceType;
 
+/// @brief Header of an object, stored at the start of its heap block.
+///
+/// The data of the object (fields, elements or string bytes) is
+/// stored in the same block, right after the header, where it is
+/// found by INSTANCE_FIELDS(), ARRAY_DATA(), OBJECT_ARRAY_ELEMENTS()
+/// and STRING_BYTES(), so the header doesn't hold pointers to it.
+/// @see allocateBlock()
 struct Reference
 {
-    ReferenceType type;
+    /// @brief Type of the object, one of ReferenceType. Blocks of the
+    /// heap that don't hold an object have type REFTYPE_FREE.
+    uint8_t type;
+
+    /// @brief Mark bit of the garbage collector, only set
+    /// while a collection is being made.
+    uint8_t marked;
+
+    /// @brief Size of the heap block of the object, in bytes,
+    /// including this header and the data of the object.
+    uint32_t size;
 
     union {
         ClassInstance ci;
         Array arr;
         ObjectArray oar;
         String str;
+
+        /// @brief Next block in the list of free blocks of
+        /// the heap, for blocks of type REFTYPE_FREE.
+        Reference* nextFree;
     };
 };
 
-typedef struct ReferenceTable
-{
-    Reference* obj;
-    struct ReferenceTable* next;
-} ReferenceTable;
+/// @brief Fields of a class instance, stored right after its header.
+#define INSTANCE_FIELDS(r) ((int32_t*)((r) + 1))
+
+/// @brief Elements of an array of a primitive type, stored right after its header.
+#define ARRAY_DATA(r) ((uint8_t*)((r) + 1))
+
+/// @brief References to the elements of an array of references, stored right
+/// after its header.
+/// @see DECODE_REFERENCE()
+#define OBJECT_ARRAY_ELEMENTS(r) ((int32_t*)((r) + 1))
+
+/// @brief Name of the class of an array of references, which is its
+/// descriptor, stored right after its elements.
+#define OBJECT_ARRAY_CLASS_NAME(r) ((uint8_t*)(OBJECT_ARRAY_ELEMENTS(r) + (r)->oar.length))
 
-/// @brief Linked list data struct that holds information about a
-/// class that has already been resolved.
+/// @brief Bytes of a string, stored right after its header.
+#define STRING_BYTES(r) ((uint8_t*)((r) + 1))
+
+/// @brief Entry of the table of loaded classes, that holds information
+/// about a class that has already been resolved.
 typedef struct LoadedClasses
 {
     /// @brief Pointer to the JavaClass struct of the resolved class.
     JavaClass* jc;
 
+    /// @brief Interned name of the class, used as key in the
+    /// table of loaded classes.
+    const Symbol* name;
+
+    /// @brief The super class of this class, or NULL if the
+    /// class has no super class (java/lang/Object).
+    struct LoadedClasses* super;
+
     /// @brief Boolean telling if the class has already been initialized
     /// or if it still needs to be.
     ///
@@ -95,11 +147,27 @@ typedef struct LoadedClasses
 
     /// @brief Array containing the data for the static fields of the class.
     int32_t* staticFieldsData;
-
-    /// @brief Pointer to the next node of the linked list.
-    struct LoadedClasses* next;
 } LoadedClasses;
 
+/// @brief Statistics of the garbage collections made by a JVM.
+typedef struct GarbageCollectorStats
+{
+    /// @brief Number of collections made so far.
+    uint32_t collections;
+
+    /// @brief Number of objects reclaimed by all collections.
+    uint32_t reclaimedObjects;
+
+    /// @brief Number of bytes reclaimed by all collections.
+    size_t reclaimedBytes;
+
+    /// @brief Sum of the duration of all collections, in seconds.
+    double totalPause;
+
+    /// @brief Duration of the longest collection, in seconds.
+    double maxPause;
+} GarbageCollectorStats;
+
 /// @brief A java virtual machine, storing all loaded classes, created
 /// objects and frames for methods being executed.
 /// @see initJVM(), executeJVM(), deinitJVM()
@@ -116,56 +184,129 @@ struct JavaVirtualMachine
     /// support for those classes is minimum.
     uint8_t simulatingSystemAndStringClasses;
 
-    /// @brief Linked list of all objects that have been
-    /// created during the execution of the JVM.
-    ReferenceTable* objects;
+    /// @brief Heap where all objects created during
+    /// the execution of the JVM are allocated.
+    Heap heap;
+
+    /// @brief Number of bytes used by all objects in \c heap.
+    size_t heapSize;
+
+    /// @brief Value of \c heapSize that triggers the next garbage collection.
+    /// @see collectGarbage()
+    size_t gcThreshold;
+
+    /// @brief Minimum value of \c gcThreshold.
+    /// @see setHeapThreshold()
+    size_t minGcThreshold;
+
+    /// @brief Boolean telling if each garbage collection should be reported.
+    uint8_t verboseGC;
+
+    /// @brief Statistics of the garbage collections made so far.
+    GarbageCollectorStats gcStats;
 
     /// @brief Stack of all frames created by method calls.
-    FrameStack* frames;
+    FrameStack frames;
+
+    /// @brief Exception being thrown, passed on from frame to frame
+    /// until it is caught, otherwise NULL.
+    /// @see throwException(), catchException()
+    Reference* exception;
+
+    /// @brief Open-addressing hash table containing all classes that
+    /// have been resolved by the JVM, keyed by their interned names.
+    ///
+    /// Empty slots are NULL. The number of slots is always a power of two,
+    /// and the table grows when more than half of them are used.
+    /// @see addClassToLoadedClasses(), isClassLoaded()
+    LoadedClasses** classes;
 
-    /// @brief Linked list containing all classes that have been
-    /// resolved by the JVM.
-    LoadedClasses* classes;
+    /// @brief Number of slots of the \c classes table.
+    uint32_t classTableCapacity;
 
-    /// @brief Path to look for files when opening classes.
+    /// @brief Number of classes stored in the \c classes table.
+    uint32_t classCount;
+
+    /// @brief The class that has been loaded most recently.
+    LoadedClasses* lastLoadedClass;
+
+    /// @brief Number of interfaces resolved so far, used to
+    /// give each interface its \c interfaceId.
+    uint32_t interfaceCount;
+
+    /// @brief Number of bytecode instructions executed so far.
     ///
-    /// If an attempt to open a class file in the
-    /// current directory fails, then this classPath
-    /// is used to build another directory to look for
-    /// the class file.
-    char classPath[256];
+    /// Used together with the execution time to measure the
+    /// throughput of the interpreter (bytecodes per second).
+    uint64_t executedInstructions;
+
+    /// @brief Directories and JAR files where classes are looked for.
+    /// @see setClassPath(), openClassFromClassPath()
+    ClassPath classPath;
+
+    /// @brief If not NULL, every class loaded is recorded in
+    /// this builder, to be written to a class archive.
+    /// @see recordArchivedClass(), writeClassArchive()
+    ClassArchiveBuilder* archiveBuilder;
+
+    /// @brief If not NULL, the time spent in each opcode and method
+    /// is measured by this profiler.
+    /// @see executeFrame(), printProfile()
+    Profiler* profiler;
+
+    /// @brief If not NULL, the frames being executed are
+    /// sampled at regular intervals by this sampler.
+    /// @see executeFrame(), takeSample()
+    Sampler* sampler;
+
+    /// @brief If not NULL, every object created is counted
+    /// by this profiler, under the instruction that created it.
+    /// @see profileAllocation(), takeHeapHistogram()
+    AllocationProfiler* allocationProfiler;
+
+    /// @brief Threads that open class files ahead of their resolution.
+    /// Without threads, classes are opened as they are resolved.
+    /// @see startLoaderPool(), loadClassFile()
+    LoaderPool loaderPool;
 };
 
 void initJVM(JavaVirtualMachine* jvm);
 void deinitJVM(JavaVirtualMachine* jvm);
 void executeJVM(JavaVirtualMachine* jvm, LoadedClasses* mainClass);
-void setClassPath(JavaVirtualMachine* jvm, const char* path);
+uint8_t setClassPath(JavaVirtualMachine* jvm, const char* classPath);
 uint8_t resolveClass(JavaVirtualMachine* jvm, const uint8_t* className_utf8_bytes, int32_t utf8_len, LoadedClasses** outClass);
 uint8_t resolveMethod(JavaVirtualMachine* jvm, JavaClass* jc, cp_info* cp_method, LoadedClasses** outClass);
 uint8_t resolveField(JavaVirtualMachine* jvm, JavaClass* jc, cp_info* cp_field, LoadedClasses** outClass);
 uint8_t runMethod(JavaVirtualMachine* jvm, JavaClass* jc, method_info* method, uint8_t numberOfParameters);
-uint8_t getMethodDescriptorParameterCount(const uint8_t* descriptor_utf8, int32_t utf8_len);
+int32_t getVirtualMethodIndex(JavaClass* jc, const Symbol* name, const Symbol* descriptor);
 
 LoadedClasses* addClassToLoadedClasses(JavaVirtualMachine* jvm, JavaClass* jc);
 LoadedClasses* isClassLoaded(JavaVirtualMachine* jvm, const uint8_t* utf8_bytes, int32_t utf8_len);
+LoadedClasses* getLoadedClass(JavaVirtualMachine* jvm, const Symbol* name);
 JavaClass* getSuperClass(JavaVirtualMachine* jvm, JavaClass* jc);
 uint8_t isClassSuperOf(JavaVirtualMachine* jvm, JavaClass* super, JavaClass* jc);
+uint8_t isClassAssignableTo(JavaClass* jc, JavaClass* target);
+uint8_t isObjectInstanceOf(JavaVirtualMachine* jvm, Reference* object, const uint8_t* className_utf8_bytes, int32_t utf8_len);
+method_info* findMethodInClassHierarchy(LoadedClasses* lc, const Symbol* name, const Symbol* descriptor,
+                                        LoadedClasses** outClass);
+field_info* findFieldInClassHierarchy(LoadedClasses* lc, const Symbol* name, const Symbol* descriptor,
+                                      LoadedClasses** outClass);
 uint8_t initClass(JavaVirtualMachine* jvm, LoadedClasses* lc);
 
 Reference* newString(JavaVirtualMachine* jvm, const uint8_t* str, int32_t strlen);
 Reference* newClassInstance(JavaVirtualMachine* jvm, LoadedClasses* jc);
 Reference* newArray(JavaVirtualMachine* jvm, uint32_t length, Opcode_newarray_type type);
 Reference* newObjectArray(JavaVirtualMachine* jvm, uint32_t length, const uint8_t* utf8_className, int32_t utf8_len);
+Reference* newComponentArray(JavaVirtualMachine* jvm, uint32_t length, const uint8_t* utf8_componentName, int32_t utf8_len);
 Reference* newObjectMultiArray(JavaVirtualMachine* jvm, int32_t* dimensions, uint8_t dimensionsSize,
                                const uint8_t* utf8_className, int32_t utf8_len);
 
-void deleteReference(Reference* obj);
 
 /// @brief Macro used to print faults in instructions.
 ///
 /// This macro is used in instructions that aren't
 /// implemented or have missing features, like
-/// exception throwing. Is is just a collection
+/// resolution errors. Is is just a collection
 /// of prints telling the user that an error occured
 /// during the execution of that instruction.
  #define DEBUG_REPORT_INSTRUCTION_ERROR \
@@ -0,0 +1,518 @@
+// Needed for sysconf() in strict C99 mode
+#define _DEFAULT_SOURCE
+
+#include <string.h>
+#include "loaderpool.h"
+#include "symbols.h"
+#include "profiler.h"
+#include "tracer.h"
+#include "utf8.h"
+#include "debugging.h"
+
+#ifndef _WIN32
+    #include <unistd.h>
+#endif
+
+/// @brief Size of the buffer that receives the path of a class.
+#define CLASS_PATH_BUFFER_SIZE 1024
+
+/// @brief Initializes a loader pool without threads.
+/// @param LoaderPool* pool - the pool
+/// @param ClassPath* classPath - class path where classes are looked for, which
+/// must outlive the pool
+void initLoaderPool(LoaderPool* pool, ClassPath* classPath)
+{
+    pool->classPath = classPath;
+    pool->recordFingerprints = 0;
+    pool->threads = NULL;
+    pool->threadCount = 0;
+    pool->stopping = 0;
+    pool->queueHead = NULL;
+    pool->queueTail = NULL;
+    pool->jobs = NULL;
+    pool->jobCapacity = 0;
+    pool->jobCount = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->jobQueued, NULL);
+    pthread_cond_init(&pool->jobFinished, NULL);
+}
+
+/// @brief Gets the number of loader threads used when none is given: one less
+/// than the number of processors, as the JVM also opens classes, up to
+/// LOADER_POOL_DEFAULT_MAX_THREADS.
+uint32_t getDefaultLoaderThreadCount(void)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (processors <= 1)
+        return 0;
+
+    if (processors - 1 > LOADER_POOL_DEFAULT_MAX_THREADS)
+        return LOADER_POOL_DEFAULT_MAX_THREADS;
+
+    return (uint32_t)(processors - 1);
+#else
+    return 0;
+#endif
+}
+
+/// @brief Finds the slot of the job table where the job of a class is,
+/// or the empty slot where it should be inserted. Requires the lock.
+static uint32_t findJobSlot(LoaderPool* pool, const uint8_t* name, int32_t nameLength, uint32_t hash)
+{
+    uint32_t mask = pool->jobCapacity - 1;
+    uint32_t slot = hash & mask;
+    ClassLoadJob* job;
+
+    while ((job = pool->jobs[slot]) != NULL)
+    {
+        if (job->hash == hash && job->nameLength == nameLength && !memcmp(job->name, name, nameLength))
+            break;
+
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/// @brief Creates the job of a class and adds it to the job table. Requires the lock.
+/// @return The job, or NULL if memory couldn't be allocated.
+static ClassLoadJob* addJob(LoaderPool* pool, const uint8_t* name, int32_t nameLength, uint32_t hash,
+                            enum ClassLoadJobState state)
+{
+    ClassLoadJob* job;
+    uint32_t index;
+
+    // Keep the load factor of the table at most 1/2
+    if (2 * (pool->jobCount + 1) > pool->jobCapacity)
+    {
+        uint32_t capacity = pool->jobCapacity ? 2 * pool->jobCapacity : 256;
+        ClassLoadJob** oldJobs = pool->jobs;
+        uint32_t oldCapacity = pool->jobCapacity;
+        ClassLoadJob** jobs = (ClassLoadJob**)malloc(capacity * sizeof(ClassLoadJob*));
+
+        if (!jobs)
+            return NULL;
+
+        memset(jobs, 0, capacity * sizeof(ClassLoadJob*));
+        pool->jobs = jobs;
+        pool->jobCapacity = capacity;
+
+        for (index = 0; index < oldCapacity; index++)
+        {
+            job = oldJobs[index];
+
+            if (job)
+                pool->jobs[findJobSlot(pool, job->name, job->nameLength, job->hash)] = job;
+        }
+
+        if (oldJobs)
+            free(oldJobs);
+    }
+
+    job = (ClassLoadJob*)malloc(sizeof(ClassLoadJob));
+
+    if (!job)
+        return NULL;
+
+    job->name = (uint8_t*)malloc(nameLength);
+
+    if (!job->name)
+    {
+        free(job);
+        return NULL;
+    }
+
+    memcpy(job->name, name, nameLength);
+    job->nameLength = nameLength;
+    job->hash = hash;
+    job->state = state;
+    job->jc = NULL;
+    job->path = NULL;
+    job->next = NULL;
+
+    pool->jobs[findJobSlot(pool, name, nameLength, hash)] = job;
+    pool->jobCount++;
+    return job;
+}
+
+/// @brief Queues a class to be opened by the loader threads, unless it
+/// already has a job. Array types are queued as their element class.
+/// Requires the lock.
+/// @return 1 if a job was queued, otherwise 0.
+static uint8_t queueClass(LoaderPool* pool, const uint8_t* name, int32_t nameLength)
+{
+    ClassLoadJob* job;
+    uint32_t hash;
+
+    if (nameLength > 0 && *name == '[')
+    {
+        while (nameLength > 0 && *name == '[')
+        {
+            name++;
+            nameLength--;
+        }
+
+        // Arrays of primitive types have no class to be opened
+        if (nameLength < 3 || *name != 'L')
+            return 0;
+
+        name++;
+        nameLength -= 2;
+    }
+
+    if (nameLength <= 0)
+        return 0;
+
+    hash = hashUTF8(name, nameLength);
+
+    if (pool->jobs && pool->jobs[findJobSlot(pool, name, nameLength, hash)])
+        return 0;
+
+    job = addJob(pool, name, nameLength, hash, CLASS_JOB_QUEUED);
+
+    if (!job)
+        return 0;
+
+    if (pool->queueTail)
+        pool->queueTail->next = job;
+    else
+        pool->queueHead = job;
+
+    pool->queueTail = job;
+    return 1;
+}
+
+/// @brief Queues the classes a class refers to: those of its Class entries,
+/// and those in the descriptors of the methods it invokes.
+static void queueReferencedClasses(LoaderPool* pool, JavaClass* jc)
+{
+    const uint8_t* descriptor;
+    const uint8_t* end;
+    const uint8_t* start;
+    cp_info* cpi;
+    uint16_t u16;
+    uint8_t queued = 0;
+
+    pthread_mutex_lock(&pool->lock);
+
+    for (u16 = 0; !pool->stopping && u16 < jc->constantPoolCount - 1; u16++)
+    {
+        cpi = jc->constantPool + u16;
+
+        if (cpi->tag == CONSTANT_Class)
+        {
+            cpi = jc->constantPool + cpi->Class.name_index - 1;
+            queued |= queueClass(pool, UTF8(cpi));
+        }
+        else if (cpi->tag == CONSTANT_Methodref || cpi->tag == CONSTANT_InterfaceMethodref)
+        {
+            cpi = jc->constantPool + cpi->Methodref.name_and_type_index - 1;
+            cpi = jc->constantPool + cpi->NameAndType.descriptor_index - 1;
+            descriptor = cpi->Utf8.bytes;
+            end = descriptor + cpi->Utf8.length;
+
+            for (; descriptor < end; descriptor++)
+            {
+                if (*descriptor != 'L')
+                    continue;
+
+                start = ++descriptor;
+
+                while (descriptor < end && *descriptor != ';')
+                    descriptor++;
+
+                queued |= queueClass(pool, start, (int32_t)(descriptor - start));
+            }
+        }
+        else if (cpi->tag == CONSTANT_Long || cpi->tag == CONSTANT_Double)
+        {
+            u16++;
+        }
+    }
+
+    if (queued)
+        pthread_cond_broadcast(&pool->jobQueued);
+
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/// @brief Opens the class of a job, which must be in the CLASS_JOB_RUNNING state,
+/// and queues the classes it refers to. Called without the lock.
+static void runJob(LoaderPool* pool, ClassLoadJob* job)
+{
+    char path[CLASS_PATH_BUFFER_SIZE];
+    JavaClass* jc = (JavaClass*)malloc(sizeof(JavaClass));
+    uint64_t startTicks = TRACING(TRACE_CATEGORY_CLASS_LOAD) ? getProfilerTicks() : 0;
+    size_t pathLength;
+
+    if (jc && !openClassFromClassPath(pool->classPath, jc, job->name, job->nameLength, path, sizeof(path),
+                                      pool->recordFingerprints ? &job->fingerprint : NULL))
+    {
+        free(jc);
+        jc = NULL;
+    }
+
+    if (!jc)
+        return;
+
+    TRACE_EVENT(TRACE_CATEGORY_CLASS_LOAD, TRACE_CLASS_LOAD, jc->status == CLASS_STATUS_OK, getTraceDuration(startTicks),
+                internSymbol(job->name, job->nameLength), NULL, NULL)
+
+    pathLength = strlen(path);
+    job->path = (char*)malloc(pathLength + 1);
+
+    if (!job->path)
+    {
+        closeClassFile(jc);
+        free(jc);
+        return;
+    }
+
+    memcpy(job->path, path, pathLength + 1);
+    job->jc = jc;
+
+    if (jc->status == CLASS_STATUS_OK)
+        queueReferencedClasses(pool, jc);
+}
+
+/// @brief Main function of the loader threads, which run queued jobs until
+/// the pool is stopped.
+static void* runLoaderThread(void* argument)
+{
+    LoaderPool* pool = (LoaderPool*)argument;
+    ClassLoadJob* job;
+
+    pthread_mutex_lock(&pool->lock);
+
+    while (1)
+    {
+        while (!pool->stopping && !pool->queueHead)
+            pthread_cond_wait(&pool->jobQueued, &pool->lock);
+
+        if (pool->stopping)
+            break;
+
+        job = pool->queueHead;
+        pool->queueHead = job->next;
+
+        if (!pool->queueHead)
+            pool->queueTail = NULL;
+
+        job->next = NULL;
+
+        // The JVM may have taken the job while it was queued
+        if (job->state != CLASS_JOB_QUEUED)
+            continue;
+
+        job->state = CLASS_JOB_RUNNING;
+        pthread_mutex_unlock(&pool->lock);
+
+        runJob(pool, job);
+
+        pthread_mutex_lock(&pool->lock);
+        job->state = CLASS_JOB_DONE;
+        pthread_cond_broadcast(&pool->jobFinished);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/// @brief Starts the loader threads of a pool.
+/// @param LoaderPool* pool - the pool, initialized with initLoaderPool()
+/// @param uint32_t threadCount - number of loader threads
+/// @param uint8_t recordFingerprints - set if the fingerprints of class
+/// files are needed, see loadClassFile()
+/// @return 1 if all threads were started, otherwise 0, in which case the
+/// pool works with the threads that could be started, if any.
+uint8_t startLoaderPool(LoaderPool* pool, uint32_t threadCount, uint8_t recordFingerprints)
+{
+    uint32_t index;
+
+    pool->recordFingerprints = recordFingerprints;
+
+    if (threadCount == 0)
+        return 1;
+
+    pool->threads = (pthread_t*)malloc(threadCount * sizeof(pthread_t));
+
+    if (!pool->threads)
+        return 0;
+
+    for (index = 0; index < threadCount; index++)
+    {
+        if (pthread_create(pool->threads + index, NULL, runLoaderThread, pool) != 0)
+            break;
+
+        pool->threadCount++;
+    }
+
+    return pool->threadCount == threadCount;
+}
+
+/// @brief Stops the loader threads of a pool, and releases
+/// the jobs and the classes that weren't taken.
+void freeLoaderPool(LoaderPool* pool)
+{
+    ClassLoadJob* job;
+    uint32_t index;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->jobQueued);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (index = 0; index < pool->threadCount; index++)
+        pthread_join(pool->threads[index], NULL);
+
+    if (pool->threads)
+        free(pool->threads);
+
+    for (index = 0; index < pool->jobCapacity; index++)
+    {
+        job = pool->jobs[index];
+
+        if (!job)
+            continue;
+
+        if (job->jc)
+        {
+            closeClassFile(job->jc);
+            free(job->jc);
+        }
+
+        if (job->path)
+            free(job->path);
+
+        free(job->name);
+        free(job);
+    }
+
+    if (pool->jobs)
+        free(pool->jobs);
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->jobQueued);
+    pthread_cond_destroy(&pool->jobFinished);
+    pool->threads = NULL;
+    pool->threadCount = 0;
+    pool->jobs = NULL;
+    pool->jobCapacity = 0;
+    pool->jobCount = 0;
+    pool->queueHead = pool->queueTail = NULL;
+}
+
+/// @brief Opens a class directly from the class path, as done without loader threads.
+static uint8_t openClass(LoaderPool* pool, const uint8_t* className_utf8_bytes, int32_t utf8_len, JavaClass** outClass,
+                         char* outPath, size_t outPathSize, ClassFingerprint* outFingerprint)
+{
+    JavaClass* jc = (JavaClass*)malloc(sizeof(JavaClass));
+    uint64_t startTicks = TRACING(TRACE_CATEGORY_CLASS_LOAD) ? getProfilerTicks() : 0;
+
+    if (!jc || !openClassFromClassPath(pool->classPath, jc, className_utf8_bytes, utf8_len, outPath, outPathSize,
+                                       outFingerprint))
+    {
+        if (jc)
+            free(jc);
+
+        return 0;
+    }
+
+    TRACE_EVENT(TRACE_CATEGORY_CLASS_LOAD, TRACE_CLASS_LOAD, jc->status == CLASS_STATUS_OK, getTraceDuration(startTicks),
+                internSymbol(className_utf8_bytes, utf8_len), NULL, NULL)
+
+    *outClass = jc;
+    return 1;
+}
+
+/// @brief Gets a class opened from the class path, taking it from the pool if a
+/// loader thread already opened it, or opening it otherwise.
+/// @param LoaderPool* pool - the pool
+/// @param const uint8_t* className_utf8_bytes - name of the class, like "java/lang/Object"
+/// @param int32_t utf8_len - length of the name in bytes
+/// @param [out] JavaClass** outClass - receives the class, allocated with malloc(),
+/// which must be closed and released by the caller
+/// @param [out] char* outPath - receives the path the class was opened from
+/// @param size_t outPathSize - size of the \c outPath buffer
+/// @param [out] ClassFingerprint* outFingerprint - if not NULL, receives the fingerprint
+/// of the class file. Classes opened by loader threads only have one if the pool was
+/// started to record fingerprints.
+///
+/// When the class is opened by the calling thread, the classes it refers to
+/// are queued for the loader threads, like for classes they open.
+///
+/// @return 1 if the class file was found and opened, even if it couldn't be parsed,
+/// or 0 if it wasn't found or memory couldn't be allocated.
+/// @see openClassFromClassPath()
+uint8_t loadClassFile(LoaderPool* pool, const uint8_t* className_utf8_bytes, int32_t utf8_len, JavaClass** outClass,
+                      char* outPath, size_t outPathSize, ClassFingerprint* outFingerprint)
+{
+    ClassLoadJob* job = NULL;
+    uint32_t hash;
+    uint8_t found;
+
+    if (pool->threadCount == 0)
+        return openClass(pool, className_utf8_bytes, utf8_len, outClass, outPath, outPathSize, outFingerprint);
+
+    hash = hashUTF8(className_utf8_bytes, utf8_len);
+    pthread_mutex_lock(&pool->lock);
+
+    if (pool->jobs)
+        job = pool->jobs[findJobSlot(pool, className_utf8_bytes, utf8_len, hash)];
+
+    if (!job)
+    {
+        job = addJob(pool, className_utf8_bytes, utf8_len, hash, CLASS_JOB_RUNNING);
+
+        if (job)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            runJob(pool, job);
+            pthread_mutex_lock(&pool->lock);
+        }
+    }
+    else if (job->state == CLASS_JOB_QUEUED)
+    {
+        // Opened here rather than waiting for it to reach the front of the queue
+        job->state = CLASS_JOB_RUNNING;
+        pthread_mutex_unlock(&pool->lock);
+        runJob(pool, job);
+        pthread_mutex_lock(&pool->lock);
+    }
+    else
+    {
+        while (job->state == CLASS_JOB_RUNNING)
+            pthread_cond_wait(&pool->jobFinished, &pool->lock);
+
+        // Taken before, when the class couldn't be resolved
+        if (job->state == CLASS_JOB_TAKEN)
+            job = NULL;
+    }
+
+    if (!job)
+    {
+        pthread_mutex_unlock(&pool->lock);
+        return openClass(pool, className_utf8_bytes, utf8_len, outClass, outPath, outPathSize, outFingerprint);
+    }
+
+    job->state = CLASS_JOB_TAKEN;
+    found = job->jc != NULL;
+
+    if (found)
+    {
+        *outClass = job->jc;
+        snprintf(outPath, outPathSize, "%s", job->path);
+
+        if (outFingerprint)
+            *outFingerprint = job->fingerprint;
+
+        free(job->path);
+        job->jc = NULL;
+        job->path = NULL;
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return found;
+}
@@ -0,0 +1,102 @@
+#ifndef LOADERPOOL_H
+#define LOADERPOOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "javaclass.h"
+#include "classpath.h"
+
+/// @brief Maximum number of loader threads used by default.
+#define LOADER_POOL_DEFAULT_MAX_THREADS 8
+
+enum ClassLoadJobState {
+    CLASS_JOB_QUEUED,   // Waiting for a loader thread
+    CLASS_JOB_RUNNING,  // Being opened by a loader thread or by the JVM
+    CLASS_JOB_DONE,     // Opened, waiting to be taken by the JVM
+    CLASS_JOB_TAKEN     // Handed to the JVM
+};
+
+/// @brief A class file to be opened, either ahead of time by
+/// a loader thread or on demand by the JVM.
+typedef struct ClassLoadJob
+{
+    /// @brief Copy of the class name, like "java/lang/Object".
+    uint8_t* name;
+    int32_t nameLength;
+    uint32_t hash;
+
+    enum ClassLoadJobState state;
+
+    /// @brief The opened class, or NULL if it wasn't found in the class path.
+    JavaClass* jc;
+
+    /// @brief Where the class was found, see openClassFromClassPath().
+    char* path;
+    ClassFingerprint fingerprint;
+
+    /// @brief Next job in the queue of the pool.
+    struct ClassLoadJob* next;
+} ClassLoadJob;
+
+/// @brief Threads that open and validate class files ahead
+/// of the JVM, following the references between classes.
+/// @see loadClassFile()
+typedef struct LoaderPool
+{
+    ClassPath* classPath;
+
+    /// @brief Set if the fingerprints of class files are needed,
+    /// because the classes are recorded in a class archive.
+    uint8_t recordFingerprints;
+
+    pthread_t* threads;
+    uint32_t threadCount;
+
+    /// @brief Protects everything below.
+    pthread_mutex_t lock;
+    pthread_cond_t jobQueued;
+    pthread_cond_t jobFinished;
+    uint8_t stopping;
+
+    /// @brief Jobs waiting for a loader thread, in the order they were queued.
+    ClassLoadJob* queueHead;
+    ClassLoadJob* queueTail;
+
+    /// @brief Open addressing hash table of all jobs, keyed by class name,
+    /// so each class is opened at most once.
+    ClassLoadJob** jobs;
+    uint32_t jobCapacity;
+    uint32_t jobCount;
+} LoaderPool;
+
+void initLoaderPool(LoaderPool* pool, ClassPath* classPath);
+uint8_t startLoaderPool(LoaderPool* pool, uint32_t threadCount, uint8_t recordFingerprints);
+void freeLoaderPool(LoaderPool* pool);
+uint32_t getDefaultLoaderThreadCount(void);
+uint8_t loadClassFile(LoaderPool* pool, const uint8_t* className_utf8_bytes, int32_t utf8_len, JavaClass** outClass,
+                      char* outPath, size_t outPathSize, ClassFingerprint* outFingerprint);
+
+#endif // LOADERPOOL_H
+
+/// @defgroup loaderpool Loader pool module
+///
+/// @brief Opens class files on several threads, ahead of the classes being resolved.
+///
+/// Resolving a class opens its file, then resolves its super class and interfaces,
+/// and other classes are resolved later, as the methods that use them run. With a
+/// loader pool, every class opened has its constant pool scanned for the classes it
+/// refers to (its Class entries and the types in the descriptors of the methods it
+/// invokes), which are queued to be opened by the loader threads. This follows the
+/// references transitively, so by the time the JVM needs a class, its file has often
+/// been read, parsed and validated already.
+///
+/// Only opening class files happens on the loader threads. The JVM still links classes
+/// on its own thread, in the order it resolves them (see resolveClass()), and takes each
+/// class from the pool with loadClassFile(). If the class is still queued, the JVM opens
+/// it itself instead of waiting, so it never waits for more than the class it needs.
+///
+/// Classes that are opened but never resolved stay in the pool until it is released.
+/// Without loader threads, loadClassFile() simply opens the class from the class path.
+///
+/// @see loaderpool.c, openClassFromClassPath()
@@ -1,10 +1,51 @@
+// Needed for clock_gettime() in strict C99 mode
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <time.h>
 #include "javaclass.h"
 #include "jvm.h"
+#include "gc.h"
 #include "debugging.h"
 
+/// @brief Gets the time elapsed since an arbitrary point, in seconds.
+///
+/// Used to time the execution of the JVM, which uses several threads
+/// to load classes, so the processor time given by clock() isn't used.
+static double getWallTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/// @brief Gets the peak resident memory of the process, in KB.
+///
+/// Taken from the VmHWM line of /proc/self/status, which only covers this
+/// program, unlike getrusage(), whose peak also includes the memory of the
+/// process that was replaced by this one when it was started.
+/// @return The peak memory, or 0 if it isn't available.
+static unsigned long getPeakMemory(void)
+{
+    char line[128];
+    unsigned long peak = 0;
+    FILE* file = fopen("/proc/self/status", "r");
+
+    if (!file)
+        return 0;
+
+    while (fgets(line, sizeof(line), file))
+    {
+        if (sscanf(line, "VmHWM: %lu", &peak) == 1)
+            break;
+    }
+
+    fclose(file);
+    return peak;
+}
+
 int main(int argc, char* args[])
 {
     if (argc <= 1)
@@ -14,36 +55,43 @@ int main(int argc, char* args[])
         printf(" -c \t Shows the content of the .class file\n");
         printf(" -e \t Execute the method 'main' from the class\n");
         printf(" -b \t Adds UTF-8 BOM to the output\n");
+        printf(" -t \t Shows execution time, bytecodes per second and peak memory\n");
+        printf(" -gc \t Reports each garbage collection and a summary at the end\n");
+        printf(" -heap <KB> \t Heap size that triggers garbage collection (default %d)\n", GC_DEFAULT_HEAP_THRESHOLD / 1024);
+        printf(" -cp <paths> \t Directories and JAR files where classes are looked for, separated by '%c'\n", CLASSPATH_SEPARATOR);
+        printf(" -archive <file> \t Opens classes from a class archive when their files didn't change\n");
+        printf(" -dumparchive <file> \t Writes every class loaded to a class archive at exit\n");
+        printf(" -loaders <N> \t Number of threads that load classes ahead of time, 0 to disable (default %u)\n",
+               getDefaultLoaderThreadCount());
+        printf(" -prof <file> \t Measures the time spent in each opcode and method, printed at exit and written to a CSV file\n");
+        printf(" -sample <file> \t Samples the methods being executed, written to a file as collapsed stacks for flame graphs\n");
+        printf(" -sampleinterval <us> \t Processor time between samples, in microseconds (default %d)\n", SAMPLER_DEFAULT_INTERVAL);
+        printf(" -allocprof <file> \t Counts the objects created by each instruction and the live objects at exit, written to a CSV file\n");
+        printf(" -trace <file> \t Records method calls, class loads, initializations and allocations to a binary trace file\n");
+        printf(" -traceevents <list> \t Events traced, separated by commas: method, native, load, init, alloc or all (default all)\n");
+        printf(" -eager \t Parses the code of every method when its class is loaded, instead of when it first runs\n");
+        printf(" -p <N> \t Parses the .class file N times and shows the parsing throughput\n");
         return 0;
     }
 
-    if (sizeof(int32_t*) > sizeof(int32_t))
-    {
-        printf("Warning: pointers cannot be stored in an int32_t.\n");
-        printf("This is very likely to malfunction when handling references.\n");
-        printf("Continue anyway? (Y/N)\n");
-
-        int input;
-
-        do {
-
-            input = getchar();
-
-            if (input == 'Y' || input == 'y')
-                break;
-
-            if (input == 'N' || input == 'n')
-                exit(0);
-
-            while (getchar() != '\n');
-
-        } while (1);
-
-    }
-
     uint8_t printClassContent = 0;
     uint8_t executeClassMain = 0;
     uint8_t includeBOM = 0;
+    uint8_t showExecutionTime = 0;
+    uint8_t reportGarbageCollection = 0;
+    size_t heapThreshold = GC_DEFAULT_HEAP_THRESHOLD;
+    uint32_t parseRepetitions = 0;
+    const char* classPath = NULL;
+    const char* archivePath = NULL;
+    const char* dumpArchivePath = NULL;
+    const char* profilePath = NULL;
+    const char* samplePath = NULL;
+    uint32_t sampleInterval = SAMPLER_DEFAULT_INTERVAL;
+    const char* allocationProfilePath = NULL;
+    const char* tracePath = NULL;
+    uint32_t traceEvents = TRACE_CATEGORY_ALL;
+    uint32_t loaderThreads = getDefaultLoaderThreadCount();
+    enum ClassParseMode parseMode = CLASS_PARSE_LAZY;
 
     int argIndex;
 
@@ -55,14 +103,44 @@ int main(int argc, char* args[])
             executeClassMain = 1;
         else if (!strcmp(args[argIndex], "-b"))
             includeBOM = 1;
+        else if (!strcmp(args[argIndex], "-t"))
+            showExecutionTime = 1;
+        else if (!strcmp(args[argIndex], "-gc"))
+            reportGarbageCollection = 1;
+        else if (!strcmp(args[argIndex], "-heap") && argIndex + 1 < argc && atoi(args[argIndex + 1]) > 0)
+            heapThreshold = (size_t)atoi(args[++argIndex]) * 1024;
+        else if (!strcmp(args[argIndex], "-cp") && argIndex + 1 < argc)
+            classPath = args[++argIndex];
+        else if (!strcmp(args[argIndex], "-archive") && argIndex + 1 < argc)
+            archivePath = args[++argIndex];
+        else if (!strcmp(args[argIndex], "-dumparchive") && argIndex + 1 < argc)
+            dumpArchivePath = args[++argIndex];
+        else if (!strcmp(args[argIndex], "-loaders") && argIndex + 1 < argc && atoi(args[argIndex + 1]) >= 0)
+            loaderThreads = (uint32_t)atoi(args[++argIndex]);
+        else if (!strcmp(args[argIndex], "-prof") && argIndex + 1 < argc)
+            profilePath = args[++argIndex];
+        else if (!strcmp(args[argIndex], "-sample") && argIndex + 1 < argc)
+            samplePath = args[++argIndex];
+        else if (!strcmp(args[argIndex], "-sampleinterval") && argIndex + 1 < argc && atoi(args[argIndex + 1]) > 0)
+            sampleInterval = (uint32_t)atoi(args[++argIndex]);
+        else if (!strcmp(args[argIndex], "-allocprof") && argIndex + 1 < argc)
+            allocationProfilePath = args[++argIndex];
+        else if (!strcmp(args[argIndex], "-trace") && argIndex + 1 < argc)
+            tracePath = args[++argIndex];
+        else if (!strcmp(args[argIndex], "-traceevents") && argIndex + 1 < argc && parseTraceCategories(args[argIndex + 1]))
+            traceEvents = parseTraceCategories(args[++argIndex]);
+        else if (!strcmp(args[argIndex], "-eager"))
+            parseMode = CLASS_PARSE_EAGER;
+        else if (!strcmp(args[argIndex], "-p") && argIndex + 1 < argc && atoi(args[argIndex + 1]) > 0)
+            parseRepetitions = (uint32_t)atoi(args[++argIndex]);
         else
             printf("Unknown argument #%d ('%s')\n", argIndex, args[argIndex]);
     }
 
-    if (!printClassContent && !executeClassMain)
+    if (!printClassContent && !executeClassMain && !parseRepetitions)
     {
         printf("Nothing to do with input.\n");
-        printf("Ensure that at least one of the following options are included: \"-c\", \"-e\".\n");
+        printf("Ensure that at least one of the following options are included: \"-c\", \"-e\", \"-p\".\n");
     }
 
     // If requested, outputs the three byte sequence that tells that
@@ -76,9 +154,9 @@ int main(int argc, char* args[])
 
     if (printClassContent)
     {
-        // Open .class file given as parameter
+        // Open .class file given as parameter, checking all of it
         JavaClass jc;
-        openClassFile(&jc, args[1]);
+        openClassFile(&jc, args[1], CLASS_PARSE_EAGER);
 
         // If something went wrong, show debug information
         if (jc.status != CLASS_STATUS_OK)
@@ -90,6 +168,44 @@ int main(int argc, char* args[])
         closeClassFile(&jc);
     }
 
+    if (parseRepetitions)
+    {
+        // Opens and closes the class file repeatedly, measuring
+        // how many bytes of class files are parsed per second.
+        JavaClass jc;
+        uint64_t parsedBytes = 0;
+        uint32_t repetition;
+        clock_t startTime = clock();
+
+        for (repetition = 0; repetition < parseRepetitions; repetition++)
+        {
+            openClassFile(&jc, args[1], parseMode);
+
+            if (jc.status != CLASS_STATUS_OK)
+                break;
+
+            parsedBytes += jc.totalBytesRead;
+            closeClassFile(&jc);
+        }
+
+        double elapsedSeconds = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+
+        if (jc.status != CLASS_STATUS_OK)
+        {
+            printClassFileDebugInfo(&jc);
+            closeClassFile(&jc);
+        }
+        else
+        {
+            printf("Parsed %llu bytes in %.6f seconds", (unsigned long long)parsedBytes, elapsedSeconds);
+
+            if (elapsedSeconds > 0)
+                printf(" (%.2f MB/s)", parsedBytes / elapsedSeconds / (1024 * 1024));
+
+            printf(".\n");
+        }
+    }
+
     if (executeClassMain)
     {
         JavaVirtualMachine jvm;
@@ -111,11 +227,105 @@ int main(int argc, char* args[])
 
         LoadedClasses* mainLoadedClass;
 
-        setClassPath(&jvm, args[1]);
+        if (classPath)
+        {
+            if (!setClassPath(&jvm, classPath))
+                printf("Some JAR files of the class path couldn't be read.\n");
+        }
+        else
+        {
+            // By default, classes are looked for in the current
+            // directory, then in the directory of the main class.
+            size_t lastSlash = 0, index;
+
+            for (index = 0; index < inputLength; index++)
+            {
+                if (args[1][index] == '/' || args[1][index] == '\\')
+                    lastSlash = index + 1;
+            }
+
+            addClassPathEntry(&jvm.classPath, ".", 1);
+
+            if (lastSlash)
+                addClassPathEntry(&jvm.classPath, args[1], lastSlash);
+        }
+
+        // An archive that can't be used is ignored, classes are then parsed
+        if (archivePath)
+        {
+            jvm.classPath.archive = openClassArchive(archivePath);
+
+            if (!jvm.classPath.archive)
+                printf("Class archive '%s' couldn't be used.\n", archivePath);
+        }
+
+        jvm.classPath.parseMode = parseMode;
+
+        ClassArchiveBuilder archiveBuilder;
+
+        if (dumpArchivePath)
+        {
+            initClassArchiveBuilder(&archiveBuilder);
+            jvm.archiveBuilder = &archiveBuilder;
+        }
+
+        Profiler profiler;
+
+        if (profilePath)
+        {
+            initProfiler(&profiler);
+            jvm.profiler = &profiler;
+        }
+
+        Sampler sampler;
+
+        if (samplePath)
+        {
+            initSampler(&sampler, sampleInterval);
+            jvm.sampler = &sampler;
+        }
+
+        AllocationProfiler allocationProfiler;
+
+        if (allocationProfilePath)
+        {
+            initAllocationProfiler(&allocationProfiler);
+            jvm.allocationProfiler = &allocationProfiler;
+
+            if (!startAllocationProfiler(&allocationProfiler))
+                printf("Heap histograms can't be requested while the program runs.\n");
+        }
+
+        setHeapThreshold(&jvm, heapThreshold);
+        jvm.verboseGC = reportGarbageCollection;
+
+        // Enabled before the loader threads start, so they trace the classes they open
+        if (tracePath)
+            startTracing(traceEvents);
+
+        double startTime = getWallTime();
+
+        // If threads can't be created, classes are loaded by this thread only
+        startLoaderPool(&jvm.loaderPool, loaderThreads, dumpArchivePath != NULL);
+
+        if (samplePath && !startSampler(&sampler))
+            printf("The sampling timer couldn't be started.\n");
 
         if (resolveClass(&jvm, (const uint8_t*)args[1], inputLength, &mainLoadedClass))
             executeJVM(&jvm, mainLoadedClass);
 
+        double elapsedSeconds = getWallTime() - startTime;
+
+        // Charges the last instruction executed
+        if (profilePath)
+            chargeProfileTicks(&profiler, NULL, NULL);
+
+        if (samplePath)
+            stopSampler(&sampler);
+
+        if (tracePath)
+            stopTracing();
+
         uint8_t printStatus = jvm.status != JVM_STATUS_OK;
 
 #ifdef DEBUG
@@ -128,9 +338,101 @@ int main(int argc, char* args[])
             printf("Status message: %s.", getJvmStatusMessage(jvm.status));
         }
 
+        if (showExecutionTime)
+        {
+            printf("\nExecuted %llu instructions in %.6f seconds", (unsigned long long)jvm.executedInstructions, elapsedSeconds);
+
+            if (elapsedSeconds > 0)
+                printf(" (%.0f bytecodes per second)", jvm.executedInstructions / elapsedSeconds);
+
+            printf(".\n");
+            printf("Loaded %u classes.\n", jvm.classCount);
+
+            unsigned long peakMemory = getPeakMemory();
+
+            if (peakMemory)
+                printf("Peak resident memory: %luK.\n", peakMemory);
+        }
+
+        if (reportGarbageCollection)
+        {
+            GarbageCollectorStats* stats = &jvm.gcStats;
+
+            printf("\n%u garbage collections, %u objects (%luK) reclaimed", stats->collections,
+                   stats->reclaimedObjects, (unsigned long)(stats->reclaimedBytes / 1024));
+            printf(", total pause %.3f ms, longest pause %.3f ms.\n", 1000 * stats->totalPause, 1000 * stats->maxPause);
+            printf("Heap size at exit: %luK.\n", (unsigned long)(jvm.heapSize / 1024));
+        }
+
+        if (profilePath)
+        {
+            printProfile(&profiler);
+
+            if (!writeProfile(&profiler, profilePath))
+                printf("Profile '%s' couldn't be written.\n", profilePath);
+
+            freeProfiler(&profiler);
+            jvm.profiler = NULL;
+        }
+
+        if (samplePath)
+        {
+            if (!writeCollapsedStacks(&sampler, samplePath))
+                printf("Samples couldn't be written to '%s'.\n", samplePath);
+            else if (showExecutionTime)
+                printf("%llu samples of %u distinct stacks written to '%s'.\n",
+                       (unsigned long long)sampler.sampleCount, sampler.stackCount, samplePath);
+
+            freeSampler(&sampler);
+            jvm.sampler = NULL;
+        }
+
+        if (allocationProfilePath)
+        {
+            HeapHistogram histogram;
+            uint8_t hasHistogram = takeHeapHistogram(&jvm, &histogram);
+
+            printAllocationProfile(&allocationProfiler);
+
+            if (hasHistogram)
+                printHeapHistogram(&histogram);
+
+            if (!writeAllocationProfile(&allocationProfiler, hasHistogram ? &histogram : NULL, allocationProfilePath))
+                printf("Allocation profile '%s' couldn't be written.\n", allocationProfilePath);
+
+            if (hasHistogram)
+                freeHeapHistogram(&histogram);
+
+            freeAllocationProfiler(&allocationProfiler);
+            jvm.allocationProfiler = NULL;
+        }
+
+        if (dumpArchivePath)
+        {
+            if (!writeClassArchive(&archiveBuilder, dumpArchivePath))
+                printf("Class archive '%s' couldn't be written.\n", dumpArchivePath);
+
+            freeClassArchiveBuilder(&archiveBuilder);
+            jvm.archiveBuilder = NULL;
+        }
+
         deinitJVM(&jvm);
+
+        // Written once the loader threads are stopped, while the symbols still exist
+        if (tracePath)
+        {
+            uint64_t tracedEvents;
+
+            if (!writeTrace(tracePath, &tracedEvents))
+                printf("Trace '%s' couldn't be written.\n", tracePath);
+            else if (showExecutionTime)
+                printf("%llu events written to '%s'.\n", (unsigned long long)tracedEvents, tracePath);
+
+            freeTrace();
+        }
     }
 
+    freeSymbols();
     return 0;
 }
 
@@ -159,9 +461,12 @@ int main(int argc, char* args[])
 ///
 /// @section stepguideJavaClass Step-by-step: display class content
 /// -# Command line parameters are parsed in file main.c to get the class file path.
-/// -# openClassFile() is called, defined in module javaclass.c.
+/// -# openClassFile() is called, defined in module javaclass.c. The whole file is read to memory (or mapped,
+/// if it is large) and parsed in place: UTF-8 entries are interned straight from the file data and the Code
+/// attributes point into it, so it is kept until closeClassFile(). Classes already in memory can be parsed
+/// with openClassBuffer().
 /// -# file signature, version and constant pool count are read.
-/// -# readConstantPoolEntry() is called several times to fill the constant pool.
+/// -# readConstantPoolEntry() is called several times to fill the constant pool. UTF-8 entries are interned as they are read, see internSymbol().
 /// -# checkConstantPoolValidity() will check if there are inconsistencies in the constant pool.
 /// Refer to section @ref validity for verification mades and the ones that aren't.
 /// -# this class index, super class index and access flags are read and checked using function checkClassIndexAndAccessFlags().
@@ -173,6 +478,8 @@ int main(int argc, char* args[])
 /// have to be allocated to hold the instance field data. When the class is initialized, it is also possible
 /// to know the how many bytes it needs for its static field data.
 /// -# method count is read, and then several calls to readMethod() are made to fill in the methods of the class.
+/// Classes opened to be executed are parsed lazily (see CLASS_PARSE_LAZY): the attributes of methods are only
+/// located with readAttributeLazily(), and their code is parsed the first time they run, see loadMethodCode().
 /// -# attribute count is read, and then several calls to readAttribute() are made to fill in the attributes of the class.
 /// -# a call to the function printClassFileInfo() will start printing general information of the class, like version, this
 /// class index, super class index, constant pool/field/method/interface count and the class access flags.
@@ -190,8 +497,15 @@ int main(int argc, char* args[])
 /// @section stepguideJVM Step-by-step: execute a class
 /// -# Command line parameters are parsed in file main.c to get the class file path.
 /// -# A JavaVirtualMachine variable needs to be initialized with a call to initJVM().
-/// -# The file path is passed as parameter to resolveClass(), that will look for the class file, open it and load the
-/// class information from it (refer to section @ref stepguideJavaClass to see how a class is read).
+/// -# The class path is set, either from the "-cp" option (see setClassPath()) or, by default, to the current directory
+/// followed by the directory of the main class. JAR files in the class path have their central directory indexed once,
+/// see @ref classpath. With the "-archive" option, classes are opened from a class archive instead of being parsed when their
+/// class files didn't change, and with "-dumparchive", the classes loaded are written to one at exit, see @ref archive.
+/// -# The loader threads are started (see startLoaderPool()). They open the classes referred to by the classes opened so far,
+/// ahead of their resolution, see @ref loaderpool.
+/// -# The file path is passed as parameter to resolveClass(), that will take the class file from the loader pool or look for it
+/// in the class path (see loadClassFile() and openClassFromClassPath()), open it and load the class information from it (refer
+/// to section @ref stepguideJavaClass to see how a class is read).
 /// -# Once the class is loaded, it is added to the table of all loaded classes so far, see LoadedClasses, JavaVirtualMachine::classes.
 /// -# A call to resolveClass() may trigger other classes resolution (super classes, interfaces implemented etc).
 /// -# After the main class has been successfully resolved, a call to executeJVM() will initialize the class.
@@ -203,20 +517,33 @@ int main(int argc, char* args[])
 /// -# After initializing the main class, a method with the signature <b>public static void main(String[] args)</b> will be searched and,
 /// if found, called. Method calling is done via runMethod(). Note that the current implementation does not support command line parameter
 /// passing to the main method.
-/// -# When running a method, a frame for it will be created with a call to newFrame(). It will also be added to the stack of frames
-/// (FrameStack) with a call to pushFrame(). A frame holds the class of the method, the bytecode of the method, the length in bytes of
-/// the bytecode, the number of operands that need to be popped from this frame and pushed to a caller frame once the method returns,
-/// a stack of operands (OperandStack) and an array of local variables.
+/// -# When running a method, its Code attribute is parsed if it wasn't yet (see loadMethodCode()), unless the "-eager"
+/// option was given, which parses the code of every method when its class is opened.
+/// -# A frame for the method will be created on the stack of frames (FrameStack) with a call to pushFrame(). A frame
+/// holds the class of the method, the bytecode of the method, the length in bytes of the bytecode, the number of operands that need
+/// to be popped from this frame and pushed to a caller frame once the method returns, a stack of operands (OperandStack) and an array
+/// of local variables. The FrameStack is allocated once by initJVM(), and the local variables of a new frame start at the parameters
+/// pushed by the caller frame, so parameters aren't copied.
 /// -# Each instruction is fetched from the Code attribute of the method and the corresponding @ref InstructionFunction function pointer is
 /// called. Fetch is done with a call to fetchOpcodeFunction(), which will return one of the functions defined in instructions.c.
-/// -# Once a method is finished, its frame will be removed with a call to popFrame(). The frame will be deallocated with freeFrame().
+/// With the "-prof" option, the time spent in each instruction and native is measured, see @ref profiler, and with
+/// "-sample", the frames being executed are sampled at regular intervals, see @ref sampler. With "-allocprof", the objects
+/// created by each instruction and the objects left in the heap are counted, see @ref allocprofiler. With "-trace",
+/// method calls, class loads, initializations and allocations are recorded as events, see @ref tracer.
+/// -# Once a method is finished, its frame will be removed with a call to popFrame().
 /// If the method returns data, some of its operands in the OperandStack will be popped and pushed to the caller frame.
 /// -# After all execution is done, a call to deinitJVM() will release all objects created and memory allocation associated with the
 /// JVM.
 ///
 /// All objects creation is done with calls from the following functions: newString(), newClassInstance(), newArray(), newObjectArray() and
-/// newObjectMultiArray(). They are all released after the entire execution of the entry point class is over, during deinitialization of
-/// the JVM. Specific object freeing is done with function deleteReference().
+/// newObjectMultiArray(). Each object is a single block, holding its Reference header and its data, carved from the regions of the
+/// heap of the JVM by allocateBlock(). Objects that can't be reached anymore are released by the garbage collector (see collectGarbage()),
+/// which runs when the heap grows past a threshold, right before an instruction creates a new object. All objects left are released
+/// together with the heap during deinitialization of the JVM.
+///
+/// Operands, local variables, fields and elements of arrays are all 32-bit wide. References to objects are stored in them as offsets
+/// from the start of the heap, in units of 8 bytes, so the JVM works the same way whether pointers have 32 or 64 bits. They are converted
+/// to and from pointers with ENCODE_REFERENCE() and DECODE_REFERENCE(). The reference 0 is null.
 ///
 /// %String class has no methods implemented, it is only simulated. Class java/lang/System is specifically checked in some instruction for special
 /// handling, like getting the static java/lang/System.out and calling its println method. This is implemented in file natives.c.
@@ -230,8 +557,10 @@ int main(int argc, char* args[])
 /// All instructions functions share the prefix "instfunc_" and have the same
 /// function prototype, which is:
 /// @code
-/// uint8_t instfunc_<instruction name>(JavaVirtualMachine* jvm, Frame* frame)
+/// static inline uint8_t instfunc_<instruction name>(JavaVirtualMachine* jvm, Frame* frame)
 /// @endcode
+/// They are inlined into the dispatch loop of executeFrame(), and also called
+/// through a table of function pointers by the loop used when profiling.
 /// A Frame structure contains all necessary information to run a method, i.e. the
 /// method's bytecode along with its length, the method's program counter, an array
 /// storing all local variables and a stack of operands (OperandStack).
@@ -301,27 +630,26 @@ int main(int argc, char* args[])
 /// Some other checks while reading attributes (from classes, fields and methods) are also made,
 /// possibly setting the class status to:
 /// ATTRIBUTE_LENGTH_MISMATCH, ATTRIBUTE_INVALID_CONSTANTVALUE_INDEX, ATTRIBUTE_INVALID_SOURCEFILE_INDEX,
-/// ATTRIBUTE_INVALID_INNERCLASS_INDEXES, ATTRIBUTE_INVALID_EXCEPTIONS_CLASS_INDEX or ATTRIBUTE_INVALID_CODE_LENGTH.
+/// ATTRIBUTE_INVALID_INNERCLASS_INDEXES, ATTRIBUTE_INVALID_EXCEPTIONS_CLASS_INDEX, ATTRIBUTE_INVALID_CODE_LENGTH
+/// or ATTRIBUTE_INVALID_CODE.
 ///
-/// There is currently no verification made on instruction parameters and validity of bytecode.
+/// The bytecode of each method is decoded when its Code attribute is read (see decodeBytecode()),
+/// which checks that instructions aren't truncated and that branches land on instructions. There is
+/// currently no verification of types, operand stack depth or constant pool indexes of instructions.
 ///
 ///
 ///
 /// @section limitations Limitations
-/// This software must be compiled in 32-bit mode, as pointer are cast to/from integers of 32 bits.
-///
-/// There is no garbage collector, so all memory allocated for objects created will be released only when
-/// the program terminates.
-///
 /// There are a few instructions that haven't been implemented. They are listed below:
 ///     - invokedynamic - will produce error if executed
-///     - checkcast - will produce error if executed
-///     - instanceof - will produce error if executed
-///     - athrow - will produce error if executed
 ///     - monitorenter - ignored
 ///     - monitorexit - ignored
 ///
-/// There is also no support for exceptions nor try/catch/finally blocks.
+/// Exceptions can be thrown and caught, but a class that can't be resolved or
+/// linked still stops the execution instead of throwing an error. Throwable and
+/// the exceptions thrown by the JVM, like NullPointerException, are generated when
+/// they aren't found in the class path, with only their constructors, getMessage()
+/// and printStackTrace().
 /// Class "java/lang/System" and "java/lang/String" can be used, but they are
 /// also limited.
 /// <br>
@@ -49,6 +49,9 @@ char readMethod(JavaClass* jc, method_info* entry)
         return 0;
     }
 
+    entry->signature.parameterSlots = getMethodDescriptorParameterCount(cpi->Utf8.bytes, cpi->Utf8.length);
+    entry->signature.classesResolved = 0;
+
     if (entry->attributes_count > 0)
     {
         entry->attributes = (attribute_info*)malloc(sizeof(attribute_info) * entry->attributes_count);
@@ -63,9 +66,12 @@ char readMethod(JavaClass* jc, method_info* entry)
 
         jc->attributeEntriesRead = 0;
 
+        // Attributes of methods, mostly their code, may be parsed later
+        char (*readEntry)(JavaClass*, attribute_info*) = jc->parseMode == CLASS_PARSE_LAZY ? readAttributeLazily : readAttribute;
+
         for (i = 0; i < entry->attributes_count; i++)
         {
-            if (!readAttribute(jc, entry->attributes + i))
+            if (!readEntry(jc, entry->attributes + i))
             {
                 // Only "i" + 1 attributes were attempted to read, so to avoid
                 // releasing uninitialized attributes (which could lead to a crash)
@@ -104,6 +110,92 @@ void freeMethodAttributes(method_info* entry)
     }
 }
 
+/// @brief Parses the attributes of a method that weren't parsed when
+/// the class was opened, see CLASS_PARSE_LAZY.
+///
+/// @param JavaClass* jc - the class that declares the method
+/// @param method_info* method - the method
+///
+/// @return 0 if an attribute is invalid, in which case the status
+/// of the class tells why, otherwise 1.
+/// @see loadMethodCode()
+uint8_t loadMethodAttributes(JavaClass* jc, method_info* method)
+{
+    uint16_t index;
+
+    for (index = 0; index < method->attributes_count; index++)
+    {
+        if (!loadAttribute(jc, method->attributes + index))
+            return 0;
+    }
+
+    return 1;
+}
+
+/// @brief Gets the Code attribute of a method, parsing it
+/// if that wasn't done when the class was opened.
+///
+/// @param JavaClass* jc - the class that declares the method
+/// @param method_info* method - the method
+/// @param att_Code_info** outCode - receives the code of the method,
+/// or NULL if the method has no code, as native and abstract methods.
+///
+/// @return 0 if the code is invalid, in which case the status
+/// of the class tells why, otherwise 1.
+uint8_t loadMethodCode(JavaClass* jc, method_info* method, att_Code_info** outCode)
+{
+    attribute_info* attribute = getAttributeByType(method->attributes, method->attributes_count, ATTR_Code);
+
+    *outCode = NULL;
+
+    if (!attribute)
+        return 1;
+
+    if (!loadAttribute(jc, attribute))
+        return 0;
+
+    *outCode = (att_Code_info*)attribute->info;
+    return 1;
+}
+
+/// @brief Gets the line of the source file of a bytecode offset of a method,
+/// from the LineNumberTable attributes of its code.
+/// @return The line, or -1 if the offset is negative or the method has no
+/// LineNumberTable.
+int32_t getMethodLineNumber(JavaClass* jc, method_info* method, int64_t offset)
+{
+    att_Code_info* code;
+    att_LineNumberTable_info* lines;
+    attribute_info* attribute;
+    int32_t line = -1, start = -1;
+    uint16_t index, entry;
+
+    if (offset < 0 || !loadMethodCode(jc, method, &code) || !code)
+        return -1;
+
+    // There may be more than one table, each with part of the lines
+    for (index = 0; index < code->attributes_count; index++)
+    {
+        attribute = code->attributes + index;
+
+        if (attribute->attributeType != ATTR_LineNumberTable || !attribute->info)
+            continue;
+
+        lines = (att_LineNumberTable_info*)attribute->info;
+
+        for (entry = 0; entry < lines->line_number_table_length; entry++)
+        {
+            if (lines->line_number_table[entry].start_pc <= offset && lines->line_number_table[entry].start_pc > start)
+            {
+                start = lines->line_number_table[entry].start_pc;
+                line = lines->line_number_table[entry].line_number;
+            }
+        }
+    }
+
+    return line;
+}
+
 /// @brief Function to print all methods of the class file.
 ///
 /// @param JavaClass *jc - pointer to JavaClass structure that must already
@@ -157,34 +249,175 @@ void printMethods(JavaClass* jc)
     }
 }
 
-method_info* getMethodMatching(JavaClass* jc, const uint8_t* name, int32_t name_len, const uint8_t* descriptor,
-                               int32_t descriptor_len, uint16_t flag_mask)
+/// @brief Builds the hash table used to find the methods of a class by
+/// their names and descriptors, see JavaClass::methodTable.
+/// @param JavaClass* jc - the class, whose methods have been read.
+/// @return 0 if memory couldn't be allocated, otherwise 1.
+uint8_t buildMethodTable(JavaClass* jc)
 {
-    method_info* method = jc->methods;
-    cp_info* cpi;
+    const cp_info* constantPool = jc->constantPool;
+    const method_info* method;
+    uint32_t capacity = 4, mask, slot;
     uint16_t index;
 
-    for (index = jc->methodCount; index > 0; index--, method++)
+    if (jc->methodCount == 0)
+        return 1;
+
+    // The table is kept at most half full
+    while (capacity < 2 * (uint32_t)jc->methodCount)
+        capacity *= 2;
+
+    jc->methodTable = (uint16_t*)malloc(capacity * sizeof(uint16_t));
+
+    if (!jc->methodTable)
+        return 0;
+
+    memset(jc->methodTable, 0, capacity * sizeof(uint16_t));
+
+    jc->methodTableCapacity = capacity;
+    mask = capacity - 1;
+
+    for (index = 0; index < jc->methodCount; index++)
     {
-        // Check if flags match
-        if ((method->access_flags & flag_mask) != flag_mask)
-            continue;
+        method = jc->methods + index;
+        slot = HASH_SYMBOL_PAIR(constantPool[method->name_index - 1].Utf8.symbol,
+                                constantPool[method->descriptor_index - 1].Utf8.symbol) & mask;
 
-        // Get the method name
-        cpi = jc->constantPool + method->name_index - 1;
-        // And check if it matches
-        if (!cmp_UTF8_Ascii(cpi->Utf8.bytes, cpi->Utf8.length, name, name_len))
-            continue;
+        while (jc->methodTable[slot])
+            slot = (slot + 1) & mask;
 
-        // Get the method descriptor
-        cpi = jc->constantPool + method->descriptor_index - 1;
-        // And check if it matches
-        if (!cmp_UTF8_Ascii(cpi->Utf8.bytes, cpi->Utf8.length, descriptor, descriptor_len))
-            continue;
+        jc->methodTable[slot] = index + 1;
+    }
 
+    return 1;
+}
+
+/// @brief Finds a method of a class by its name and descriptor.
+/// @param JavaClass* jc - the class that declares the method.
+/// @param const Symbol* name - interned name of the method.
+/// @param const Symbol* descriptor - interned descriptor of the method.
+/// @param uint16_t flag_mask - access flags that the method must have.
+/// @return The method that matches, or NULL if there is none.
+method_info* getMethodMatchingSymbols(JavaClass* jc, const Symbol* name, const Symbol* descriptor, uint16_t flag_mask)
+{
+    const cp_info* constantPool = jc->constantPool;
+    method_info* method;
+    uint32_t mask = jc->methodTableCapacity - 1;
+    uint32_t slot;
+
+    if (!jc->methodTable)
+        return NULL;
+
+    for (slot = HASH_SYMBOL_PAIR(name, descriptor) & mask; jc->methodTable[slot]; slot = (slot + 1) & mask)
+    {
+        method = jc->methods + jc->methodTable[slot] - 1;
 
-        return method;
+        // Names and descriptors are interned, so they can be compared by pointer
+        if (constantPool[method->name_index - 1].Utf8.symbol == name &&
+            constantPool[method->descriptor_index - 1].Utf8.symbol == descriptor)
+        {
+            // Check if flags match
+            return (method->access_flags & flag_mask) == flag_mask ? method : NULL;
+        }
     }
 
     return NULL;
 }
+
+/// @brief Finds a method of a class by its name and descriptor.
+///
+/// Same as getMethodMatchingSymbols(), for names and descriptors
+/// that aren't interned, such as string literals.
+method_info* getMethodMatching(JavaClass* jc, const uint8_t* name, int32_t name_len, const uint8_t* descriptor,
+                               int32_t descriptor_len, uint16_t flag_mask)
+{
+    // If a string hasn't been interned, no class has a method with that name or descriptor
+    const Symbol* nameSymbol = findSymbol(name, name_len);
+    const Symbol* descriptorSymbol = findSymbol(descriptor, descriptor_len);
+
+    if (!nameSymbol || !descriptorSymbol)
+        return NULL;
+
+    return getMethodMatchingSymbols(jc, nameSymbol, descriptorSymbol, flag_mask);
+}
+
+/// @brief Gets how many operands a method descriptor requires.
+/// @param const uint8_t* descriptor_utf8 - UTF-8 string containing the method
+/// descriptor
+/// @param int32_t utf8_len - length of the UTF-8 string
+///
+/// This function counts how many operands (which are 32-bit integers) are
+/// needed from a function with the given descriptor. For example, the following
+/// method: @code public int mymethod(long a, byte b) @endcode will have the
+/// following descriptor: (JB)I. When called, this method would require
+/// 3 operands to be passed as parameter, 2 to form the 64-bit long variable, and
+/// another one to form the 32-bit byte variable. A call to this function with that
+/// example descriptor will return 3, meaning that three operands should be popped
+/// from a caller frame and pushed to the callee frame.
+///
+/// @return Number of operands that need to be handled when calling a method
+/// with the given descriptor.
+uint8_t getMethodDescriptorParameterCount(const uint8_t* descriptor_utf8, int32_t utf8_len)
+{
+    uint8_t parameterCount = 0;
+
+    while (utf8_len > 0)
+    {
+        switch (*descriptor_utf8)
+        {
+            case '(': break;
+            case ')': return parameterCount;
+
+            case 'J': case 'D':
+                parameterCount += 2;
+                break;
+
+            case 'L':
+
+                parameterCount++;
+
+                do {
+                    utf8_len--;
+                    descriptor_utf8++;
+                } while (utf8_len > 0 && *descriptor_utf8 != ';');
+
+                break;
+
+            case '[':
+
+                parameterCount++;
+
+                do {
+                    utf8_len--;
+                    descriptor_utf8++;
+                } while (utf8_len > 0 && *descriptor_utf8 == '[');
+
+                if (utf8_len > 0 && *descriptor_utf8 == 'L')
+                {
+                    do {
+                        utf8_len--;
+                        descriptor_utf8++;
+                    } while (utf8_len > 0 && *descriptor_utf8 != ';');
+                }
+
+                break;
+
+            case 'F': // float
+            case 'B': // byte
+            case 'C': // char
+            case 'I': // int
+            case 'S': // short
+            case 'Z': // boolean
+                parameterCount++;
+                break;
+
+            default:
+                break;
+        }
+
+        descriptor_utf8++;
+        utf8_len--;
+    }
+
+    return parameterCount;
+}
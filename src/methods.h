@@ -6,6 +6,20 @@ typedef struct method_info method_info;
 #include <stdint.h>
 #include "javaclass.h"
 #include "attributes.h"
+#include "symbols.h"
+
+/// @brief What the JVM needs to know about the descriptor of a method
+/// to invoke it, parsed once when the method is read.
+typedef struct MethodSignature
+{
+    /// @brief Number of operands taken by the parameters of the
+    /// method, not counting the object of instance methods.
+    uint8_t parameterSlots;
+
+    /// @brief Tells if the classes named in the descriptor
+    /// have already been resolved, see resolveMethod().
+    uint8_t classesResolved;
+} MethodSignature;
 
 struct method_info {
     uint16_t access_flags;
@@ -13,12 +27,19 @@ struct method_info {
     uint16_t descriptor_index;
     uint16_t attributes_count;
     attribute_info* attributes;
+    MethodSignature signature;
 };
 
 char readMethod(JavaClass* jc, method_info* entry);
 void freeMethodAttributes(method_info* entry);
+uint8_t loadMethodAttributes(JavaClass* jc, method_info* method);
+uint8_t loadMethodCode(JavaClass* jc, method_info* method, att_Code_info** outCode);
+int32_t getMethodLineNumber(JavaClass* jc, method_info* method, int64_t offset);
 void printMethods(JavaClass* jc);
+uint8_t getMethodDescriptorParameterCount(const uint8_t* descriptor_utf8, int32_t utf8_len);
 
+uint8_t buildMethodTable(JavaClass* jc);
+method_info* getMethodMatchingSymbols(JavaClass* jc, const Symbol* name, const Symbol* descriptor, uint16_t flag_mask);
 method_info* getMethodMatching(JavaClass* jc, const uint8_t* name, int32_t name_len, const uint8_t* descriptor,
                                int32_t descriptor_len, uint16_t flag_mask);
 
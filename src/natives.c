@@ -3,6 +3,7 @@
 #include "debugging.h"
 #include "utf8.h"
 #include "jvm.h"
+#include "exceptions.h"
 #include <string.h>
 #include <inttypes.h>
 #include <time.h>
@@ -70,11 +71,11 @@ uint8_t native_println(JavaVirtualMachine* jvm, Frame* frame, const uint8_t* des
         case 'L':
         {
             popOperand(&frame->operands, &low, NULL);
-            Reference* obj = (Reference*)low;
+            Reference* obj = DECODE_REFERENCE(low);
 
             if (obj->type == REFTYPE_STRING)
             {
-                uint8_t* bytes = obj->str.utf8_bytes;
+                uint8_t* bytes = STRING_BYTES(obj);
                 int32_t len = obj->str.len;
 
                 if (len > 0)
@@ -119,6 +120,23 @@ uint8_t native_currentTimeMillis(JavaVirtualMachine* jvm, Frame* frame, const ui
     return 1;
 }
 
+uint8_t native_fillInStackTrace(JavaVirtualMachine* jvm, Frame* frame, const uint8_t* descriptor_utf8, int32_t utf8_len)
+{
+    int32_t throwable;
+
+    popOperand(&frame->operands, &throwable, NULL);
+    return fillInStackTrace(jvm, DECODE_REFERENCE(throwable));
+}
+
+uint8_t native_printStackTrace(JavaVirtualMachine* jvm, Frame* frame, const uint8_t* descriptor_utf8, int32_t utf8_len)
+{
+    int32_t throwable;
+
+    popOperand(&frame->operands, &throwable, NULL);
+    printStackTrace(DECODE_REFERENCE(throwable));
+    return 1;
+}
+
 NativeFunction getNative(const uint8_t* className, int32_t classLen,
                          const uint8_t* methodName, int32_t methodLen,
                          const uint8_t* descriptor, int32_t descrLen)
@@ -131,22 +149,32 @@ NativeFunction getNative(const uint8_t* className, int32_t classLen,
     } nativeMethods[] = {
         {"java/io/PrintStream", 19, "println", 7, NULL, 0, native_println},
         {"java/lang/System", 16, "currentTimeMillis", 17, NULL, 0, native_currentTimeMillis},
+
+        // Static helpers called by the simulated Throwable, see openSimulatedThrowable()
+        {"java/lang/Throwable", 19, "fillInStackTrace", 16, "(Ljava/lang/Throwable;)V", 24, native_fillInStackTrace},
+        {"java/lang/Throwable", 19, "printStackTrace", 15, "(Ljava/lang/Throwable;)V", 24, native_printStackTrace},
     };
 
     uint32_t index;
 
+    // Names are compared byte by byte, without decoding
+    // the characters, since both are valid UTF-8 strings.
+    #define EQUAL_NAMES(a, a_len, b, b_len) ((a_len) == (b_len) && !memcmp(a, b, b_len))
+
     for (index = 0; index < sizeof(nativeMethods)/sizeof(*nativeMethods); index++)
     {
-        if (cmp_UTF8((uint8_t*)nativeMethods[index].methodname, nativeMethods[index].methodlen, methodName, methodLen) &&
-            cmp_UTF8((uint8_t*)nativeMethods[index].classname, nativeMethods[index].classlen, className, classLen))
+        if (EQUAL_NAMES(nativeMethods[index].methodname, nativeMethods[index].methodlen, methodName, methodLen) &&
+            EQUAL_NAMES(nativeMethods[index].classname, nativeMethods[index].classlen, className, classLen))
         {
             if (!nativeMethods[index].descriptor ||
-                cmp_UTF8((uint8_t*)nativeMethods[index].descriptor, nativeMethods[index].descrlen, descriptor, descrLen))
+                EQUAL_NAMES(nativeMethods[index].descriptor, nativeMethods[index].descrlen, descriptor, descrLen))
             {
                 return nativeMethods[index].func;
             }
         }
     }
 
+    #undef EQUAL_NAMES
+
     return NULL;
 }
@@ -63,9 +63,10 @@ const char* getOpcodeMnemonic(uint8_t opcode)
         "getfield", "putfield", "invokevirtual", "invokespecial", "invokestatic", "invokeinterface",
         "invokedynamic", "new", "newarray", "anewarray", "arraylength", "athrow",
         "checkcast", "instanceof", "monitorenter", "monitorexit", "wide", "multianewarray",
-        "ifnull", "ifnonnull", "goto_w", "jsr_w", "breakpoint", NULL,
-        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-        NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+        "ifnull", "ifnonnull", "goto_w", "jsr_w", "breakpoint", "getstatic_quick",
+        "getstatic2_quick", "putstatic_quick", "putstatic2_quick", "getfield_quick", "getfield2_quick", "putfield_quick",
+        "putfield2_quick", "invokevirtual_quick", "invokeinterface_quick", "invokenative_quick", "invokestatic_quick", "invokespecial_quick",
+        "checkcast_quick", "instanceof_quick", NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
         NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
         NULL, NULL, "impdep1", "impdep2"
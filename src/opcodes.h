@@ -74,7 +74,20 @@ enum Opcodes {
     opcode_jsr_w = 0xC9,
 
     // Reserved
-    opcode_breakpoint = 0xCA, opcode_impdep1 = 0xFE, opcode_impdep2 = 0xFF
+    opcode_breakpoint = 0xCA, opcode_impdep1 = 0xFE, opcode_impdep2 = 0xFF,
+
+    // Internal opcodes, not allowed in class files. Field and invoke
+    // instructions are rewritten into these quick variants once their
+    // constant pool entry is resolved. The "2" variants access category 2
+    // (long/double) fields. invokenative_quick calls a simulated method.
+    // invokestatic_quick and invokespecial_quick call the method found
+    // the first time the instruction was executed. checkcast_quick and
+    // instanceof_quick check objects against an already resolved class.
+    opcode_getstatic_quick = 0xCB, opcode_getstatic2_quick = 0xCC, opcode_putstatic_quick = 0xCD,
+    opcode_putstatic2_quick = 0xCE, opcode_getfield_quick = 0xCF, opcode_getfield2_quick = 0xD0,
+    opcode_putfield_quick = 0xD1, opcode_putfield2_quick = 0xD2, opcode_invokevirtual_quick = 0xD3,
+    opcode_invokeinterface_quick = 0xD4, opcode_invokenative_quick = 0xD5, opcode_invokestatic_quick = 0xD6,
+    opcode_invokespecial_quick = 0xD7, opcode_checkcast_quick = 0xD8, opcode_instanceof_quick = 0xD9
 };
 
 typedef enum Opcode_newarray_type {
@@ -3,65 +3,40 @@
 
 ///@brief Push the operand on the top of OperandStack passed as parameter by reference
 ///
-///@param OperandStack** os - pointer to the OperandStack where the operand will be pushed.
+///@param OperandStack* os - pointer to the OperandStack where the operand will be pushed.
 ///@param int32_t value - value of the operand.
 ///@param OperandType type - type of the operand that will be pushed
 ///
-///@return 0 if OperandStack* node is NULL, in other words, if the push was not successful, 1 otherwise
-uint8_t pushOperand(OperandStack** os, int32_t value, enum OperandType type)
+///@return 0 if the OperandStack is full, in other words, if the push was not successful, 1 otherwise
+uint8_t pushOperand(OperandStack* os, int32_t value, enum OperandType type)
 {
-    OperandStack* node = (OperandStack*)malloc(sizeof(OperandStack));
+    if (os->top >= os->capacity)
+        return 0;
 
-    if (node)
-    {
-        node->value = value;
-        node->type = type;
-        node->next = *os;
-        *os = node;
-    }
-
-    return node != NULL;
+    os->values[os->top] = value;
+    os->types[os->top++] = type;
+    return 1;
 }
+
 ///@brief Pop the operand out of the top of OperandStack passed as parameter by reference
 ///
-///@param OperandStack** os - pointer to the OperandStack.
+///@param OperandStack* os - pointer to the OperandStack.
 ///@param int32_t* outPtr - value of the operand that will be popped.
 ///@param OperandType outType - type of the operand that will be popped.
 ///
 ///@return 0 if the pop operation was not successful, 1 otherwise.
-uint8_t popOperand(OperandStack** os, int32_t* outPtr, enum OperandType* outType)
+uint8_t popOperand(OperandStack* os, int32_t* outPtr, enum OperandType* outType)
 {
-    OperandStack* node = *os;
-
-    if (node)
-    {
-        if (outPtr)
-            *outPtr = node->value;
-
-        if (outType)
-            *outType = node->type;
+    if (os->top == 0)
+        return 0;
 
-        *os = node->next;
-        free(node);
-    }
+    os->top--;
 
-    return node != NULL;
-}
-
-///@brief Free all the elements of the OperandStack passed as parameter by reference
-///
-///@param OperandStack** os - pointer to the OperandStack.
-void freeOperandStack(OperandStack** os)
-{
-    OperandStack* node = *os;
-    OperandStack* tmp;
+    if (outPtr)
+        *outPtr = os->values[os->top];
 
-    while (node)
-    {
-        tmp = node;
-        node = node->next;
-        free(tmp);
-    }
+    if (outType)
+        *outType = os->types[os->top];
 
-    *os = NULL;
+    return 1;
 }
@@ -10,15 +10,30 @@ typedef enum OperandType {
     OP_NULL, OP_REFERENCE, OP_RETURNADDRESS
 } OperandType;
 
+/// @brief Operand stack of a frame.
+///
+/// The slots are stored contiguously in the stack of the JVM,
+/// right after the local variables of the frame, and the stack
+/// is sized from the max_stack of the method's Code attribute.
+/// Pushing and popping operands never needs to allocate memory.
+/// @see FrameStack
 struct OperandStack
 {
-    int32_t value;
-    OperandType type;
-    OperandStack* next;
+    /// @brief Values of the operands.
+    int32_t* values;
+
+    /// @brief Types of the operands, parallel to the values array.
+    OperandType* types;
+
+    /// @brief Index of the next free slot, which is
+    /// also the number of operands in the stack.
+    uint16_t top;
+
+    /// @brief Number of slots of the stack.
+    uint16_t capacity;
 };
 
-uint8_t pushOperand(OperandStack** os, int32_t value, OperandType type);
-uint8_t popOperand(OperandStack** os, int32_t* outPtr, OperandType* outType);
-void freeOperandStack(OperandStack** os);
+uint8_t pushOperand(OperandStack* os, int32_t value, OperandType type);
+uint8_t popOperand(OperandStack* os, int32_t* outPtr, OperandType* outType);
 
 #endif // OPERAND_STACK
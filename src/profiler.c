@@ -0,0 +1,386 @@
+// Needed for clock_gettime() in strict C99 mode
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "profiler.h"
+#include "opcodes.h"
+#include "debugging.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <x86intrin.h>
+    #define PROFILER_USES_TSC
+#endif
+
+/// @brief Initial number of slots of the table of method profiles.
+/// Must be a power of two.
+#define METHOD_PROFILE_TABLE_INITIAL_CAPACITY 256
+
+/// @brief Initializes an empty profile.
+void initProfiler(Profiler* profiler)
+{
+    memset(profiler, 0, sizeof(Profiler));
+    profiler->lastTick = getProfilerTicks();
+}
+
+/// @brief Frees all method profiles of a profiler.
+void freeProfiler(Profiler* profiler)
+{
+    uint32_t index;
+
+    for (index = 0; index < profiler->methodCapacity; index++)
+    {
+        if (profiler->methods[index])
+            free(profiler->methods[index]);
+    }
+
+    if (profiler->methods)
+        free(profiler->methods);
+
+    profiler->methods = NULL;
+    profiler->methodCapacity = 0;
+    profiler->methodCount = 0;
+}
+
+/// @brief Gets the current time, in ticks of the profiler.
+///
+/// On x86 processors, this is the time stamp counter, which is read
+/// in a few cycles. Elsewhere, a monotonic clock in nanoseconds is used.
+/// @see getProfilerTickUnit()
+uint64_t getProfilerTicks(void)
+{
+#ifdef PROFILER_USES_TSC
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + now.tv_nsec;
+#endif // PROFILER_USES_TSC
+}
+
+/// @brief Gets the name of the unit of the ticks of the profiler.
+const char* getProfilerTickUnit(void)
+{
+#ifdef PROFILER_USES_TSC
+    return "cycles";
+#else
+    return "ns";
+#endif // PROFILER_USES_TSC
+}
+
+/// @brief Hash of the names that identify a method profile.
+#define HASH_METHOD_PROFILE(className, name, descriptor) \
+    (HASH_SYMBOL_PAIR(className, name) * 31u + (descriptor)->hash)
+
+/// @brief Finds the slot of the table of method profiles where the profile
+/// of a method is stored, or the empty slot where it should be added.
+static uint32_t findMethodProfileSlot(Profiler* profiler, const Symbol* className, const Symbol* name,
+                                      const Symbol* descriptor)
+{
+    uint32_t mask = profiler->methodCapacity - 1;
+    uint32_t slot = HASH_METHOD_PROFILE(className, name, descriptor) & mask;
+    MethodProfile* method;
+
+    while ((method = profiler->methods[slot]) != NULL)
+    {
+        if (method->className == className && method->name == name && method->descriptor == descriptor)
+            break;
+
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/// @brief Doubles the number of slots of the table of method profiles,
+/// or allocates the table if it is empty.
+/// @return 1 on success, 0 if memory allocation failed.
+static uint8_t growMethodProfileTable(Profiler* profiler)
+{
+    uint32_t oldCapacity = profiler->methodCapacity;
+    uint32_t newCapacity = oldCapacity ? 2 * oldCapacity : METHOD_PROFILE_TABLE_INITIAL_CAPACITY;
+    MethodProfile** oldTable = profiler->methods;
+    MethodProfile** newTable = (MethodProfile**)malloc(newCapacity * sizeof(MethodProfile*));
+    MethodProfile* method;
+    uint32_t index;
+
+    if (!newTable)
+        return 0;
+
+    memset(newTable, 0, newCapacity * sizeof(MethodProfile*));
+    profiler->methods = newTable;
+    profiler->methodCapacity = newCapacity;
+
+    for (index = 0; index < oldCapacity; index++)
+    {
+        method = oldTable[index];
+
+        if (method)
+            newTable[findMethodProfileSlot(profiler, method->className, method->name, method->descriptor)] = method;
+    }
+
+    if (oldTable)
+        free(oldTable);
+
+    return 1;
+}
+
+/// @brief Gets the profile of a method, creating it the first time the method runs.
+/// @param Profiler* profiler - the profiler
+/// @param const Symbol* className - name of the class of the method
+/// @param const Symbol* name - name of the method
+/// @param const Symbol* descriptor - descriptor of the method
+/// @param uint8_t isNative - whether the method is native or simulated
+/// @return The profile of the method, or NULL if memory allocation failed.
+MethodProfile* getMethodProfile(Profiler* profiler, const Symbol* className, const Symbol* name,
+                                const Symbol* descriptor, uint8_t isNative)
+{
+    uint32_t slot;
+    MethodProfile* method;
+
+    if (profiler->methodCount > 0)
+    {
+        slot = findMethodProfileSlot(profiler, className, name, descriptor);
+
+        if (profiler->methods[slot])
+            return profiler->methods[slot];
+    }
+
+    // Keep the load factor of the table at most 1/2
+    if (2 * (profiler->methodCount + 1) > profiler->methodCapacity && !growMethodProfileTable(profiler))
+        return NULL;
+
+    method = (MethodProfile*)malloc(sizeof(MethodProfile));
+
+    if (!method)
+        return NULL;
+
+    memset(method, 0, sizeof(MethodProfile));
+    method->className = className;
+    method->name = name;
+    method->descriptor = descriptor;
+    method->isNative = isNative;
+
+    profiler->methods[findMethodProfileSlot(profiler, className, name, descriptor)] = method;
+    profiler->methodCount++;
+    return method;
+}
+
+/// @brief Charges the time elapsed since the last call to the opcode and to the
+/// method that were running, then sets what is running from now on.
+/// @param Profiler* profiler - the profiler
+/// @param MethodProfile* method - the method starting to run, or NULL
+/// @param OpcodeProfile* opcode - the opcode starting to run, or NULL. Its
+/// execution count is incremented.
+///
+/// Called before each instruction and native runs, and with NULL arguments
+/// at exit, so the last instruction is also charged.
+void chargeProfileTicks(Profiler* profiler, MethodProfile* method, OpcodeProfile* opcode)
+{
+    uint64_t now = getProfilerTicks();
+    uint64_t elapsed = now - profiler->lastTick;
+
+    if (profiler->currentMethod)
+        profiler->currentMethod->ticks += elapsed;
+
+    if (profiler->currentOpcode)
+        profiler->currentOpcode->ticks += elapsed;
+
+    if (opcode)
+        opcode->executions++;
+
+    profiler->currentMethod = method;
+    profiler->currentOpcode = opcode;
+    profiler->lastTick = now;
+}
+
+/// @brief Counts an invocation of a native or simulated method, and
+/// charges the time from now on to it.
+/// @return 1 on success, 0 if memory allocation failed.
+uint8_t profileNativeCall(Profiler* profiler, const Symbol* className, const Symbol* name, const Symbol* descriptor)
+{
+    MethodProfile* method = getMethodProfile(profiler, className, name, descriptor, 1);
+
+    if (!method)
+        return 0;
+
+    method->invocations++;
+    chargeProfileTicks(profiler, method, NULL);
+    return 1;
+}
+
+/// @brief Prints the name of a method as "package.Class.method(descriptor)".
+static void printMethodName(FILE* file, MethodProfile* method)
+{
+    int32_t index;
+
+    for (index = 0; index < method->className->length; index++)
+        fputc(method->className->bytes[index] == '/' ? '.' : method->className->bytes[index], file);
+
+    fprintf(file, ".%.*s%.*s", method->name->length, method->name->bytes,
+            method->descriptor->length, method->descriptor->bytes);
+}
+
+static int compareOpcodeTicks(const void* a, const void* b)
+{
+    const OpcodeProfile* first = *(const OpcodeProfile* const*)a;
+    const OpcodeProfile* second = *(const OpcodeProfile* const*)b;
+
+    return (first->ticks < second->ticks) - (first->ticks > second->ticks);
+}
+
+static int compareMethodTicks(const void* a, const void* b)
+{
+    const MethodProfile* first = *(const MethodProfile* const*)a;
+    const MethodProfile* second = *(const MethodProfile* const*)b;
+
+    return (first->ticks < second->ticks) - (first->ticks > second->ticks);
+}
+
+/// @brief Lists the opcodes that were executed, sorted by time, longest first.
+/// @return The number of opcodes in \c outOpcodes.
+static uint32_t sortOpcodes(Profiler* profiler, OpcodeProfile** outOpcodes)
+{
+    uint32_t count = 0, index;
+
+    for (index = 0; index < 256; index++)
+    {
+        if (profiler->opcodes[index].executions)
+            outOpcodes[count++] = profiler->opcodes + index;
+    }
+
+    qsort(outOpcodes, count, sizeof(OpcodeProfile*), compareOpcodeTicks);
+    return count;
+}
+
+/// @brief Lists the profiles of all methods, sorted by time, longest first.
+/// @return The list, which must be freed, or NULL if there are no methods or
+/// memory allocation failed.
+static MethodProfile** sortMethods(Profiler* profiler)
+{
+    MethodProfile** methods;
+    uint32_t count = 0, index;
+
+    if (profiler->methodCount == 0)
+        return NULL;
+
+    methods = (MethodProfile**)malloc(profiler->methodCount * sizeof(MethodProfile*));
+
+    if (!methods)
+        return NULL;
+
+    for (index = 0; index < profiler->methodCapacity; index++)
+    {
+        if (profiler->methods[index])
+            methods[count++] = profiler->methods[index];
+    }
+
+    qsort(methods, count, sizeof(MethodProfile*), compareMethodTicks);
+    return methods;
+}
+
+/// @brief Prints the opcodes and methods that took the most time.
+///
+/// Each one is printed with its share of the total time. Times of methods
+/// don't include the methods they invoked.
+void printProfile(Profiler* profiler)
+{
+    OpcodeProfile* opcodes[256];
+    MethodProfile** methods = sortMethods(profiler);
+    uint32_t opcodeCount = sortOpcodes(profiler, opcodes);
+    uint64_t totalTicks = 0;
+    uint32_t index;
+    const char* unit = getProfilerTickUnit();
+
+    for (index = 0; index < opcodeCount; index++)
+        totalTicks += opcodes[index]->ticks;
+
+    for (index = 0; index < profiler->methodCount && methods; index++)
+    {
+        if (methods[index]->isNative)
+            totalTicks += methods[index]->ticks;
+    }
+
+    if (totalTicks == 0)
+        totalTicks = 1;
+
+    printf("\n%-24s %14s %16s %8s %12s\n", "opcode", "executions", unit, "%", "per exec");
+
+    for (index = 0; index < opcodeCount && index < PROFILE_PRINTED_ROWS; index++)
+    {
+        OpcodeProfile* opcode = opcodes[index];
+
+        printf("%-24s %14llu %16llu %7.2f%% %12.1f\n", getOpcodeMnemonic((uint8_t)(opcode - profiler->opcodes)),
+               (unsigned long long)opcode->executions, (unsigned long long)opcode->ticks,
+               100.0 * opcode->ticks / totalTicks, (double)opcode->ticks / opcode->executions);
+    }
+
+    printf("\n%14s %14s %16s %8s  %s\n", "invocations", "instructions", unit, "%", "method");
+
+    for (index = 0; index < profiler->methodCount && index < PROFILE_PRINTED_ROWS && methods; index++)
+    {
+        MethodProfile* method = methods[index];
+
+        printf("%14llu %14llu %16llu %7.2f%%  ", (unsigned long long)method->invocations,
+               (unsigned long long)method->instructions, (unsigned long long)method->ticks,
+               100.0 * method->ticks / totalTicks);
+        printMethodName(stdout, method);
+        printf(method->isNative ? " (native)\n" : "\n");
+    }
+
+    if (methods)
+        free(methods);
+}
+
+/// @brief Writes the whole profile to a CSV file.
+///
+/// The file has a header line and one line per opcode and per method, with the columns
+/// "kind" ("opcode", "method" or "native"), "name", "count" (executions of opcodes and
+/// invocations of methods), "instructions" (executed by the method itself) and "ticks".
+/// Rows are sorted by time, longest first.
+/// @return 1 on success, 0 if the file couldn't be written.
+uint8_t writeProfile(Profiler* profiler, const char* path)
+{
+    OpcodeProfile* opcodes[256];
+    MethodProfile** methods = sortMethods(profiler);
+    uint32_t opcodeCount = sortOpcodes(profiler, opcodes);
+    uint32_t index;
+    FILE* file;
+
+    if (profiler->methodCount && !methods)
+        return 0;
+
+    file = fopen(path, "w");
+
+    if (!file)
+    {
+        if (methods)
+            free(methods);
+
+        return 0;
+    }
+
+    fprintf(file, "kind,name,count,instructions,ticks\n");
+
+    for (index = 0; index < opcodeCount; index++)
+    {
+        fprintf(file, "opcode,%s,%llu,%llu,%llu\n", getOpcodeMnemonic((uint8_t)(opcodes[index] - profiler->opcodes)),
+                (unsigned long long)opcodes[index]->executions, (unsigned long long)opcodes[index]->executions,
+                (unsigned long long)opcodes[index]->ticks);
+    }
+
+    for (index = 0; index < profiler->methodCount; index++)
+    {
+        fprintf(file, "%s,\"", methods[index]->isNative ? "native" : "method");
+        printMethodName(file, methods[index]);
+        fprintf(file, "\",%llu,%llu,%llu\n", (unsigned long long)methods[index]->invocations,
+                (unsigned long long)methods[index]->instructions, (unsigned long long)methods[index]->ticks);
+    }
+
+    if (methods)
+        free(methods);
+
+    return fclose(file) == 0;
+}
@@ -0,0 +1,98 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include "symbols.h"
+
+/// @brief Number of rows of each table printed by printProfile().
+/// The CSV file written by writeProfile() has all of them.
+#define PROFILE_PRINTED_ROWS 20
+
+/// @brief Execution counts and time of an opcode.
+typedef struct OpcodeProfile
+{
+    /// @brief Number of instructions executed with the opcode.
+    uint64_t executions;
+
+    /// @brief Time spent in the instructions, in ticks.
+    /// @see getProfilerTicks()
+    uint64_t ticks;
+} OpcodeProfile;
+
+/// @brief Invocations and time of a method.
+typedef struct MethodProfile
+{
+    /// @brief Names of the class, of the method and of its descriptor.
+    const Symbol* className;
+    const Symbol* name;
+    const Symbol* descriptor;
+
+    /// @brief Boolean telling if the method is native or simulated,
+    /// so it has no instructions.
+    uint8_t isNative;
+
+    uint64_t invocations;
+
+    /// @brief Number of instructions executed by the method itself,
+    /// without the methods it invoked.
+    uint64_t instructions;
+
+    /// @brief Time spent in the method itself, in ticks, without
+    /// the methods it invoked.
+    uint64_t ticks;
+} MethodProfile;
+
+/// @brief Execution profile of a JVM, by opcode and by method.
+///
+/// The time between two consecutive calls to chargeProfileTicks() is charged
+/// to the opcode and to the method that were running, so the time of each
+/// instruction and method excludes the methods they invoke.
+/// @see initProfiler(), printProfile(), writeProfile()
+typedef struct Profiler
+{
+    OpcodeProfile opcodes[256];
+
+    /// @brief Open addressing hash table of the profiles of all methods that
+    /// were run, keyed by the names of their class, method and descriptor.
+    MethodProfile** methods;
+    uint32_t methodCapacity;
+    uint32_t methodCount;
+
+    /// @brief Ticks at the last call to chargeProfileTicks().
+    uint64_t lastTick;
+
+    /// @brief What is running since \c lastTick, either of which can be NULL.
+    MethodProfile* currentMethod;
+    OpcodeProfile* currentOpcode;
+} Profiler;
+
+void initProfiler(Profiler* profiler);
+void freeProfiler(Profiler* profiler);
+uint64_t getProfilerTicks(void);
+const char* getProfilerTickUnit(void);
+MethodProfile* getMethodProfile(Profiler* profiler, const Symbol* className, const Symbol* name,
+                                const Symbol* descriptor, uint8_t isNative);
+void chargeProfileTicks(Profiler* profiler, MethodProfile* method, OpcodeProfile* opcode);
+uint8_t profileNativeCall(Profiler* profiler, const Symbol* className, const Symbol* name, const Symbol* descriptor);
+void printProfile(Profiler* profiler);
+uint8_t writeProfile(Profiler* profiler, const char* path);
+
+#endif // PROFILER_H
+
+/// @defgroup profiler Profiler module
+///
+/// @brief Counts how many times each opcode and each method runs,
+/// and how much time is spent in them.
+///
+/// The JVM is only profiled if a Profiler is given to it, with the "-prof"
+/// option. executeFrame() then runs the frames with a separate dispatch loop
+/// that charges the time of each instruction, and natives are charged when
+/// they are invoked (see profileNativeCall()). Without a profiler, the only
+/// cost is a check when a frame starts running and when a native is invoked.
+///
+/// Time is measured with the time stamp counter of the processor when it is
+/// available, in cycles, otherwise with a monotonic clock, in nanoseconds. At
+/// exit, the opcodes and methods that took the most time are printed, and the
+/// whole profile is written to a CSV file.
+///
+/// @see profiler.c
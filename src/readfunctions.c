@@ -3,13 +3,23 @@
 #include "validity.h"
 #include <math.h>
 
-/// @cond
-static const union {
-    uint16_t value;
-    uint8_t bytes[2];
-} byte_order = {1};
-#define IS_LITTLE_ENDIAN byte_order.bytes[1]
-/// @endcond
+/// @brief Takes a number of bytes from the data of a class file,
+/// advancing the read cursor past them.
+/// @param JavaClass* jc - pointer to an already open JavaClass file
+/// @param uint32_t count - number of bytes to be read
+/// @return Pointer to the first byte read, pointing into the class file
+/// data, or NULL if there aren't \c count bytes left to be read.
+const uint8_t* readBytes(JavaClass* jc, uint32_t count)
+{
+    const uint8_t* bytes;
+
+    if (count > jc->fileSize - jc->totalBytesRead)
+        return NULL;
+
+    bytes = jc->fileData + jc->totalBytesRead;
+    jc->totalBytesRead += count;
+    return bytes;
+}
 
 /// @brief Reads a four-byte unsigned integer from the JavaClass file
 /// @param JavaClass* jc - poiter to an already open JavaClass file
@@ -18,18 +28,13 @@ static const union {
 /// @return 1 in case of success, 0 in case of failure
 uint8_t readu4(JavaClass* jc, uint32_t* out)
 {
-    uint32_t u4 = 0;
+    const uint8_t* bytes = readBytes(jc, 4);
 
-    if (fread(&u4, sizeof(uint32_t), 1, jc->file) != 1)
+    if (!bytes)
         return 0;
 
-    jc->totalBytesRead += 4;
-
-    if (!IS_LITTLE_ENDIAN)
-        u4 = (u4 >> 24) | ((u4 & 0xFF0000) >> 8) | ((u4 & 0xFF00) << 8) | ((u4 & 0xFF) << 24);
-
     if (out)
-        *out = u4;
+        *out = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
 
     return 1;
 }
@@ -41,19 +46,31 @@ uint8_t readu4(JavaClass* jc, uint32_t* out)
 /// @return 1 in case of success, 0 in case of failure
 uint8_t readu2(JavaClass* jc, uint16_t* out)
 {
-    uint16_t u2 = 0;
+    const uint8_t* bytes = readBytes(jc, 2);
 
-    if (fread(&u2, sizeof(uint16_t), 1, jc->file) != 1)
+    if (!bytes)
         return 0;
 
-    jc->totalBytesRead += 2;
+    if (out)
+        *out = (uint16_t)((bytes[0] << 8) | bytes[1]);
 
-    if (!IS_LITTLE_ENDIAN)
-        u2 = (u2 >> 8) | ((u2 & 0xFF) << 8);
+    return 1;
+}
+
+/// @brief Reads a one-byte unsigned integer from the JavaClass file
+/// @param JavaClass* jc - poiter to an already open JavaClass file
+/// @param [out] uint8_t* out - pointer to variable that will receive
+/// the value read, if non null.
+/// @return 1 in case of success, 0 in case of failure
+uint8_t readu1(JavaClass* jc, uint8_t* out)
+{
+    if (jc->totalBytesRead >= jc->fileSize)
+        return 0;
 
     if (out)
-        *out = u2;
+        *out = jc->fileData[jc->totalBytesRead];
 
+    jc->totalBytesRead++;
     return 1;
 }
 
@@ -67,7 +84,7 @@ uint8_t readu2(JavaClass* jc, uint16_t* out)
 // Number of bytes read could differ from number of characters read, as classes
 // could have UTF-8 identifiers that require more than one byte in the representation
 // of some character. This function stops once it sucessfully reads one field descriptor.
-int32_t readFieldDescriptor(uint8_t* utf8_bytes, int32_t utf8_len, char checkValidClassIdentifier)
+int32_t readFieldDescriptor(const uint8_t* utf8_bytes, int32_t utf8_len, char checkValidClassIdentifier)
 {
     int32_t totalBytesRead = 0;
     uint32_t utf8_char;
@@ -91,7 +108,7 @@ int32_t readFieldDescriptor(uint8_t* utf8_bytes, int32_t utf8_len, char checkVal
         case 'B': case 'C': case 'D': case 'F': case 'I': case 'J': case 'S': case 'Z': break;
         case 'L':
         {
-            uint8_t* identifierBegin = utf8_bytes;
+            const uint8_t* identifierBegin = utf8_bytes;
             int32_t identifierLength = 0;
 
             do
@@ -131,7 +148,7 @@ int32_t readFieldDescriptor(uint8_t* utf8_bytes, int32_t utf8_len, char checkVal
 // Number of bytes read could differ from number of characters read, as classes
 // could have UTF-8 identifiers that require more than one byte in the representation
 // of some character. This function stops once it sucessfully reads one method descriptor.
-int32_t readMethodDescriptor(uint8_t* utf8_bytes, int32_t utf8_len, char checkValidClassIdentifier)
+int32_t readMethodDescriptor(const uint8_t* utf8_bytes, int32_t utf8_len, char checkValidClassIdentifier)
 {
     int32_t bytesProcessed = 0;
     uint32_t utf8_char;
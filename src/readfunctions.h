@@ -6,10 +6,12 @@
 #include "javaclass.h"
 #include "constantpool.h"
 
+const uint8_t* readBytes(struct JavaClass* jc, uint32_t count);
 uint8_t readu4(struct JavaClass* jc, uint32_t* out);
 uint8_t readu2(struct JavaClass* jc, uint16_t* out);
-int32_t readFieldDescriptor(uint8_t* utf8_bytes, int32_t utf8_len, char checkValidClassIdentifier);
-int32_t readMethodDescriptor(uint8_t* utf8_bytes, int32_t utf8_len, char checkValidClassIdentifier);
+uint8_t readu1(struct JavaClass* jc, uint8_t* out);
+int32_t readFieldDescriptor(const uint8_t* utf8_bytes, int32_t utf8_len, char checkValidClassIdentifier);
+int32_t readMethodDescriptor(const uint8_t* utf8_bytes, int32_t utf8_len, char checkValidClassIdentifier);
 float readFloatFromUint32(uint32_t bytes);
 double readDoubleFromUint64(uint64_t bytes);
 
@@ -0,0 +1,369 @@
+// Needed for sigaction() and setitimer() in strict C99 mode
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sampler.h"
+#include "methods.h"
+#include "utf8.h"
+#include "debugging.h"
+
+#ifdef SAMPLER_USES_TIMER
+    #include <sys/time.h>
+#endif
+
+/// @brief Initial number of slots of the table of sampled stacks.
+/// Must be a power of two.
+#define SAMPLED_STACK_TABLE_INITIAL_CAPACITY 256
+
+#ifdef SAMPLER_USES_TIMER
+
+/// @brief The sampler whose timer is running. There can only be one,
+/// as the signal is sent to the whole process.
+static Sampler* runningSampler;
+
+/// @brief The action of SIGPROF before the sampler started.
+static struct sigaction previousAction;
+
+static void requestSample(int signal)
+{
+    if (runningSampler)
+        runningSampler->pending = 1;
+}
+
+#endif // SAMPLER_USES_TIMER
+
+/// @brief Initializes a sampler without samples.
+/// @param Sampler* sampler - the sampler
+/// @param uint32_t interval - time between samples, in microseconds
+void initSampler(Sampler* sampler, uint32_t interval)
+{
+    memset(sampler, 0, sizeof(Sampler));
+    sampler->interval = interval ? interval : SAMPLER_DEFAULT_INTERVAL;
+    sampler->countdown = sampler->interval * SAMPLER_INSTRUCTIONS_PER_MICROSECOND;
+}
+
+/// @brief Starts the timer that requests samples.
+/// @return 1 on success, 0 if the timer couldn't be started.
+uint8_t startSampler(Sampler* sampler)
+{
+#ifdef SAMPLER_USES_TIMER
+    struct sigaction action;
+    struct itimerval timer;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestSample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (runningSampler || sigaction(SIGPROF, &action, &previousAction))
+        return 0;
+
+    runningSampler = sampler;
+
+    timer.it_interval.tv_sec = sampler->interval / 1000000;
+    timer.it_interval.tv_usec = sampler->interval % 1000000;
+    timer.it_value = timer.it_interval;
+
+    if (setitimer(ITIMER_PROF, &timer, NULL))
+    {
+        sigaction(SIGPROF, &previousAction, NULL);
+        runningSampler = NULL;
+        return 0;
+    }
+#endif // SAMPLER_USES_TIMER
+
+    return 1;
+}
+
+/// @brief Stops the timer that requests samples.
+void stopSampler(Sampler* sampler)
+{
+#ifdef SAMPLER_USES_TIMER
+    struct itimerval timer;
+
+    if (runningSampler != sampler)
+        return;
+
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    sigaction(SIGPROF, &previousAction, NULL);
+    runningSampler = NULL;
+#endif // SAMPLER_USES_TIMER
+}
+
+/// @brief Frees all stacks sampled.
+void freeSampler(Sampler* sampler)
+{
+    uint32_t index;
+
+    stopSampler(sampler);
+
+    for (index = 0; index < sampler->stackCapacity; index++)
+    {
+        if (sampler->stacks[index])
+            free(sampler->stacks[index]);
+    }
+
+    if (sampler->stacks)
+        free(sampler->stacks);
+
+    sampler->stacks = NULL;
+    sampler->stackCapacity = 0;
+    sampler->stackCount = 0;
+}
+
+/// @brief Gets the method being executed by a frame.
+static void getSampledFrame(Frame* frame, SampledFrame* outFrame)
+{
+    outFrame->jc = frame->jc;
+    outFrame->method = frame->method;
+
+    // The pc of a frame is the instruction after the one being executed
+    outFrame->offset = frame->pc > 0 ? (int32_t)frame->instructions[frame->pc - 1].offset : -1;
+    outFrame->line = -1;
+}
+
+/// @brief Hashes the frames of a stack.
+static uint32_t hashFrames(FrameStack* frames)
+{
+    uint32_t hash = frames->frameCount;
+    SampledFrame sampled;
+    uint32_t index;
+
+    for (index = 0; index < frames->frameCount; index++)
+    {
+        getSampledFrame(frames->frames + index, &sampled);
+        hash = hash * 31u + (uint32_t)((uintptr_t)sampled.method >> 3);
+        hash = hash * 31u + (uint32_t)sampled.offset;
+    }
+
+    return hash;
+}
+
+/// @brief Tells if a sampled stack has the same frames as a stack of frames.
+static uint8_t isSameStack(SampledStack* stack, uint32_t hash, FrameStack* frames)
+{
+    SampledFrame sampled;
+    uint32_t index;
+
+    if (stack->hash != hash || stack->depth != frames->frameCount)
+        return 0;
+
+    for (index = 0; index < stack->depth; index++)
+    {
+        getSampledFrame(frames->frames + index, &sampled);
+
+        if (stack->frames[index].method != sampled.method || stack->frames[index].offset != sampled.offset)
+            return 0;
+    }
+
+    return 1;
+}
+
+/// @brief Doubles the number of slots of the table of sampled stacks,
+/// or allocates the table if it is empty.
+/// @return 1 on success, 0 if memory allocation failed.
+static uint8_t growSampledStackTable(Sampler* sampler)
+{
+    uint32_t oldCapacity = sampler->stackCapacity;
+    uint32_t newCapacity = oldCapacity ? 2 * oldCapacity : SAMPLED_STACK_TABLE_INITIAL_CAPACITY;
+    SampledStack** oldTable = sampler->stacks;
+    SampledStack** newTable = (SampledStack**)malloc(newCapacity * sizeof(SampledStack*));
+    uint32_t index, slot;
+
+    if (!newTable)
+        return 0;
+
+    memset(newTable, 0, newCapacity * sizeof(SampledStack*));
+
+    for (index = 0; index < oldCapacity; index++)
+    {
+        if (!oldTable[index])
+            continue;
+
+        slot = oldTable[index]->hash & (newCapacity - 1);
+
+        while (newTable[slot])
+            slot = (slot + 1) & (newCapacity - 1);
+
+        newTable[slot] = oldTable[index];
+    }
+
+    if (oldTable)
+        free(oldTable);
+
+    sampler->stacks = newTable;
+    sampler->stackCapacity = newCapacity;
+    return 1;
+}
+
+/// @brief Counts a sample of the current stack of frames of the JVM.
+/// @param Sampler* sampler - the sampler, whose pending sample is taken
+/// @param FrameStack* frames - the frames of the JVM, which must be between
+/// two instructions
+///
+/// Only the class, method and bytecode offset of each frame are kept. The
+/// first time a stack is seen, a copy is added to the table of the sampler.
+///
+/// @return 1 on success, 0 if memory allocation failed.
+uint8_t takeSample(Sampler* sampler, FrameStack* frames)
+{
+    uint32_t hash = hashFrames(frames);
+    uint32_t slot, index;
+    SampledStack* stack;
+
+    sampler->pending = 0;
+    sampler->countdown = sampler->interval * SAMPLER_INSTRUCTIONS_PER_MICROSECOND;
+    sampler->sampleCount++;
+
+    if (sampler->stackCount > 0)
+    {
+        for (slot = hash & (sampler->stackCapacity - 1); sampler->stacks[slot];
+             slot = (slot + 1) & (sampler->stackCapacity - 1))
+        {
+            if (isSameStack(sampler->stacks[slot], hash, frames))
+            {
+                sampler->stacks[slot]->count++;
+                return 1;
+            }
+        }
+    }
+
+    // Keep the load factor of the table at most 1/2
+    if (2 * (sampler->stackCount + 1) > sampler->stackCapacity && !growSampledStackTable(sampler))
+        return 0;
+
+    stack = (SampledStack*)malloc(sizeof(SampledStack) + frames->frameCount * sizeof(SampledFrame));
+
+    if (!stack)
+        return 0;
+
+    stack->hash = hash;
+    stack->count = 1;
+    stack->depth = frames->frameCount;
+
+    for (index = 0; index < stack->depth; index++)
+        getSampledFrame(frames->frames + index, stack->frames + index);
+
+    slot = hash & (sampler->stackCapacity - 1);
+
+    while (sampler->stacks[slot])
+        slot = (slot + 1) & (sampler->stackCapacity - 1);
+
+    sampler->stacks[slot] = stack;
+    sampler->stackCount++;
+    return 1;
+}
+
+/// @brief Writes a frame as "package.Class.method:line", without the line if it is unknown.
+static void writeSampledFrame(FILE* file, SampledFrame* frame)
+{
+    cp_info* cpi = frame->jc->constantPool + frame->jc->thisClass - 1;
+    int32_t index;
+
+    cpi = frame->jc->constantPool + cpi->Class.name_index - 1;
+
+    for (index = 0; index < cpi->Utf8.length; index++)
+        fputc(cpi->Utf8.bytes[index] == '/' ? '.' : cpi->Utf8.bytes[index], file);
+
+    cpi = frame->jc->constantPool + frame->method->name_index - 1;
+    fprintf(file, ".%.*s", PRINT_UTF8(cpi));
+
+    if (frame->line >= 0)
+        fprintf(file, ":%d", frame->line);
+}
+
+/// @brief Orders stacks by their methods and lines, frame by frame, so
+/// stacks that are written the same way end up next to each other.
+static int compareStackLines(const void* a, const void* b)
+{
+    const SampledStack* first = *(const SampledStack* const*)a;
+    const SampledStack* second = *(const SampledStack* const*)b;
+    const SampledFrame* frame1, *frame2;
+    uint32_t index;
+
+    for (index = 0; index < first->depth && index < second->depth; index++)
+    {
+        frame1 = first->frames + index;
+        frame2 = second->frames + index;
+
+        if (frame1->method != frame2->method)
+            return (uintptr_t)frame1->method < (uintptr_t)frame2->method ? -1 : 1;
+
+        if (frame1->line != frame2->line)
+            return frame1->line < frame2->line ? -1 : 1;
+    }
+
+    return (first->depth > second->depth) - (first->depth < second->depth);
+}
+
+/// @brief Writes the stacks sampled as collapsed stacks, one line per stack,
+/// with its frames from the bottom to the top separated by ';', followed by
+/// a space and the number of samples of the stack.
+///
+/// The line of each frame is only looked up now. Stacks that only differ in
+/// the offsets of instructions of the same lines are written as one.
+/// Must be called while the classes of the JVM are still loaded.
+///
+/// @return 1 on success, 0 if the file couldn't be written.
+uint8_t writeCollapsedStacks(Sampler* sampler, const char* path)
+{
+    SampledStack** stacks = NULL;
+    SampledStack* stack;
+    uint32_t count = 0, index, frame;
+    uint64_t samples;
+    FILE* file;
+
+    if (sampler->stackCount)
+    {
+        stacks = (SampledStack**)malloc(sampler->stackCount * sizeof(SampledStack*));
+
+        if (!stacks)
+            return 0;
+    }
+
+    for (index = 0; index < sampler->stackCapacity; index++)
+    {
+        stack = sampler->stacks[index];
+
+        if (!stack || stack->depth == 0)
+            continue;
+
+        for (frame = 0; frame < stack->depth; frame++)
+        {
+            stack->frames[frame].line = getMethodLineNumber(stack->frames[frame].jc, stack->frames[frame].method,
+                                                            stack->frames[frame].offset);
+        }
+
+        stacks[count++] = stack;
+    }
+
+    qsort(stacks, count, sizeof(SampledStack*), compareStackLines);
+
+    file = fopen(path, "w");
+
+    for (index = 0; file && index < count; index++)
+    {
+        samples = stacks[index]->count;
+
+        while (index + 1 < count && !compareStackLines(stacks + index, stacks + index + 1))
+            samples += stacks[++index]->count;
+
+        for (frame = 0; frame < stacks[index]->depth; frame++)
+        {
+            if (frame > 0)
+                fputc(';', file);
+
+            writeSampledFrame(file, stacks[index]->frames + frame);
+        }
+
+        fprintf(file, " %llu\n", (unsigned long long)samples);
+    }
+
+    if (stacks)
+        free(stacks);
+
+    return file && fclose(file) == 0;
+}
@@ -0,0 +1,106 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+#include <signal.h>
+#include "framestack.h"
+
+// Samples are requested by a timer where SIGPROF exists,
+// otherwise after a number of instructions
+#ifdef SIGPROF
+    #define SAMPLER_USES_TIMER
+#endif
+
+/// @brief Default time between samples, in microseconds of processor time.
+#define SAMPLER_DEFAULT_INTERVAL 1000
+
+/// @brief Number of instructions executed between samples when
+/// there is no timer, for each microsecond of the interval.
+#define SAMPLER_INSTRUCTIONS_PER_MICROSECOND 100
+
+/// @brief A method being executed when a sample was taken.
+typedef struct SampledFrame
+{
+    JavaClass* jc;
+    method_info* method;
+
+    /// @brief Bytecode offset of the instruction being executed,
+    /// or -1 for native methods.
+    int32_t offset;
+
+    /// @brief Line of the instruction being executed, or -1 if it
+    /// is unknown. Only set when the samples are written.
+    int32_t line;
+} SampledFrame;
+
+/// @brief A distinct stack of frames that was sampled, and how many times.
+typedef struct SampledStack
+{
+    uint32_t hash;
+    uint64_t count;
+
+    /// @brief Number of frames, from the bottom of the stack to its top.
+    uint32_t depth;
+    SampledFrame frames[];
+} SampledStack;
+
+/// @brief Takes samples of the stack of frames of the JVM at regular intervals,
+/// counting how many times each distinct stack was seen.
+/// @see startSampler(), takeSample(), writeCollapsedStacks()
+typedef struct Sampler
+{
+    /// @brief Set when a sample should be taken before the next instruction.
+    volatile sig_atomic_t pending;
+
+    /// @brief Instructions left until the next sample, without a timer.
+    uint32_t countdown;
+
+    /// @brief Time between samples, in microseconds.
+    uint32_t interval;
+
+    /// @brief Number of samples taken.
+    uint64_t sampleCount;
+
+    /// @brief Open addressing hash table of the stacks sampled,
+    /// keyed by their frames.
+    SampledStack** stacks;
+    uint32_t stackCapacity;
+    uint32_t stackCount;
+} Sampler;
+
+/// @brief Tells if a sample should be taken before the next instruction.
+#ifdef SAMPLER_USES_TIMER
+    #define SAMPLE_DUE(sampler) ((sampler)->pending)
+#else
+    #define SAMPLE_DUE(sampler) (--(sampler)->countdown == 0)
+#endif // SAMPLER_USES_TIMER
+
+void initSampler(Sampler* sampler, uint32_t interval);
+uint8_t startSampler(Sampler* sampler);
+void stopSampler(Sampler* sampler);
+void freeSampler(Sampler* sampler);
+uint8_t takeSample(Sampler* sampler, FrameStack* frames);
+uint8_t writeCollapsedStacks(Sampler* sampler, const char* path);
+
+#endif // SAMPLER_H
+
+/// @defgroup sampler Sampler module
+///
+/// @brief Samples the methods being executed, to find where a
+/// program spends its time without measuring every instruction.
+///
+/// With the "-sample" option, a timer raises SIGPROF at regular intervals of
+/// processor time, and its handler only sets a flag. executeFrame() then runs
+/// frames with a loop that checks the flag before each instruction, so samples
+/// are always taken between two instructions, when the stack of frames is
+/// consistent (see takeSample()). Samples of time spent in natives, class
+/// loading or garbage collection are taken right after them. Where SIGPROF
+/// isn't available, a sample is taken every few instructions instead.
+///
+/// Each sample records the class, method and bytecode offset of every frame.
+/// Equal stacks are counted together, and only at exit are they written as
+/// collapsed stacks, one line per stack, like "Main.main:5;Main.run:12 42",
+/// with line numbers taken from the LineNumberTable of each method. The file
+/// can be given to flame graph tools.
+///
+/// @see sampler.c
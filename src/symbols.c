@@ -0,0 +1,166 @@
+#include <string.h>
+#include <pthread.h>
+#include "symbols.h"
+#include "debugging.h"
+
+/// @brief Initial number of slots of the symbol table. Must be a power of two.
+#define SYMBOL_TABLE_INITIAL_CAPACITY 256
+
+static const Symbol** symbolTable = NULL;
+static uint32_t symbolTableCapacity = 0;
+static uint32_t symbolCount = 0;
+
+// Classes can be opened by loader threads, which intern their strings
+static pthread_mutex_t symbolLock = PTHREAD_MUTEX_INITIALIZER;
+
+/// @brief Calculates the hash of a UTF-8 string (32 bit FNV-1a).
+/// @param const uint8_t* utf8_bytes - pointer to the UTF-8 bytes
+/// @param int32_t utf8_len - length of the UTF-8 string
+/// @return The hash of the string.
+uint32_t hashUTF8(const uint8_t* utf8_bytes, int32_t utf8_len)
+{
+    uint32_t hash = 2166136261u;
+
+    while (utf8_len-- > 0)
+    {
+        hash ^= *utf8_bytes++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/// @brief Finds the slot of the symbol table where a string is stored,
+/// or the empty slot where it should be inserted.
+static uint32_t findSymbolSlot(const uint8_t* utf8_bytes, int32_t utf8_len, uint32_t hash)
+{
+    uint32_t mask = symbolTableCapacity - 1;
+    uint32_t slot = hash & mask;
+    const Symbol* symbol;
+
+    while ((symbol = symbolTable[slot]) != NULL)
+    {
+        if (symbol->hash == hash && symbol->length == utf8_len &&
+            memcmp(symbol->bytes, utf8_bytes, utf8_len) == 0)
+        {
+            break;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/// @brief Doubles the capacity of the symbol table, or allocates
+/// it if it is empty.
+/// @return 1 on success, 0 if memory allocation failed.
+static uint8_t growSymbolTable(void)
+{
+    uint32_t newCapacity = symbolTableCapacity ? 2 * symbolTableCapacity : SYMBOL_TABLE_INITIAL_CAPACITY;
+    const Symbol** newTable = (const Symbol**)malloc(newCapacity * sizeof(Symbol*));
+    const Symbol** oldTable = symbolTable;
+    uint32_t oldCapacity = symbolTableCapacity;
+    uint32_t index;
+
+    if (!newTable)
+        return 0;
+
+    memset(newTable, 0, newCapacity * sizeof(Symbol*));
+
+    symbolTable = newTable;
+    symbolTableCapacity = newCapacity;
+
+    for (index = 0; index < oldCapacity; index++)
+    {
+        if (oldTable[index])
+            symbolTable[findSymbolSlot(oldTable[index]->bytes, oldTable[index]->length, oldTable[index]->hash)] = oldTable[index];
+    }
+
+    if (oldTable)
+        free(oldTable);
+
+    return 1;
+}
+
+/// @brief Gets the unique symbol of a UTF-8 string, creating it
+/// if this string hasn't been interned yet.
+/// @param const uint8_t* utf8_bytes - pointer to the UTF-8 bytes
+/// @param int32_t utf8_len - length of the UTF-8 string
+/// @return The symbol of the string, or NULL if memory allocation failed.
+/// @see findSymbol()
+const Symbol* internSymbol(const uint8_t* utf8_bytes, int32_t utf8_len)
+{
+    uint32_t hash = hashUTF8(utf8_bytes, utf8_len);
+    uint32_t slot;
+    Symbol* symbol = NULL;
+
+    pthread_mutex_lock(&symbolLock);
+
+    // Keep the load factor of the table at most 1/2
+    if (2 * (symbolCount + 1) > symbolTableCapacity && !growSymbolTable())
+        goto done;
+
+    slot = findSymbolSlot(utf8_bytes, utf8_len, hash);
+
+    if (symbolTable[slot])
+    {
+        symbol = (Symbol*)symbolTable[slot];
+        goto done;
+    }
+
+    symbol = (Symbol*)malloc(sizeof(Symbol) + utf8_len);
+
+    if (!symbol)
+        goto done;
+
+    symbol->hash = hash;
+    symbol->length = utf8_len;
+    memcpy(symbol->bytes, utf8_bytes, utf8_len);
+
+    symbolTable[slot] = symbol;
+    symbolCount++;
+
+done:
+    pthread_mutex_unlock(&symbolLock);
+    return symbol;
+}
+
+/// @brief Gets the symbol of a UTF-8 string without creating it.
+/// @param const uint8_t* utf8_bytes - pointer to the UTF-8 bytes
+/// @param int32_t utf8_len - length of the UTF-8 string
+/// @return The symbol of the string, or NULL if it hasn't been interned.
+/// @see internSymbol()
+const Symbol* findSymbol(const uint8_t* utf8_bytes, int32_t utf8_len)
+{
+    const Symbol* symbol = NULL;
+
+    pthread_mutex_lock(&symbolLock);
+
+    if (symbolCount > 0)
+        symbol = symbolTable[findSymbolSlot(utf8_bytes, utf8_len, hashUTF8(utf8_bytes, utf8_len))];
+
+    pthread_mutex_unlock(&symbolLock);
+    return symbol;
+}
+
+/// @brief Releases all symbols and the symbol table.
+///
+/// All pointers to symbols become invalid after this call.
+void freeSymbols(void)
+{
+    uint32_t index;
+
+    for (index = 0; index < symbolTableCapacity; index++)
+    {
+        if (symbolTable[index])
+            free((void*)symbolTable[index]);
+    }
+
+    if (symbolTable)
+        free(symbolTable);
+
+    symbolTable = NULL;
+    symbolTableCapacity = 0;
+    symbolCount = 0;
+}
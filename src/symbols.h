@@ -0,0 +1,46 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <stdint.h>
+
+/// @brief An interned UTF-8 string.
+///
+/// There is only one Symbol for each distinct sequence of bytes,
+/// so two symbols are equal if and only if their pointers are equal.
+/// @see internSymbol(), findSymbol()
+typedef struct Symbol
+{
+    /// @brief Hash of the bytes of the symbol, used to index tables
+    /// keyed by symbols without hashing the string again.
+    uint32_t hash;
+
+    /// @brief Length of the UTF-8 string, in bytes.
+    int32_t length;
+
+    /// @brief The UTF-8 bytes of the symbol. They are not null terminated.
+    uint8_t bytes[];
+} Symbol;
+
+/// @brief Hash of a pair of symbols, such as the name and the descriptor
+/// of a member of a class. It only depends on the bytes of the symbols.
+#define HASH_SYMBOL_PAIR(first, second) ((first)->hash * 31u + (second)->hash)
+
+uint32_t hashUTF8(const uint8_t* utf8_bytes, int32_t utf8_len);
+const Symbol* internSymbol(const uint8_t* utf8_bytes, int32_t utf8_len);
+const Symbol* findSymbol(const uint8_t* utf8_bytes, int32_t utf8_len);
+void freeSymbols(void);
+
+#endif // SYMBOLS_H
+
+/// @defgroup symbols Symbols module
+///
+/// @brief Keeps a single copy of each UTF-8 string used as a name
+/// by the JVM, so names can be compared by pointer.
+///
+/// The symbols are stored in a process-wide open-addressing hash table,
+/// which grows as needed and is protected by a lock, as loader threads
+/// intern the strings of the classes they open (see @ref loaderpool).
+/// Symbols live until freeSymbols() is called, which must only happen once
+/// nothing refers to them anymore.
+///
+/// @see symbols.c
@@ -0,0 +1,346 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tracer.h"
+#include "profiler.h"
+#include "debugging.h"
+
+/// @brief Identifies trace files, followed by TRACE_FILE_VERSION.
+#define TRACE_FILE_MAGIC "JVMTRACE"
+#define TRACE_FILE_VERSION 1
+
+uint32_t traceCategories = 0;
+
+/// @brief List of the buffers of all threads that recorded events.
+/// Buffers are added with an atomic exchange, so threads don't wait for each other.
+static TraceBuffer* traceBuffers = NULL;
+
+/// @brief Number of threads that recorded events so far.
+static uint32_t traceThreadCount = 0;
+
+/// @brief Number of events that couldn't be recorded because
+/// a thread couldn't allocate its buffer.
+static uint64_t traceLostEvents = 0;
+
+/// @brief Buffer of the calling thread, created when it records its first event.
+static __thread TraceBuffer* threadTraceBuffer = NULL;
+
+/// @brief Set if the buffer of the calling thread couldn't be created,
+/// so it isn't tried again for every event.
+static __thread uint8_t threadTraceFailed = 0;
+
+static const struct
+{
+    const char* name;
+    uint32_t category;
+} traceCategoryNames[] = {
+    {"method", TRACE_CATEGORY_METHOD},
+    {"native", TRACE_CATEGORY_NATIVE},
+    {"load", TRACE_CATEGORY_CLASS_LOAD},
+    {"init", TRACE_CATEGORY_CLASS_INIT},
+    {"alloc", TRACE_CATEGORY_ALLOCATION},
+    {"all", TRACE_CATEGORY_ALL}
+};
+
+/// @brief Gets the categories named in a list separated by commas, like "method,alloc".
+/// The names are "method", "native", "load", "init", "alloc" and "all".
+/// @return The categories, or 0 if a name is unknown.
+uint32_t parseTraceCategories(const char* list)
+{
+    uint32_t categories = 0;
+    size_t length, index;
+    const char* end;
+
+    while (*list)
+    {
+        end = strchr(list, ',');
+        length = end ? (size_t)(end - list) : strlen(list);
+
+        for (index = 0; index < sizeof(traceCategoryNames) / sizeof(*traceCategoryNames); index++)
+        {
+            if (strlen(traceCategoryNames[index].name) == length && !strncmp(traceCategoryNames[index].name, list, length))
+                break;
+        }
+
+        if (index == sizeof(traceCategoryNames) / sizeof(*traceCategoryNames))
+            return 0;
+
+        categories |= traceCategoryNames[index].category;
+        list += length + (end != NULL);
+    }
+
+    return categories;
+}
+
+/// @brief Enables the tracepoints of some categories.
+/// @param uint32_t categories - combination of TraceCategory
+void startTracing(uint32_t categories)
+{
+    __atomic_store_n(&traceCategories, categories, __ATOMIC_RELAXED);
+}
+
+/// @brief Disables all tracepoints. The events recorded are kept.
+void stopTracing(void)
+{
+    __atomic_store_n(&traceCategories, 0, __ATOMIC_RELAXED);
+}
+
+/// @brief Creates the buffer of the calling thread and adds it to the list of buffers.
+/// @return The buffer, or NULL if memory allocation failed.
+static TraceBuffer* newThreadTraceBuffer(void)
+{
+    TraceBuffer* buffer = (TraceBuffer*)malloc(sizeof(TraceBuffer) + TRACE_BUFFER_EVENTS * sizeof(TraceEvent));
+
+    if (!buffer)
+    {
+        threadTraceFailed = 1;
+        return NULL;
+    }
+
+    buffer->thread = __sync_fetch_and_add(&traceThreadCount, 1);
+    buffer->capacity = TRACE_BUFFER_EVENTS;
+    buffer->recorded = 0;
+
+    do
+    {
+        buffer->next = __atomic_load_n(&traceBuffers, __ATOMIC_RELAXED);
+    } while (!__sync_bool_compare_and_swap(&traceBuffers, buffer->next, buffer));
+
+    threadTraceBuffer = buffer;
+    return buffer;
+}
+
+/// @brief Records an event in the buffer of the calling thread.
+/// @see TRACE_EVENT(), TraceEventType
+void recordTraceEvent(uint8_t type, uint8_t detail, uint32_t value,
+                      const Symbol* symbol1, const Symbol* symbol2, const Symbol* symbol3)
+{
+    TraceBuffer* buffer = threadTraceBuffer;
+    TraceEvent* event;
+
+    if (!buffer && (threadTraceFailed || !(buffer = newThreadTraceBuffer())))
+    {
+        __sync_fetch_and_add(&traceLostEvents, 1);
+        return;
+    }
+
+    event = buffer->events + (buffer->recorded & (buffer->capacity - 1));
+    event->time = getProfilerTicks();
+    event->type = type;
+    event->detail = detail;
+    event->value = value;
+    event->symbols[0] = symbol1;
+    event->symbols[1] = symbol2;
+    event->symbols[2] = symbol3;
+    buffer->recorded++;
+}
+
+/// @brief Records an event about a method, with the names of its
+/// class, of the method and of its descriptor.
+/// @see TRACE_METHOD_EVENT()
+void recordMethodTraceEvent(uint8_t type, uint8_t detail, JavaClass* jc, method_info* method)
+{
+    cp_info* className = jc->constantPool + jc->thisClass - 1;
+    className = jc->constantPool + className->Class.name_index - 1;
+
+    recordTraceEvent(type, detail, 0, className->Utf8.symbol, jc->constantPool[method->name_index - 1].Utf8.symbol,
+                     jc->constantPool[method->descriptor_index - 1].Utf8.symbol);
+}
+
+/// @brief Gets the ticks elapsed since \c startTicks, as stored in the value of an event.
+uint32_t getTraceDuration(uint64_t startTicks)
+{
+    uint64_t elapsed = getProfilerTicks() - startTicks;
+    return elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+}
+
+static void writeTraceU32(FILE* file, uint32_t value)
+{
+    uint8_t bytes[4] = {value, value >> 8, value >> 16, value >> 24};
+    fwrite(bytes, 1, sizeof(bytes), file);
+}
+
+static void writeTraceU64(FILE* file, uint64_t value)
+{
+    writeTraceU32(file, (uint32_t)value);
+    writeTraceU32(file, (uint32_t)(value >> 32));
+}
+
+static int compareSymbolAddresses(const void* a, const void* b)
+{
+    uintptr_t first = (uintptr_t)*(const Symbol* const*)a;
+    uintptr_t second = (uintptr_t)*(const Symbol* const*)b;
+
+    return (first > second) - (first < second);
+}
+
+/// @brief Gets the number a symbol is written as, which is its index
+/// in the sorted list of symbols plus one, or 0 for NULL.
+static uint32_t getTraceSymbolNumber(const Symbol** symbols, uint32_t symbolCount, const Symbol* symbol)
+{
+    uint32_t low = 0, high = symbolCount;
+    uint32_t middle;
+
+    if (!symbol)
+        return 0;
+
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+
+        if ((uintptr_t)symbols[middle] < (uintptr_t)symbol)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low + 1;
+}
+
+/// @brief Gets the first stored event of a buffer and how many events it holds.
+static TraceEvent* getOldestTraceEvent(TraceBuffer* buffer, uint32_t* outCount)
+{
+    if (buffer->recorded <= buffer->capacity)
+    {
+        *outCount = (uint32_t)buffer->recorded;
+        return buffer->events;
+    }
+
+    *outCount = buffer->capacity;
+    return buffer->events + (buffer->recorded & (buffer->capacity - 1));
+}
+
+/// @brief Writes the events of all threads to a trace file.
+/// @param const char* path - path of the file
+/// @param [out] uint64_t* outEventCount - if not NULL, receives the number of events written
+///
+/// The file is little endian. It starts with TRACE_FILE_MAGIC, the version, the unit of
+/// the times (see getProfilerTickUnit()) and the number of events that were lost because
+/// a thread couldn't allocate its buffer. Then come the symbols referred to by the events,
+/// each one as its length and its bytes, and finally the buffer of each thread, with the
+/// number of the thread, the number of events it recorded, the number of events stored,
+/// and the events from the oldest to the newest. Each event has its time, type, detail,
+/// value and three symbol numbers (see getTraceSymbolNumber()).
+///
+/// Must be called when no other thread records events.
+/// @return 1 on success, 0 if the file couldn't be written.
+uint8_t writeTrace(const char* path, uint64_t* outEventCount)
+{
+    const Symbol** symbols;
+    const char* unit = getProfilerTickUnit();
+    uint32_t symbolCount = 0, bufferCount = 0, eventCount, index, slot, distinct = 0;
+    uint64_t eventTotal = 0;
+    TraceBuffer* buffer;
+    TraceEvent* event;
+    FILE* file;
+
+    for (buffer = traceBuffers; buffer; buffer = buffer->next)
+    {
+        getOldestTraceEvent(buffer, &eventCount);
+        symbolCount += 3 * eventCount;
+        bufferCount++;
+    }
+
+    symbols = (const Symbol**)malloc((symbolCount ? symbolCount : 1) * sizeof(const Symbol*));
+
+    if (!symbols)
+        return 0;
+
+    // Lists the distinct symbols, sorted by address so their numbers are found by binary search
+    symbolCount = 0;
+
+    for (buffer = traceBuffers; buffer; buffer = buffer->next)
+    {
+        getOldestTraceEvent(buffer, &eventCount);
+
+        for (index = 0; index < eventCount; index++)
+        {
+            for (slot = 0; slot < 3; slot++)
+            {
+                if (buffer->events[index].symbols[slot])
+                    symbols[symbolCount++] = buffer->events[index].symbols[slot];
+            }
+        }
+    }
+
+    qsort(symbols, symbolCount, sizeof(const Symbol*), compareSymbolAddresses);
+
+    for (index = 0; index < symbolCount; index++)
+    {
+        if (distinct == 0 || symbols[distinct - 1] != symbols[index])
+            symbols[distinct++] = symbols[index];
+    }
+
+    file = fopen(path, "wb");
+
+    if (!file)
+    {
+        free(symbols);
+        return 0;
+    }
+
+    fwrite(TRACE_FILE_MAGIC, 1, 8, file);
+    writeTraceU32(file, TRACE_FILE_VERSION);
+    writeTraceU32(file, (uint32_t)strlen(unit));
+    fwrite(unit, 1, strlen(unit), file);
+    writeTraceU64(file, traceLostEvents);
+    writeTraceU32(file, distinct);
+
+    for (index = 0; index < distinct; index++)
+    {
+        writeTraceU32(file, (uint32_t)symbols[index]->length);
+        fwrite(symbols[index]->bytes, 1, symbols[index]->length, file);
+    }
+
+    writeTraceU32(file, bufferCount);
+
+    for (buffer = traceBuffers; buffer; buffer = buffer->next)
+    {
+        event = getOldestTraceEvent(buffer, &eventCount);
+        writeTraceU32(file, buffer->thread);
+        writeTraceU64(file, buffer->recorded);
+        writeTraceU32(file, eventCount);
+        eventTotal += eventCount;
+
+        for (index = 0; index < eventCount; index++)
+        {
+            writeTraceU64(file, event->time);
+            fputc(event->type, file);
+            fputc(event->detail, file);
+            writeTraceU32(file, event->value);
+
+            for (slot = 0; slot < 3; slot++)
+                writeTraceU32(file, getTraceSymbolNumber(symbols, distinct, event->symbols[slot]));
+
+            // The events wrap around the end of the ring buffer
+            if (++event == buffer->events + buffer->capacity)
+                event = buffer->events;
+        }
+    }
+
+    free(symbols);
+
+    if (outEventCount)
+        *outEventCount = eventTotal;
+
+    return fclose(file) == 0;
+}
+
+/// @brief Frees the buffers of all threads. Must be called
+/// when no other thread records events.
+void freeTrace(void)
+{
+    TraceBuffer* buffer;
+
+    while (traceBuffers)
+    {
+        buffer = traceBuffers;
+        traceBuffers = buffer->next;
+        free(buffer);
+    }
+
+    threadTraceBuffer = NULL;
+    threadTraceFailed = 0;
+    traceThreadCount = 0;
+    traceLostEvents = 0;
+}
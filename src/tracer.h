@@ -0,0 +1,145 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <stdint.h>
+#include "javaclass.h"
+#include "symbols.h"
+
+/// @brief Categories of trace events, which are enabled independently.
+/// @see parseTraceCategories()
+enum TraceCategory
+{
+    TRACE_CATEGORY_METHOD = 1 << 0,
+    TRACE_CATEGORY_NATIVE = 1 << 1,
+    TRACE_CATEGORY_CLASS_LOAD = 1 << 2,
+    TRACE_CATEGORY_CLASS_INIT = 1 << 3,
+    TRACE_CATEGORY_ALLOCATION = 1 << 4,
+    TRACE_CATEGORY_ALL = (1 << 5) - 1
+};
+
+/// @brief Types of trace events. The values are stored in trace files,
+/// so they must not change.
+enum TraceEventType
+{
+    /// @brief A method starts running. Symbols: class, method, descriptor.
+    TRACE_METHOD_ENTER = 1,
+
+    /// @brief A method stops running. Symbols: class, method, descriptor.
+    /// Detail: 1 if it returned, 0 if it failed or threw an exception.
+    TRACE_METHOD_EXIT = 2,
+
+    /// @brief A native or simulated method is invoked. Symbols: class, method, descriptor.
+    TRACE_NATIVE_CALL = 3,
+
+    /// @brief A class file was opened. Symbols: class. Detail: 1 if it could
+    /// be parsed, otherwise 0. Value: ticks taken to open it.
+    TRACE_CLASS_LOAD = 4,
+
+    /// @brief A class was initialized. Symbols: class. Detail: 1 on success,
+    /// otherwise 0. Value: ticks taken, including its <clinit> method.
+    TRACE_CLASS_INIT = 5,
+
+    /// @brief An object was created. Symbols: class, for class instances.
+    /// Detail: its ReferenceType. Value: size of its heap block, in bytes.
+    TRACE_ALLOCATION = 6
+};
+
+/// @brief Number of events kept by the buffer of each thread.
+/// Must be a power of two.
+#define TRACE_BUFFER_EVENTS (64 * 1024)
+
+/// @brief An event recorded by a tracepoint.
+typedef struct TraceEvent
+{
+    /// @brief Time of the event, in ticks.
+    /// @see getProfilerTicks()
+    uint64_t time;
+
+    /// @brief One of TraceEventType.
+    uint8_t type;
+
+    uint8_t detail;
+    uint32_t value;
+
+    /// @brief Names related to the event, or NULL.
+    const Symbol* symbols[3];
+} TraceEvent;
+
+/// @brief Ring buffer of the events recorded by a thread.
+///
+/// Only its thread writes to it, so events are recorded without locks.
+/// When the buffer is full, the oldest events are overwritten.
+typedef struct TraceBuffer
+{
+    /// @brief Next buffer of the list of the buffers of all threads.
+    struct TraceBuffer* next;
+
+    /// @brief Number of the thread, in the order threads recorded their first event.
+    uint32_t thread;
+
+    /// @brief Number of events the buffer holds. A power of two.
+    uint32_t capacity;
+
+    /// @brief Number of events recorded, including the ones that were overwritten.
+    uint64_t recorded;
+
+    TraceEvent events[];
+} TraceBuffer;
+
+/// @brief Categories of the events that are recorded, a combination of TraceCategory.
+/// Loader threads read it while the main thread may change it, so it is only
+/// accessed atomically, with relaxed loads that cost as much as plain ones.
+extern uint32_t traceCategories;
+
+// Building with NO_TRACEPOINTS removes all tracepoints
+#ifdef NO_TRACEPOINTS
+    #define TRACING(category) 0
+#else
+    #define TRACING(category) \
+        __builtin_expect((__atomic_load_n(&traceCategories, __ATOMIC_RELAXED) & (category)) != 0, 0)
+#endif // NO_TRACEPOINTS
+
+/// @brief Records an event if its category is enabled. The arguments
+/// are only evaluated if it is.
+#define TRACE_EVENT(category, type, detail, value, symbol1, symbol2, symbol3) \
+    if (TRACING(category)) \
+        recordTraceEvent(type, detail, value, symbol1, symbol2, symbol3);
+
+/// @brief Records an event about a method if its category is enabled.
+#define TRACE_METHOD_EVENT(category, type, detail, jc, method) \
+    if (TRACING(category)) \
+        recordMethodTraceEvent(type, detail, jc, method);
+
+uint32_t parseTraceCategories(const char* list);
+void startTracing(uint32_t categories);
+void stopTracing(void);
+void recordTraceEvent(uint8_t type, uint8_t detail, uint32_t value,
+                      const Symbol* symbol1, const Symbol* symbol2, const Symbol* symbol3);
+void recordMethodTraceEvent(uint8_t type, uint8_t detail, JavaClass* jc, method_info* method);
+uint32_t getTraceDuration(uint64_t startTicks);
+uint8_t writeTrace(const char* path, uint64_t* outEventCount);
+void freeTrace(void);
+
+#endif // TRACER_H
+
+/// @defgroup tracer Tracer module
+///
+/// @brief Records what the JVM does as a sequence of timestamped events,
+/// cheaply enough to leave the tracepoints in release builds.
+///
+/// Tracepoints are placed where methods start and stop running, natives are
+/// invoked, class files are opened, classes are initialized and objects are
+/// created. Each one is a TRACE_EVENT() or TRACE_METHOD_EVENT(), which only tests a
+/// bit of ::traceCategories unless its category was enabled with the "-traceevents"
+/// option, so a disabled tracepoint costs a branch that is always predicted. Building
+/// with NO_TRACEPOINTS removes them altogether.
+///
+/// Events are written in a binary form to a ring buffer of the thread that
+/// records them, so loader threads (see @ref loaderpool) trace the classes
+/// they open without taking locks. Names are kept as symbols, which live
+/// until the end of the program. At exit, when no other thread is running,
+/// the events of all threads are written to the file given with the "-trace"
+/// option, with the names they refer to (see writeTrace()). The file is
+/// decoded offline by tools/tracedump.py.
+///
+/// @see tracer.c
@@ -225,7 +225,7 @@ char checkClassNameFileNameMatch(JavaClass* jc, const char* classFilePath)
 ///
 /// @return The function returns 1 if it the string is indeed
 /// a valid Java Identifier, otherwise zero.
-char isValidJavaIdentifier(uint8_t* utf8_bytes, int32_t utf8_len, uint8_t isClassIdentifier)
+char isValidJavaIdentifier(const uint8_t* utf8_bytes, int32_t utf8_len, uint8_t isClassIdentifier)
 {
     uint32_t utf8_char;
     uint8_t used_bytes;
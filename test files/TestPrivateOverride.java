@@ -0,0 +1,36 @@
+class TestPrivateOverride {
+
+	static class A {
+
+		private void foo() {
+			System.out.println("A.foo private");
+		}
+
+		public void bar() {
+			foo();
+		}
+	}
+
+	static class B extends A {
+
+		public void foo() {
+			System.out.println("B.foo");
+		}
+	}
+
+	static class C extends B {
+
+		public void foo() {
+			System.out.println("C.foo");
+		}
+	}
+
+	public static void main(String[] args) {
+		B b = new B();
+		b.foo();
+		b = new C();
+		b.foo();
+		b.bar();
+	}
+
+}
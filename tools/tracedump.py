@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+# Decodes a trace file written by the "-trace" option of the JVM.
+#
+# By default, prints the events of all threads merged by time, one per
+# line, with the time relative to the first event, the number of the
+# thread and the event. Method calls are indented by their depth in the
+# stack of their thread. With "--summary", prints how many events of each
+# type were recorded instead, and the methods, classes and types that
+# appear the most in them.
+#
+# Usage: python3 tools/tracedump.py <trace file> [--summary]
+
+import collections
+import struct
+import sys
+
+MAGIC = b'JVMTRACE'
+VERSION = 1
+
+METHOD_ENTER, METHOD_EXIT, NATIVE_CALL, CLASS_LOAD, CLASS_INIT, ALLOCATION = range(1, 7)
+
+EVENT_NAMES = {
+    METHOD_ENTER: 'enter',
+    METHOD_EXIT: 'exit',
+    NATIVE_CALL: 'native',
+    CLASS_LOAD: 'load',
+    CLASS_INIT: 'init',
+    ALLOCATION: 'alloc',
+}
+
+# Names of the values of ReferenceType, the detail of allocations
+REFERENCE_TYPES = ['array', 'instance', 'object array', 'string']
+
+EVENT_FORMAT = struct.Struct('<QBBI3I')
+SUMMARY_ROWS = 20
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.offset = 0
+
+    def take(self, size):
+        if self.offset + size > len(self.data):
+            raise ValueError('truncated trace file')
+        chunk = self.data[self.offset:self.offset + size]
+        self.offset += size
+        return chunk
+
+    def u32(self):
+        return struct.unpack('<I', self.take(4))[0]
+
+    def u64(self):
+        return struct.unpack('<Q', self.take(8))[0]
+
+
+def read_trace(path):
+    """Returns the unit of times, the number of events lost, the symbols and
+    the threads, each one as (thread number, events recorded, events)."""
+    with open(path, 'rb') as f:
+        reader = Reader(f.read())
+
+    if reader.take(8) != MAGIC:
+        raise ValueError('not a trace file')
+
+    version = reader.u32()
+    if version != VERSION:
+        raise ValueError('unsupported trace version %d' % version)
+
+    unit = reader.take(reader.u32()).decode()
+    lost = reader.u64()
+
+    # Symbol number 0 is "no symbol"
+    symbols = [None]
+    for _ in range(reader.u32()):
+        symbols.append(reader.take(reader.u32()).decode('utf-8', 'replace'))
+
+    threads = []
+    for _ in range(reader.u32()):
+        thread = reader.u32()
+        recorded = reader.u64()
+        events = []
+        for _ in range(reader.u32()):
+            time, kind, detail, value, s1, s2, s3 = EVENT_FORMAT.unpack(reader.take(EVENT_FORMAT.size))
+            events.append((time, thread, kind, detail, value, symbols[s1], symbols[s2], symbols[s3]))
+        threads.append((thread, recorded, events))
+
+    return unit, lost, symbols, threads
+
+
+def class_name(name):
+    return name.replace('/', '.') if name else '?'
+
+
+def method_name(event):
+    return '%s.%s%s' % (class_name(event[5]), event[6], event[7])
+
+
+def describe(event, unit):
+    time, thread, kind, detail, value = event[:5]
+
+    if kind in (METHOD_ENTER, METHOD_EXIT):
+        text = method_name(event)
+        return text + (' (failed)' if kind == METHOD_EXIT and not detail else '')
+    if kind == NATIVE_CALL:
+        return method_name(event) + ('' if detail else ' (not implemented)')
+    if kind in (CLASS_LOAD, CLASS_INIT):
+        return '%s, %d %s%s' % (class_name(event[5]), value, unit, '' if detail else ' (failed)')
+    if kind == ALLOCATION:
+        kind_name = REFERENCE_TYPES[detail] if detail < len(REFERENCE_TYPES) else 'type %d' % detail
+        return '%s, %d bytes' % (class_name(event[5]) if event[5] else kind_name, value)
+    return 'unknown event %d' % kind
+
+
+def print_events(unit, threads):
+    events = sorted((event for _, _, thread_events in threads for event in thread_events), key=lambda e: e[0])
+    depths = collections.defaultdict(int)
+    start = events[0][0] if events else 0
+
+    for event in events:
+        thread, kind = event[1], event[2]
+
+        if kind == METHOD_EXIT:
+            depths[thread] = max(depths[thread] - 1, 0)
+
+        print('%14d  #%-3d %-7s %s%s' % (event[0] - start, thread, EVENT_NAMES.get(kind, '?'),
+                                           '  ' * depths[thread], describe(event, unit)))
+
+        if kind == METHOD_ENTER:
+            depths[thread] += 1
+
+
+def print_summary(unit, threads):
+    counts = collections.Counter()
+    methods = collections.Counter()
+    natives = collections.Counter()
+    allocations = collections.Counter()
+    allocated_bytes = collections.Counter()
+    load_ticks = collections.Counter()
+
+    for _, _, events in threads:
+        for event in events:
+            kind = event[2]
+            counts[kind] += 1
+            if kind == METHOD_ENTER:
+                methods[method_name(event)] += 1
+            elif kind == NATIVE_CALL:
+                natives[method_name(event)] += 1
+            elif kind == ALLOCATION:
+                name = class_name(event[5]) if event[5] else REFERENCE_TYPES[event[3]]
+                allocations[name] += 1
+                allocated_bytes[name] += event[4]
+            elif kind in (CLASS_LOAD, CLASS_INIT):
+                load_ticks['%s %s' % (EVENT_NAMES[kind], class_name(event[5]))] += event[4]
+
+    for kind, name in sorted(EVENT_NAMES.items()):
+        print('%14d %s events' % (counts[kind], name))
+
+    for title, counter in (('method calls', methods), ('native calls', natives), ('allocations', allocations)):
+        if counter:
+            print('\n%14s  %s' % ('count', title))
+            for name, count in counter.most_common(SUMMARY_ROWS):
+                extra = ', %d bytes' % allocated_bytes[name] if counter is allocations else ''
+                print('%14d  %s%s' % (count, name, extra))
+
+    if load_ticks:
+        print('\n%14s  %s' % (unit, 'class loads and initializations'))
+        for name, ticks in load_ticks.most_common(SUMMARY_ROWS):
+            print('%14d  %s' % (ticks, name))
+
+
+def main():
+    args = [arg for arg in sys.argv[1:] if not arg.startswith('--')]
+    if len(args) != 1:
+        print('Usage: python3 tools/tracedump.py <trace file> [--summary]')
+        return 1
+
+    unit, lost, _, threads = read_trace(args[0])
+
+    for thread, recorded, events in sorted(threads):
+        if recorded > len(events):
+            print('Thread #%d: only the last %d of %d events were kept.' % (thread, len(events), recorded))
+
+    if lost:
+        print('%d events were lost.' % lost)
+
+    if '--summary' in sys.argv:
+        print_summary(unit, threads)
+    else:
+        print_events(unit, threads)
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())